@@ -0,0 +1,76 @@
+/*
+ * Copyright (c) 2012-2013 Akihiro Kaneda.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   1.Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   2.Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ *   3.Neither the name of the Monochrome Soft nor the names of its contributors
+ *     may be used to endorse or promote products derived from this software
+ *     without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+/*!
+ @file AKAdController.h
+ @brief 広告管理
+
+ 広告バナーの読み込みと表示位置の変更を行うタイミングを管理するクラスを定義する。
+ */
+
+#import <UIKit/UIKit.h>
+#import "AKAdProvider.h"
+
+// 広告管理クラス
+@interface AKAdController : NSObject <AKAdProviderDelegate> {
+    /// 広告の取得処理
+    id<AKAdProvider> provider_;
+    /// 広告を配置するビュー
+    UIView *parentView_;
+    /// 読み込みと表示位置の変更を止めているかどうか
+    BOOL isSuspended_;
+    /// 読み込み中かどうか
+    BOOL isLoading_;
+    /// 広告を表示しているかどうか
+    BOOL isShown_;
+    /// 広告を表示するかどうか(止めている間に受けた読み込み結果)
+    BOOL shouldShow_;
+    /// 最後に読み込みを開始した時刻
+    CFAbsoluteTime lastLoadTime_;
+}
+
+/// 広告の取得処理
+@property (nonatomic, retain)id<AKAdProvider> provider;
+/// 読み込みと表示位置の変更を止めているかどうか
+@property (nonatomic, readonly)BOOL isSuspended;
+
+// シングルトンオブジェクト取得
++ (AKAdController *)sharedController;
+// 広告バナーの配置
+- (void)attachToViewController:(UIViewController *)viewController;
+// 広告バナーの削除
+- (void)detach;
+// 広告バナーを配置しているかどうか
+- (BOOL)isAttached;
+// 読み込みと表示位置の変更の停止/再開
+- (void)setSuspended:(BOOL)isSuspended;
+// 広告の読み込み
+- (void)loadIfNeeded;
+// 表示位置の反映
+- (void)applyLayout;
+@end
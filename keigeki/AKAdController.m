@@ -0,0 +1,311 @@
+/*
+ * Copyright (c) 2012-2013 Akihiro Kaneda.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   1.Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   2.Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ *   3.Neither the name of the Monochrome Soft nor the names of its contributors
+ *     may be used to endorse or promote products derived from this software
+ *     without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+/*!
+ @file AKAdController.m
+ @brief 広告管理
+
+ 広告バナーの読み込みと表示位置の変更を行うタイミングを管理するクラスを定義する。
+ */
+
+#import "AKAdController.h"
+#import "AKCommon.h"
+#import "AKGameScene.h"
+#import "SimpleAudioEngine.h"
+
+/// 広告を読み込み直す間隔(秒)
+static const NSTimeInterval kAKAdRefreshInterval = 60.0;
+#ifdef DEBUG
+/// 試験用の広告の読み込み時間を指定する設定のキー(ミリ秒)
+static NSString *kAKMockAdDelayKey = @"AKMockAdDelay";
+/// 試験用の広告の表示位置の変更でメインスレッドを止める時間を指定する設定のキー(ミリ秒)
+static NSString *kAKMockAdStallKey = @"AKMockAdStall";
+#endif
+
+/// シングルトンオブジェクト
+static AKAdController *sharedController_ = nil;
+
+/*!
+ @brief 広告管理クラス
+
+ ゲームプレイ中は広告の読み込みと表示位置の変更を止め、メニューやリザルト画面に戻ったときにまとめて行う。
+ 広告の処理はcocos2dの描画と同じメインスレッドで行われるため、ゲームプレイ中のフレーム時間に影響しないようにする。
+ 止めている間に受けた読み込み結果は表示するかどうかだけを記録し、再開時に反映する。
+ 読み込み中の広告は止められないため、結果の通知はゲームプレイ中にも届くが、表示位置の変更は行わない。
+ */
+@implementation AKAdController
+
+@synthesize provider = provider_;
+@synthesize isSuspended = isSuspended_;
+
+/*!
+ @brief シングルトンオブジェクト取得
+
+ シングルトンオブジェクトを取得する。
+ まだ生成されていない場合は生成を行う。
+ @return シングルトンオブジェクト
+ */
++ (AKAdController *)sharedController
+{
+    // 他のスレッドで同時に実行されないようにする
+    @synchronized(self) {
+
+        // シングルトンオブジェクトが生成されていない場合は生成する
+        if (!sharedController_) {
+            sharedController_ = [[AKAdController alloc] init];
+        }
+
+        return sharedController_;
+    }
+
+    return nil;
+}
+
+/*!
+ @brief インスタンス生成処理
+
+ インスタンス生成処理。
+ シングルトンのため、二重に生成された場合はアサーションを出力する。
+ */
++ (id)alloc
+{
+    // 他のスレッドで同時に実行されないようにする
+    @synchronized(self) {
+
+        NSAssert(sharedController_ == nil, @"Attempted to allocate a second instance of a singleton.");
+        return [super alloc];
+    }
+
+    return nil;
+}
+
+/*!
+ @brief インスタンス解放処理
+
+ 広告の取得処理を解放する。
+ */
+- (void)dealloc
+{
+    [self detach];
+
+    // スーパークラスの解放処理を実行する
+    [super dealloc];
+}
+
+/*!
+ @brief 広告バナーの配置
+
+ 広告の取得処理を生成し、ビューコントローラーのビューに広告バナーを配置する。
+ デバッグ版では、起動引数で試験用の広告の読み込み時間が指定されている場合はAdMobの代わりに試験用の取得処理を使用する。
+ 止めていない場合は広告の読み込みを開始する。
+ @param viewController 広告を配置するビューコントローラー
+ */
+- (void)attachToViewController:(UIViewController *)viewController
+{
+    // 配置済みの場合は取り除く
+    [self detach];
+
+    // 広告の取得処理を生成する
+#ifdef DEBUG
+    NSUserDefaults *userDefaults = [NSUserDefaults standardUserDefaults];
+    if ([userDefaults objectForKey:kAKMockAdDelayKey] != nil) {
+        self.provider = [[[AKMockAdProvider alloc] initWithLoadDelay:[userDefaults doubleForKey:kAKMockAdDelayKey] / 1000.0
+                                                         layoutStall:[userDefaults doubleForKey:kAKMockAdStallKey] / 1000.0]
+                         autorelease];
+    }
+    else {
+        self.provider = [[[AKAdMobProvider alloc] initWithRootViewController:viewController] autorelease];
+    }
+#else
+    self.provider = [[[AKAdMobProvider alloc] initWithRootViewController:viewController] autorelease];
+#endif
+    [self.provider setDelegate:self];
+
+    // ビュー階層に追加する
+    parentView_ = viewController.view;
+    [parentView_ addSubview:[self.provider adView]];
+
+    isLoading_ = NO;
+    isShown_ = NO;
+    shouldShow_ = NO;
+    lastLoadTime_ = 0.0;
+
+    // 広告を読み込む
+    [self loadIfNeeded];
+}
+
+/*!
+ @brief 広告バナーの削除
+
+ 広告バナーをビュー階層から取り除き、広告の取得処理を解放する。
+ */
+- (void)detach
+{
+    [[self.provider adView] removeFromSuperview];
+    [self.provider setDelegate:nil];
+    self.provider = nil;
+    parentView_ = nil;
+}
+
+/*!
+ @brief 広告バナーを配置しているかどうか
+
+ 広告バナーを配置しているかどうかを返す。
+ @return 配置している場合YES
+ */
+- (BOOL)isAttached
+{
+    return (self.provider != nil);
+}
+
+/*!
+ @brief 読み込みと表示位置の変更の停止/再開
+
+ ゲームプレイ中は止め、それ以外の画面では再開する。
+ 再開時は止めている間に受けた読み込み結果を反映し、読み込み直す間隔が経過していれば読み込みを開始する。
+ @param isSuspended 止める場合YES
+ */
+- (void)setSuspended:(BOOL)isSuspended
+{
+    if (isSuspended_ == isSuspended) {
+        return;
+    }
+
+    isSuspended_ = isSuspended;
+
+    AKLog(1, @"広告の更新%@", isSuspended_ ? @"停止" : @"再開");
+
+    if (!isSuspended_) {
+        [self applyLayout];
+        [self loadIfNeeded];
+    }
+}
+
+/*!
+ @brief 広告の読み込み
+
+ 止めていない場合で、読み込み中でなく、前回の読み込みから読み込み直す間隔が経過している場合は読み込みを開始する。
+ */
+- (void)loadIfNeeded
+{
+    if (isSuspended_ || isLoading_ || self.provider == nil) {
+        return;
+    }
+
+    // 前回の読み込みから間隔が経過していない場合は読み込まない
+    CFAbsoluteTime now = CFAbsoluteTimeGetCurrent();
+    if (lastLoadTime_ > 0.0 && now - lastLoadTime_ < kAKAdRefreshInterval) {
+        return;
+    }
+
+    isLoading_ = YES;
+    lastLoadTime_ = now;
+    [self.provider loadAd];
+}
+
+/*!
+ @brief 表示位置の反映
+
+ 止めていない場合、表示状態が変わっていれば広告バナーの表示位置を変更する。
+ */
+- (void)applyLayout
+{
+    if (isSuspended_ || isShown_ == shouldShow_ || self.provider == nil) {
+        return;
+    }
+
+    isShown_ = shouldShow_;
+    [self.provider showAd:isShown_ inBounds:parentView_.bounds];
+}
+
+/*!
+ @brief 広告読み込み成功時処理
+
+ 広告を表示するように記録し、止めていない場合は画面内に広告バナーを表示する。
+ @param provider 広告の取得処理
+ */
+- (void)adProviderDidReceiveAd:(id<AKAdProvider>)provider
+{
+    AKLog(1, @"広告読み込み成功:suspended=%d", isSuspended_);
+
+    isLoading_ = NO;
+    shouldShow_ = YES;
+    [self applyLayout];
+}
+
+/*!
+ @brief 広告読み込み失敗時処理
+
+ 広告を表示しないように記録し、止めていない場合は画面外に広告バナーを移動する。
+ @param provider 広告の取得処理
+ @param error エラー内容
+ */
+- (void)adProvider:(id<AKAdProvider>)provider didFailWithError:(NSError *)error
+{
+    AKLog(1, @"広告読み込み失敗:suspended=%d [%@]", isSuspended_, [error localizedDescription]);
+
+    isLoading_ = NO;
+    shouldShow_ = NO;
+    [self applyLayout];
+}
+
+/*!
+ @brief 広告フルスクリーン表示時処理
+
+ 広告がフルスクリーン表示される前に行う処理。
+ ゲームプレイ中の場合は一時停止状態にする。
+ @param provider 広告の取得処理
+ */
+- (void)adProviderWillPresentScreen:(id<AKAdProvider>)provider
+{
+    AKLog(1, @"start");
+
+    // 実行中のシーンを取得する
+    CCScene *scene = [[CCDirector sharedDirector] runningScene];
+
+    // ゲームプレイシーンでゲームプレイ中の場合は一時停止状態にする
+    if ([scene isKindOfClass:[AKGameScene class]]) {
+
+        // ゲームプレイシーンにキャストする
+        AKGameScene *gameScene = (AKGameScene *)scene;
+
+        // ゲームプレイ中の場合は一時停止状態にする
+        if (gameScene.state == kAKGameStatePlaying) {
+
+            // 一時停止する
+            [gameScene pause:NO];
+
+            // BGMは停止させる
+            [[SimpleAudioEngine sharedEngine] stopBackgroundMusic];
+        }
+    }
+
+    AKLog(1, @"end");
+}
+
+@end
@@ -0,0 +1,110 @@
+/*
+ * Copyright (c) 2012-2013 Akihiro Kaneda.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   1.Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   2.Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ *   3.Neither the name of the Monochrome Soft nor the names of its contributors
+ *     may be used to endorse or promote products derived from this software
+ *     without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+/*!
+ @file AKAdProvider.h
+ @brief 広告の取得処理
+
+ 広告バナーの読み込みと表示を行う処理を定義する。
+ */
+
+#import <UIKit/UIKit.h>
+#import "GADBannerView.h"
+#import "GADBannerViewDelegate.h"
+
+@protocol AKAdProvider;
+
+/*!
+ @brief 広告の取得処理の通知先
+
+ 広告の読み込み結果を受け取る。通知はメインスレッドで行う。
+ */
+@protocol AKAdProviderDelegate <NSObject>
+
+// 広告読み込み成功時処理
+- (void)adProviderDidReceiveAd:(id<AKAdProvider>)provider;
+// 広告読み込み失敗時処理
+- (void)adProvider:(id<AKAdProvider>)provider didFailWithError:(NSError *)error;
+// 広告フルスクリーン表示時処理
+- (void)adProviderWillPresentScreen:(id<AKAdProvider>)provider;
+
+@end
+
+/*!
+ @brief 広告の取得処理
+
+ 広告バナーのビューを持ち、指定されたときにのみ広告の読み込みと表示位置の変更を行う。
+ */
+@protocol AKAdProvider <NSObject>
+
+// 広告バナーのビュー
+- (UIView *)adView;
+// 通知先の設定
+- (void)setDelegate:(id<AKAdProviderDelegate>)delegate;
+// 広告の読み込み
+- (void)loadAd;
+// 広告の表示/非表示の反映
+- (void)showAd:(BOOL)isShow inBounds:(CGRect)bounds;
+
+@end
+
+// AdMobによる広告の取得処理
+@interface AKAdMobProvider : NSObject <AKAdProvider, GADBannerViewDelegate> {
+    /// 広告バナー
+    GADBannerView *bannerView_;
+    /// 通知先
+    id<AKAdProviderDelegate> delegate_;
+}
+
+/// 広告バナー
+@property (nonatomic, retain)GADBannerView *bannerView;
+
+// ルートビューコントローラーを指定した初期化処理
+- (id)initWithRootViewController:(UIViewController *)viewController;
+@end
+
+#ifdef DEBUG
+// 遅延を指定できる試験用の広告の取得処理
+@interface AKMockAdProvider : NSObject <AKAdProvider> {
+    /// 広告バナーの代わりのビュー
+    UIView *view_;
+    /// 通知先
+    id<AKAdProviderDelegate> delegate_;
+    /// 読み込みにかかる時間
+    NSTimeInterval loadDelay_;
+    /// 表示位置の変更でメインスレッドを止める時間
+    NSTimeInterval layoutStall_;
+}
+
+/// 広告バナーの代わりのビュー
+@property (nonatomic, retain)UIView *view;
+
+// 遅延を指定した初期化処理
+- (id)initWithLoadDelay:(NSTimeInterval)loadDelay layoutStall:(NSTimeInterval)layoutStall;
+@end
+#endif
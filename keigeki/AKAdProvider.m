@@ -0,0 +1,305 @@
+/*
+ * Copyright (c) 2012-2013 Akihiro Kaneda.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   1.Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   2.Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ *   3.Neither the name of the Monochrome Soft nor the names of its contributors
+ *     may be used to endorse or promote products derived from this software
+ *     without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+/*!
+ @file AKAdProvider.m
+ @brief 広告の取得処理
+
+ 広告バナーの読み込みと表示を行う処理を定義する。
+ */
+
+#import "AKAdProvider.h"
+#import "AKCommon.h"
+
+/// AdMobパブリッシャーID
+static NSString *kAKAdMobID = @"ca-app-pub-8055460627535570/7187368047";
+
+/*!
+ @brief AdMobによる広告の取得処理
+
+ AdMobの広告バナーを生成し、読み込み結果を通知先に伝える。
+ 自動更新はAdMobの管理画面で無効にし、読み込みは広告管理クラスから指示されたときのみ行う。
+ */
+@implementation AKAdMobProvider
+
+@synthesize bannerView = bannerView_;
+
+/*!
+ @brief ルートビューコントローラーを指定した初期化処理
+
+ 画面下部に標準サイズの広告バナーを生成する。
+ @param viewController 広告を表示した場所に後で復元するビューコントローラー
+ @return 生成したオブジェクト。失敗時はnilを返す。
+ */
+- (id)initWithRootViewController:(UIViewController *)viewController
+{
+    // スーパークラスの初期化処理を実行する
+    self = [super init];
+    if (!self) {
+        return nil;
+    }
+
+    // 読み込みが終わるまでは画面外に配置する
+    self.bannerView = [[[GADBannerView alloc] initWithFrame:CGRectMake(0.0,
+                                                                       -GAD_SIZE_320x50.height,
+                                                                       GAD_SIZE_320x50.width,
+                                                                       GAD_SIZE_320x50.height)]
+                       autorelease];
+
+    // 広告の「ユニット ID」を指定する。これは AdMob パブリッシャー ID です。
+    self.bannerView.adUnitID = kAKAdMobID;
+
+    // デリゲートを設定する
+    self.bannerView.delegate = self;
+
+    // ユーザーに広告を表示した場所に後で復元する UIViewController をランタイムに知らせる
+    self.bannerView.rootViewController = viewController;
+
+    return self;
+}
+
+/*!
+ @brief インスタンス解放処理
+
+ 広告バナーを解放する。
+ */
+- (void)dealloc
+{
+    // デリゲートを削除する
+    self.bannerView.delegate = nil;
+
+    // バナーを削除する
+    self.bannerView = nil;
+
+    // スーパークラスの解放処理を実行する
+    [super dealloc];
+}
+
+/*!
+ @brief 広告バナーのビュー
+
+ 広告バナーのビューを返す。
+ @return 広告バナーのビュー
+ */
+- (UIView *)adView
+{
+    return self.bannerView;
+}
+
+/*!
+ @brief 通知先の設定
+
+ 読み込み結果の通知先を設定する。通知先は保持しない。
+ @param delegate 通知先
+ */
+- (void)setDelegate:(id<AKAdProviderDelegate>)delegate
+{
+    delegate_ = delegate;
+}
+
+/*!
+ @brief 広告の読み込み
+
+ 広告リクエストを作成して読み込みを開始する。
+ */
+- (void)loadAd
+{
+    [self.bannerView loadRequest:[GADRequest request]];
+}
+
+/*!
+ @brief 広告の表示/非表示の反映
+
+ 表示する場合は画面下部に、表示しない場合は画面外に広告バナーを移動する。
+ @param isShow 表示する場合YES
+ @param bounds 親ビューの範囲
+ */
+- (void)showAd:(BOOL)isShow inBounds:(CGRect)bounds
+{
+    CGSize size = self.bannerView.frame.size;
+
+    self.bannerView.frame = CGRectMake(0.0,
+                                       isShow ? bounds.size.height - GAD_SIZE_320x50.height : -size.height,
+                                       size.width,
+                                       size.height);
+}
+
+/*!
+ @brief リクエスト成功時処理
+
+ 広告リクエストに成功したことを通知先に伝える。
+ @param bannerView 広告バナー
+ */
+- (void)adViewDidReceiveAd:(GADBannerView *)bannerView
+{
+    [delegate_ adProviderDidReceiveAd:self];
+}
+
+/*!
+ @brief リクエスト失敗時処理
+
+ 広告リクエストに失敗したことを通知先に伝える。
+ @param bannerView 広告バナー
+ @param error エラー内容
+ */
+- (void)adView:(GADBannerView *)bannerView didFailToReceiveAdWithError:(GADRequestError *)error
+{
+    [delegate_ adProvider:self didFailWithError:error];
+}
+
+/*!
+ @brief 広告フルスクリーン表示時処理
+
+ 広告がフルスクリーン表示されることを通知先に伝える。
+ @param bannerView 広告バナー
+ */
+- (void)adViewWillPresentScreen:(GADBannerView *)bannerView
+{
+    [delegate_ adProviderWillPresentScreen:self];
+}
+
+@end
+
+#ifdef DEBUG
+/*!
+ @brief 遅延を指定できる試験用の広告の取得処理
+
+ ネットワークを使わずに広告の読み込みを模擬する。
+ 読み込みは指定時間後に成功を通知し、表示位置の変更では指定時間メインスレッドを止める。
+ 広告の処理がゲームプレイ中のフレーム時間に影響しないことを処理時間計測で確認するために使用する。
+ デバッグ版にのみ組み込む。
+ */
+@implementation AKMockAdProvider
+
+@synthesize view = view_;
+
+/*!
+ @brief 遅延を指定した初期化処理
+
+ 広告バナーと同じサイズのビューを生成する。
+ @param loadDelay 読み込みにかかる時間(秒)
+ @param layoutStall 表示位置の変更でメインスレッドを止める時間(秒)
+ @return 生成したオブジェクト。失敗時はnilを返す。
+ */
+- (id)initWithLoadDelay:(NSTimeInterval)loadDelay layoutStall:(NSTimeInterval)layoutStall
+{
+    // スーパークラスの初期化処理を実行する
+    self = [super init];
+    if (!self) {
+        return nil;
+    }
+
+    loadDelay_ = loadDelay;
+    layoutStall_ = layoutStall;
+
+    // 読み込みが終わるまでは画面外に配置する
+    self.view = [[[UIView alloc] initWithFrame:CGRectMake(0.0,
+                                                          -GAD_SIZE_320x50.height,
+                                                          GAD_SIZE_320x50.width,
+                                                          GAD_SIZE_320x50.height)]
+                 autorelease];
+    self.view.backgroundColor = [UIColor darkGrayColor];
+
+    return self;
+}
+
+/*!
+ @brief インスタンス解放処理
+
+ ビューを解放する。
+ */
+- (void)dealloc
+{
+    self.view = nil;
+
+    // スーパークラスの解放処理を実行する
+    [super dealloc];
+}
+
+/*!
+ @brief 広告バナーのビュー
+
+ 広告バナーの代わりのビューを返す。
+ @return 広告バナーの代わりのビュー
+ */
+- (UIView *)adView
+{
+    return self.view;
+}
+
+/*!
+ @brief 通知先の設定
+
+ 読み込み結果の通知先を設定する。通知先は保持しない。
+ @param delegate 通知先
+ */
+- (void)setDelegate:(id<AKAdProviderDelegate>)delegate
+{
+    delegate_ = delegate;
+}
+
+/*!
+ @brief 広告の読み込み
+
+ 指定時間後にメインスレッドで読み込み成功を通知する。
+ */
+- (void)loadAd
+{
+    AKLog(1, @"模擬広告読み込み開始:delay=%.0fms", loadDelay_ * 1000.0);
+
+    [self retain];
+    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(loadDelay_ * NSEC_PER_SEC)), dispatch_get_main_queue(), ^{
+        [delegate_ adProviderDidReceiveAd:self];
+        [self release];
+    });
+}
+
+/*!
+ @brief 広告の表示/非表示の反映
+
+ 指定時間メインスレッドを止めてから、ビューの位置を変更する。
+ @param isShow 表示する場合YES
+ @param bounds 親ビューの範囲
+ */
+- (void)showAd:(BOOL)isShow inBounds:(CGRect)bounds
+{
+    // レイアウト処理の負荷を模擬する
+    AKLog(1, @"模擬広告レイアウト:stall=%.0fms", layoutStall_ * 1000.0);
+    [NSThread sleepForTimeInterval:layoutStall_];
+
+    CGSize size = self.view.frame.size;
+
+    self.view.frame = CGRectMake(0.0,
+                                 isShow ? bounds.size.height - size.height : -size.height,
+                                 size.width,
+                                 size.height);
+}
+
+@end
+
+#endif
@@ -34,6 +34,7 @@
  */
 
 #import "AKBackground.h"
+#import "AKTextureManager.h"
 
 /// タイルのサイズ
 static const NSInteger kAKTileSize = 64;
@@ -83,7 +84,7 @@ static NSString *kAKTileFile = @"Back.png";
         for (int j = 0; j < kAKTileCount; j++) {
             
             // タイルを生成する
-            CCSprite *tile = [CCSprite spriteWithFile:kAKTileFile];
+            CCSprite *tile = [CCSprite spriteWithTexture:[[AKTextureManager sharedManager] textureForFile:kAKTileFile]];
             NSAssert(tile != nil, @"can not create tile");
             
             // アンカーポイントを中心にして画像を配置する
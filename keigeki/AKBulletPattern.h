@@ -0,0 +1,122 @@
+/*
+ * Copyright (c) 2012-2013 Akihiro Kaneda.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   1.Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   2.Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ *   3.Neither the name of the Monochrome Soft nor the names of its contributors
+ *     may be used to endorse or promote products derived from this software
+ *     without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+/*!
+ @file AKBulletPattern.h
+ @brief 弾幕パターン
+
+ スクリプトファイルで定義した敵と敵弾の動作パターンを実行するクラスを定義する。
+ */
+
+#import <Foundation/Foundation.h>
+#import "AKCharacter.h"
+
+/// 命令の種類
+enum AKPatternOpCode {
+    kAKPatternOpEnd = 0,    ///< パターン終了
+    kAKPatternOpFire,       ///< 敵弾発射
+    kAKPatternOpDirection,  ///< 発射方向の設定
+    kAKPatternOpSpeed,      ///< 発射速度の設定
+    kAKPatternOpWait,       ///< 待機
+    kAKPatternOpRepeat,     ///< 繰り返し開始
+    kAKPatternOpLoop,       ///< 繰り返し終了
+    kAKPatternOpTurn,       ///< 発射元の回転速度の設定
+    kAKPatternOpAccel,      ///< 発射元の速度の設定
+    kAKPatternOpChase       ///< 自機の方向への旋回
+};
+
+/// 値の指定方法
+enum AKPatternMode {
+    kAKPatternModeAbsolute = 0, ///< 絶対値
+    kAKPatternModeRelative,     ///< 前回の値からの相対値
+    kAKPatternModeAim,          ///< 自機の方向からの相対値
+    kAKPatternModeHeading       ///< 発射元の向きからの相対値
+};
+
+/// 命令(固定長)
+struct AKPatternOp {
+    uint8_t code;   ///< 命令の種類
+    uint8_t mode;   ///< 値の指定方法
+    int16_t arg;    ///< 整数の引数(繰り返し回数、ジャンプ先、敵弾のパターンID)
+    float value;    ///< 実数の引数(角度、速度、待機時間)
+    float time;     ///< 実数の引数(旋回時間)
+};
+
+/// 繰り返しの入れ子の上限
+enum {
+    kAKPatternLoopDepth = 4
+};
+
+/// 実行中のパターン
+struct AKPatternThread {
+    AKCharacter *owner;                     ///< 発射元(プールが保持するため、ここでは保持しない)
+    uint32_t generation;                    ///< 開始時の発射元の画像の世代
+    int32_t pc;                             ///< 次に実行する命令の位置
+    float wait;                             ///< 待機時間の残り
+    float chaseTime;                        ///< 旋回時間の残り
+    float chaseSpeed;                       ///< 旋回の回転速度
+    float direction;                        ///< 発射方向
+    float speed;                            ///< 発射速度(0の場合は敵弾の種類ごとの速度)
+    int32_t loopDepth;                      ///< 繰り返しの入れ子の深さ
+    int32_t loopCount[kAKPatternLoopDepth]; ///< 繰り返しの残り回数(負の場合は無限)
+};
+
+// 弾幕パターンクラス
+@interface AKBulletPattern : NSObject {
+    /// 命令の配列
+    struct AKPatternOp *ops_;
+    /// 命令の数
+    NSInteger opCount_;
+    /// パターンごとの開始位置(パターンIDから1を引いたインデックス)
+    NSMutableArray *entries_;
+    /// パターン名からパターンIDへの対応
+    NSMutableDictionary *names_;
+    /// 実行中のパターンの配列
+    struct AKPatternThread *threads_;
+    /// 実行中のパターンの数
+    NSInteger threadCount_;
+    /// 実行中のパターンの配列の確保サイズ
+    NSInteger threadCapacity_;
+}
+
+/// 実行中のパターンの数
+@property (nonatomic, readonly)NSInteger threadCount;
+
+// シングルトンオブジェクト取得
++ (AKBulletPattern *)sharedPattern;
+// スクリプトの読み込み
+- (BOOL)compileScript:(NSString *)script;
+// パターンIDの取得
+- (NSInteger)patternIDForName:(NSString *)name;
+// パターンの開始
+- (void)startPattern:(NSInteger)patternID owner:(AKCharacter *)owner;
+// 全パターンの実行
+- (void)update:(ccTime)dt;
+// 実行中のパターンのクリア
+- (void)clear;
+@end
@@ -0,0 +1,598 @@
+/*
+ * Copyright (c) 2012-2013 Akihiro Kaneda.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   1.Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   2.Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ *   3.Neither the name of the Monochrome Soft nor the names of its contributors
+ *     may be used to endorse or promote products derived from this software
+ *     without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+/*!
+ @file AKBulletPattern.m
+ @brief 弾幕パターン
+
+ スクリプトファイルで定義した敵と敵弾の動作パターンを実行するクラスを定義する。
+ */
+
+#import "AKBulletPattern.h"
+#import "AKGameEventBuffer.h"
+#import "AKEnemyShot.h"
+#import "AKCommon.h"
+
+/// スクリプトファイル名
+static NSString *kAKBulletPatternFile = @"bullet";
+/// 実行中のパターンの配列の初期確保サイズ
+static const NSInteger kAKPatternThreadInitialCapacity = 256;
+/// 1フレームで1つのパターンが実行する命令の上限(待機のない無限ループ対策)
+static const NSInteger kAKPatternMaxStepCount = 256;
+
+/// シングルトンオブジェクト
+static AKBulletPattern *sharedPattern_ = nil;
+
+/*!
+ @brief 値の指定方法の解析
+
+ スクリプトの値の指定方法の文字列を変換する。
+ @param name 指定方法の文字列
+ @param isDirection 方向の指定かどうか(自機方向、発射元の向きを許可する)
+ @param mode 変換結果
+ @return 変換できた場合YES
+ */
+static BOOL AKPatternParseMode(NSString *name, BOOL isDirection, uint8_t *mode)
+{
+    if ([name isEqualToString:@"absolute"]) {
+        *mode = kAKPatternModeAbsolute;
+    }
+    else if ([name isEqualToString:@"relative"]) {
+        *mode = kAKPatternModeRelative;
+    }
+    else if (isDirection && [name isEqualToString:@"aim"]) {
+        *mode = kAKPatternModeAim;
+    }
+    else if (isDirection && [name isEqualToString:@"heading"]) {
+        *mode = kAKPatternModeHeading;
+    }
+    else {
+        return NO;
+    }
+    
+    return YES;
+}
+
+/*!
+ @brief 弾幕パターンクラス
+
+ 敵弾の発射や発射元の旋回などの動作を、スクリプトファイルで定義したパターンとして実行する。
+ スクリプトは1行1命令のカンマ区切りで記述し、読み込み時に固定長の命令の配列に変換する。
+ 実行中のパターンは配列にまとめて保持し、毎フレーム全パターンを順番に実行する。
+ 敵弾の発射はイベントバッファに追加し、シーンのイベント処理で生成する。
+ 発射元が画面から取り除かれた場合、画像が差し替えられた場合(プールで再利用された場合)はパターンを終了する。
+ */
+@implementation AKBulletPattern
+
+@synthesize threadCount = threadCount_;
+
+/*!
+ @brief シングルトンオブジェクト取得
+
+ シングルトンオブジェクトを取得する。
+ まだ生成されていない場合は生成を行い、スクリプトファイルを読み込む。
+ @return シングルトンオブジェクト
+ */
++ (AKBulletPattern *)sharedPattern
+{
+    // 他のスレッドで同時に実行されないようにする
+    @synchronized(self) {
+
+        // シングルトンオブジェクトが生成されていない場合は生成する
+        if (!sharedPattern_) {
+            sharedPattern_ = [[AKBulletPattern alloc] init];
+        }
+
+        return sharedPattern_;
+    }
+
+    return nil;
+}
+
+/*!
+ @brief インスタンス生成処理
+
+ インスタンス生成処理。
+ シングルトンのため、二重に生成された場合はアサーションを出力する。
+ */
++ (id)alloc
+{
+    // 他のスレッドで同時に実行されないようにする
+    @synchronized(self) {
+
+        NSAssert(sharedPattern_ == nil, @"Attempted to allocate a second instance of a singleton.");
+        return [super alloc];
+    }
+
+    return nil;
+}
+
+/*!
+ @brief オブジェクト生成処理
+
+ オブジェクトの生成を行う。実行中のパターンの配列を確保し、スクリプトファイルを読み込む。
+ @return 生成したオブジェクト。失敗時はnilを返す。
+ */
+- (id)init
+{
+    // スーパークラスの生成処理
+    self = [super init];
+    if (!self) {
+        return nil;
+    }
+
+    // 実行中のパターンの配列を確保する
+    threads_ = malloc(sizeof(struct AKPatternThread) * kAKPatternThreadInitialCapacity);
+    if (!threads_) {
+        [self release];
+        return nil;
+    }
+    threadCapacity_ = kAKPatternThreadInitialCapacity;
+    threadCount_ = 0;
+    
+    // スクリプトファイルを読み込む
+    NSString *filePath = [[NSBundle mainBundle] pathForResource:kAKBulletPatternFile ofType:@"txt"];
+    NSError *error = nil;
+    NSString *script = [NSString stringWithContentsOfFile:filePath encoding:NSUTF8StringEncoding error:&error];
+    if (script == nil) {
+        AKLog(1, @"弾幕パターンの読み込みに失敗:%@", [error localizedDescription]);
+    }
+    else {
+        [self compileScript:script];
+    }
+
+    return self;
+}
+
+/*!
+ @brief インスタンス解放時処理
+
+ インスタンス解放時にオブジェクトを解放する。
+ */
+- (void)dealloc
+{
+    // 配列を解放する
+    free(ops_);
+    free(threads_);
+    [entries_ release];
+    [names_ release];
+
+    // スーパークラスの解放処理
+    [super dealloc];
+}
+
+/*!
+ @brief スクリプトの読み込み
+
+ スクリプトを命令の配列に変換する。読み込み済みのパターンはすべて置き換える。
+ 1行に1命令をカンマ区切りで記述する。"#"で始まる行と空行は無視する。
+ 角度は度、時間は秒で指定する。
+ 
+     pattern,名前             パターンの開始
+     fire[,名前]              現在の方向と速度で敵弾を発射する。名前を指定した場合は敵弾がそのパターンを実行する
+     direction,指定方法,角度   発射方向を設定する(aim:自機方向 heading:発射元の向き relative:前回の方向 absolute:絶対)
+     speed,指定方法,速度       発射速度を設定する(absolute、relative)
+     wait,時間                 待機する
+     repeat,回数 〜 end        繰り返す。回数が0の場合は無限に繰り返す
+     turn,角速度               発射元の回転速度を設定する
+     accel,指定方法,速度       発射元の速度を設定する(absolute、relative)
+     chase,角速度,時間         指定時間の間、自機の方向へ旋回しながら待機する
+ 
+ エラーがあった場合は行番号をログに出力し、読み込み済みのパターンは変更しない。
+ @param script スクリプト
+ @return 読み込みに成功した場合YES
+ */
+- (BOOL)compileScript:(NSString *)script
+{
+    NSArray *lines = [script componentsSeparatedByCharactersInSet:[NSCharacterSet newlineCharacterSet]];
+    NSCharacterSet *spaces = [NSCharacterSet whitespaceCharacterSet];
+    NSMutableDictionary *names = [NSMutableDictionary dictionary];
+    NSMutableArray *entries = [NSMutableArray array];
+    NSMutableData *code = [NSMutableData data];
+    NSInteger loopStack[kAKPatternLoopDepth];
+    NSInteger loopDepth = 0;
+    
+    // 敵弾のパターンを後方参照できるように、先にパターン名を登録する
+    // パターンIDは定義順に1から割り当てる
+    NSInteger patternCount = 0;
+    for (NSString *line in lines) {
+        NSArray *params = [line componentsSeparatedByString:@","];
+        NSString *command = [[params objectAtIndex:0] stringByTrimmingCharactersInSet:spaces];
+        if ([command isEqualToString:@"pattern"]) {
+            
+            patternCount++;
+            
+            // 名前がない場合は本処理でエラーとする
+            if ([params count] < 2) {
+                continue;
+            }
+            
+            // 名前が重複している場合はエラーとする
+            NSString *name = [[params objectAtIndex:1] stringByTrimmingCharactersInSet:spaces];
+            if ([names objectForKey:name]) {
+                AKLog(1, @"弾幕パターンのエラー:名前の重複 %@", name);
+                return NO;
+            }
+            [names setObject:[NSNumber numberWithInteger:patternCount] forKey:name];
+        }
+    }
+    
+    for (NSUInteger lineNo = 0; lineNo < [lines count]; lineNo++) {
+        
+        NSString *line = [[lines objectAtIndex:lineNo] stringByTrimmingCharactersInSet:spaces];
+        
+        // コメントと空行は飛ばす
+        if ([line length] == 0 || [line hasPrefix:@"#"]) {
+            continue;
+        }
+        
+        // カンマ区切りでパラメータを分割する
+        NSMutableArray *params = [NSMutableArray array];
+        for (NSString *param in [line componentsSeparatedByString:@","]) {
+            [params addObject:[param stringByTrimmingCharactersInSet:spaces]];
+        }
+        NSString *command = [params objectAtIndex:0];
+        NSUInteger paramCount = [params count];
+        
+        struct AKPatternOp op;
+        memset(&op, 0, sizeof(op));
+        BOOL isValid = YES;
+        
+        // パターンの開始
+        if ([command isEqualToString:@"pattern"]) {
+            
+            // 名前がない場合、前のパターンの繰り返しが閉じていない場合はエラーとする
+            isValid = (paramCount >= 2 && loopDepth == 0);
+            
+            // 前のパターンを終了する
+            if ([entries count] > 0) {
+                op.code = kAKPatternOpEnd;
+                [code appendBytes:&op length:sizeof(op)];
+            }
+            
+            [entries addObject:[NSNumber numberWithInteger:[code length] / sizeof(op)]];
+            
+            if (isValid) {
+                continue;
+            }
+        }
+        // パターンの外の命令はエラーとする
+        else if ([entries count] == 0) {
+            isValid = NO;
+        }
+        else if ([command isEqualToString:@"fire"]) {
+            op.code = kAKPatternOpFire;
+            if (paramCount >= 2) {
+                NSNumber *patternID = [names objectForKey:[params objectAtIndex:1]];
+                isValid = (patternID != nil);
+                op.arg = [patternID integerValue];
+            }
+        }
+        else if ([command isEqualToString:@"direction"]) {
+            op.code = kAKPatternOpDirection;
+            isValid = (paramCount >= 3 && AKPatternParseMode([params objectAtIndex:1], YES, &op.mode));
+            op.value = AKCnvAngleDeg2Rad([[params lastObject] floatValue]);
+        }
+        else if ([command isEqualToString:@"speed"] || [command isEqualToString:@"accel"]) {
+            op.code = ([command isEqualToString:@"speed"] ? kAKPatternOpSpeed : kAKPatternOpAccel);
+            isValid = (paramCount >= 3 && AKPatternParseMode([params objectAtIndex:1], NO, &op.mode));
+            op.value = [[params lastObject] floatValue];
+        }
+        else if ([command isEqualToString:@"wait"]) {
+            op.code = kAKPatternOpWait;
+            isValid = (paramCount >= 2);
+            op.value = [[params lastObject] floatValue];
+        }
+        else if ([command isEqualToString:@"repeat"]) {
+            op.code = kAKPatternOpRepeat;
+            isValid = (paramCount >= 2 && loopDepth < kAKPatternLoopDepth);
+            op.arg = [[params lastObject] integerValue];
+            if (isValid) {
+                loopStack[loopDepth++] = [code length] / sizeof(op);
+            }
+        }
+        else if ([command isEqualToString:@"end"]) {
+            op.code = kAKPatternOpLoop;
+            isValid = (loopDepth > 0);
+            if (isValid) {
+                // 繰り返し開始の次の命令に戻る
+                op.arg = loopStack[--loopDepth] + 1;
+            }
+        }
+        else if ([command isEqualToString:@"turn"]) {
+            op.code = kAKPatternOpTurn;
+            isValid = (paramCount >= 2);
+            op.value = AKCnvAngleDeg2Rad([[params lastObject] floatValue]);
+        }
+        else if ([command isEqualToString:@"chase"]) {
+            op.code = kAKPatternOpChase;
+            isValid = (paramCount >= 3);
+            op.value = AKCnvAngleDeg2Rad([[params objectAtIndex:1] floatValue]);
+            op.time = [[params objectAtIndex:2] floatValue];
+        }
+        else {
+            isValid = NO;
+        }
+        
+        // エラーの場合は読み込みを中止する
+        if (!isValid) {
+            AKLog(1, @"弾幕パターンのエラー:line=%d %@", lineNo + 1, line);
+            return NO;
+        }
+        
+        [code appendBytes:&op length:sizeof(op)];
+    }
+    
+    // 最後のパターンを終了する
+    if (loopDepth > 0) {
+        AKLog(1, @"弾幕パターンのエラー:repeatに対応するendがない");
+        return NO;
+    }
+    struct AKPatternOp endOp;
+    memset(&endOp, 0, sizeof(endOp));
+    endOp.code = kAKPatternOpEnd;
+    [code appendBytes:&endOp length:sizeof(endOp)];
+    
+    // 命令の配列を置き換える
+    struct AKPatternOp *ops = malloc([code length]);
+    if (!ops) {
+        return NO;
+    }
+    memcpy(ops, [code bytes], [code length]);
+    
+    // 実行中のパターンは命令の位置が変わるため破棄する
+    [self clear];
+    
+    free(ops_);
+    ops_ = ops;
+    opCount_ = [code length] / sizeof(struct AKPatternOp);
+    [entries_ release];
+    entries_ = [entries retain];
+    [names_ release];
+    names_ = [names retain];
+    
+    AKLog(1, @"弾幕パターン読み込み:patterns=%d ops=%d", [entries_ count], opCount_);
+    
+    return YES;
+}
+
+/*!
+ @brief パターンIDの取得
+
+ パターン名に対応するパターンIDを取得する。
+ @param name パターン名
+ @return パターンID。パターンが存在しない場合は0。
+ */
+- (NSInteger)patternIDForName:(NSString *)name
+{
+    return [[names_ objectForKey:name] integerValue];
+}
+
+/*!
+ @brief パターンの開始
+
+ 発射元のキャラクターでパターンの実行を開始する。
+ 発射方向の初期値は発射元の向き、発射速度の初期値は敵弾の種類ごとの速度とする。
+ @param patternID パターンID
+ @param owner 発射元
+ */
+- (void)startPattern:(NSInteger)patternID owner:(AKCharacter *)owner
+{
+    // パターンが存在しない場合は無処理
+    if (patternID <= 0 || patternID > [entries_ count]) {
+        return;
+    }
+    
+    // 配列が不足している場合は拡張する
+    if (threadCount_ >= threadCapacity_) {
+        
+        struct AKPatternThread *threads = realloc(threads_, sizeof(struct AKPatternThread) * threadCapacity_ * 2);
+        
+        // 拡張に失敗した場合はパターンを開始しない
+        if (!threads) {
+            AKLog(1, @"弾幕パターン配列の拡張に失敗:capacity=%d", threadCapacity_);
+            return;
+        }
+        
+        threads_ = threads;
+        threadCapacity_ *= 2;
+        AKLog(1, @"弾幕パターン配列を拡張:capacity=%d", threadCapacity_);
+    }
+    
+    struct AKPatternThread *thread = &threads_[threadCount_++];
+    memset(thread, 0, sizeof(struct AKPatternThread));
+    thread->owner = owner;
+    thread->generation = owner.imageGeneration;
+    thread->pc = [[entries_ objectAtIndex:patternID - 1] intValue];
+    thread->direction = owner.angle;
+}
+
+/*!
+ @brief パターンの実行
+
+ 待機時間が経過するまで命令を順番に実行する。
+ @param thread 実行するパターン
+ @param dt フレーム更新間隔
+ @return パターンが終了した場合NO
+ */
+- (BOOL)step:(struct AKPatternThread *)thread dt:(ccTime)dt
+{
+    AKCharacter *owner = thread->owner;
+    
+    // 発射元が取り除かれた場合、再利用された場合は終了する
+    if (!owner.isStaged || owner.hitPoint <= 0 || owner.imageGeneration != thread->generation) {
+        return NO;
+    }
+    
+    // 旋回中は自機の方向へ回転する
+    if (thread->chaseTime > 0.0f) {
+        
+        thread->chaseTime -= dt;
+        
+        if (thread->chaseTime > 0.0f) {
+            owner.rotSpeed = thread->chaseSpeed * AKCalcRotDirect(owner.angle,
+                                                                  owner.screenPos.x, owner.screenPos.y,
+                                                                  AKPlayerPosX(), AKPlayerPosY());
+            return YES;
+        }
+        
+        // 旋回時間の超過分を待機時間に繰り越す
+        thread->wait += thread->chaseTime;
+        thread->chaseTime = 0.0f;
+    }
+    else {
+        // 待機時間をカウントする
+        thread->wait -= dt;
+    }
+    
+    // 待機中は命令を実行しない
+    if (thread->wait > 0.0f) {
+        return YES;
+    }
+    
+    for (NSInteger step = 0; step < kAKPatternMaxStepCount; step++) {
+        
+        const struct AKPatternOp *op = &ops_[thread->pc++];
+        
+        switch (op->code) {
+            case kAKPatternOpEnd:
+                return NO;
+                
+            case kAKPatternOpFire:
+                [[AKGameEventBuffer sharedBuffer] pushEnemyShot:ENEMY_SHOT_TYPE_NORMAL
+                                                           posX:owner.absx posY:owner.absy
+                                                          angle:thread->direction
+                                                          speed:thread->speed
+                                                        pattern:op->arg];
+                break;
+                
+            case kAKPatternOpDirection:
+                switch (op->mode) {
+                    case kAKPatternModeAim:
+                        thread->direction = AKCalcDestAngle(owner.screenPos.x, owner.screenPos.y,
+                                                            AKPlayerPosX(), AKPlayerPosY()) + op->value;
+                        break;
+                    case kAKPatternModeHeading:
+                        thread->direction = owner.angle + op->value;
+                        break;
+                    case kAKPatternModeRelative:
+                        thread->direction += op->value;
+                        break;
+                    default:
+                        thread->direction = op->value;
+                        break;
+                }
+                break;
+                
+            case kAKPatternOpSpeed:
+                thread->speed = (op->mode == kAKPatternModeRelative ? thread->speed + op->value : op->value);
+                break;
+                
+            case kAKPatternOpWait:
+                thread->wait += op->value;
+                if (thread->wait > 0.0f) {
+                    return YES;
+                }
+                break;
+                
+            case kAKPatternOpRepeat:
+                thread->loopCount[thread->loopDepth++] = (op->arg > 0 ? op->arg : -1);
+                break;
+                
+            case kAKPatternOpLoop:
+            {
+                int32_t *count = &thread->loopCount[thread->loopDepth - 1];
+                
+                // 無限ループの場合、残り回数がある場合は繰り返し開始に戻る
+                if (*count < 0 || --(*count) > 0) {
+                    thread->pc = op->arg;
+                }
+                else {
+                    thread->loopDepth--;
+                }
+                break;
+            }
+                
+            case kAKPatternOpTurn:
+                owner.rotSpeed = op->value;
+                break;
+                
+            case kAKPatternOpAccel:
+                owner.speed = (op->mode == kAKPatternModeRelative ? owner.speed + op->value : op->value);
+                break;
+                
+            case kAKPatternOpChase:
+                thread->chaseSpeed = op->value;
+                thread->chaseTime = op->time;
+                owner.rotSpeed = thread->chaseSpeed * AKCalcRotDirect(owner.angle,
+                                                                      owner.screenPos.x, owner.screenPos.y,
+                                                                      AKPlayerPosX(), AKPlayerPosY());
+                return YES;
+                
+            default:
+                assert(0);
+                return NO;
+        }
+    }
+    
+    // 待機のないループは次のフレームに続きを実行する
+    return YES;
+}
+
+/*!
+ @brief 全パターンの実行
+
+ 実行中の全パターンを1フレーム分実行する。終了したパターンは配列の末尾の要素で埋める。
+ 敵と敵弾の移動処理の後、イベント処理の前に呼び出す。
+ @param dt フレーム更新間隔
+ */
+- (void)update:(ccTime)dt
+{
+    NSInteger i = 0;
+    
+    while (i < threadCount_) {
+        
+        if ([self step:&threads_[i] dt:dt]) {
+            i++;
+        }
+        else {
+            threads_[i] = threads_[--threadCount_];
+        }
+    }
+}
+
+/*!
+ @brief 実行中のパターンのクリア
+
+ 実行中のパターンをすべて破棄する。キャラクターを初期化するときに呼び出す。
+ */
+- (void)clear
+{
+    threadCount_ = 0;
+}
+@end
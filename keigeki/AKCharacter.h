@@ -35,6 +35,42 @@
 
 #import <Foundation/Foundation.h>
 #import "cocos2d.h"
+#import "AKRenderBuffer.h"
+
+/// 移動計算に使用するフレームごとのパラメータ
+struct AKMoveParam {
+    /// フレーム更新間隔
+    ccTime dt;
+    /// スクリーン座標x
+    NSInteger scrx;
+    /// スクリーン座標y
+    NSInteger scry;
+    /// 画面サイズ
+    CGSize screenSize;
+    /// ステージサイズ
+    CGSize stageSize;
+    /// 速度の倍率
+    float speedRatio;
+};
+
+// 移動計算パラメータの作成
+struct AKMoveParam AKMakeMoveParam(ccTime dt, NSInteger scrx, NSInteger scry);
+
+/// 中断時のスナップショットに保存するキャラクターの状態(固定長)
+struct AKCharacterRecord {
+    int32_t type;       ///< 種類
+    float absx;         ///< 絶対座標x
+    float absy;         ///< 絶対座標y
+    float angle;        ///< 向き
+    float speed;        ///< 速度
+    float rotSpeed;     ///< 回転速度
+    int32_t hitPoint;   ///< HP
+    float time;         ///< 経過時間
+    int32_t state;      ///< 動作状態
+    float distance;     ///< 移動距離
+};
+
+struct AKKinematicsBatch;
 
 // キャラクタークラス
 @interface AKCharacter : NSObject {
@@ -58,6 +94,12 @@
     NSInteger hitPoint_;
     /// ステージ上に存在しているかどうか
     BOOL isStaged_;
+    /// スクリーン座標
+    CGPoint screenPos_;
+    /// 画像に反映した表示状態
+    BOOL isVisible_;
+    /// 画像の世代
+    uint32_t imageGeneration_;
 }
 
 /// 画像
@@ -80,13 +122,47 @@
 @property (nonatomic)NSInteger hitPoint;
 /// ステージ上に存在しているかどうか
 @property (nonatomic)BOOL isStaged;
+/// スクリーン座標
+@property (nonatomic)CGPoint screenPos;
+/// 画像の世代。画像を差し替えるたびに更新する。
+@property (nonatomic, readonly)uint32_t imageGeneration;
 
 // 移動処理
 - (void)move:(ccTime)dt ScreenX:(NSInteger)scrx ScreenY:(NSInteger)scry;
+// 位置の計算
+- (void)integrate:(const struct AKMoveParam *)param;
+// 位置計算用の値の取り出し
+- (void)packKinematics:(struct AKKinematicsBatch *)batch;
+// 位置計算結果の書き戻し
+- (void)unpackKinematics:(const struct AKKinematicsBatch *)batch index:(NSInteger)index;
+// 移動後の表示更新と固有の動作
+- (void)applyMove:(ccTime)dt;
+// 詳細度の更新
+- (BOOL)updateLevelOfDetail;
+// 表示状態の更新
+- (BOOL)updateVisibility;
 // キャラクター固有の動作
 - (void)action:(ccTime)dt;
+// 描画状態の追加
+- (struct AKRenderState *)pushRenderState:(uint32_t)flags;
+// アニメーションフレームの反映
+- (void)applyFrame:(NSInteger)frame;
 // 破壊処理
 - (void)destroy;
+// 再利用のための削除
+- (void)retire;
+// 画像の世代の更新
+- (void)invalidateImage;
 // 衝突判定
 - (void)hit:(const NSEnumerator *)characters;
+// 状態の保存
+- (void)saveRecord:(struct AKCharacterRecord *)record;
+// 状態の復元
+- (void)loadRecord:(const struct AKCharacterRecord *)record;
+// 処理数のクリア
++ (void)resetNodeCount;
+// 移動処理を行ったキャラクターの数取得
++ (NSInteger)visitedNodeCount;
+// 表示したキャラクターの数取得
++ (NSInteger)drawnNodeCount;
 @end
@@ -36,7 +36,48 @@
 #import <math.h>
 #import "AKCharacter.h"
 #import "AKScreenSize.h"
+#import "AKKinematics.h"
 #import "AKCommon.h"
+#import "AKTrace.h"
+
+/// 表示範囲判定の余白。画像の大きさに加えて、画面回転の更新遅れを吸収するための余裕を持たせる。
+static const float kAKCullingMargin = 32.0f;
+
+/*!
+ @brief 移動計算パラメータの作成
+
+ 移動計算に使用する画面サイズなどをまとめる。
+ 位置の計算は複数のスレッドから呼ばれるため、UIKitへの問い合わせはここで事前に行う。
+ @param dt フレーム更新間隔
+ @param scrx スクリーン座標x
+ @param scry スクリーン座標y
+ @return 移動計算パラメータ
+ */
+struct AKMoveParam AKMakeMoveParam(ccTime dt, NSInteger scrx, NSInteger scry)
+{
+    struct AKMoveParam param;
+    
+    param.dt = dt;
+    param.scrx = scrx;
+    param.scry = scry;
+    param.screenSize = [AKScreenSize screenSize];
+    param.stageSize = [AKScreenSize stageSize];
+    
+    // iPadの場合は速度を倍にする
+    if (UI_USER_INTERFACE_IDIOM() == UIUserInterfaceIdiomPad) {
+        param.speedRatio = 2.0f;
+    }
+    else {
+        param.speedRatio = 1.0f;
+    }
+    
+    return param;
+}
+
+/// 現在のフレームで移動処理を行ったキャラクターの数
+static NSInteger visitedNodeCount_ = 0;
+/// 現在のフレームで表示したキャラクターの数
+static NSInteger drawnNodeCount_ = 0;
 
 /*!
  @brief キャラクタークラス
@@ -55,6 +96,8 @@
 @synthesize rotSpeed = rotSpeed_;
 @synthesize hitPoint = hitPoint_;
 @synthesize isStaged = isStaged_;
+@synthesize screenPos = screenPos_;
+@synthesize imageGeneration = imageGeneration_;
 
 /*!
  @brief オブジェクト生成処理
@@ -81,10 +124,30 @@
     self.rotSpeed = 0.0f;
     self.hitPoint = 0;
     self.isStaged = NO;
+    self.screenPos = CGPointZero;
+    isVisible_ = NO;
     
     return self;
 }
 
+/*!
+ @brief 画像の設定
+
+ 画像を設定し、画像に反映済みの表示状態を新しい画像の表示状態に合わせる。
+ 画像を差し替えた場合は世代を更新し、反映前の描画状態が新しい画像に適用されないようにする。
+ @param image 画像
+ */
+- (void)setImage:(CCNode *)image
+{
+    if (image_ != image) {
+        [image_ release];
+        image_ = [image retain];
+        imageGeneration_++;
+    }
+    
+    isVisible_ = (image_ != nil && image_.visible);
+}
+
 /*!
  @brief インスタンス解放時処理
 
@@ -155,11 +218,6 @@
  */
 - (void)move:(ccTime)dt ScreenX:(NSInteger)scrx ScreenY:(NSInteger)scry
 {
-    float posx = 0.0f;      // スクリーン座標x
-    float posy = 0.0f;      // スクリーン座標y
-    float velx = 0.0f;      // x方向の速度
-    float vely = 0.0f;      // y方向の速度
-
     // 画面に配置されていない場合は無処理
     if (!self.isStaged) {
         return;
@@ -170,49 +228,157 @@
         [self destroy];
         return;
     }
-        
-    // 向きを更新する
-    self.angle += (self.rotSpeed * dt);
     
-    // 速度をx方向、y方向に分解する
-    velx = self.speed * cosf(self.angle);
-    vely = self.speed * sinf(self.angle);
+    // 位置を計算する
+    struct AKMoveParam param = AKMakeMoveParam(dt, scrx, scry);
+    [self integrate:&param];
     
-    // iPadの場合は速度を倍にする
-    if (UI_USER_INTERFACE_IDIOM() == UIUserInterfaceIdiomPad) {
-        velx *= 2.0f;
-        vely *= 2.0f;
+    // 表示の更新と固有の動作を行う
+    [self applyMove:dt];
+}
+
+/*!
+ @brief 位置の計算
+
+ 速度によって向きと絶対座標、スクリーン座標を更新する。
+ プールで一括計算するキャラクターと計算結果が一致するように、
+ 1要素の配列に取り出してAKKinematicsIntegrateで計算する。
+ 自分自身のメンバのみを更新するため、異なるキャラクターに対しては複数のスレッドから同時に呼び出せる。
+ 画面に配置されていない場合とHPが0の場合は何もしない。
+ @param param 移動計算パラメータ
+ */
+- (void)integrate:(const struct AKMoveParam *)param
+{
+    // スタック上の配列に取り出す。画面に配置されていない場合、破壊処理待ちの場合は取り出されない。
+    struct AKKinematicsStackBatch stack;
+    AKKinematicsInitStackBatch(&stack);
+    [self packKinematics:&stack.batch];
+    
+    // 位置を計算して書き戻す
+    AKKinematicsFlush(&stack.batch, param);
+}
+
+/*!
+ @brief 位置計算用の値の取り出し
+
+ 位置の計算に使用する値を一括計算用の配列の末尾に追加する。
+ integrate:と同じく、画面に配置されていない場合とHPが0の場合は何もしない。
+ 配列には追加する分の領域があらかじめ確保されていること。
+ @param batch 一括計算用の配列
+ */
+- (void)packKinematics:(struct AKKinematicsBatch *)batch
+{
+    // 画面に配置されていない場合、破壊処理待ちの場合は無処理
+    if (!isStaged_ || hitPoint_ <= 0) {
+        return;
     }
     
-    AKLog(0, @"angle=%f vx=%f vy=%f", self.angle / M_PI * 180, velx / self.speed, vely / self.speed);
+    NSInteger index = batch->count++;
+    assert(index < batch->capacity);
     
-    // 座標の移動
-    self.absx += (velx * dt);
-    self.absy += (vely * dt);
-        
-    // 表示位置の計算
-    // スクリーン位置中心からの距離 + スクリーンサイズの半分
-    // スクリーン位置中心からの距離はステージサイズの半分を超えているときは反対側にいるものとして判定する。
-    // これはマーカーの表示のため。
-    posx = AKRangeCheckLF(self.absx - scrx + [AKScreenSize screenSize].width / 2,
-                          -([AKScreenSize stageSize].width / 2),
-                          [AKScreenSize stageSize].width / 2);
-    posy = AKRangeCheckLF(self.absy - scry + [AKScreenSize screenSize].height / 2,
-                          -([AKScreenSize stageSize].height / 2),
-                          [AKScreenSize stageSize].height / 2);
+    batch->characters[index] = self;
+    batch->absx[index] = absx_;
+    batch->absy[index] = absy_;
+    batch->angle[index] = angle_;
+    batch->speed[index] = speed_;
+    batch->rotSpeed[index] = rotSpeed_;
+}
+
+/*!
+ @brief 位置計算結果の書き戻し
+
+ 一括計算した向きと絶対座標、スクリーン座標をメンバに書き戻す。
+ @param batch 一括計算用の配列
+ @param index 配列内の位置
+ */
+- (void)unpackKinematics:(const struct AKKinematicsBatch *)batch index:(NSInteger)index
+{
+    absx_ = batch->absx[index];
+    absy_ = batch->absy[index];
+    angle_ = batch->angle[index];
+    screenPos_ = ccp(batch->posx[index], batch->posy[index]);
+}
+
+/*!
+ @brief 移動後の表示更新と固有の動作
+
+ 位置の計算結果から詳細度と表示状態を更新し、画像に反映する内容を描画状態バッファに追加する。
+ その後キャラクター固有の動作を行う。
+ ノードは操作しないため、描画状態の反映とは別のスレッドから呼び出せる。
+ @param dt フレーム更新間隔
+ */
+- (void)applyMove:(ccTime)dt
+{
+    uint32_t flags = 0;
     
-    AKLog(0, @"vx=%f vy=%f ax=%f ay=%f px=%f py=%f sx=%d sy=%d", velx, vely, self.absx, self.absy, posx, posy, scrx, scry);
-        
-    // 表示座標の設定
-    self.image.position = ccp(posx, posy);
+    // 詳細度を更新する
+    BOOL isDetailed = [self updateLevelOfDetail];
+    
+    // 表示範囲外の場合は非表示とする
+    BOOL isVisible = [self updateVisibility];
+    
+    // 処理したキャラクターの数をカウントする
+    visitedNodeCount_++;
+    if (isVisible) {
+        drawnNodeCount_++;
+    }
+    
+    // 表示状態が変わった場合のみ設定する
+    if (isVisible_ != isVisible) {
+        isVisible_ = isVisible;
+        flags |= (isVisible ? kAKRenderFlagShow : kAKRenderFlagHide);
+    }
     
-    // 回転処理
-    [self.image setRotation:AKCnvAngleRad2Scr(self.angle)];
+    // 表示範囲内で詳細度が下がっていない場合のみ表示座標と回転を更新する
+    if (isVisible && isDetailed) {
+        flags |= kAKRenderFlagTransform;
+    }
+    
+    // 反映する内容がある場合は描画状態を追加する
+    if (flags) {
+        [self pushRenderState:flags];
+    }
         
     // キャラクター固有の動作を行う
     [self action:dt];
 }
 
+/*!
+ @brief 詳細度の更新
+
+ 自機からの距離などによって処理の詳細度を更新し、画像の表示を更新するかどうかを返す。
+ 基本クラスでは常に表示を更新する。
+ @return 画像の表示を更新する場合YES
+ */
+- (BOOL)updateLevelOfDetail
+{
+    // 派生クラスで詳細度を定義する
+    return YES;
+}
+
+/*!
+ @brief 表示状態の更新
+
+ スクリーン座標が画面の表示範囲外の場合は非表示とし、cocos2dの描画処理の対象から外す。
+ 画面は自機の位置を中心に回転するため、回転によらず画面に入らない距離の円で判定する。
+ レーダーはスクリーン座標を使用するため、非表示の場合も表示される。
+ @return 表示する場合YES
+ */
+- (BOOL)updateVisibility
+{
+    // 表示範囲の半径に画像の大きさと余白を加えて判定距離とする
+    float margin = kAKCullingMargin;
+    if (UI_USER_INTERFACE_IDIOM() == UIUserInterfaceIdiomPad) {
+        margin *= 2.0f;
+    }
+    float radius = AKVisibleRadius() + MAX(width_, height_) + margin;
+    
+    // 自機の表示位置からの距離の2乗を計算する
+    float dx = screenPos_.x - AKPlayerPosX();
+    float dy = screenPos_.y - AKPlayerPosY();
+    return (dx * dx + dy * dy <= radius * radius);
+}
+
 /*!
  @brief キャラクター固有の動作
 
@@ -224,6 +390,37 @@
     // 派生クラスで動作を定義する
 }
 
+/*!
+ @brief 描画状態の追加
+
+ 現在のスクリーン座標と向きを設定した描画状態を描画状態バッファに追加する。
+ @param flags 反映する項目(AKRenderFlagの組み合わせ)
+ @return 追加した描画状態。追加に失敗した場合はNULL。
+ */
+- (struct AKRenderState *)pushRenderState:(uint32_t)flags
+{
+    struct AKRenderState *state = [[AKRenderBuffer sharedBuffer] push:self];
+    if (state) {
+        state->flags = flags;
+        state->position = screenPos_;
+        state->rotation = AKCnvAngleRad2Scr(angle_);
+    }
+    
+    return state;
+}
+
+/*!
+ @brief アニメーションフレームの反映
+
+ 描画状態の反映時に、アニメーションフレームを画像に反映する。
+ 基本クラスではアニメーションは行わない。
+ @param frame アニメーションフレーム
+ */
+- (void)applyFrame:(NSInteger)frame
+{
+    // 派生クラスでアニメーションを定義する
+}
+
 /*!
  @brief 破壊処理
 
@@ -239,6 +436,35 @@
     [self.image removeFromParentAndCleanup:YES];
 }
 
+/*!
+ @brief 再利用のための削除
+
+ プールに空きがないときに配置中のキャラクターを再利用するため、破壊処理を行わずに画面から取り除く。
+ 画像の世代を更新し、反映前の描画状態や実行中の弾幕パターンが再利用後のキャラクターに適用されないようにする。
+ */
+- (void)retire
+{
+    // ステージ配置フラグを落とす
+    self.isStaged = NO;
+    
+    // 画面から取り除く
+    [self.image removeFromParentAndCleanup:YES];
+    
+    // 画像の世代を更新する
+    [self invalidateImage];
+}
+
+/*!
+ @brief 画像の世代の更新
+
+ 画像を差し替えずに再利用する場合に世代を更新し、
+ 反映前の描画状態や実行中の弾幕パターンが再利用後のキャラクターに適用されないようにする。
+ */
+- (void)invalidateImage
+{
+    imageGeneration_++;
+}
+
 /*!
  @brief 衝突判定
 
@@ -263,10 +489,12 @@
     }
     
     // 自キャラの上下左右の端を計算する
-    myleft = self.image.position.x - self.width / 2.0f;
-    myright = self.image.position.x + self.width / 2.0f;
-    mytop = self.image.position.y + self.height / 2.0f;
-    mybottom = self.image.position.y - self.height / 2.0f;
+    // 画像の表示は詳細度によって更新されない場合があるため、スクリーン座標を使用する
+    CGPoint mypos = screenPos_;
+    myleft = mypos.x - width_ / 2.0f;
+    myright = mypos.x + width_ / 2.0f;
+    mytop = mypos.y + height_ / 2.0f;
+    mybottom = mypos.y - height_ / 2.0f;
     
     AKLog(0, @"    my=(%f, %f, %f, %f)", myleft, myright, mytop, mybottom);
     
@@ -279,10 +507,13 @@
         }
         
         // 相手の上下左右の端を計算する
-        targetleft = target.image.position.x - target.width / 2.0f;
-        targetright = target.image.position.x + target.width / 2.0f;
-        targettop = target.image.position.y + target.height / 2.0f;
-        targetbottom = target.image.position.y - target.height / 2.0f;
+        CGPoint targetpos = target.screenPos;
+        float targethalfw = target.width / 2.0f;
+        float targethalfh = target.height / 2.0f;
+        targetleft = targetpos.x - targethalfw;
+        targetright = targetpos.x + targethalfw;
+        targettop = targetpos.y + targethalfh;
+        targetbottom = targetpos.y - targethalfh;
         
         AKLog(0, @"target=(%f, %f, %f, %f)", targetleft, targetright, targettop, targetbottom);
         
@@ -299,9 +530,80 @@
             // 自分と相手のHPを減らす
             self.hitPoint--;
             target.hitPoint--;
+            AKTraceInstant("hit");
             
             AKLog(0, @"self.hitPoint=%d, target.hitPoint=%d", self.hitPoint, target.hitPoint);
         }
     }
 }
+
+/*!
+ @brief 状態の保存
+
+ 中断時のスナップショットに保存するため、キャラクターの状態を固定長の構造体に書き出す。
+ 派生クラスで固有の状態を持つ場合はオーバーライドして追加する。
+ @param record 書き込み先
+ */
+- (void)saveRecord:(struct AKCharacterRecord *)record
+{
+    // パディングや未使用のメンバが不定値にならないように0クリアする
+    memset(record, 0, sizeof(*record));
+    
+    record->absx = absx_;
+    record->absy = absy_;
+    record->angle = angle_;
+    record->speed = speed_;
+    record->rotSpeed = rotSpeed_;
+    record->hitPoint = (int32_t)hitPoint_;
+}
+
+/*!
+ @brief 状態の復元
+
+ スナップショットに保存した状態を反映する。
+ 生成処理を行った後に呼び出し、生成時の初期値を上書きする。
+ @param record 保存した状態
+ */
+- (void)loadRecord:(const struct AKCharacterRecord *)record
+{
+    self.absx = record->absx;
+    self.absy = record->absy;
+    angle_ = record->angle;
+    speed_ = record->speed;
+    rotSpeed_ = record->rotSpeed;
+    hitPoint_ = record->hitPoint;
+}
+
+/*!
+ @brief 処理数のクリア
+
+ フレームごとの移動処理を行ったキャラクターの数と表示したキャラクターの数をクリアする。
+ */
++ (void)resetNodeCount
+{
+    visitedNodeCount_ = 0;
+    drawnNodeCount_ = 0;
+}
+
+/*!
+ @brief 移動処理を行ったキャラクターの数取得
+
+ 前回のクリアから移動処理を行ったキャラクターの数を取得する。
+ @return 移動処理を行ったキャラクターの数
+ */
++ (NSInteger)visitedNodeCount
+{
+    return visitedNodeCount_;
+}
+
+/*!
+ @brief 表示したキャラクターの数取得
+
+ 前回のクリアから移動処理を行ったキャラクターのうち、表示範囲内のものの数を取得する。
+ @return 表示したキャラクターの数
+ */
++ (NSInteger)drawnNodeCount
+{
+    return drawnNodeCount_;
+}
 @end
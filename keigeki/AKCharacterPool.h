@@ -36,6 +36,15 @@
 #import <Foundation/Foundation.h>
 #import <UIKit/UIKit.h>
 #import "AKCharacter.h"
+#import "AKKinematics.h"
+
+/// 空きがないときの動作
+enum AKPoolOverflowPolicy {
+    kAKPoolOverflowDropNewest = 0,  ///< 新しいキャラクターを生成しない
+    kAKPoolOverflowRecycleOldest,   ///< 最も古いキャラクターを再利用する
+    kAKPoolOverflowRecycleFarthest, ///< 画面中心から最も遠いキャラクターを再利用する
+    kAKPoolOverflowGrow             ///< 上限までプールを拡張する
+};
 
 // キャラクタープールクラス
 @interface AKCharacterPool : NSObject {
@@ -47,15 +56,65 @@
     NSInteger size_;
     /// 次にキャラクターを追加するインデックス
     NSInteger next_;
+    /// 位置の一括計算用の配列
+    struct AKKinematicsBatch batch_;
+    /// 空きがないときの動作
+    enum AKPoolOverflowPolicy policy_;
+    /// 拡張時の配列サイズの上限
+    NSInteger limit_;
+    /// キャラクターごとの取得順序
+    uint32_t *serials_;
+    /// 取得順序の配列のサイズ
+    NSInteger serialCapacity_;
+    /// 最後に取得したキャラクターの取得順序
+    uint32_t lastSerial_;
+    /// 最後に移動処理を行ったときの取得順序
+    uint32_t movedSerial_;
+    /// 同時に配置されていたキャラクター数の最大値
+    NSInteger peakCount_;
+    /// 空きがなく生成できなかった回数
+    NSInteger dropCount_;
+    /// 配置中のキャラクターを再利用した回数
+    NSInteger recycleCount_;
+    /// 配列サイズを超えて生成した回数
+    NSInteger growCount_;
 }
 
 /// キャラクターを管理する配列
 @property (nonatomic, retain)NSMutableArray *pool;
+/// 配列サイズ
+@property (nonatomic, readonly)NSInteger size;
+/// 空きがないときの動作
+@property (nonatomic)enum AKPoolOverflowPolicy policy;
+/// 拡張時の配列サイズの上限
+@property (nonatomic)NSInteger limit;
+/// 同時に配置されていたキャラクター数の最大値
+@property (nonatomic, readonly)NSInteger peakCount;
+/// 空きがなく生成できなかった回数
+@property (nonatomic, readonly)NSInteger dropCount;
+/// 配置中のキャラクターを再利用した回数
+@property (nonatomic, readonly)NSInteger recycleCount;
 
 // 初期化処理
 - (id)initWithClass:(Class)characlass Size:(NSInteger)size;
 // 未使用キャラクター取得
 - (id)getNext;
+// キャラクターの追加
+- (AKCharacter *)addCharacter;
+// 再利用するキャラクターの検索
+- (NSInteger)findRecycleIndex;
 // 全キャラクター削除
 - (void)reset;
+// 使用状況のクリア
+- (void)resetUsage;
+// 移動後の使用状況の更新
+- (void)updateUsage;
+// 使用状況の出力
+- (void)reportUsage;
+// 全キャラクターの移動
+- (BOOL)moveAll:(ccTime)dt ScreenX:(NSInteger)scrx ScreenY:(NSInteger)scry;
+// 並列処理の有効/無効設定
++ (void)setParallelEnabled:(BOOL)enabled;
+// 並列処理が有効かどうか
++ (BOOL)isParallelEnabled;
 @end
@@ -35,6 +35,18 @@
 
 #import "AKCharacterPool.h"
 #import "AKCommon.h"
+#import "AKScreenSize.h"
+#import "AKTrace.h"
+
+/// 位置の計算を並列に行うキャラクター数の下限
+static const NSInteger kAKParallelMinSize = 1024;
+/// 並列処理1回あたりのキャラクター数(一度に計算する要素の数の倍数とする)
+static const NSInteger kAKParallelChunkSize = 512;
+
+/// 並列処理が有効かどうか
+static BOOL isParallelEnabled_ = NO;
+/// 並列処理の有効/無効が設定済みかどうか
+static BOOL isParallelConfigured_ = NO;
 
 /*!
  @brief キャラクタープールクラス
@@ -44,20 +56,25 @@
 @implementation AKCharacterPool
 
 @synthesize pool = pool_;
+@synthesize size = size_;
+@synthesize policy = policy_;
+@synthesize limit = limit_;
+@synthesize peakCount = peakCount_;
+@synthesize dropCount = dropCount_;
+@synthesize recycleCount = recycleCount_;
 
 /*!
  @brief オブジェクト生成処理
 
  オブジェクトの生成を行う。
+ シーン生成時間を短くするため、キャラクターはここでは生成せず、
+ getNextで未使用のキャラクターがない場合にプールのサイズまで追加で生成する。
  @param characlass 管理するキャラクターのクラス
  @param size 管理するプールのサイズ
  @return 生成したオブジェクト。失敗時はnilを返す。
  */
 - (id)initWithClass:(Class)characlass Size:(NSInteger)size
 {
-    int i = 0;                  // ループ変数
-    AKCharacter *character = nil; // キャラクター生成用バッファ
-    
     AKLog(0, @"class=%@ size=%d", characlass, size);
     
     // スーパークラスの生成処理
@@ -72,16 +89,23 @@
     
     // プールの生成
     self.pool = [NSMutableArray arrayWithCapacity:size_];
-
-    // キャラクターの生成
-    for (i = 0; i < size_; i++) {
-        character = [[[class_ alloc] init] autorelease];
-        [pool_ addObject:character];
-    }
     
     // 次にキャラクターを生成するインデックスを初期化する
     next_ = 0;
     
+    // 位置の一括計算用の配列は移動処理で必要になったときに確保する
+    memset(&batch_, 0, sizeof(batch_));
+    
+    // 空きがないときは生成しない
+    policy_ = kAKPoolOverflowDropNewest;
+    limit_ = size_;
+    
+    // 取得順序の配列は取得時に必要になったときに確保する
+    serials_ = NULL;
+    serialCapacity_ = 0;
+    lastSerial_ = 0;
+    movedSerial_ = 0;
+    
     return self;
 }
 
@@ -95,6 +119,12 @@
     // プールのメモリを解放する
     self.pool = nil;
     
+    // 位置の一括計算用の配列を解放する
+    AKKinematicsRelease(&batch_);
+    
+    // 取得順序の配列を解放する
+    free(serials_);
+    
     // スーパークラスの解放処理
     [super dealloc];
 }
@@ -103,6 +133,8 @@
  @brief 未使用キャラクター取得
 
  キャラクタープールの中から未使用のキャラクターを検索して返す。
+ 生成済みのキャラクターがすべて使用中の場合は、プールのサイズまで新たに生成する。
+ プールのサイズまで使用中の場合は、空きがないときの動作に従う。
  @return 未使用キャラクター。見つからないときはnilを返す。
  */
 - (id)getNext
@@ -110,17 +142,20 @@
     int i = 0;              // ループ変数
     AKCharacter *ret = nil;   // 戻り値
     AKCharacter *work = nil;  // ワーク変数
+    NSInteger index = 0;    // 戻り値のインデックス
+    NSInteger count = [pool_ count];    // 生成済みのキャラクターの数
     
-    AKLog(0, @"m_size=%d", size_);
+    AKLog(0, @"m_size=%d count=%d", size_, count);
     
     // 未使用のキャラクターを検索する
-    for (i = 0; i < size_; i++) {
+    for (i = 0; i < count; i++) {
         
         // キャラクターを取得する
-        work = [pool_ objectAtIndex:next_];
+        index = next_;
+        work = [pool_ objectAtIndex:index];
         
         // インデックスを進める
-        next_ = (next_ + 1) % size_;
+        next_ = (next_ + 1) % count;
         
         AKLog(0, @"i=%d work.isStaged=%d", i, work.isStaged);
         
@@ -133,6 +168,124 @@
         }
     }
     
+    // 未使用のキャラクターがない場合は空きがないときの動作に従う
+    if (ret == nil) {
+        
+        // サイズに余裕がある場合、または拡張する設定で上限に余裕がある場合は新たに生成する
+        if (count < size_ || (policy_ == kAKPoolOverflowGrow && count < limit_)) {
+            ret = [self addCharacter];
+            index = count;
+            
+            if (count >= size_) {
+                growCount_++;
+            }
+        }
+        // 再利用する設定の場合は配置中のキャラクターを取り除いて再利用する
+        else if (policy_ == kAKPoolOverflowRecycleOldest || policy_ == kAKPoolOverflowRecycleFarthest) {
+            index = [self findRecycleIndex];
+            if (index >= 0) {
+                ret = [pool_ objectAtIndex:index];
+                [ret retire];
+                recycleCount_++;
+                AKTraceInstant("poolRecycle");
+            }
+        }
+        
+        // 生成できない場合は回数を記録する
+        if (ret == nil) {
+            dropCount_++;
+            AKLog(dropCount_ == 1, @"%@のプールに空きなし", NSStringFromClass(class_));
+            AKTraceInstant("poolDrop");
+            return nil;
+        }
+    }
+    
+    // 取得順序を記録する
+    serials_[index] = ++lastSerial_;
+    
+    return ret;
+}
+
+/*!
+ @brief キャラクターの追加
+
+ キャラクターを生成してプールに追加する。
+ 取得順序の配列が足りない場合は拡張する。
+ @return 追加したキャラクター。取得順序の配列を確保できない場合はnil。
+ */
+- (AKCharacter *)addCharacter
+{
+    NSInteger count = [pool_ count];    // 生成済みのキャラクターの数
+    
+    // 取得順序の配列が足りない場合は拡張する
+    if (count >= serialCapacity_) {
+        
+        NSInteger capacity = MAX(count + 1, MAX(size_, serialCapacity_ * 2));
+        uint32_t *serials = realloc(serials_, capacity * sizeof(uint32_t));
+        if (serials == NULL) {
+            AKLog(1, @"取得順序の配列の確保に失敗:%d", capacity);
+            return nil;
+        }
+        
+        serials_ = serials;
+        serialCapacity_ = capacity;
+    }
+    
+    AKCharacter *character = [[[class_ alloc] init] autorelease];
+    [pool_ addObject:character];
+    
+    // 次回は先頭から検索する
+    next_ = 0;
+    
+    return character;
+}
+
+/*!
+ @brief 再利用するキャラクターの検索
+
+ 空きがないときの動作に従い、再利用する配置中のキャラクターを検索する。
+ 古いものを再利用する場合は最も前に取得したものを選ぶ。
+ 遠いものを再利用する場合は画面中心から最も遠いものを選ぶ。
+ ただし、取得後に移動処理を行っていないものは画面上の位置が決まっていないため対象外とする。
+ @return 再利用するキャラクターのインデックス。見つからないときは-1。
+ */
+- (NSInteger)findRecycleIndex
+{
+    NSInteger ret = -1;         // 戻り値
+    uint32_t oldest = 0;        // 最も古い取得順序
+    float farthest = -1.0f;     // 最も遠い距離の2乗
+    CGPoint center = [AKScreenSize center];     // 画面中心
+    NSInteger count = [pool_ count];    // 生成済みのキャラクターの数
+    
+    for (NSInteger i = 0; i < count; i++) {
+        
+        AKCharacter *character = [pool_ objectAtIndex:i];
+        
+        // 配置されていないもの、破壊処理待ちのものは対象外とする
+        if (!character.isStaged || character.hitPoint <= 0) {
+            continue;
+        }
+        
+        // 取得順序は32bitで一周するため、現在の値からの差で比較する
+        uint32_t age = lastSerial_ - serials_[i];
+        
+        if (policy_ == kAKPoolOverflowRecycleOldest) {
+            if (ret < 0 || age > oldest) {
+                ret = i;
+                oldest = age;
+            }
+        }
+        else if (age >= lastSerial_ - movedSerial_) {
+            float dx = character.screenPos.x - center.x;
+            float dy = character.screenPos.y - center.y;
+            float distance = dx * dx + dy * dy;
+            if (distance > farthest) {
+                ret = i;
+                farthest = distance;
+            }
+        }
+    }
+    
     return ret;
 }
 
@@ -163,5 +316,199 @@
     
     // インデックスを初期化する
     next_ = 0;
+    
+    // 使用状況をクリアする
+    [self resetUsage];
+}
+
+/*!
+ @brief 使用状況のクリア
+ 
+ 同時に配置されていたキャラクター数の最大値と、空きがなかったときの処理回数をクリアする。
+ 画面上のキャラクターは取り除かない。
+ */
+- (void)resetUsage
+{
+    peakCount_ = 0;
+    dropCount_ = 0;
+    recycleCount_ = 0;
+    growCount_ = 0;
+}
+
+/*!
+ @brief 移動後の使用状況の更新
+
+ moveAll:ScreenX:ScreenY:を使わずにキャラクターごとに移動処理を行うプールで、
+ 移動処理の後に呼び出して同時に配置されているキャラクター数の最大値と画面上の位置が決まった範囲を更新する。
+ */
+- (void)updateUsage
+{
+    NSInteger stagedCount = 0;  // 配置されているキャラクターの数
+    
+    for (AKCharacter *character in pool_) {
+        if (character.isStaged) {
+            stagedCount++;
+        }
+    }
+    
+    // 同時に配置されていたキャラクター数の最大値を更新する
+    if (stagedCount > peakCount_) {
+        peakCount_ = stagedCount;
+    }
+    
+    // ここまでに取得したキャラクターは画面上の位置が決まっている
+    movedSerial_ = lastSerial_;
+}
+
+/*!
+ @brief 使用状況の出力
+
+ 同時に配置されていたキャラクター数の最大値と、空きがなかったときの処理回数を出力する。
+ ステージ終了時など、プールのサイズを見直すための情報として使用する。
+ */
+- (void)reportUsage
+{
+    AKLog(1, @"pool %@ peak=%d/%d created=%d drop=%d recycle=%d grow=%d",
+          NSStringFromClass(class_), peakCount_, size_, [pool_ count],
+          dropCount_, recycleCount_, growCount_);
+}
+
+/*!
+ @brief 全キャラクターの移動
+
+ プール内の全キャラクターの移動処理を行う。
+ 位置の計算は、配置されているキャラクターの値を種類ごとの配列に取り出し、
+ AKKinematicsIntegrateで4体ずつまとめて行ってから各キャラクターに書き戻す。
+ 計算するキャラクターが多い場合はGCDのワーカースレッドで分割して並列に行う。
+ 配列を確保できない場合はスタック上の配列で少数ずつ計算する。
+ どの場合も同じAKKinematicsIntegrateで計算し、各要素の計算内容は分割によらないため、
+ 結果はスレッド数や分割の仕方によらず一致する。
+ integrate:を上書きするクラスはこの計算の対象外となるため、プールでは管理しないこと。
+ 破壊処理、表示の更新、キャラクター固有の動作はイベントバッファなどを操作するため、
+ メインスレッドでプールの順番に行う。
+ @param dt フレーム更新間隔
+ @param scrx スクリーン座標x
+ @param scry スクリーン座標y
+ @return 画面に配置されているキャラクターが存在した場合YES
+ */
+- (BOOL)moveAll:(ccTime)dt ScreenX:(NSInteger)scrx ScreenY:(NSInteger)scry
+{
+    BOOL isExist = NO;  // 配置されているキャラクターが存在するかどうか
+    NSInteger stagedCount = 0;  // 配置されているキャラクターの数
+    
+    AKTraceBegin("moveAll");
+    
+    // ここまでに取得したキャラクターは移動後に画面上の位置が決まる
+    movedSerial_ = lastSerial_;
+    
+    // 移動計算パラメータを作成する
+    struct AKMoveParam param = AKMakeMoveParam(dt, scrx, scry);
+    
+    // 生成済みのキャラクターが入るように配列を確保する
+    if (batch_.capacity < [pool_ count] && !AKKinematicsReserve(&batch_, [pool_ count])) {
+        
+        // 確保できない場合はスタック上の配列で少数ずつ計算する
+        // 計算結果が一致するように、並列に計算する場合と同じAKKinematicsIntegrateを使用する
+        struct AKKinematicsStackBatch stack;
+        AKKinematicsInitStackBatch(&stack);
+        for (AKCharacter *character in pool_) {
+            [character packKinematics:&stack.batch];
+            if (stack.batch.count >= stack.batch.capacity) {
+                AKKinematicsFlush(&stack.batch, &param);
+            }
+        }
+        AKKinematicsFlush(&stack.batch, &param);
+    }
+    else {
+        
+        // 位置の計算に使用する値を取り出す
+        batch_.count = 0;
+        for (AKCharacter *character in pool_) {
+            [character packKinematics:&batch_];
+        }
+        
+        // 計算するキャラクターが多い場合は並列に計算する
+        NSInteger count = batch_.count;
+        if (count >= kAKParallelMinSize && [AKCharacterPool isParallelEnabled]) {
+            
+            struct AKKinematicsBatch *batch = &batch_;
+            size_t chunkCount = (count + kAKParallelChunkSize - 1) / kAKParallelChunkSize;
+            
+            dispatch_apply(chunkCount, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_HIGH, 0), ^(size_t chunk) {
+                
+                AKTraceBegin("integrate");
+                AKKinematicsIntegrate(batch,
+                                      chunk * kAKParallelChunkSize,
+                                      MIN((NSInteger)(chunk + 1) * kAKParallelChunkSize, count),
+                                      &param);
+                AKTraceEnd("integrate");
+            });
+        }
+        else {
+            AKKinematicsIntegrate(&batch_, 0, count, &param);
+        }
+        
+        // 計算結果を書き戻す
+        for (NSInteger i = 0; i < count; i++) {
+            [batch_.characters[i] unpackKinematics:&batch_ index:i];
+        }
+    }
+    
+    // 破壊処理、表示の更新と固有の動作をプールの順番に行う
+    for (AKCharacter *character in pool_) {
+        
+        // 画面に配置されていない場合は無処理
+        if (!character.isStaged) {
+            continue;
+        }
+        
+        isExist = YES;
+        stagedCount++;
+        
+        // HPが0になった場合は破壊処理を行う
+        if (character.hitPoint <= 0) {
+            [character destroy];
+            continue;
+        }
+        
+        [character applyMove:dt];
+    }
+    
+    // 同時に配置されていたキャラクター数の最大値を更新する
+    if (stagedCount > peakCount_) {
+        peakCount_ = stagedCount;
+    }
+    
+    AKTraceEnd("moveAll");
+    
+    return isExist;
+}
+
+/*!
+ @brief 並列処理の有効/無効設定
+
+ 位置の計算を並列に行うかどうかを設定する。
+ @param enabled 並列に行う場合YES
+ */
++ (void)setParallelEnabled:(BOOL)enabled
+{
+    isParallelEnabled_ = enabled;
+    isParallelConfigured_ = YES;
+}
+
+/*!
+ @brief 並列処理が有効かどうか
+
+ 位置の計算を並列に行うかどうかを返す。
+ 設定されていない場合はCPUのコア数が複数の場合に有効とする。
+ @return 並列に行う場合YES
+ */
++ (BOOL)isParallelEnabled
+{
+    if (!isParallelConfigured_) {
+        [self setParallelEnabled:([[NSProcessInfo processInfo] activeProcessorCount] > 1)];
+    }
+    
+    return isParallelEnabled_;
 }
 @end
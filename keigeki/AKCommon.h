@@ -39,8 +39,6 @@
 #import <Foundation/Foundation.h>
 #import "cocos2d.h"
 
-// 同時に生成可能な敵の最大数
-extern const NSInteger kAKMaxEnemyCount;
 /// メニュー選択時の効果音
 extern NSString *kAKMenuSelectSE;
 
@@ -73,6 +71,7 @@ float AKRangeCheckF(float val, float min, float max);
 
 // 角度変換
 float AKCnvAngleRad2Deg(float radAngle);
+float AKCnvAngleDeg2Rad(float degAngle);
 float AKCnvAngleRad2Scr(float radAngle);
 
 // 2点間の角度計算
@@ -82,7 +81,7 @@ float AKCalcDestAngle(float srcx, float srcy, float dstx, float dsty);
 int AKCalcRotDirect(float angle, float srcx, float srcy, float dstx, float dsty);
 
 // n-way弾発射時の方向計算
-NSArray* AKCalcNWayAngle(int count, float centerAngle, float space);
+void AKCalcNWayAngles(int count, float centerAngle, float space, float *angles);
 
 // 矩形内判定
 BOOL AKIsInside(CGPoint point, CGRect rect);
@@ -99,4 +98,7 @@ float AKPlayerPosX(void);
 // 自機の表示位置のy座標を取得する
 float AKPlayerPosY(void);
 
+// 画面の表示範囲の半径を取得する
+float AKVisibleRadius(void);
+
 #endif
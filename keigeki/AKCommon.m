@@ -38,8 +38,6 @@
 #import "AKScreenSize.h"
 #import "AKCommon.h"
 
-/// 同時に生成可能な敵の最大数
-const NSInteger kAKMaxEnemyCount = 16;
 /// メニュー選択時の効果音
 NSString *kAKMenuSelectSE = @"ScoreCount.caf";
 
@@ -72,6 +70,9 @@ float AKRangeCheckF(float val, float min, float max)
  @brief 範囲チェック(ループ、 実数)
 
  値が範囲内にあるかチェックし、範囲外にあれば反対側にループする。
+ 通常は1周分ずらせば範囲内に戻るため、まず1周分だけずらす。
+ それでも範囲外の場合は繰り返しではなく剰余で一度に補正する。
+ 最小値未満の場合は最小値以上最大値未満、最大値超過の場合は最小値超過最大値以下に補正する。
  @param val 値
  @param min 最小値
  @param max 最大値
@@ -79,13 +80,42 @@ float AKRangeCheckF(float val, float min, float max)
  */
 float AKRangeCheckLF(float val, float min, float max)
 {
+    float range = 0.0f;     // 範囲の幅
+    float over = 0.0f;      // 範囲からはみ出した量
+    
     // 最小値未満
     if (val < min) {
-        return AKRangeCheckLF(val + (max - min), min, max);
+        
+        // 1周分ずらして範囲内に戻った場合はその値とする
+        range = max - min;
+        if (val + range >= min) {
+            return val + range;
+        }
+        
+        // 範囲の幅がない場合は最小値とする
+        if (range <= 0.0f) {
+            return min;
+        }
+        
+        over = fmodf(min - val, range);
+        return (over > 0.0f) ? max - over : min;
     }
     // 最大値超過
     else if (val > max) {
-        return AKRangeCheckLF(val - (max - min), min, max);
+        
+        // 1周分ずらして範囲内に戻った場合はその値とする
+        range = max - min;
+        if (val - range <= max) {
+            return val - range;
+        }
+        
+        // 範囲の幅がない場合は最小値とする
+        if (range <= 0.0f) {
+            return min;
+        }
+        
+        over = fmodf(val - max, range);
+        return (over > 0.0f) ? min + over : max;
     }
     // 範囲内
     else {
@@ -103,7 +133,20 @@ float AKRangeCheckLF(float val, float min, float max)
 float AKCnvAngleRad2Deg(float radAngle)
 {
     // radianからdegreeへ変換する
-    return radAngle / (2 * M_PI) * 360;
+    return radAngle * (180.0f / (float)M_PI);
+}
+
+/*!
+ @brief deg角度からrad角度への変換
+
+ degreeからradianへ変換する。
+ @param degAngle deg角度
+ @return rad角度
+ */
+float AKCnvAngleDeg2Rad(float degAngle)
+{
+    // degreeからradianへ変換する
+    return degAngle * ((float)M_PI / 180.0f);
 }
 
 /*!
@@ -121,10 +164,10 @@ float AKCnvAngleRad2Scr(float radAngle)
     srcAngle = AKCnvAngleRad2Deg(radAngle);
     
     // 上向きを0°とするため、90°ずらす。
-    srcAngle -= 90;
+    srcAngle -= 90.0f;
     
     // 時計回りを正とするため符号を反転する。
-    srcAngle *= -1;
+    srcAngle *= -1.0f;
     
     return srcAngle;
 }
@@ -133,6 +176,7 @@ float AKCnvAngleRad2Scr(float radAngle)
  @brief 2点間の角度計算
 
  2点間を線で結んだときの角度を計算する。
+ 2点が同じ位置の場合は角度が決まらないため0とする。
  @param srcx 出発点x座標
  @param srcy 出発点y座標
  @param dstx 到達点x座標
@@ -148,6 +192,12 @@ float AKCalcDestAngle(float srcx, float srcy, float dstx, float dsty)
     // 角度を計算する
     vx = dstx - srcx;
     vy = dsty - srcy;
+    
+    // 2点が同じ位置の場合は0とする
+    if (vx == 0.0f && vy == 0.0f) {
+        return 0.0f;
+    }
+    
     angle = atan(vy / vx);
 
     // 第2象限、第3象限の場合はπ進める
@@ -186,7 +236,7 @@ int AKCalcRotDirect(float angle, float srcx, float srcy, float dstx, float dsty)
     // 現在の角度から見て入力角度が時計回りの側か反時計回りの側か調べる
     // sin(目的角度 - 現在の角度) > 0の場合は反時計回り
     // sin(目的角度 - 現在の角度) < 0の場合は時計回り
-    destsin = sin(destangle - angle);
+    destsin = sinf(destangle - angle);
     
     // 回転方向を設定する
     if (destsin > 0.0f) {
@@ -200,7 +250,7 @@ int AKCalcRotDirect(float angle, float srcx, float srcy, float dstx, float dsty)
         // 同じ向きか反対向きか調べる
         // cos(入力角度 - 現在角度) < 0の場合は反対向き
         // 反対向きの場合は反時計回りとする
-        destcos = cos(destangle - angle);
+        destcos = cosf(destangle - angle);
         if (destcos < 0.0f) {
             rotdirect = 1;
         }
@@ -215,41 +265,25 @@ int AKCalcRotDirect(float angle, float srcx, float srcy, float dstx, float dsty)
 /*!
  @brief n-way弾発射時の方向計算
  
- n-way弾を発射するときの角度を計算する。
+ n-way弾を発射するときの角度を計算し、呼び出し元の配列に格納する。
+ オブジェクトを生成しないため、弾の発射ごとに呼び出す場合はこちらを使用する。
  @param count 弾の数
  @param centerAngle n-way弾の中心の角度
  @param space 2点間の間隔
- @return n-way弾の角度配列(autorelease済)
+ @param angles 角度格納先の配列(count個以上の要素を持つこと)
  */
-NSArray* AKCalcNWayAngle(int count, float centerAngle, float space)
+void AKCalcNWayAngles(int count, float centerAngle, float space, float *angles)
 {
     int i = 0;                          // ループ変数
-    float angle = 0.0f;                 // 弾を発射する角度
     float minAngle = 0.0f;              // n-way弾の最小の角度
-    NSNumber *angleObj = nil;           // 角度をNSArrayに格納するためのオブジェクト
-    NSMutableArray *angleArray = nil;   // n-way弾の角度配列
-    
-    // 角度格納用配列を生成する
-    angleArray = [NSMutableArray arrayWithCapacity:count];
     
     // 最小値の角度を計算する
     minAngle = centerAngle - (space * (count - 1)) / 2.0f;
     
     // 各弾の発射角度を計算する
     for (i = 0; i < count; i++) {
-        
-        // 弾の角度を計算する
-        angle = minAngle + i * space;
-        
-        // NSArrayに格納するためにオブジェクトを作成する
-        angleObj = [NSNumber numberWithFloat:angle];
-        
-        // 戻り値の配列に追加する
-        [angleArray addObject:angleObj];
+        angles[i] = minAngle + i * space;
     }
-    
-    // 計算した角度の配列を返す
-    return angleArray;
 }
 
 /*!
@@ -347,3 +381,19 @@ float AKPlayerPosY(void)
     
     return [AKScreenSize positionFromBottomRatio:kAKPlayerPosBottomRatio];
 }
+
+/*!
+ @brief 画面の表示範囲の半径を取得する
+ 
+ 画面は自機の表示位置を中心に回転するため、自機の表示位置から画面の四隅までの距離の最大値を
+ 表示範囲の半径とする。この円の外側にあるものは画面の向きによらず表示されない。
+ @return 画面の表示範囲の半径
+ */
+float AKVisibleRadius(void)
+{
+    // 自機の表示位置から画面の端までの距離の最大値を横方向、縦方向それぞれ求める
+    float dx = MAX(AKPlayerPosX(), [AKScreenSize screenSize].width - AKPlayerPosX());
+    float dy = MAX(AKPlayerPosY(), [AKScreenSize screenSize].height - AKPlayerPosY());
+    
+    return sqrtf(dx * dx + dy * dy);
+}
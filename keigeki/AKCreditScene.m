@@ -35,6 +35,7 @@
 
 #import "SimpleAudioEngine.h"
 #import "AKCreditScene.h"
+#import "AKTextureManager.h"
 #import "AKInterface.h"
 #import "AKScreenSize.h"
 #import "AKCommon.h"
@@ -69,6 +70,9 @@ enum {
         return nil;
     }
     
+    // このシーンで使用するテクスチャを登録する
+    [[AKTextureManager sharedManager] beginScene:NSStringFromClass([self class])];
+    
     // 背景色レイヤーを作成する
     CCLayerColor *backColor = AKCreateBackColorLayer();
     
@@ -34,6 +34,7 @@
  */
 
 #import "AKEffect.h"
+#import "AKTextureManager.h"
 #import "AKCommon.h"
 
 /*!
@@ -106,7 +107,8 @@
                        posX:(float)posx posY:(float)posy
 {
     // バッチノードを作成する
-    CCSpriteBatchNode *batch = [CCSpriteBatchNode batchNodeWithFile:fileName capacity:count];
+    CCSpriteBatchNode *batch = [CCSpriteBatchNode batchNodeWithTexture:[[AKTextureManager sharedManager] textureForFile:fileName]
+                                                              capacity:count];
     NSAssert(batch != nil, @"can not create CCSpriteBatchNode from %@", fileName);
     
     // 最初の1フレーム目のスプライトを作成する
@@ -127,12 +129,12 @@
     NSMutableArray *animationFrames = [NSMutableArray arrayWithCapacity:count];
     for (int i = 1; i < count; i++) {
         
-        // ファイルからスプライトフレームを作成する
-        CCSpriteFrame *spriteFrame = [CCSpriteFrame frameWithTextureFilename:fileName
-                                                                        rect:CGRectMake(rect.origin.x + rect.size.width * i,
-                                                                                        rect.origin.y,
-                                                                                        rect.size.width,
-                                                                                        rect.size.height)];
+        // テクスチャからスプライトフレームを作成する
+        CCSpriteFrame *spriteFrame = [CCSpriteFrame frameWithTexture:batch.texture
+                                                                rect:CGRectMake(rect.origin.x + rect.size.width * i,
+                                                                                rect.origin.y,
+                                                                                rect.size.width,
+                                                                                rect.size.height)];
         
         // 配列に追加する
         [animationFrames addObject:spriteFrame];
@@ -40,6 +40,8 @@
 
 // 敵クラス
 @interface AKEnemy : AKCharacter {
+    /// 敵の種類
+    NSInteger type_;
     /// 動作開始からの経過時間(各敵種別で使用)
     ccTime time_;
     /// 動作状態(各敵種別で使用)
@@ -48,8 +50,19 @@
     SEL action_;
     /// 破壊処理のセレクタ
     SEL destroy_;
+    /// 弾幕パターンID
+    NSInteger pattern_;
+    /// 詳細度(0が最も詳細)
+    NSInteger lodLevel_;
+    /// 前回の動作処理からのフレーム数
+    NSInteger lodFrame_;
+    /// 前回の動作処理からの経過時間
+    ccTime lodTime_;
 }
 
+/// 敵の種類
+@property (nonatomic)NSInteger type;
+
 // 生成処理
 - (void)createWithX:(NSInteger)x Y:(NSInteger)y Z:(NSInteger)z Angle:(float)angle
              Parent:(CCNode*)parent CreateSel:(SEL)create;
@@ -79,8 +92,4 @@
 - (void)actionCanon:(ccTime)dt;
 // 雑魚破壊処理
 - (void)destroyNormal;
-// 雑魚通常弾発射
-- (void)fireNormal;
-// n-Way弾発射
-- (void)fireNWay:(NSInteger)way;
 @end
@@ -33,10 +33,15 @@
  敵キャラクターのクラスの定義をする。
  */
 
-#import "SimpleAudioEngine.h"
 #import "AKEnemy.h"
-#import "AKGameScene.h"
+#import "AKTextureManager.h"
+#import "AKEnemyShot.h"
 #import "AKGameCenterHelper.h"
+#import "AKGameEventBuffer.h"
+#import "AKBulletPattern.h"
+
+/// 敵種別ごとの処理の関数ポインタ型
+typedef void (*AKEnemyAction)(id, SEL, ccTime);
 
 /// 敵を倒したときのスコア
 static const NSInteger kAKEnemyScore = 500;
@@ -49,17 +54,37 @@ static float kAKBackShortCos = -0.99f;
 static const NSInteger kAKEnemySpeed = 260;
 /// 雑魚の回転速度
 static const float kAKEnemyRotSpeed = 0.4f;
-/// 雑魚の弾発射の時間
-static const NSInteger kAKEnemyActionTime = 5;
 /// 雑魚の敵のサイズ
 static const NSInteger kAKEnemySize = 16;
 
+/// 雑魚の弾幕パターン名
+static NSString *kAKNormalPattern = @"normal";
+/// 高速移動の弾幕パターン名
+static NSString *kAKHighSpeedPattern = @"highspeed";
+/// 高速旋回の弾幕パターン名
+static NSString *kAKHighTurnPattern = @"highturn";
+/// 高速ショットの弾幕パターン名
+static NSString *kAKHighShotPattern = @"highshot";
+/// 3-Way弾発射の弾幕パターン名
+static NSString *kAKThreeWayPattern = @"3way";
+/// 大砲の弾幕パターン名
+static NSString *kAKCanonPattern = @"canon";
+
 /// 大砲の移動速度
 static const NSInteger kAKCanonSpeed = 120;
 /// 大砲の回転速度
 static const float kAKCanonRotSpeed = 0.7f;
 
 
+/// 詳細度の段階数
+enum {
+    kAKLodLevelCount = 3
+};
+/// 詳細度を下げる自機からの距離(画面の表示範囲の半径に対する比率)
+static const float kAKLodDistanceRatio[kAKLodLevelCount - 1] = {1.5f, 4.0f};
+/// 詳細度ごとの動作処理の間隔(フレーム数)
+static const NSInteger kAKLodInterval[kAKLodLevelCount] = {1, 2, 4};
+
 /// 爆発エフェクト画像のファイル名
 static NSString *kAKExplosion = @"Explosion.png";
 /// 爆発エフェクトの位置とサイズ
@@ -76,24 +101,101 @@ static const float kAKExplosionFrameDelay = 0.2f;
  */
 @implementation AKEnemy
 
+@synthesize type = type_;
+
+/*!
+ @brief 詳細度の更新
+
+ 自機からの距離によって詳細度を決める。
+ 画面の表示範囲(回転を考慮して自機の表示位置を中心とした円)よりも外側の距離で詳細度を下げるため、
+ 画面内に入る前に最も詳細な状態に戻る。
+ @return 最も詳細な状態の場合YES
+ */
+- (BOOL)updateLevelOfDetail
+{
+    // 画面の表示範囲の半径の2乗を計算する
+    float visibleRadius = AKVisibleRadius();
+    float baseDistance2 = visibleRadius * visibleRadius;
+    
+    // 自機からの距離の2乗を計算する
+    float dx = screenPos_.x - AKPlayerPosX();
+    float dy = screenPos_.y - AKPlayerPosY();
+    float distance2 = dx * dx + dy * dy;
+    
+    // 距離から詳細度を決める
+    lodLevel_ = 0;
+    for (int i = 0; i < kAKLodLevelCount - 1; i++) {
+        if (distance2 > baseDistance2 * kAKLodDistanceRatio[i] * kAKLodDistanceRatio[i]) {
+            lodLevel_ = i + 1;
+        }
+    }
+    
+    return (lodLevel_ == 0);
+}
+
 /*!
  @brief キャラクター固有の動作
 
  生成時に指定されたセレクタを呼び出す。
+ 詳細度が下がっている場合は一定フレームごとに呼び出し、その間の移動は前回の回転速度のまま進める。
+ 呼び出し時のフレーム更新間隔には前回の呼び出しからの経過時間を渡す。
  @param dt フレーム更新間隔
  */
 - (void)action:(ccTime)dt
 {
-    NSNumber *objdt = NULL;     // フレーム更新間隔(オブジェクト版)
+    ccTime actiondt = 0.0f;     // 敵種別ごとの処理に渡すフレーム更新間隔
     
     // 動作開始からの経過時間をカウントする
     time_ += dt;
     
-    // id型として渡すためにNSNumberを作成する
-    objdt = [NSNumber numberWithFloat:dt];
+    // 前回の動作処理からの経過時間をカウントする
+    lodTime_ += dt;
+    lodFrame_++;
+    
+    // 詳細度に応じた間隔に達していない場合は処理しない
+    if (lodFrame_ < kAKLodInterval[lodLevel_]) {
+        return;
+    }
+    
+    // 前回の動作処理からの経過時間を渡し、経過をクリアする
+    actiondt = lodTime_;
+    lodTime_ = 0.0f;
+    lodFrame_ = 0;
     
     // 敵種別ごとの処理を実行
-    [self performSelector:action_ withObject:objdt];
+    // performSelector:withObject:ではNSNumberの生成が必要になり、
+    // 毎フレームメモリ確保が発生するため、関数ポインタで直接呼び出す。
+    ((AKEnemyAction)[self methodForSelector:action_])(self, action_, actiondt);
+}
+
+/*!
+ @brief 状態の保存
+
+ 共通の状態に加えて、敵の種類と敵種別ごとの動作状態を書き出す。
+ @param record 書き込み先
+ */
+- (void)saveRecord:(struct AKCharacterRecord *)record
+{
+    [super saveRecord:record];
+    
+    record->type = (int32_t)type_;
+    record->time = time_;
+    record->state = (int32_t)state_;
+}
+
+/*!
+ @brief 状態の復元
+
+ 共通の状態に加えて、敵種別ごとの動作状態を反映する。
+ 敵の種類は生成処理で決まるため、ここでは設定しない。
+ @param record 保存した状態
+ */
+- (void)loadRecord:(const struct AKCharacterRecord *)record
+{
+    [super loadRecord:record];
+    
+    time_ = record->time;
+    state_ = record->state;
 }
 
 /*!
@@ -107,14 +209,14 @@ static const float kAKExplosionFrameDelay = 0.2f;
     float destAngle = 0.0f; // 敵から自機への角度
     
     // 破壊時の効果音を鳴らす
-    [[SimpleAudioEngine sharedEngine] playEffect:kAKHitSE];
+    [[AKGameEventBuffer sharedBuffer] pushSound:kAKHitSE];
     
     // 敵種別ごとの処理を実行
     [self performSelector:destroy_];
     
     // 敵の向きによって加算するスコアを変える。
     // 後ろを向いている場合が最大とする。
-    destAngle = AKCalcDestAngle(self.image.position.x, self.image.position.y,
+    destAngle = AKCalcDestAngle(screenPos_.x, screenPos_.y,
                                 AKPlayerPosX(), AKPlayerPosY());
     score = kAKEnemyScore * (2 - cos(destAngle - self.angle));
     
@@ -126,7 +228,7 @@ static const float kAKExplosionFrameDelay = 0.2f;
     }
     
     // スコアを加算する
-    [[AKGameScene getInstance] addScore:score];
+    [[AKGameEventBuffer sharedBuffer] pushScore:score];
     
     // 画像の解放
     [self.image removeFromParentAndCleanup:YES];
@@ -163,9 +265,20 @@ static const float kAKExplosionFrameDelay = 0.2f;
     // 状態をクリアする
     state_ = 0;
     
+    // 詳細度をクリアする
+    lodLevel_ = 0;
+    lodFrame_ = 0;
+    lodTime_ = 0.0f;
+    
+    // 弾幕パターンをクリアする
+    pattern_ = 0;
+    
     // 種別ごとの固有生成処理を実行する
     [self performSelector:create];
     
+    // 弾幕パターンを開始する
+    [[AKBulletPattern sharedPattern] startPattern:pattern_ owner:self];
+    
     // iPadの場合はサイズを倍にする
     if (UI_USER_INTERFACE_IDIOM() == UIUserInterfaceIdiomPad) {
         self.width *= 2;
@@ -189,8 +302,11 @@ static const float kAKExplosionFrameDelay = 0.2f;
     // 破壊処理を設定する
     destroy_ = @selector(destroyNormal);
     
+    // 弾幕パターンを設定する
+    pattern_ = [[AKBulletPattern sharedPattern] patternIDForName:kAKNormalPattern];
+    
     // 画像を読み込む
-    self.image = [CCSprite spriteWithFile:@"Enemy1.png"];
+    self.image = [CCSprite spriteWithTexture:[[AKTextureManager sharedManager] textureForFile:@"Enemy1.png"]];
     assert(image_ != nil);
     
     // 当たり判定サイズを設定する
@@ -219,8 +335,11 @@ static const float kAKExplosionFrameDelay = 0.2f;
     // 破壊処理を設定する
     destroy_ = @selector(destroyNormal);
     
+    // 弾幕パターンを設定する
+    pattern_ = [[AKBulletPattern sharedPattern] patternIDForName:kAKHighSpeedPattern];
+    
     // 画像を読み込む
-    self.image = [CCSprite spriteWithFile:@"Enemy3.png"];
+    self.image = [CCSprite spriteWithTexture:[[AKTextureManager sharedManager] textureForFile:@"Enemy3.png"]];
     assert(image_ != nil);
     
     // 当たり判定サイズを設定する
@@ -247,8 +366,11 @@ static const float kAKExplosionFrameDelay = 0.2f;
     // 破壊処理を設定する
     destroy_ = @selector(destroyNormal);
     
+    // 弾幕パターンを設定する
+    pattern_ = [[AKBulletPattern sharedPattern] patternIDForName:kAKHighTurnPattern];
+    
     // 画像を読み込む
-    self.image = [CCSprite spriteWithFile:@"Enemy2.png"];
+    self.image = [CCSprite spriteWithTexture:[[AKTextureManager sharedManager] textureForFile:@"Enemy2.png"]];
     assert(image_ != nil);
     
     // 当たり判定サイズを設定する
@@ -275,8 +397,11 @@ static const float kAKExplosionFrameDelay = 0.2f;
     // 破壊処理を設定する
     destroy_ = @selector(destroyNormal);
     
+    // 弾幕パターンを設定する
+    pattern_ = [[AKBulletPattern sharedPattern] patternIDForName:kAKHighShotPattern];
+    
     // 画像を読み込む
-    self.image = [CCSprite spriteWithFile:@"Enemy4.png"];
+    self.image = [CCSprite spriteWithTexture:[[AKTextureManager sharedManager] textureForFile:@"Enemy4.png"]];
     assert(image_ != nil);
     
     // 当たり判定サイズを設定する
@@ -303,8 +428,11 @@ static const float kAKExplosionFrameDelay = 0.2f;
     // 破壊処理を設定する
     destroy_ = @selector(destroyNormal);
     
+    // 弾幕パターンを設定する
+    pattern_ = [[AKBulletPattern sharedPattern] patternIDForName:kAKThreeWayPattern];
+    
     // 画像を読み込む
-    self.image = [CCSprite spriteWithFile:@"Enemy5.png"];
+    self.image = [CCSprite spriteWithTexture:[[AKTextureManager sharedManager] textureForFile:@"Enemy5.png"]];
     assert(image_ != nil);
     
     // 当たり判定サイズを設定する
@@ -331,8 +459,11 @@ static const float kAKExplosionFrameDelay = 0.2f;
     // 破壊処理を設定する
     destroy_ = @selector(destroyNormal);
     
+    // 弾幕パターンを設定する
+    pattern_ = [[AKBulletPattern sharedPattern] patternIDForName:kAKCanonPattern];
+    
     // 画像を読み込む
-    self.image = [CCSprite spriteWithFile:@"Enemy6.png"];
+    self.image = [CCSprite spriteWithTexture:[[AKTextureManager sharedManager] textureForFile:@"Enemy6.png"]];
     assert(image_ != nil);
     
     // 当たり判定サイズを設定する
@@ -349,7 +480,7 @@ static const float kAKExplosionFrameDelay = 0.2f;
 /*!
  @brief 雑魚動作
  
- 自機を追う。一定間隔で自機を狙う1-way弾発射。
+ 自機を追う。弾の発射は弾幕パターンで行う。
  @param dt フレーム更新間隔
  */
 - (void)actionNoraml:(ccTime)dt
@@ -357,31 +488,21 @@ static const float kAKExplosionFrameDelay = 0.2f;
     int rotdirect = 0;      // 回転方向
     
     // 回転方向を自機のある方に決定する
-    rotdirect = AKCalcRotDirect(angle_, self.image.position.x, self.image.position.y,
+    rotdirect = AKCalcRotDirect(angle_, screenPos_.x, screenPos_.y,
                                 AKPlayerPosX(), AKPlayerPosY());
     
     // 自機の方に向かって向きを回転する
     self.rotSpeed = rotdirect * kAKEnemyRotSpeed;
     AKLog(0, @"rotspeed=%f roddirect=%d", rotSpeed_, rotdirect);
     
-    // 一定時間経過しているときは自機を狙う1-way弾を発射する
-    if (time_ > kAKEnemyActionTime) {
-        
-        // 弾を発射する
-        [self fireNormal];
-        
-        // 動作時間の初期化を行う
-        time_ = 0.0f;
-    }
-    
-    AKLog(0, @"pos=(%f, %f) angle=%f", self.image.position.x, self.image.position.y,
+    AKLog(0, @"pos=(%f, %f) angle=%f", screenPos_.x, screenPos_.y,
           AKCnvAngleRad2Deg(angle_));
 }
 
 /*!
  @brief 高速移動動作処理
  
- 自機を追う。一定間隔で自機を狙う1-way弾発射。
+ 自機を追う。弾の発射は弾幕パターンで行う。
  @param dt フレーム更新間隔
  */
 - (void)actionHighSpeed:(ccTime)dt
@@ -389,31 +510,21 @@ static const float kAKExplosionFrameDelay = 0.2f;
     int rotdirect = 0;      // 回転方向
     
     // 回転方向を自機のある方に決定する
-    rotdirect = AKCalcRotDirect(angle_, self.image.position.x, self.image.position.y,
+    rotdirect = AKCalcRotDirect(angle_, screenPos_.x, screenPos_.y,
                                 AKPlayerPosX(), AKPlayerPosY());
     
     // 自機の方に向かって向きを回転する
     self.rotSpeed = rotdirect * kAKEnemyRotSpeed * 1.2;
     AKLog(0, @"rotspeed=%f roddirect=%d", rotSpeed_, rotdirect);
     
-    // 一定時間経過しているときは自機を狙う1-way弾を発射する
-    if (time_ > kAKEnemyActionTime) {
-        
-        // 弾を発射する
-        [self fireNormal];
-        
-        // 動作時間の初期化を行う
-        time_ = 0.0f;
-    }
-    
-    AKLog(0, @"pos=(%f, %f) angle=%f", self.image.position.x, self.image.position.y,
+    AKLog(0, @"pos=(%f, %f) angle=%f", screenPos_.x, screenPos_.y,
           AKCnvAngleRad2Deg(angle_));
 }
 
 /*!
  @brief 高速旋回動作処理
  
- 自機を追う。一定間隔で自機を狙う1-way弾発射。
+ 自機を追う。弾の発射は弾幕パターンで行う。
  @param dt フレーム更新間隔
  */
 - (void)actionHighTurn:(ccTime)dt
@@ -421,27 +532,17 @@ static const float kAKExplosionFrameDelay = 0.2f;
     int rotdirect = 0;      // 回転方向
     
     // 回転方向を自機のある方に決定する
-    rotdirect = AKCalcRotDirect(angle_, self.image.position.x, self.image.position.y,
+    rotdirect = AKCalcRotDirect(angle_, screenPos_.x, screenPos_.y,
                                 AKPlayerPosX(), AKPlayerPosY());
     
     // 自機の方に向かって向きを回転する
     self.rotSpeed = rotdirect * kAKEnemyRotSpeed * 1.5;
-    
-    // 一定時間経過しているときは自機を狙う1-way弾を発射する
-    if (time_ > kAKEnemyActionTime) {
-        
-        // 弾を発射する
-        [self fireNormal];
-        
-        // 動作時間の初期化を行う
-        time_ = 0.0f;
-    }
 }
 
 /*!
  @brief 高速ショット処理
  
- 自機を追う。通常よりも短い間隔で1-way弾を発射する。
+ 自機を追う。弾の発射は弾幕パターンで行う。
  @param dt フレーム更新間隔
  */
 - (void)actionHighShot:(ccTime)dt
@@ -449,27 +550,17 @@ static const float kAKExplosionFrameDelay = 0.2f;
     int rotdirect = 0;      // 回転方向
     
     // 回転方向を自機のある方に決定する
-    rotdirect = AKCalcRotDirect(angle_, self.image.position.x, self.image.position.y,
+    rotdirect = AKCalcRotDirect(angle_, screenPos_.x, screenPos_.y,
                                 AKPlayerPosX(), AKPlayerPosY());
     
     // 自機の方に向かって向きを回転する
     self.rotSpeed = rotdirect * kAKEnemyRotSpeed * 1.4;
-    
-    // 一定時間経過しているときは自機を狙う1-way弾を発射する
-    if (time_ > kAKEnemyActionTime / 10.0f) {
-        
-        // 弾を発射する
-        [self fireNormal];
-        
-        // 動作時間の初期化を行う
-        time_ = 0.0f;
-    }
 }
 
 /*!
  @brief 3-Way弾発射処理
  
- 自機を追う。一定間隔で3-way弾を発射する。
+ 自機を追う。弾の発射は弾幕パターンで行う。
  @param dt フレーム更新間隔
  */
 - (void)action3WayShot:(ccTime)dt
@@ -477,77 +568,21 @@ static const float kAKExplosionFrameDelay = 0.2f;
     int rotdirect = 0;      // 回転方向
     
     // 回転方向を自機のある方に決定する
-    rotdirect = AKCalcRotDirect(angle_, self.image.position.x, self.image.position.y,
+    rotdirect = AKCalcRotDirect(angle_, screenPos_.x, screenPos_.y,
                                 AKPlayerPosX(), AKPlayerPosY());
     
     // 自機の方に向かって向きを回転する
     self.rotSpeed = rotdirect * kAKEnemyRotSpeed * 1.3;
-    
-    // 一定時間経過しているときは自機を狙う3-way弾を発射する
-    if (time_ > kAKEnemyActionTime / 2.0f) {
-        
-        // 弾を発射する
-        [self fireNWay:3];
-        
-        // 動作時間の初期化を行う
-        time_ = 0.0f;
-    }
 }
 
 /*!
  @brief 大砲動作処理
  
- 大砲の動作を行う。
+ 大砲の動作を行う。弾の発射と旋回は弾幕パターンで行う。
  */
 - (void)actionCanon:(ccTime)dt
 {
-    // 待機時間
-    const float waitTime = 3.0f;
-    // 弾発射間隔
-    const float fireDelay = 0.5f;
-    // 弾発射弾数
-    const int fireCount = 5;
-    
-    // 状態が発射弾数に達していない場合は弾を発射する
-    if (state_ < fireCount) {
-
-        // 一定時間経過しているときは自機を狙う3-way弾を発射する
-        if (time_ > fireDelay) {
-            
-            // 弾を発射する
-            [self fireNWay:3];
-            
-            // 状態をひとつ進める
-            state_++;
-
-            // 動作時間の初期化を行う
-            time_ = 0.0f;
-        }
-    }
-    // 弾を発射したあとは向きを変える
-    else {
-        int rotdirect = 0;      // 回転方向
-    
-        // 回転方向を自機のある方に決定する
-        rotdirect = AKCalcRotDirect(angle_, self.image.position.x, self.image.position.y,
-                                    AKPlayerPosX(), AKPlayerPosY());
-    
-        // 自機の方に向かって向きを回転する
-        self.rotSpeed = rotdirect * kAKCanonRotSpeed;
-    
-        // 待機時間経過している場合は状態をリセットする
-        if (time_ > waitTime) {
-            
-            // 回転を停止する
-            self.rotSpeed = 0.0f;
-            
-            // 状態をリセットする
-            state_ = 0;
-            
-            // 動作時間の初期化を行う
-            time_ = 0.0f;
-        }
-    }
+    // 弾幕パターンで動作を定義する
 }
 
 /*!
@@ -558,44 +593,10 @@ static const float kAKExplosionFrameDelay = 0.2f;
 - (void)destroyNormal
 {
     // 画面効果を生成する
-    [[AKGameScene getInstance] entryEffect:kAKExplosion
-                                 startRect:kAKExplosionRect
-                                frameCount:kAKExplosionFrameCount
-                                     delay:kAKExplosionFrameDelay
-                                      posX:self.absx posY:self.absy];
-}
-
-/*!
- @brief 通常弾の発射
- 
- 通常弾の発射を行う。
- */
-- (void)fireNormal
-{
-    // 通常弾を生成する
-    [[AKGameScene getInstance] fireEnemyShot:ENEMY_SHOT_TYPE_NORMAL
-                                        PosX:self.absx PosY:self.absy Angle:self.angle];
-}
-
-/*!
- @brief n-Way弾発射
- 
- n-Way弾の発射を行う。
- @param way 発射方向の数
- */
-- (void)fireNWay:(NSInteger)way
-{
-    // 弾の間隔を決める
-    float space = M_PI / 8.0f;
-    
-    // 発射角度を計算する
-    NSArray *angleArray = AKCalcNWayAngle(way, self.angle, space);
-    
-    // 各弾を発射する
-    for (NSNumber *angle in angleArray) {
-        // 通常弾を生成する
-        [[AKGameScene getInstance] fireEnemyShot:ENEMY_SHOT_TYPE_NORMAL
-                                            PosX:self.absx PosY:self.absy Angle:[angle floatValue]];
-    }
+    [[AKGameEventBuffer sharedBuffer] pushEffect:kAKExplosion
+                                       startRect:kAKExplosionRect
+                                      frameCount:kAKExplosionFrameCount
+                                           delay:kAKExplosionFrameDelay
+                                            posX:self.absx posY:self.absy];
 }
 @end
@@ -45,7 +45,8 @@ enum ENEMY_SHOT_TYPE {
 
 // 敵弾クラス
 @interface AKEnemyShot : AKShot {
-    
+    /// 読み込み済みの画像の敵弾の種類
+    enum ENEMY_SHOT_TYPE imageType_;
 }
 
 // 生成処理
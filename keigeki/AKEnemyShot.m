@@ -34,6 +34,7 @@
  */
 
 #import "AKEnemyShot.h"
+#import "AKTextureManager.h"
 
 /// 敵弾の画像
 static const char *ENEMY_SHOT_IMAGE[ENEMY_SHOT_TYPE_COUNT] = {
@@ -76,12 +77,20 @@ static const int ENEMY_SHOT_HEIGHT[ENEMY_SHOT_TYPE_COUNT] = {
 - (void)createWithType:(enum ENEMY_SHOT_TYPE)type X:(NSInteger)x Y:(NSInteger)y Z:(NSInteger)z
                  Angle:(float)angle Parent:(CCNode *)parent
 {
-    // 画像を開放する
+    // 画像を画面から取り除く
     [self.image removeFromParentAndCleanup:YES];
     
-    // 画像を読み込む
-    NSString *fileName = [NSString stringWithUTF8String:ENEMY_SHOT_IMAGE[type]];
-    self.image = [CCSprite spriteWithFile:fileName];
+    // 同じ種類の画像を読み込み済みの場合は発射のたびにスプライトを生成しないように再利用する。
+    // 再利用する場合は世代を更新し、前回の発射時の描画状態や弾幕パターンが適用されないようにする。
+    if (self.image != nil && imageType_ == type) {
+        [self invalidateImage];
+    }
+    // 読み込んでいない場合は画像を読み込む
+    else {
+        NSString *fileName = [NSString stringWithUTF8String:ENEMY_SHOT_IMAGE[type]];
+        self.image = [CCSprite spriteWithTexture:[[AKTextureManager sharedManager] textureForFile:fileName]];
+        imageType_ = type;
+    }
     assert(image_ != nil);
     
     // 各種パラメータを設定する
@@ -39,12 +39,21 @@
 // フォントサイズ
 extern const NSInteger kAKFontSize;
 
+/// スプライトフレームを保持する文字数(ASCII文字)
+enum {
+    kAKFontCachedCharCount = 128
+};
+
 // フォント管理クラス
 @interface AKFont : NSObject {
     /// 文字のテクスチャ内の位置情報
     NSDictionary *fontMap_;
     /// フォントテクスチャ
     CCTexture2D *fontTexture_;
+    /// 文字のスプライトフレーム(通常/色反転)
+    CCSpriteFrame *charFrames_[kAKFontCachedCharCount][2];
+    /// キーのスプライトフレーム(通常/色反転)
+    NSMutableDictionary *keyFrames_[2];
 }
 
 /// 文字のテクスチャ内の位置情報
@@ -64,4 +73,8 @@ extern const NSInteger kAKFontSize;
 - (CCSpriteFrame *)spriteFrameOfChar:(unichar)c isReverse:(BOOL)isReverse;
 // キーからスプライトフレームを取得する
 - (CCSpriteFrame *)spriteFrameWithKey:(NSString *)key isReverse:(BOOL)isReverse;
+// 文字のスプライトフレームを生成する
+- (CCSpriteFrame *)createSpriteFrameOfChar:(unichar)c isReverse:(BOOL)isReverse;
+// キーからスプライトフレームを生成する
+- (CCSpriteFrame *)createSpriteFrameWithKey:(NSString *)key isReverse:(BOOL)isReverse;
 @end
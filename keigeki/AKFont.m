@@ -34,6 +34,7 @@
  */
 
 #import "AKFont.h"
+#import "AKTextureManager.h"
 #import "AKCommon.h"
 
 /// フォントサイズ
@@ -108,7 +109,7 @@ static AKFont *sharedInstance_;
     }
     
     // フォント画像を読み込む
-    self.fontTexture = [[CCTextureCache sharedTextureCache] addImage:kAKFontImageName];
+    self.fontTexture = [[AKTextureManager sharedManager] commonTextureForFile:kAKFontImageName];
     NSAssert(self.fontTexture != nil, @"フォント画像の読み込みに失敗");
     
     // ファイルパスをバンドルから取得する
@@ -118,6 +119,11 @@ static AKFont *sharedInstance_;
     self.fontMap = [NSDictionary dictionaryWithContentsOfFile:filePath];
     assert(self.fontMap != nil);
     
+    // キーのスプライトフレームの保持領域を生成する
+    for (int i = 0; i < 2; i++) {
+        keyFrames_[i] = [[NSMutableDictionary alloc] init];
+    }
+    
     return self;
 }
 
@@ -129,6 +135,12 @@ static AKFont *sharedInstance_;
 - (void)dealloc
 {
     // メンバを解放する
+    for (int i = 0; i < kAKFontCachedCharCount; i++) {
+        [charFrames_[i][0] release];
+        [charFrames_[i][1] release];
+    }
+    [keyFrames_[0] release];
+    [keyFrames_[1] release];
     self.fontMap = nil;
     self.fontTexture = nil;
     
@@ -191,11 +203,36 @@ static AKFont *sharedInstance_;
  @brief 文字のスプライトフレームを取得する
  
  文字のスプライトフレームを取得する。
+ ラベルの更新で毎フレーム呼ばれるため、ASCII文字は一度生成したスプライトフレームを保持して再利用する。
  @param c 文字
  @param isReverse 色反転するかどうか
  @return 文字のスプライトフレーム
  */
 - (CCSpriteFrame *)spriteFrameOfChar:(unichar)c isReverse:(BOOL)isReverse
+{
+    // ASCII文字の場合は保持しているスプライトフレームを返す
+    if (c < kAKFontCachedCharCount) {
+        
+        // まだ生成していない場合は生成する
+        if (charFrames_[c][isReverse ? 1 : 0] == nil) {
+            charFrames_[c][isReverse ? 1 : 0] = [[self createSpriteFrameOfChar:c isReverse:isReverse] retain];
+        }
+        
+        return charFrames_[c][isReverse ? 1 : 0];
+    }
+    
+    return [self createSpriteFrameOfChar:c isReverse:isReverse];
+}
+
+/*!
+ @brief 文字のスプライトフレームを生成する
+ 
+ フォントのテクスチャから文字の部分を切り出したスプライトフレームを生成する。
+ @param c 文字
+ @param isReverse 色反転するかどうか
+ @return 文字のスプライトフレーム
+ */
+- (CCSpriteFrame *)createSpriteFrameOfChar:(unichar)c isReverse:(BOOL)isReverse
 {
     AKLog(0, @"c=%c rect=(%f,%f) isReverse=%d", c, [self rectOfChar:c].origin.x, [self rectOfChar:c].origin.y, isReverse);
     
@@ -218,11 +255,34 @@ static AKFont *sharedInstance_;
  @brief キーからスプライトフレームを取得する
  
  キーからスプライトフレームを取得する。
+ 一度生成したスプライトフレームは保持して再利用する。
  @param key キー
  @param isReverse 色反転するかどうか
  @return キーのスプライトフレーム
  */
 - (CCSpriteFrame *)spriteFrameWithKey:(NSString *)key isReverse:(BOOL)isReverse
+{
+    NSMutableDictionary *frames = keyFrames_[isReverse ? 1 : 0];
+    
+    // 保持しているスプライトフレームがあればそれを返す
+    CCSpriteFrame *frame = [frames objectForKey:key];
+    if (frame == nil) {
+        frame = [self createSpriteFrameWithKey:key isReverse:isReverse];
+        [frames setObject:frame forKey:key];
+    }
+    
+    return frame;
+}
+
+/*!
+ @brief キーからスプライトフレームを生成する
+ 
+ フォントのテクスチャからキーに対応する部分を切り出したスプライトフレームを生成する。
+ @param key キー
+ @param isReverse 色反転するかどうか
+ @return キーのスプライトフレーム
+ */
+- (CCSpriteFrame *)createSpriteFrameWithKey:(NSString *)key isReverse:(BOOL)isReverse
 {
     AKLog(0, @"key=%@ rect=(%f,%f) isReverse=%d", key, [self rectByKey:key].origin.x, [self rectByKey:key].origin.y, isReverse);
     
@@ -0,0 +1,72 @@
+/*
+ * Copyright (c) 2012-2013 Akihiro Kaneda.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   1.Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   2.Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ *   3.Neither the name of the Monochrome Soft nor the names of its contributors
+ *     may be used to endorse or promote products derived from this software
+ *     without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+/*!
+ @file AKFramePacer.h
+ @brief フレームレート制御
+
+ 画面の変化の有無によって描画間隔を切り替えるクラスを定義する。
+ */
+
+#import <Foundation/Foundation.h>
+#import "cocos2d.h"
+
+// フレームレート制御クラス
+@interface AKFramePacer : NSObject {
+    /// 低フレームレートで動作中かどうか
+    BOOL isIdle_;
+    /// 画面の変化がなくなってからの経過時間
+    float quietTime_;
+    /// 描画フレーム数の集計開始時刻
+    double countStart_;
+    /// シーンごとの描画フレーム数(シーンのクラス名をキーとする)
+    NSMutableDictionary *frameCounts_;
+    /// カウント中のシーンのクラス
+    Class countClass_;
+    /// カウント中のシーンの描画フレーム数
+    NSInteger frameCount_;
+}
+
+/// 低フレームレートで動作中かどうか
+@property (nonatomic, readonly)BOOL isIdle;
+
+// シングルトンオブジェクト取得
++ (AKFramePacer *)sharedPacer;
+// フレームレート制御の開始
+- (void)start;
+// 通常のフレームレートへの復帰
+- (void)wake;
+// フレームごとの処理
+- (void)tick:(ccTime)dt;
+// 画面に変化があるかどうか
+- (BOOL)isSceneActive:(CCScene *)scene;
+// 描画フレーム数の記録
+- (void)countFrameOfScene:(CCScene *)scene;
+// 描画フレーム数の反映
+- (void)flushFrameCount;
+@end
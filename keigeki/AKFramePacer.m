@@ -0,0 +1,314 @@
+/*
+ * Copyright (c) 2012-2013 Akihiro Kaneda.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   1.Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   2.Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ *   3.Neither the name of the Monochrome Soft nor the names of its contributors
+ *     may be used to endorse or promote products derived from this software
+ *     without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+/*!
+ @file AKFramePacer.m
+ @brief フレームレート制御
+
+ 画面の変化の有無によって描画間隔を切り替えるクラスを定義する。
+ */
+
+#import <QuartzCore/QuartzCore.h>
+#import "AKFramePacer.h"
+#import "AKCommon.h"
+
+/// 通常時の描画間隔
+static const double kAKActiveInterval = 1.0 / 60.0;
+/// 画面に変化がないときの描画間隔
+static const double kAKIdleInterval = 1.0 / 10.0;
+/// 低フレームレートに切り替えるまでの画面に変化がない時間
+static const float kAKIdleDelay = 0.5f;
+/// 描画フレーム数を集計する間隔(秒)
+static const double kAKFrameCountPeriod = 60.0;
+
+/// シングルトンオブジェクト
+static AKFramePacer *sharedPacer_ = nil;
+
+/*!
+ @brief ノードのアクション実行中判定
+
+ ノードとその子ノードのいずれかでアクションが実行中かどうかを調べる。
+ @param node 判定するノード
+ @return アクションが実行中の場合YES
+ */
+static BOOL AKHasRunningAction(CCNode *node)
+{
+    if ([node numberOfRunningActions] > 0) {
+        return YES;
+    }
+
+    for (CCNode *child in node.children) {
+        if (AKHasRunningAction(child)) {
+            return YES;
+        }
+    }
+
+    return NO;
+}
+
+/*!
+ @brief フレームレート制御クラス
+
+ メニュー画面やポーズ中など画面に変化がない間は描画間隔を長くし、同じ画面の再描画を減らす。
+ 実行中のシーンが連続した描画を要求している場合(needsContinuousFramesがYESを返す場合)、
+ トランジション中の場合、シーン内のノードでアクションが実行中の場合は画面に変化があるものとする。
+ 画面に変化がない状態が一定時間続いた場合に低フレームレートに切り替え、
+ 画面に変化があった場合とタッチされた場合は直ちに通常のフレームレートに戻す。
+ */
+@implementation AKFramePacer
+
+@synthesize isIdle = isIdle_;
+
+/*!
+ @brief シングルトンオブジェクト取得
+
+ シングルトンオブジェクトを取得する。
+ まだ生成されていない場合は生成を行う。
+ @return シングルトンオブジェクト
+ */
++ (AKFramePacer *)sharedPacer
+{
+    // 他のスレッドで同時に実行されないようにする
+    @synchronized(self) {
+
+        // シングルトンオブジェクトが生成されていない場合は生成する
+        if (!sharedPacer_) {
+            sharedPacer_ = [[AKFramePacer alloc] init];
+        }
+
+        return sharedPacer_;
+    }
+
+    return nil;
+}
+
+/*!
+ @brief インスタンス生成処理
+
+ インスタンス生成処理。
+ シングルトンのため、二重に生成された場合はアサーションを出力する。
+ */
++ (id)alloc
+{
+    // 他のスレッドで同時に実行されないようにする
+    @synchronized(self) {
+
+        NSAssert(sharedPacer_ == nil, @"Attempted to allocate a second instance of a singleton.");
+        return [super alloc];
+    }
+
+    return nil;
+}
+
+/*!
+ @brief オブジェクト生成処理
+
+ オブジェクトの生成を行う。
+ @return 生成したオブジェクト。失敗時はnilを返す。
+ */
+- (id)init
+{
+    // スーパークラスの生成処理
+    self = [super init];
+    if (!self) {
+        return nil;
+    }
+
+    // メンバを初期化する
+    isIdle_ = NO;
+    quietTime_ = 0.0f;
+    countStart_ = CACurrentMediaTime();
+    frameCounts_ = [[NSMutableDictionary alloc] init];
+    countClass_ = Nil;
+    frameCount_ = 0;
+
+    return self;
+}
+
+/*!
+ @brief インスタンス解放時処理
+
+ インスタンス解放時にオブジェクトを解放する。
+ */
+- (void)dealloc
+{
+    // スケジュールを解除する
+    [[[CCDirector sharedDirector] scheduler] unscheduleAllSelectorsForTarget:self];
+
+    // メンバを解放する
+    [frameCounts_ release];
+
+    // スーパークラスの解放処理
+    [super dealloc];
+}
+
+/*!
+ @brief フレームレート制御の開始
+
+ 毎フレームの処理をスケジューラに登録する。
+ */
+- (void)start
+{
+    [[[CCDirector sharedDirector] scheduler] scheduleSelector:@selector(tick:)
+                                                    forTarget:self
+                                                     interval:0
+                                                       paused:NO];
+}
+
+/*!
+ @brief 通常のフレームレートへの復帰
+
+ 低フレームレートで動作中の場合は直ちに通常のフレームレートに戻す。
+ タッチ時やゲームの状態変更時に呼び出す。
+ */
+- (void)wake
+{
+    quietTime_ = 0.0f;
+
+    if (isIdle_) {
+
+        AKLog(0, @"通常フレームレートに復帰");
+
+        isIdle_ = NO;
+        [[CCDirector sharedDirector] setAnimationInterval:kAKActiveInterval];
+    }
+}
+
+/*!
+ @brief フレームごとの処理
+
+ 実行中のシーンに変化があるかどうかを調べ、描画間隔を切り替える。
+ 描画フレーム数の記録も行う。
+ @param dt フレーム更新間隔
+ */
+- (void)tick:(ccTime)dt
+{
+    CCScene *scene = [[CCDirector sharedDirector] runningScene];
+
+    // 描画フレーム数を記録する
+    [self countFrameOfScene:scene];
+
+    // 画面に変化がある場合は通常のフレームレートとする
+    if ([self isSceneActive:scene]) {
+        [self wake];
+        return;
+    }
+
+    // 画面に変化がない状態が一定時間続いた場合は低フレームレートに切り替える
+    quietTime_ += dt;
+    if (!isIdle_ && quietTime_ > kAKIdleDelay) {
+
+        AKLog(0, @"低フレームレートに切り替え");
+
+        isIdle_ = YES;
+        [[CCDirector sharedDirector] setAnimationInterval:kAKIdleInterval];
+    }
+}
+
+/*!
+ @brief 画面に変化があるかどうか
+
+ シーンが連続した描画を要求している場合、トランジション中の場合、
+ シーン内でアクションが実行中の場合に画面に変化があるものとする。
+ @param scene 判定するシーン
+ @return 画面に変化がある場合YES
+ */
+- (BOOL)isSceneActive:(CCScene *)scene
+{
+    // シーンがない場合は変化なしとする
+    if (scene == nil) {
+        return NO;
+    }
+
+    // トランジション中は変化ありとする
+    if ([scene isKindOfClass:[CCTransitionScene class]]) {
+        return YES;
+    }
+
+    // シーンが連続した描画を要求している場合は変化ありとする
+    if ([scene respondsToSelector:@selector(needsContinuousFrames)] &&
+        [(id)scene needsContinuousFrames]) {
+        return YES;
+    }
+
+    // アクションが実行中の場合は変化ありとする
+    return AKHasRunningAction(scene);
+}
+
+/*!
+ @brief 描画フレーム数の記録
+
+ シーンごとの描画フレーム数を記録し、一定時間ごとに1分あたりのフレーム数をログに出力する。
+ 毎フレームのオブジェクト生成を避けるため、同じシーンが続く間は数値のみをカウントし、
+ シーンが切り替わったときと集計時に辞書に反映する。
+ @param scene 実行中のシーン
+ */
+- (void)countFrameOfScene:(CCScene *)scene
+{
+    // シーンが切り替わった場合はカウントを辞書に反映する
+    Class sceneClass = [scene class];
+    if (sceneClass != countClass_) {
+        [self flushFrameCount];
+        countClass_ = sceneClass;
+    }
+    
+    frameCount_++;
+
+    // 集計間隔が経過した場合はログに出力してクリアする
+    double now = CACurrentMediaTime();
+    if (now - countStart_ >= kAKFrameCountPeriod) {
+
+        [self flushFrameCount];
+
+        for (NSString *name in frameCounts_) {
+            AKLog(1, @"%@: %.0f frames/min",
+                  name, [[frameCounts_ objectForKey:name] doubleValue] * 60.0 / (now - countStart_));
+        }
+
+        [frameCounts_ removeAllObjects];
+        countStart_ = now;
+    }
+}
+
+/*!
+ @brief 描画フレーム数の反映
+
+ カウント中のシーンの描画フレーム数を辞書に加算し、カウントをクリアする。
+ */
+- (void)flushFrameCount
+{
+    if (countClass_ != Nil && frameCount_ > 0) {
+        
+        NSString *key = NSStringFromClass(countClass_);
+        NSNumber *count = [frameCounts_ objectForKey:key];
+        [frameCounts_ setObject:[NSNumber numberWithInteger:[count integerValue] + frameCount_] forKey:key];
+    }
+    
+    frameCount_ = 0;
+}
+@end
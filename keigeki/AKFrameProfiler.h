@@ -0,0 +1,139 @@
+/*
+ * Copyright (c) 2012-2013 Akihiro Kaneda.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   1.Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   2.Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ *   3.Neither the name of the Monochrome Soft nor the names of its contributors
+ *     may be used to endorse or promote products derived from this software
+ *     without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+/*!
+ @file AKFrameProfiler.h
+ @brief フレーム処理時間計測
+
+ ゲームプレイ中の各処理の時間を計測するクラスを定義する。
+ */
+
+#import <Foundation/Foundation.h>
+
+/// 計測処理を組み込むかどうか。リリースビルドでは組み込まない。
+#ifndef AK_PROFILE
+#ifdef DEBUG
+#define AK_PROFILE 1
+#else
+#define AK_PROFILE 0
+#endif
+#endif
+
+/// 計測する処理の区分
+enum AKProfilePhase {
+    kAKProfilePhasePlayer = 0,  ///< 自機の移動
+    kAKProfilePhasePlayerShot,  ///< 自機弾の移動
+    kAKProfilePhaseEnemy,       ///< 敵の移動
+    kAKProfilePhaseEnemyShot,   ///< 敵弾の移動
+    kAKProfilePhasePattern,     ///< 弾幕パターンの実行
+    kAKProfilePhaseCollision,   ///< 当たり判定
+    kAKProfilePhaseEvent,       ///< イベント処理
+    kAKProfilePhaseEffect,      ///< 画面効果の移動
+    kAKProfilePhaseRenderSync,  ///< 描画状態の反映
+    kAKProfilePhaseBackground,  ///< 背景の移動
+    kAKProfilePhaseRadar,       ///< レーダーの更新
+    kAKProfilePhaseHUD,         ///< 表示の更新
+    kAKProfilePhaseCount        ///< 区分の数
+};
+
+/// 計測する数値の区分
+enum AKProfileCounter {
+    kAKProfileCounterVisited = 0,   ///< 移動処理を行ったキャラクターの数
+    kAKProfileCounterDrawn,         ///< 表示したキャラクターの数
+    kAKProfileCounterTiltLatency,   ///< 傾き入力から表示までの遅延(ミリ秒)
+    kAKProfileCounterAllocCount,    ///< メインスレッドのメモリ確保回数
+    kAKProfileCounterAllocSize,     ///< メインスレッドのメモリ確保量(KB)
+    kAKProfileCounterMemorySize,    ///< プロセスの使用メモリ量(KB)
+    kAKProfileCounterAllocTime,     ///< メモリ確保にかかった時間の推定値(マイクロ秒)
+    kAKProfileCounterCount          ///< 区分の数
+};
+
+/// 計測結果を保持するフレーム数
+enum {
+    kAKProfileSampleCount = 256
+};
+
+/// メモリ確保回数の上限判定を始めるまでのフレーム数
+enum {
+    kAKProfileWarmupFrameCount = 60
+};
+
+#if AK_PROFILE
+/// 計測が有効かどうか
+extern BOOL AKProfileEnabled;
+
+// フレームの計測開始
+void AKProfileStartFrame(void);
+// 処理区分の計測
+void AKProfileRecordLap(enum AKProfilePhase phase);
+// 数値の記録
+void AKProfileRecordCounter(enum AKProfileCounter counter, NSInteger value);
+// フレームの計測終了
+void AKProfileFinishFrame(void);
+
+/// フレームの計測を開始する
+#define AKProfileStart() do { if (AKProfileEnabled) { AKProfileStartFrame(); } } while (0)
+/// 前回の計測から現在までの時間を処理区分の時間として記録する
+#define AKProfileLap(phase) do { if (AKProfileEnabled) { AKProfileRecordLap(phase); } } while (0)
+/// 数値を記録する
+#define AKProfileCount(counter, value) do { if (AKProfileEnabled) { AKProfileRecordCounter(counter, value); } } while (0)
+/// フレームの計測を終了する
+#define AKProfileFinish() do { if (AKProfileEnabled) { AKProfileFinishFrame(); } } while (0)
+
+// フレーム処理時間計測クラス
+@interface AKFrameProfiler : NSObject
+
+// 計測の有効/無効設定
++ (void)setEnabled:(BOOL)enabled;
+// 計測結果のクリア
++ (void)reset;
+// 処理区分の名前取得
++ (NSString *)nameOfPhase:(enum AKProfilePhase)phase;
+// 処理区分の統計値取得
++ (void)statisticsOfPhase:(enum AKProfilePhase)phase min:(float *)min median:(float *)median p99:(float *)p99 max:(float *)max;
+// 数値の区分の統計値取得
++ (void)statisticsOfCounter:(enum AKProfileCounter)counter min:(NSInteger *)min median:(NSInteger *)median p99:(NSInteger *)p99 max:(NSInteger *)max;
+// 処理区分のメモリ確保回数の統計値取得
++ (void)allocationStatisticsOfPhase:(enum AKProfilePhase)phase min:(NSInteger *)min median:(NSInteger *)median p99:(NSInteger *)p99 max:(NSInteger *)max;
+// 計測結果の表示用文字列取得
++ (NSString *)summaryString;
+// 計測結果のCSV出力
++ (BOOL)exportCSV;
+// 1フレームのメモリ確保回数の上限設定
++ (void)setAllocationBudget:(NSInteger)budget;
+// メモリ確保回数の上限判定
++ (BOOL)checkAllocationBudget;
+// メモリ確保回数の上限判定の失敗回数取得
++ (NSInteger)allocationBudgetFailureCount;
+@end
+#else
+#define AKProfileStart() do { } while (0)
+#define AKProfileLap(phase) do { } while (0)
+#define AKProfileCount(counter, value) do { } while (0)
+#define AKProfileFinish() do { } while (0)
+#endif
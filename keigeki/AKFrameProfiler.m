@@ -0,0 +1,708 @@
+/*
+ * Copyright (c) 2012-2013 Akihiro Kaneda.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   1.Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   2.Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ *   3.Neither the name of the Monochrome Soft nor the names of its contributors
+ *     may be used to endorse or promote products derived from this software
+ *     without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+/*!
+ @file AKFrameProfiler.m
+ @brief フレーム処理時間計測
+
+ ゲームプレイ中の各処理の時間を計測するクラスを定義する。
+ */
+
+#import <mach/mach.h>
+#import <mach/mach_time.h>
+#import <pthread.h>
+#import "AKFrameProfiler.h"
+#import "AKCommon.h"
+
+#if AK_PROFILE
+
+/// CSVファイル名
+static NSString *kAKProfileCSVFileName = @"profile.csv";
+/// 表示用文字列の1行のフォーマット
+static NSString *kAKProfileLineFormat = @"%-6s%5.2f%5.2f%5.2f%5.2f";
+/// 表示用文字列の数値の行のフォーマット
+static NSString *kAKProfileCounterLineFormat = @"%-6s%5d%5d%5d%5d";
+/// 表示用文字列の見出し
+static NSString *kAKProfileHeader = @"MSEC    MIN  MED  P99  MAX";
+/// メモリ確保時間の推定に使う確保回数
+static const int kAKProfileCalibrationCount = 1000;
+/// メモリ確保時間の推定に使う確保サイズ
+static const size_t kAKProfileCalibrationSize = 64;
+
+/// メモリ確保・解放の記録関数の型
+typedef void (AKMallocLogger)(uint32_t type, uintptr_t arg1, uintptr_t arg2, uintptr_t arg3, uintptr_t result, uint32_t numHotFramesToSkip);
+/// libmallocがメモリ確保・解放のたびに呼び出す記録関数
+extern AKMallocLogger *malloc_logger;
+
+/// 記録関数に渡される種別(メモリ確保)
+static const uint32_t kAKMallocLogAllocate = 2;
+/// 記録関数に渡される種別(メモリ解放)
+static const uint32_t kAKMallocLogDeallocate = 4;
+
+/// 処理区分の名前
+static const char *kAKProfilePhaseName[kAKProfilePhaseCount] = {
+    "PLAYER",
+    "PSHOT",
+    "ENEMY",
+    "ESHOT",
+    "PATTRN",
+    "HIT",
+    "EVENT",
+    "EFFECT",
+    "SYNC",
+    "BG",
+    "RADAR",
+    "HUD"
+};
+
+/// 数値の区分の名前
+static const char *kAKProfileCounterName[kAKProfileCounterCount] = {
+    "VISIT",
+    "DRAW",
+    "TILTMS",
+    "ALLOC",
+    "ALLOKB",
+    "MEMKB",
+    "ALLOUS"
+};
+
+/// 計測が有効かどうか
+BOOL AKProfileEnabled = NO;
+
+/// 計測結果(ミリ秒)のリングバッファ
+static float samples_[kAKProfilePhaseCount][kAKProfileSampleCount];
+/// 計測中のフレームの処理時間(ミリ秒)
+static float current_[kAKProfilePhaseCount];
+/// 数値のリングバッファ
+static NSInteger counterSamples_[kAKProfileCounterCount][kAKProfileSampleCount];
+/// 計測中のフレームの数値
+static NSInteger currentCounter_[kAKProfileCounterCount];
+/// 次に書き込むリングバッファの位置
+static NSInteger sampleIndex_ = 0;
+/// リングバッファに格納されている計測結果の数
+static NSInteger sampleCount_ = 0;
+/// 前回の計測時刻
+static uint64_t lapStart_ = 0;
+/// 計測時刻をミリ秒に変換する係数
+static double ticksToMsec_ = 0.0;
+/// 処理区分ごとのメモリ確保回数のリングバッファ
+static NSInteger allocSamples_[kAKProfilePhaseCount][kAKProfileSampleCount];
+/// 計測中のフレームの処理区分ごとのメモリ確保回数
+static NSInteger currentAlloc_[kAKProfilePhaseCount];
+/// メモリ確保を数えているかどうか
+static BOOL isCountingAlloc_ = NO;
+/// 前回の計測からのメモリ確保回数
+static NSInteger lapAllocCount_ = 0;
+/// 計測中のフレームのメモリ確保回数
+static NSInteger frameAllocCount_ = 0;
+/// 計測中のフレームのメモリ確保量(バイト)
+static size_t frameAllocSize_ = 0;
+/// 計測を有効にする前に設定されていた記録関数
+static AKMallocLogger *previousLogger_ = NULL;
+/// 1回のメモリ確保と解放にかかる時間の推定値(マイクロ秒)
+static double allocUsec_ = 0.0;
+/// 1フレームのメモリ確保回数の上限。負の値の場合は判定しない。
+static NSInteger allocBudget_ = -1;
+/// 上限判定の対象としたフレームも含めた計測フレーム数
+static NSInteger budgetFrameCount_ = 0;
+/// 上限判定の対象としたフレーム数
+static NSInteger checkedFrameCount_ = 0;
+/// メモリ確保回数が上限を超えたフレーム数
+static NSInteger overBudgetFrameCount_ = 0;
+/// メモリ確保回数の上限判定に失敗した回数
+static NSInteger budgetFailureCount_ = 0;
+/// 上限判定の対象としたフレームのメモリ確保回数の最大値
+static NSInteger maxAllocCount_ = 0;
+/// 上限判定を始めたときのプロセスの使用メモリ量(KB)
+static NSInteger baseMemorySize_ = 0;
+
+/*!
+ @brief 計測時刻の単位の取得
+
+ 計測時刻をミリ秒に変換する係数を取得する。取得済みの場合は何もしない。
+ */
+static void AKProfileInitTimebase(void)
+{
+    if (ticksToMsec_ <= 0.0) {
+        mach_timebase_info_data_t info;
+        mach_timebase_info(&info);
+        ticksToMsec_ = (double)info.numer / info.denom / 1000000.0;
+    }
+}
+
+/*!
+ @brief メモリ確保・解放の記録
+
+ libmallocからメモリ確保・解放のたびに呼び出される。
+ フレームの計測中にメインスレッドで行われたメモリ確保の回数と量を数える。
+ reallocは確保と解放の両方の種別で呼び出され、確保量は第3引数に渡される。
+ 元の記録関数が設定されていた場合はそちらも呼び出す。
+ @param type 種別
+ @param arg1 ゾーン
+ @param arg2 確保量または解放するアドレス
+ @param arg3 reallocの確保量
+ @param result 確保したアドレス
+ @param numHotFramesToSkip スタックトレースで飛ばすフレーム数
+ */
+static void AKProfileMallocLogger(uint32_t type, uintptr_t arg1, uintptr_t arg2, uintptr_t arg3, uintptr_t result, uint32_t numHotFramesToSkip)
+{
+    if (previousLogger_ != NULL) {
+        previousLogger_(type, arg1, arg2, arg3, result, numHotFramesToSkip + 1);
+    }
+
+    // 計測中のメインスレッドのメモリ確保のみ数える
+    if (!isCountingAlloc_ || !(type & kAKMallocLogAllocate) || !pthread_main_np()) {
+        return;
+    }
+
+    lapAllocCount_++;
+    frameAllocSize_ += (type & kAKMallocLogDeallocate) ? arg3 : arg2;
+}
+
+/*!
+ @brief メモリ確保時間の推定
+
+ 一定サイズのメモリ確保と解放を繰り返した時間から、1回あたりの時間を推定する。
+ 実際のメモリ確保はサイズや断片化の状況で時間が変わるため、フレームごとの値は目安として扱う。
+ */
+static void AKProfileCalibrateAlloc(void)
+{
+    void *buffers[kAKProfileCalibrationCount];
+
+    AKProfileInitTimebase();
+
+    uint64_t start = mach_absolute_time();
+    for (int i = 0; i < kAKProfileCalibrationCount; i++) {
+        buffers[i] = malloc(kAKProfileCalibrationSize);
+    }
+    for (int i = 0; i < kAKProfileCalibrationCount; i++) {
+        free(buffers[i]);
+    }
+    allocUsec_ = (mach_absolute_time() - start) * ticksToMsec_ * 1000.0 / kAKProfileCalibrationCount;
+
+    AKLog(1, @"メモリ確保時間:%.3fus", allocUsec_);
+}
+
+/*!
+ @brief プロセスの使用メモリ量取得
+
+ プロセスの常駐メモリ量を取得する。
+ @return 使用メモリ量(KB)。取得に失敗した場合は0。
+ */
+static NSInteger AKProfileMemorySize(void)
+{
+    struct task_basic_info info;
+    mach_msg_type_number_t count = TASK_BASIC_INFO_COUNT;
+
+    if (task_info(mach_task_self(), TASK_BASIC_INFO, (task_info_t)&info, &count) != KERN_SUCCESS) {
+        return 0;
+    }
+
+    return info.resident_size / 1024;
+}
+
+/*!
+ @brief フレームの計測開始
+
+ 計測中のフレームの処理時間をクリアし、計測開始時刻を記録する。
+ */
+void AKProfileStartFrame(void)
+{
+    // 初回は計測時刻の単位を取得する
+    AKProfileInitTimebase();
+
+    // 計測中のフレームの処理時間をクリアする
+    memset(current_, 0, sizeof(current_));
+    memset(currentCounter_, 0, sizeof(currentCounter_));
+    memset(currentAlloc_, 0, sizeof(currentAlloc_));
+
+    // メモリ確保を数え始める
+    lapAllocCount_ = 0;
+    frameAllocCount_ = 0;
+    frameAllocSize_ = 0;
+    isCountingAlloc_ = YES;
+
+    // 計測開始時刻を記録する
+    lapStart_ = mach_absolute_time();
+}
+
+/*!
+ @brief 処理区分の計測
+
+ 前回の計測から現在までの時間とメモリ確保回数を処理区分の値に加算する。
+ @param phase 処理区分
+ */
+void AKProfileRecordLap(enum AKProfilePhase phase)
+{
+    uint64_t now = mach_absolute_time();
+
+    current_[phase] += (now - lapStart_) * ticksToMsec_;
+    lapStart_ = now;
+
+    currentAlloc_[phase] += lapAllocCount_;
+    frameAllocCount_ += lapAllocCount_;
+    lapAllocCount_ = 0;
+}
+
+/*!
+ @brief 数値の記録
+
+ 計測中のフレームの数値を記録する。
+ @param counter 数値の区分
+ @param value 数値
+ */
+void AKProfileRecordCounter(enum AKProfileCounter counter, NSInteger value)
+{
+    currentCounter_[counter] = value;
+}
+
+/*!
+ @brief フレームの計測終了
+
+ メモリ確保の数値を記録し、計測中のフレームの処理時間と数値をリングバッファに格納する。
+ メモリ確保回数の上限が設定されている場合は、開始直後のフレームを除いて上限を超えたかどうかを判定する。
+ */
+void AKProfileFinishFrame(void)
+{
+    // メモリ確保を数えるのを終了する
+    isCountingAlloc_ = NO;
+    frameAllocCount_ += lapAllocCount_;
+    lapAllocCount_ = 0;
+
+    // メモリ確保の数値を記録する
+    NSInteger memorySize = AKProfileMemorySize();
+    currentCounter_[kAKProfileCounterAllocCount] = frameAllocCount_;
+    currentCounter_[kAKProfileCounterAllocSize] = frameAllocSize_ / 1024;
+    currentCounter_[kAKProfileCounterMemorySize] = memorySize;
+    currentCounter_[kAKProfileCounterAllocTime] = (NSInteger)(frameAllocCount_ * allocUsec_);
+
+    // メモリ確保回数の上限を判定する
+    budgetFrameCount_++;
+    if (allocBudget_ >= 0 && budgetFrameCount_ > kAKProfileWarmupFrameCount) {
+
+        if (checkedFrameCount_ == 0) {
+            baseMemorySize_ = memorySize;
+        }
+
+        checkedFrameCount_++;
+        maxAllocCount_ = MAX(maxAllocCount_, frameAllocCount_);
+        if (frameAllocCount_ > allocBudget_) {
+            overBudgetFrameCount_++;
+        }
+    }
+
+    // リングバッファに格納する
+    for (int i = 0; i < kAKProfilePhaseCount; i++) {
+        samples_[i][sampleIndex_] = current_[i];
+        allocSamples_[i][sampleIndex_] = currentAlloc_[i];
+    }
+    for (int i = 0; i < kAKProfileCounterCount; i++) {
+        counterSamples_[i][sampleIndex_] = currentCounter_[i];
+    }
+
+    // 書き込み位置を進める
+    sampleIndex_ = (sampleIndex_ + 1) % kAKProfileSampleCount;
+    if (sampleCount_ < kAKProfileSampleCount) {
+        sampleCount_++;
+    }
+}
+
+/*!
+ @brief float比較
+
+ qsortに渡す比較関数。
+ @param a 比較対象a
+ @param b 比較対象b
+ @return aが小さい場合は負の値、大きい場合は正の値、等しい場合は0
+ */
+static int AKCompareFloat(const void *a, const void *b)
+{
+    float fa = *(const float *)a;
+    float fb = *(const float *)b;
+
+    return (fa > fb) - (fa < fb);
+}
+
+/*!
+ @brief NSInteger比較
+
+ qsortに渡す比較関数。
+ @param a 比較対象a
+ @param b 比較対象b
+ @return aが小さい場合は負の値、大きい場合は正の値、等しい場合は0
+ */
+static int AKCompareInteger(const void *a, const void *b)
+{
+    NSInteger ia = *(const NSInteger *)a;
+    NSInteger ib = *(const NSInteger *)b;
+
+    return (ia > ib) - (ia < ib);
+}
+
+/*!
+ @brief NSIntegerのリングバッファの統計値取得
+
+ リングバッファに保持している数値から統計値を計算する。
+ 計測結果がない場合はすべて0とする。
+ @param samples リングバッファ
+ @param min 最小値
+ @param median 中央値
+ @param p99 99パーセンタイル値
+ @param max 最大値
+ */
+static void AKProfileIntegerStatistics(const NSInteger *samples, NSInteger *min, NSInteger *median, NSInteger *p99, NSInteger *max)
+{
+    // 計測結果がない場合は0とする
+    if (sampleCount_ <= 0) {
+        *min = *median = *p99 = *max = 0;
+        return;
+    }
+
+    // 計測結果をコピーして並び替える
+    NSInteger sorted[kAKProfileSampleCount];
+    memcpy(sorted, samples, sizeof(NSInteger) * sampleCount_);
+    qsort(sorted, sampleCount_, sizeof(NSInteger), AKCompareInteger);
+
+    // 統計値を取得する
+    *min = sorted[0];
+    *median = sorted[sampleCount_ / 2];
+    *p99 = sorted[MIN(sampleCount_ * 99 / 100, sampleCount_ - 1)];
+    *max = sorted[sampleCount_ - 1];
+}
+
+/*!
+ @brief フレーム処理時間計測クラス
+
+ ゲームプレイ中の各処理の時間を計測する。
+ 計測結果は直近のフレーム分をリングバッファに保持し、統計値の表示とCSV出力を行う。
+ 計測処理は毎フレーム呼ばれるため、C関数とマクロで実装し、
+ 無効時はフラグの判定のみとなるようにしている。
+ メモリ確保はlibmallocの記録関数で数え、計測中のメインスレッドの確保回数を処理区分ごとに振り分ける。
+ */
+@implementation AKFrameProfiler
+
+/*!
+ @brief 計測の有効/無効設定
+
+ 計測の有効/無効を設定する。有効にする場合は過去の計測結果をクリアする。
+ @param enabled 有効にする場合YES
+ */
++ (void)setEnabled:(BOOL)enabled
+{
+    if (enabled && !AKProfileEnabled) {
+        [self reset];
+
+        // メモリ確保時間を推定し、メモリ確保の記録関数を設定する
+        AKProfileCalibrateAlloc();
+        previousLogger_ = malloc_logger;
+        malloc_logger = AKProfileMallocLogger;
+    }
+    else if (!enabled && AKProfileEnabled) {
+
+        // メモリ確保の記録関数を元に戻す
+        if (malloc_logger == AKProfileMallocLogger) {
+            malloc_logger = previousLogger_;
+        }
+        previousLogger_ = NULL;
+    }
+
+    AKProfileEnabled = enabled;
+}
+
+/*!
+ @brief 計測結果のクリア
+
+ リングバッファに保持している計測結果をクリアする。
+ */
++ (void)reset
+{
+    memset(samples_, 0, sizeof(samples_));
+    memset(counterSamples_, 0, sizeof(counterSamples_));
+    memset(allocSamples_, 0, sizeof(allocSamples_));
+    sampleIndex_ = 0;
+    sampleCount_ = 0;
+    budgetFrameCount_ = 0;
+    checkedFrameCount_ = 0;
+    overBudgetFrameCount_ = 0;
+    maxAllocCount_ = 0;
+}
+
+/*!
+ @brief 処理区分の名前取得
+
+ 処理区分の名前を取得する。
+ @param phase 処理区分
+ @return 処理区分の名前
+ */
++ (NSString *)nameOfPhase:(enum AKProfilePhase)phase
+{
+    return [NSString stringWithUTF8String:kAKProfilePhaseName[phase]];
+}
+
+/*!
+ @brief 処理区分の統計値取得
+
+ リングバッファに保持している計測結果から処理区分の統計値を計算する。
+ 計測結果がない場合はすべて0とする。
+ @param phase 処理区分
+ @param min 最小値(ミリ秒)
+ @param median 中央値(ミリ秒)
+ @param p99 99パーセンタイル値(ミリ秒)
+ @param max 最大値(ミリ秒)
+ */
++ (void)statisticsOfPhase:(enum AKProfilePhase)phase min:(float *)min median:(float *)median p99:(float *)p99 max:(float *)max
+{
+    // 計測結果がない場合は0とする
+    if (sampleCount_ <= 0) {
+        *min = *median = *p99 = *max = 0.0f;
+        return;
+    }
+
+    // 計測結果をコピーして並び替える
+    float sorted[kAKProfileSampleCount];
+    memcpy(sorted, samples_[phase], sizeof(float) * sampleCount_);
+    qsort(sorted, sampleCount_, sizeof(float), AKCompareFloat);
+
+    // 統計値を取得する
+    *min = sorted[0];
+    *median = sorted[sampleCount_ / 2];
+    *p99 = sorted[MIN(sampleCount_ * 99 / 100, sampleCount_ - 1)];
+    *max = sorted[sampleCount_ - 1];
+}
+
+/*!
+ @brief 数値の区分の統計値取得
+
+ リングバッファに保持している数値から統計値を計算する。
+ 計測結果がない場合はすべて0とする。
+ @param counter 数値の区分
+ @param min 最小値
+ @param median 中央値
+ @param p99 99パーセンタイル値
+ @param max 最大値
+ */
++ (void)statisticsOfCounter:(enum AKProfileCounter)counter min:(NSInteger *)min median:(NSInteger *)median p99:(NSInteger *)p99 max:(NSInteger *)max
+{
+    AKProfileIntegerStatistics(counterSamples_[counter], min, median, p99, max);
+}
+
+/*!
+ @brief 処理区分のメモリ確保回数の統計値取得
+
+ リングバッファに保持している処理区分ごとのメモリ確保回数から統計値を計算する。
+ 計測結果がない場合はすべて0とする。
+ @param phase 処理区分
+ @param min 最小値
+ @param median 中央値
+ @param p99 99パーセンタイル値
+ @param max 最大値
+ */
++ (void)allocationStatisticsOfPhase:(enum AKProfilePhase)phase min:(NSInteger *)min median:(NSInteger *)median p99:(NSInteger *)p99 max:(NSInteger *)max
+{
+    AKProfileIntegerStatistics(allocSamples_[phase], min, median, p99, max);
+}
+
+/*!
+ @brief 計測結果の表示用文字列取得
+
+ 処理区分ごとの統計値と数値の区分ごとの統計値を1行ずつ並べた文字列を作成する。
+ @return 表示用文字列
+ */
++ (NSString *)summaryString
+{
+    NSMutableString *summary = [NSMutableString stringWithString:kAKProfileHeader];
+
+    for (int i = 0; i < kAKProfilePhaseCount; i++) {
+
+        float min = 0.0f, median = 0.0f, p99 = 0.0f, max = 0.0f;
+        [self statisticsOfPhase:i min:&min median:&median p99:&p99 max:&max];
+
+        [summary appendString:@"\n"];
+        [summary appendFormat:kAKProfileLineFormat, kAKProfilePhaseName[i], min, median, p99, max];
+    }
+
+    for (int i = 0; i < kAKProfileCounterCount; i++) {
+
+        NSInteger min = 0, median = 0, p99 = 0, max = 0;
+        [self statisticsOfCounter:i min:&min median:&median p99:&p99 max:&max];
+
+        [summary appendString:@"\n"];
+        [summary appendFormat:kAKProfileCounterLineFormat, kAKProfileCounterName[i], min, median, p99, max];
+    }
+
+    return summary;
+}
+
+/*!
+ @brief 計測結果のCSV出力
+
+ 処理区分と数値の区分ごとの統計値と、フレームごとの計測結果をDocumentsディレクトリにCSV形式で出力する。
+ @return 出力に成功した場合YES
+ */
++ (BOOL)exportCSV
+{
+    NSMutableString *csv = [NSMutableString string];
+
+    // 統計値を出力する
+    [csv appendString:@"phase,min,median,p99,max\n"];
+    for (int i = 0; i < kAKProfilePhaseCount; i++) {
+
+        float min = 0.0f, median = 0.0f, p99 = 0.0f, max = 0.0f;
+        [self statisticsOfPhase:i min:&min median:&median p99:&p99 max:&max];
+
+        [csv appendFormat:@"%s,%f,%f,%f,%f\n", kAKProfilePhaseName[i], min, median, p99, max];
+    }
+    for (int i = 0; i < kAKProfileCounterCount; i++) {
+
+        NSInteger min = 0, median = 0, p99 = 0, max = 0;
+        [self statisticsOfCounter:i min:&min median:&median p99:&p99 max:&max];
+
+        [csv appendFormat:@"%s,%d,%d,%d,%d\n", kAKProfileCounterName[i], min, median, p99, max];
+    }
+    for (int i = 0; i < kAKProfilePhaseCount; i++) {
+
+        NSInteger min = 0, median = 0, p99 = 0, max = 0;
+        [self allocationStatisticsOfPhase:i min:&min median:&median p99:&p99 max:&max];
+
+        [csv appendFormat:@"%s_A,%d,%d,%d,%d\n", kAKProfilePhaseName[i], min, median, p99, max];
+    }
+
+    // フレームごとの計測結果の見出しを出力する
+    [csv appendString:@"\nframe"];
+    for (int i = 0; i < kAKProfilePhaseCount; i++) {
+        [csv appendFormat:@",%s", kAKProfilePhaseName[i]];
+    }
+    for (int i = 0; i < kAKProfileCounterCount; i++) {
+        [csv appendFormat:@",%s", kAKProfileCounterName[i]];
+    }
+    for (int i = 0; i < kAKProfilePhaseCount; i++) {
+        [csv appendFormat:@",%s_A", kAKProfilePhaseName[i]];
+    }
+    [csv appendString:@"\n"];
+
+    // フレームごとの計測結果を古い順に出力する
+    NSInteger start = (sampleIndex_ - sampleCount_ + kAKProfileSampleCount) % kAKProfileSampleCount;
+    for (NSInteger frame = 0; frame < sampleCount_; frame++) {
+
+        NSInteger index = (start + frame) % kAKProfileSampleCount;
+
+        [csv appendFormat:@"%d", frame];
+        for (int i = 0; i < kAKProfilePhaseCount; i++) {
+            [csv appendFormat:@",%f", samples_[i][index]];
+        }
+        for (int i = 0; i < kAKProfileCounterCount; i++) {
+            [csv appendFormat:@",%d", counterSamples_[i][index]];
+        }
+        for (int i = 0; i < kAKProfilePhaseCount; i++) {
+            [csv appendFormat:@",%d", allocSamples_[i][index]];
+        }
+        [csv appendString:@"\n"];
+    }
+
+    // Documentsディレクトリへのパスを作成する
+    NSString *docDir = [NSHomeDirectory() stringByAppendingPathComponent:@"Documents"];
+    NSString *filePath = [docDir stringByAppendingPathComponent:kAKProfileCSVFileName];
+
+    // ファイルを書き込む
+    NSError *error = nil;
+    BOOL isSuccess = [csv writeToFile:filePath atomically:YES encoding:NSUTF8StringEncoding error:&error];
+
+    AKLog(!isSuccess, @"CSV出力に失敗:%@", [error localizedDescription]);
+    AKLog(isSuccess, @"CSV出力:%@", filePath);
+
+    return isSuccess;
+}
+
+/*!
+ @brief 1フレームのメモリ確保回数の上限設定
+
+ 1フレームのメモリ確保回数の上限を設定する。
+ 設定後、計測を開始してから一定フレーム経過した後のフレームを上限判定の対象とする。
+ @param budget メモリ確保回数の上限。負の値の場合は判定しない。
+ */
++ (void)setAllocationBudget:(NSInteger)budget
+{
+    allocBudget_ = budget;
+    budgetFrameCount_ = 0;
+    checkedFrameCount_ = 0;
+    overBudgetFrameCount_ = 0;
+    maxAllocCount_ = 0;
+    budgetFailureCount_ = 0;
+}
+
+/*!
+ @brief メモリ確保回数の上限判定
+
+ 前回の判定以降に上限を超えたフレームがあったかどうかを判定し、結果をログに出力する。
+ 判定後は次のステージの判定のために集計をクリアし、開始直後のフレームを再び対象外とする。
+ 上限を超えたフレームがあった場合は失敗回数を数える。
+ 上限が設定されていない場合は常に成功とする。
+ @return 上限を超えたフレームがない場合YES
+ */
++ (BOOL)checkAllocationBudget
+{
+    if (allocBudget_ < 0) {
+        return YES;
+    }
+
+    BOOL isSuccess = (overBudgetFrameCount_ == 0);
+    if (!isSuccess) {
+        budgetFailureCount_++;
+    }
+
+    AKLog(1, @"メモリ確保回数判定:%@ budget=%d max=%d over=%d/%d memory=%+dKB failure=%d",
+          isSuccess ? @"OK" : @"NG",
+          allocBudget_,
+          maxAllocCount_,
+          overBudgetFrameCount_,
+          checkedFrameCount_,
+          checkedFrameCount_ > 0 ? AKProfileMemorySize() - baseMemorySize_ : 0,
+          budgetFailureCount_);
+
+    // 集計をクリアする
+    budgetFrameCount_ = 0;
+    checkedFrameCount_ = 0;
+    overBudgetFrameCount_ = 0;
+    maxAllocCount_ = 0;
+
+    return isSuccess;
+}
+
+/*!
+ @brief メモリ確保回数の上限判定の失敗回数取得
+
+ 上限を設定してから上限判定に失敗した回数を取得する。
+ @return 上限判定に失敗した回数
+ */
++ (NSInteger)allocationBudgetFailureCount
+{
+    return budgetFailureCount_;
+}
+@end
+
+#endif
@@ -35,6 +35,7 @@
 
 #import <Foundation/Foundation.h>
 #import <GameKit/GameKit.h>
+#import "AKGameCenterTransport.h"
 
 /// 実績ノーミスクリアのID
 extern NSString *kAKGCNoMissID;
@@ -53,10 +54,26 @@ extern NSString *kAKGCPlayCountID;
 @interface AKGameCenterHelper : NSObject {
     /// 解除済みの実績
     NSMutableDictionary *localAchievments_;
+    /// 送信待ちのデータ
+    NSMutableDictionary *outbox_;
+    /// 送信処理
+    id<AKGameCenterTransport> transport_;
+    /// 送信中かどうか
+    BOOL isSending_;
+    /// 連続して送信に失敗した回数
+    NSInteger retryCount_;
+    /// 次に送信できる時刻
+    CFAbsoluteTime nextSendTime_;
+    /// ファイル書き込みと送信用のキュー
+    dispatch_queue_t queue_;
 }
 
 /// 解除済みの実績
 @property (retain, nonatomic)NSMutableDictionary *localAchievements;
+/// 送信待ちのデータ
+@property (retain, nonatomic)NSMutableDictionary *outbox;
+/// 送信処理
+@property (retain, nonatomic)id<AKGameCenterTransport> transport;
 
 // シングルトンオブジェクトを取得する
 + (AKGameCenterHelper *)sharedHelper;
@@ -76,6 +93,16 @@ extern NSString *kAKGCPlayCountID;
 - (void)reportAchievements:(NSString *)identifier;
 // 達成率増加分を指定して実績送信
 - (void)reportAchievements:(NSString *)identifier percentIncrement:(float)percent;
+// 実績を送信待ちに登録する
+- (void)enqueueAchievement:(GKAchievement *)achievement;
+// 送信待ちのデータ読み込み
+- (void)readOutbox;
+// 送信待ちのデータ書き込み
+- (void)writeOutbox;
+// 送信待ちのデータをまとめて送信する
+- (void)flush;
+// 送信結果の反映
+- (void)completeSending:(NSDictionary *)sent error:(NSError *)error;
 // ステージクリア送信
 - (void)reportStageClear:(NSInteger)stage;
 // Leaderboard表示
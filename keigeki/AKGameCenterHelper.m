@@ -54,8 +54,16 @@ NSString *kAKGCPlayCountID = @"keigeki_play_count";
 static NSString *kAKGCLocalAchievementsFile = @"LocalAchievements.dat";
 /// 解除済みの実績をアーカイブする時のキー
 static NSString *kAKGCLocalAchievementsKey = @"LocalAchievements";
-/// 傾撃ハイスコアのカテゴリ
-static NSString *kAKGCScoreID = @"keigeki_score";
+/// 送信待ちのデータを保存するファイル
+static NSString *kAKGCOutboxFile = @"GameCenterOutbox.plist";
+#ifdef DEBUG
+/// 送信先をHTTPのスタブサーバーに切り替える設定のキー
+static NSString *kAKGCStubURLKey = @"AKGameCenterStubURL";
+#endif
+/// 送信に失敗したときに次に送信するまでの最短の間隔
+static const NSTimeInterval kAKGCRetryMinInterval = 5.0;
+/// 送信に失敗したときに次に送信するまでの最長の間隔
+static const NSTimeInterval kAKGCRetryMaxInterval = 600.0;
 /// 実績ステージクリアのIDフォーマット
 static NSString *kAKGCStargeClearID = @"keigeki_stage%d_clear";
 
@@ -71,6 +79,10 @@ static AKGameCenterHelper *sharedHelper_ = nil;
 
 // 解除済みの実績
 @synthesize localAchievements = localAchievments_;
+// 送信待ちのデータ
+@synthesize outbox = outbox_;
+// 送信処理
+@synthesize transport = transport_;
 
 /*!
  @brief シングルトンオブジェクト取得
@@ -117,7 +129,8 @@ static AKGameCenterHelper *sharedHelper_ = nil;
  @brief インスタンス初期化処理
  
  インスタンス初期化。
- 解除済みの実績と送信に失敗した実績とスコアをファイルから読み込む。
+ 解除済みの実績と送信待ちのデータをファイルから読み込む。
+ デバッグ版では、起動引数でスタブサーバーのURLが指定されている場合はGame Centerの代わりにHTTPで送信する。
  */
 - (id)init
 {
@@ -130,6 +143,24 @@ static AKGameCenterHelper *sharedHelper_ = nil;
     // 解除済みの実績を読み込む
     [self readLocalAchievements];
     
+    // ファイル書き込みと送信用のキューを作成する
+    queue_ = dispatch_queue_create("com.monochromesoft.keigeki.gamecenter", DISPATCH_QUEUE_SERIAL);
+    
+    // 前回送信できなかったデータを読み込む
+    [self readOutbox];
+    
+    // 送信処理を作成する
+    self.transport = [[[AKGameKitTransport alloc] init] autorelease];
+    
+#ifdef DEBUG
+    // スタブサーバーのURLが指定されている場合はHTTPで送信する
+    NSString *stubURL = [[NSUserDefaults standardUserDefaults] stringForKey:kAKGCStubURLKey];
+    if (stubURL != nil) {
+        AKLog(1, @"スタブサーバーに送信:%@", stubURL);
+        self.transport = [[[AKHTTPGameCenterTransport alloc] initWithURL:[NSURL URLWithString:stubURL]] autorelease];
+    }
+#endif
+    
     return self;
 }
 
@@ -144,6 +175,13 @@ static AKGameCenterHelper *sharedHelper_ = nil;
     // 解除済みの実績を解放する
     self.localAchievements = nil;
     
+    // 送信待ちのデータと送信処理を解放する
+    self.outbox = nil;
+    self.transport = nil;
+    
+    // キューを解放する
+    dispatch_release(queue_);
+    
     // スーパークラスの解放処理を実行する
     [super dealloc];
 }
@@ -203,6 +241,7 @@ static AKGameCenterHelper *sharedHelper_ = nil;
  @brief 解除済みの実績書き込み
  
  解除済みの実績をファイルに保存する。
+ エンコードは呼び出し元のスレッドで行い、ファイルの書き込みはキューで行う。
  */
 - (void)writeLocalAchievements
 {
@@ -234,8 +273,13 @@ static AKGameCenterHelper *sharedHelper_ = nil;
     // エンコードを完了する
     [encoder finishEncoding];
     
-    // ファイルを書き込む
-    [data writeToFile:filePath atomically:YES];
+    // ファイルの書き込みはキューで行う
+    dispatch_async(queue_, ^{
+        
+        // ファイルを書き込む
+        BOOL isSuccess = [data writeToFile:filePath atomically:YES];
+        AKLog(!isSuccess, @"ファイル書き込み失敗");
+    });
 }
 
 /*!
@@ -274,7 +318,8 @@ static AKGameCenterHelper *sharedHelper_ = nil;
  @brief 送信に失敗したデータを再送信する
  
  送信に失敗した内容を再送信する。
- Game Centerから取得した実績になく、ローカルに保存されている実績を送信する。
+ Game Centerから取得した実績になく、ローカルに保存されている実績を送信待ちに登録して送信する。
+ 認証直後に呼ばれるため、送信失敗による待ち時間を解除してから送信する。
  @param networkAchievements Game Centerから取得した実績
  */
 - (void)reSendData:(NSDictionary *)networkAchievements
@@ -296,16 +341,14 @@ static AKGameCenterHelper *sharedHelper_ = nil;
         // 通知バナーはオフにする
         achievement.showsCompletionBanner = NO;
         
-        // 実績を送信する
-        [achievement reportAchievementWithCompletionHandler:^(NSError *error) {
-            
-            // 送信に失敗した場合のログを出力する
-            AKLog(error != nil, @"実績送信に失敗:identifier=%@ [%@]", achievement.identifier, [error localizedDescription]);
-            
-            // 送信に成功した場合のログを出力する
-            AKLog(error == nil, @"実績送信完了:identifier=%@", achievement.identifier);
-        }];
+        // 送信待ちに登録する
+        [self enqueueAchievement:achievement];
     }
+    
+    // 送信失敗による待ち時間を解除して送信する
+    retryCount_ = 0;
+    nextSendTime_ = 0.0;
+    [self flush];
 }
 
 /*!
@@ -358,8 +401,10 @@ static AKGameCenterHelper *sharedHelper_ = nil;
             // 送信済み実績データのファイルの内容を更新する
             [self writeLocalAchievements];
             
-            // ローカルにのみ存在する実績を再送信する
-            [self reSendData:work];
+            // ローカルにのみ存在する実績を再送信する。送信待ちのデータはメインスレッドで操作する。
+            dispatch_async(dispatch_get_main_queue(), ^{
+                [self reSendData:work];
+            });
         }
     }];
 }
@@ -367,26 +412,21 @@ static AKGameCenterHelper *sharedHelper_ = nil;
 /*!
  @brief ハイスコア送信
  
- ハイスコアをGame Centerに送信する。
+ ハイスコアを送信待ちに登録する。
+ 送信待ちのスコアより高い場合のみ置き換え、送信はflushでまとめて行う。
  @param score スコア
  */
 - (void)reportHiScore:(NSInteger)score
 {
-    // スコア送信クラスを生成する
-    GKScore *scoreReporter = [[[GKScore alloc] initWithCategory:kAKGCScoreID] autorelease];
+    // 送信待ちのスコアより低い場合は登録しない
+    if (score <= [[self.outbox objectForKey:kAKGCOutboxScoreKey] longLongValue]) {
+        return;
+    }
     
-    // スコアを設定する
-    scoreReporter.value = score;
+    [self.outbox setObject:[NSNumber numberWithLongLong:score] forKey:kAKGCOutboxScoreKey];
     
-    // スコアを送信する
-    [scoreReporter reportScoreWithCompletionHandler:^(NSError *error) {
-        
-        // 送信に失敗した場合のログを出力する
-        AKLog(error != nil, @"ハイスコア送信に失敗:score=%d [%@]", score, [error localizedDescription]);
-
-        // 送信に成功した場合のログを出力する
-        AKLog(error == nil, @"ハイスコア送信完了:score=%d", score);
-    }];
+    // 送信前に終了しても次回起動時に送信できるようにファイルに保存する
+    [self writeOutbox];
 }
 
 /*!
@@ -404,12 +444,13 @@ static AKGameCenterHelper *sharedHelper_ = nil;
 /*!
  @brief 達成率増加分を指定して実績送信
  
- 達成率増加分を指定して実績をGame Centerに送信する。
- 送信済みの実績データを取得し、達成率を増加させてGame Centerに送信する。
+ 達成率増加分を指定して実績の達成率を更新する。
+ 送信済みの実績データを取得し、達成率を増加させて送信待ちに登録する。
  送信済みの実績データが存在しない場合は新規に作成し、指定された増加分を達成率に設定する。
  送信済みの実績データの達成率がすでに100%の場合は無処理とする。
  達成率が100%未満から100%以上になった場合は100%にして、バナーを表示する。
- 送信済み実績データのファイルの内容を更新する。
+ ゲームプレイ中に呼ばれるため、ここではファイル書き込みとGame Centerへの送信は行わない。
+ 送信待ちのデータはflushでまとめて送信する。
  @param identifier 実績のID
  @param percent 達成率増加分
  */
@@ -447,19 +488,196 @@ static AKGameCenterHelper *sharedHelper_ = nil;
             achievement.percentComplete = 100.0f;
         }
         
-        // 実績を送信する
-        [achievement reportAchievementWithCompletionHandler:^(NSError *error) {
-            
-            // 送信に失敗した場合のログを出力する
-            AKLog(error != nil, @"実績送信に失敗:identifier=%@ [%@]", identifier, [error localizedDescription]);
-            
-            // 送信に成功した場合のログを出力する
-            AKLog(error == nil, @"実績送信完了:identifier=%@ percent=%f", identifier, achievement.percentComplete);
+        // 送信待ちに登録する。同じIDの更新は1回の送信にまとめる。
+        [self enqueueAchievement:achievement];
+    }
+}
+
+/*!
+ @brief 実績を送信待ちに登録する
+ 
+ 実績の達成率を送信待ちのデータに設定する。
+ 同じIDの実績がすでに送信待ちの場合は最新の達成率で置き換える。
+ バナー表示はまだ送信していない更新のいずれかで有効になっていれば有効とする。
+ @param achievement 実績
+ */
+- (void)enqueueAchievement:(GKAchievement *)achievement
+{
+    NSMutableDictionary *entries = [self.outbox objectForKey:kAKGCOutboxAchievementsKey];
+    
+    BOOL banner = achievement.showsCompletionBanner ||
+        [[[entries objectForKey:achievement.identifier] objectForKey:kAKGCOutboxBannerKey] boolValue];
+    
+    [entries setObject:[NSDictionary dictionaryWithObjectsAndKeys:
+                        [NSNumber numberWithDouble:achievement.percentComplete], kAKGCOutboxPercentKey,
+                        [NSNumber numberWithBool:banner], kAKGCOutboxBannerKey,
+                        nil]
+                forKey:achievement.identifier];
+}
+
+/*!
+ @brief 送信待ちのデータ読み込み
+ 
+ 前回送信できなかったデータをファイルから読み込む。
+ ファイルがない場合や読み込めない場合は空のデータを作成する。
+ */
+- (void)readOutbox
+{
+    // ファイルパスを作成する
+    NSString *docDir = [NSHomeDirectory() stringByAppendingPathComponent:@"Documents"];
+    NSString *filePath = [docDir stringByAppendingPathComponent:kAKGCOutboxFile];
+    
+    // ファイルを読み込む
+    NSData *data = [NSData dataWithContentsOfFile:filePath];
+    if (data != nil) {
+        self.outbox = [NSPropertyListSerialization propertyListWithData:data
+                                                                options:NSPropertyListMutableContainers
+                                                                 format:NULL
+                                                                  error:NULL];
+    }
+    
+    // 読み込めなかった場合は空のデータを作成する
+    if (![self.outbox isKindOfClass:[NSMutableDictionary class]] ||
+        ![[self.outbox objectForKey:kAKGCOutboxAchievementsKey] isKindOfClass:[NSMutableDictionary class]]) {
+        
+        self.outbox = [NSMutableDictionary dictionaryWithObject:[NSMutableDictionary dictionary]
+                                                         forKey:kAKGCOutboxAchievementsKey];
+    }
+    
+    AKLog(1, @"送信待ち:achievements=%d score=%@",
+          [[self.outbox objectForKey:kAKGCOutboxAchievementsKey] count],
+          [self.outbox objectForKey:kAKGCOutboxScoreKey]);
+}
+
+/*!
+ @brief 送信待ちのデータ書き込み
+ 
+ 送信待ちのデータをファイルに保存する。
+ シリアライズは呼び出し元のスレッドで行い、ファイルの書き込みはキューで行う。
+ */
+- (void)writeOutbox
+{
+    // ファイルパスを作成する
+    NSString *docDir = [NSHomeDirectory() stringByAppendingPathComponent:@"Documents"];
+    NSString *filePath = [docDir stringByAppendingPathComponent:kAKGCOutboxFile];
+    
+    // シリアライズする
+    NSData *data = [NSPropertyListSerialization dataWithPropertyList:self.outbox
+                                                              format:NSPropertyListBinaryFormat_v1_0
+                                                             options:0
+                                                               error:NULL];
+    
+    // ファイルの書き込みはキューで行う
+    dispatch_async(queue_, ^{
+        BOOL isSuccess = [data writeToFile:filePath atomically:YES];
+        AKLog(!isSuccess, @"送信待ちのデータの書き込み失敗");
+    });
+}
+
+/*!
+ @brief 送信待ちのデータをまとめて送信する
+ 
+ 送信待ちの実績とスコアをまとめて送信し、送信済み実績データと送信待ちのデータのファイルを更新する。
+ ウェーブクリアやステージクリアなど、ゲームプレイの区切りで呼び出す。
+ 送信中の場合や、前回の送信失敗から待ち時間が経過していない場合は送信しない。
+ 再送信もタイマーではなく次の区切りで行い、ゲームプレイ中に通信が行われないようにする。
+ 送信するデータはゲームプレイ中に変更されないように複製してからキューに渡す。
+ */
+- (void)flush
+{
+    NSDictionary *entries = [self.outbox objectForKey:kAKGCOutboxAchievementsKey];
+    NSNumber *score = [self.outbox objectForKey:kAKGCOutboxScoreKey];
+    
+    // 送信待ちのデータがない場合は処理しない
+    if (entries.count <= 0 && score == nil) {
+        return;
+    }
+    
+    // 送信済み実績データと送信待ちのデータのファイルの内容を更新する
+    [self writeLocalAchievements];
+    [self writeOutbox];
+    
+    // 送信中の場合、送信失敗後の待ち時間が経過していない場合は送信しない
+    if (isSending_ || CFAbsoluteTimeGetCurrent() < nextSendTime_) {
+        AKLog(1, @"送信待ち:retry=%d", retryCount_);
+        return;
+    }
+    
+    AKLog(1, @"送信開始:achievements=%d score=%@", entries.count, score);
+    
+    // 送信するデータを複製する
+    NSDictionary *sent = [NSPropertyListSerialization propertyListWithData:
+                          [NSPropertyListSerialization dataWithPropertyList:self.outbox
+                                                                     format:NSPropertyListBinaryFormat_v1_0
+                                                                    options:0
+                                                                      error:NULL]
+                                                                   options:NSPropertyListImmutable
+                                                                    format:NULL
+                                                                     error:NULL];
+    if (sent == nil) {
+        return;
+    }
+    
+    isSending_ = YES;
+    
+    // 送信はキューで行い、結果はメインスレッドで反映する
+    id<AKGameCenterTransport> transport = self.transport;
+    dispatch_async(queue_, ^{
+        [transport sendOutbox:sent completion:^(NSError *error) {
+            dispatch_async(dispatch_get_main_queue(), ^{
+                [self completeSending:sent error:error];
+            });
         }];
+    });
+}
+
+/*!
+ @brief 送信結果の反映
+ 
+ 送信に成功した場合は、送信後に更新されていないデータを送信待ちから取り除く。
+ 失敗した場合は送信待ちに残し、連続して失敗した回数に応じて次に送信できるまでの時間を倍に延ばす。
+ @param sent 送信したデータ
+ @param error 送信に失敗した場合のエラー
+ */
+- (void)completeSending:(NSDictionary *)sent error:(NSError *)error
+{
+    isSending_ = NO;
+    
+    // 失敗した場合は次に送信できるまでの時間を延ばす
+    if (error != nil) {
+        
+        retryCount_++;
+        NSTimeInterval interval = MIN(kAKGCRetryMinInterval * (1 << MIN(retryCount_ - 1, 16)),
+                                      kAKGCRetryMaxInterval);
+        nextSendTime_ = CFAbsoluteTimeGetCurrent() + interval;
         
-        // 送信済み実績データのファイルの内容を更新する
-        [self writeLocalAchievements];
+        AKLog(1, @"送信失敗:retry=%d interval=%.0f [%@]", retryCount_, interval, [error localizedDescription]);
+        return;
     }
+    
+    retryCount_ = 0;
+    nextSendTime_ = 0.0;
+    
+    // 送信後に更新されていない実績を取り除く
+    NSMutableDictionary *entries = [self.outbox objectForKey:kAKGCOutboxAchievementsKey];
+    NSDictionary *sentEntries = [sent objectForKey:kAKGCOutboxAchievementsKey];
+    for (NSString *identifier in sentEntries) {
+        if ([[entries objectForKey:identifier] isEqualToDictionary:[sentEntries objectForKey:identifier]]) {
+            [entries removeObjectForKey:identifier];
+        }
+    }
+    
+    // 送信後に更新されていないスコアを取り除く
+    NSNumber *score = [self.outbox objectForKey:kAKGCOutboxScoreKey];
+    NSNumber *sentScore = [sent objectForKey:kAKGCOutboxScoreKey];
+    if (score != nil && sentScore != nil && [score isEqualToNumber:sentScore]) {
+        [self.outbox removeObjectForKey:kAKGCOutboxScoreKey];
+    }
+    
+    AKLog(1, @"送信完了:achievements=%d score=%@", sentEntries.count, sentScore);
+    
+    // 送信待ちのデータのファイルの内容を更新する
+    [self writeOutbox];
 }
 
 /*!
@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) 2012-2013 Akihiro Kaneda.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   1.Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   2.Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ *   3.Neither the name of the Monochrome Soft nor the names of its contributors
+ *     may be used to endorse or promote products derived from this software
+ *     without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+/*!
+ @file AKGameCenterTransport.h
+ @brief Game Center送信処理
+
+ Game Centerの送信待ちデータを送信する処理を定義する。
+ */
+
+#import <Foundation/Foundation.h>
+
+/// 送信データの実績の辞書のキー
+extern NSString *kAKGCOutboxAchievementsKey;
+/// 送信データのスコアのキー
+extern NSString *kAKGCOutboxScoreKey;
+/// 実績の達成率のキー
+extern NSString *kAKGCOutboxPercentKey;
+/// 実績のバナー表示有無のキー
+extern NSString *kAKGCOutboxBannerKey;
+
+/*!
+ @brief Game Center送信処理
+
+ 送信待ちデータをまとめて送信する。
+ 送信データは保存形式と同じプロパティリストで、実績のIDをキーとした達成率とバナー表示有無の辞書と、
+ スコアの最大値を持つ。送信処理はGame Center管理クラスのキューから呼び出される。
+ */
+@protocol AKGameCenterTransport <NSObject>
+
+// 送信待ちデータの送信
+- (void)sendOutbox:(NSDictionary *)outbox completion:(void (^)(NSError *error))completion;
+
+@end
+
+// GameKitによる送信処理
+@interface AKGameKitTransport : NSObject <AKGameCenterTransport>
+@end
+
+#ifdef DEBUG
+// HTTPによる送信処理
+@interface AKHTTPGameCenterTransport : NSObject <AKGameCenterTransport> {
+    /// 送信先のURL
+    NSURL *url_;
+}
+
+/// 送信先のURL
+@property (nonatomic, retain)NSURL *url;
+
+// 送信先を指定した初期化処理
+- (id)initWithURL:(NSURL *)url;
+@end
+#endif
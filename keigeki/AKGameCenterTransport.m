@@ -0,0 +1,263 @@
+/*
+ * Copyright (c) 2012-2013 Akihiro Kaneda.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   1.Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   2.Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ *   3.Neither the name of the Monochrome Soft nor the names of its contributors
+ *     may be used to endorse or promote products derived from this software
+ *     without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+/*!
+ @file AKGameCenterTransport.m
+ @brief Game Center送信処理
+
+ Game Centerの送信待ちデータを送信する処理を定義する。
+ */
+
+#import <GameKit/GameKit.h>
+#import "AKGameCenterTransport.h"
+#import "AKCommon.h"
+
+/// 送信データの実績の辞書のキー
+NSString *kAKGCOutboxAchievementsKey = @"achievements";
+/// 送信データのスコアのキー
+NSString *kAKGCOutboxScoreKey = @"score";
+/// 実績の達成率のキー
+NSString *kAKGCOutboxPercentKey = @"percent";
+/// 実績のバナー表示有無のキー
+NSString *kAKGCOutboxBannerKey = @"banner";
+
+/// 傾撃ハイスコアのカテゴリ
+static NSString *kAKGCScoreCategory = @"keigeki_score";
+/// エラーのドメイン
+static NSString *kAKGCTransportErrorDomain = @"AKGameCenterTransport";
+#ifdef DEBUG
+/// HTTP送信のタイムアウト時間
+static const NSTimeInterval kAKHTTPTimeout = 10.0;
+#endif
+
+/*!
+ @brief GameKitによる送信処理
+
+ 実績はまとめて1回、スコアは1回で送信する。
+ まとめて送信するメソッドがないOSでは1件ずつ送信する。
+ */
+@implementation AKGameKitTransport
+
+/*!
+ @brief 送信待ちデータの送信
+
+ GameKitで実績とスコアを送信する。
+ 認証済みでない場合は送信せずにエラーとする。
+ 実績とスコアの両方の送信が終わった時点で完了処理を呼び出し、どちらかが失敗した場合はそのエラーを渡す。
+ @param outbox 送信データ
+ @param completion 完了処理
+ */
+- (void)sendOutbox:(NSDictionary *)outbox completion:(void (^)(NSError *))completion
+{
+    // 認証済みでない場合は送信しない
+    if (![GKLocalPlayer localPlayer].isAuthenticated) {
+        completion([NSError errorWithDomain:kAKGCTransportErrorDomain code:1 userInfo:nil]);
+        return;
+    }
+
+    // 送信する実績を作成する
+    NSDictionary *entries = [outbox objectForKey:kAKGCOutboxAchievementsKey];
+    NSMutableArray *achievements = [NSMutableArray arrayWithCapacity:entries.count];
+    for (NSString *identifier in entries) {
+
+        NSDictionary *entry = [entries objectForKey:identifier];
+
+        GKAchievement *achievement = [[[GKAchievement alloc] initWithIdentifier:identifier] autorelease];
+        achievement.percentComplete = [[entry objectForKey:kAKGCOutboxPercentKey] doubleValue];
+        // バナー表示の設定はiOS 5以降のため、ない場合は設定しない
+        if ([achievement respondsToSelector:@selector(setShowsCompletionBanner:)]) {
+            achievement.showsCompletionBanner = [[entry objectForKey:kAKGCOutboxBannerKey] boolValue];
+        }
+
+        [achievements addObject:achievement];
+    }
+
+    // 送信するスコアを作成する
+    NSMutableArray *scores = [NSMutableArray arrayWithCapacity:1];
+    int64_t value = [[outbox objectForKey:kAKGCOutboxScoreKey] longLongValue];
+    if (value > 0) {
+        GKScore *score = [[[GKScore alloc] initWithCategory:kAKGCScoreCategory] autorelease];
+        score.value = value;
+        [scores addObject:score];
+    }
+
+    // 両方の送信が終わるのを待つためのグループを作成する
+    dispatch_group_t group = dispatch_group_create();
+    __block NSError *result = nil;
+
+    // 送信結果の処理を作成する。最初に失敗したエラーを完了処理に渡す。
+    void (^finish)(NSError *) = ^(NSError *error) {
+        if (error != nil && result == nil) {
+            result = [error retain];
+        }
+        dispatch_group_leave(group);
+    };
+
+    // 実績を送信する
+    // まとめて送信するメソッドはiOS 6以降のため、ない場合は1件ずつ送信する
+    if (achievements.count > 0) {
+        if ([GKAchievement respondsToSelector:@selector(reportAchievements:withCompletionHandler:)]) {
+            dispatch_group_enter(group);
+            [GKAchievement reportAchievements:achievements withCompletionHandler:^(NSError *error) {
+                AKLog(error != nil, @"実績送信に失敗:count=%d [%@]", achievements.count, [error localizedDescription]);
+                finish(error);
+            }];
+        }
+        else {
+            for (GKAchievement *achievement in achievements) {
+                dispatch_group_enter(group);
+                [achievement reportAchievementWithCompletionHandler:^(NSError *error) {
+                    AKLog(error != nil, @"実績送信に失敗:id=%@ [%@]", achievement.identifier, [error localizedDescription]);
+                    finish(error);
+                }];
+            }
+        }
+    }
+
+    // スコアを送信する
+    // まとめて送信するメソッドはiOS 6以降のため、ない場合は1件ずつ送信する
+    if (scores.count > 0) {
+        if ([GKScore respondsToSelector:@selector(reportScores:withCompletionHandler:)]) {
+            dispatch_group_enter(group);
+            [GKScore reportScores:scores withCompletionHandler:^(NSError *error) {
+                AKLog(error != nil, @"ハイスコア送信に失敗:score=%lld [%@]", value, [error localizedDescription]);
+                finish(error);
+            }];
+        }
+        else {
+            for (GKScore *score in scores) {
+                dispatch_group_enter(group);
+                [score reportScoreWithCompletionHandler:^(NSError *error) {
+                    AKLog(error != nil, @"ハイスコア送信に失敗:score=%lld [%@]", value, [error localizedDescription]);
+                    finish(error);
+                }];
+            }
+        }
+    }
+
+    // 両方の送信が終わったら完了処理を呼び出す
+    dispatch_group_notify(group, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+        completion([result autorelease]);
+    });
+    dispatch_release(group);
+}
+
+@end
+
+#ifdef DEBUG
+/*!
+ @brief HTTPによる送信処理
+
+ 送信データをJSONにしてPOSTする。
+ Game Centerを使えない環境で送信待ちの処理を確認するために、ローカルのスタブサーバーへの送信に使用する。
+ デバッグ版にのみ組み込む。
+ */
+@implementation AKHTTPGameCenterTransport
+
+@synthesize url = url_;
+
+/*!
+ @brief 送信先を指定した初期化処理
+
+ 送信先のURLを指定して初期化する。
+ @param url 送信先のURL
+ @return 生成したオブジェクト。失敗時はnilを返す。
+ */
+- (id)initWithURL:(NSURL *)url
+{
+    // スーパークラスの初期化処理を実行する
+    self = [super init];
+    if (!self) {
+        return nil;
+    }
+
+    self.url = url;
+
+    return self;
+}
+
+/*!
+ @brief インスタンス解放処理
+
+ メンバを解放する。
+ */
+- (void)dealloc
+{
+    self.url = nil;
+
+    // スーパークラスの解放処理を実行する
+    [super dealloc];
+}
+
+/*!
+ @brief 送信待ちデータの送信
+
+ 送信データをJSONにして1回のリクエストで送信する。
+ ステータスコードが200番台以外の場合はエラーとする。
+ @param outbox 送信データ
+ @param completion 完了処理
+ */
+- (void)sendOutbox:(NSDictionary *)outbox completion:(void (^)(NSError *))completion
+{
+    NSError *error = nil;
+
+    // 送信データをJSONにする
+    NSData *body = [NSJSONSerialization dataWithJSONObject:outbox options:0 error:&error];
+    if (body == nil) {
+        completion(error);
+        return;
+    }
+
+    // リクエストを作成する
+    NSMutableURLRequest *request = [NSMutableURLRequest requestWithURL:self.url
+                                                           cachePolicy:NSURLRequestReloadIgnoringLocalCacheData
+                                                       timeoutInterval:kAKHTTPTimeout];
+    [request setHTTPMethod:@"POST"];
+    [request setValue:@"application/json" forHTTPHeaderField:@"Content-Type"];
+    [request setHTTPBody:body];
+
+    // 送信する
+    [NSURLConnection sendAsynchronousRequest:request
+                                       queue:[[[NSOperationQueue alloc] init] autorelease]
+                           completionHandler:^(NSURLResponse *response, NSData *data, NSError *error) {
+
+        // ステータスコードが200番台以外の場合はエラーとする
+        NSInteger status = [(NSHTTPURLResponse *)response statusCode];
+        if (error == nil && (status < 200 || status >= 300)) {
+            error = [NSError errorWithDomain:kAKGCTransportErrorDomain code:status userInfo:nil];
+        }
+
+        AKLog(error != nil, @"送信に失敗:url=%@ [%@]", self.url, [error localizedDescription]);
+
+        completion(error);
+    }];
+}
+
+@end
+
+#endif
@@ -0,0 +1,112 @@
+/*
+ * Copyright (c) 2012-2013 Akihiro Kaneda.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   1.Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   2.Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ *   3.Neither the name of the Monochrome Soft nor the names of its contributors
+ *     may be used to endorse or promote products derived from this software
+ *     without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+/*!
+ @file AKGameEventBuffer.h
+ @brief ゲームイベントバッファ
+
+ キャラクターからゲームプレイシーンへの要求をフレーム単位で蓄積するクラスを定義する。
+ */
+
+#import <Foundation/Foundation.h>
+#import <UIKit/UIKit.h>
+
+/// ゲームイベントの種類。シーンはこの順番にまとめて処理する。
+enum AKGameEventType {
+    kAKGameEventShotResult = 0, ///< 自機弾の命中結果
+    kAKGameEventEnemyShot,      ///< 敵弾の発射
+    kAKGameEventEffect,         ///< 画面効果の生成
+    kAKGameEventSound,          ///< 効果音の再生
+    kAKGameEventScore,          ///< スコアの加算
+    kAKGameEventMiss,           ///< 自機の破壊
+    kAKGameEventTypeCount       ///< 種類の数
+};
+
+/// ゲームイベント
+struct AKGameEvent {
+    /// 種類
+    enum AKGameEventType type;
+    /// ファイル名(効果音、画面効果)。定数文字列のみを指定し、保持はしない。
+    NSString *name;
+    /// 画像の切り出し範囲(画面効果)
+    CGRect rect;
+    /// 数値(敵弾の種類、画面効果のフレーム数、スコア、命中したかどうか)
+    NSInteger value;
+    /// フレーム更新間隔(画面効果)
+    float delay;
+    /// 位置x座標
+    float x;
+    /// 位置y座標
+    float y;
+    /// 向き
+    float angle;
+    /// 速度(敵弾。0の場合は種類ごとの速度)
+    float speed;
+    /// 弾幕パターンID(敵弾。0の場合はパターンなし)
+    NSInteger pattern;
+};
+
+// ゲームイベントバッファクラス
+@interface AKGameEventBuffer : NSObject {
+    /// イベントの配列
+    struct AKGameEvent *events_;
+    /// 格納しているイベントの数
+    NSInteger count_;
+    /// 配列の確保サイズ
+    NSInteger capacity_;
+}
+
+/// 格納しているイベントの数
+@property (nonatomic, readonly)NSInteger count;
+
+// シングルトンオブジェクト取得
++ (AKGameEventBuffer *)sharedBuffer;
+// イベントの追加
+- (struct AKGameEvent *)push:(enum AKGameEventType)type;
+// 効果音再生の追加
+- (void)pushSound:(NSString *)fileName;
+// 画面効果生成の追加
+- (void)pushEffect:(NSString *)fileName startRect:(CGRect)rect
+        frameCount:(NSInteger)count delay:(float)delay
+              posX:(float)posx posY:(float)posy;
+// 敵弾発射の追加
+- (void)pushEnemyShot:(NSInteger)type posX:(float)posx posY:(float)posy angle:(float)angle;
+// 速度と弾幕パターンを指定した敵弾発射の追加
+- (void)pushEnemyShot:(NSInteger)type posX:(float)posx posY:(float)posy angle:(float)angle
+                speed:(float)speed pattern:(NSInteger)pattern;
+// スコア加算の追加
+- (void)pushScore:(NSInteger)score;
+// 自機弾命中結果の追加
+- (void)pushShotResult:(BOOL)isHit;
+// 自機破壊の追加
+- (void)pushMiss;
+// イベントの取得
+- (const struct AKGameEvent *)eventAtIndex:(NSInteger)index;
+// イベントのクリア
+- (void)clear;
+@end
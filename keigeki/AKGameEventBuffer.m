@@ -0,0 +1,313 @@
+/*
+ * Copyright (c) 2012-2013 Akihiro Kaneda.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   1.Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   2.Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ *   3.Neither the name of the Monochrome Soft nor the names of its contributors
+ *     may be used to endorse or promote products derived from this software
+ *     without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+/*!
+ @file AKGameEventBuffer.m
+ @brief ゲームイベントバッファ
+
+ キャラクターからゲームプレイシーンへの要求をフレーム単位で蓄積するクラスを定義する。
+ */
+
+#import "AKGameEventBuffer.h"
+#import "AKCommon.h"
+
+/// イベント配列の初期確保サイズ
+static const NSInteger kAKGameEventInitialCapacity = 64;
+
+/// シングルトンオブジェクト
+static AKGameEventBuffer *sharedBuffer_ = nil;
+
+/*!
+ @brief ゲームイベントバッファクラス
+
+ キャラクターの移動処理中に発生した、敵弾の発射や画面効果の生成、スコアの加算などの要求を蓄積する。
+ ゲームプレイシーンは全キャラクターの移動と当たり判定が終わった後に、種類ごとにまとめて処理する。
+ キャラクタープールの走査中にプールへの追加が行われないようにし、
+ キャラクターからシーンを検索する処理をなくすために使用する。
+ 配列は不足したときのみ拡張し、毎フレームのメモリ確保は行わない。
+ */
+@implementation AKGameEventBuffer
+
+@synthesize count = count_;
+
+/*!
+ @brief シングルトンオブジェクト取得
+
+ シングルトンオブジェクトを取得する。
+ まだ生成されていない場合は生成を行う。
+ @return シングルトンオブジェクト
+ */
++ (AKGameEventBuffer *)sharedBuffer
+{
+    // 他のスレッドで同時に実行されないようにする
+    @synchronized(self) {
+
+        // シングルトンオブジェクトが生成されていない場合は生成する
+        if (!sharedBuffer_) {
+            sharedBuffer_ = [[AKGameEventBuffer alloc] init];
+        }
+
+        return sharedBuffer_;
+    }
+
+    return nil;
+}
+
+/*!
+ @brief インスタンス生成処理
+
+ インスタンス生成処理。
+ シングルトンのため、二重に生成された場合はアサーションを出力する。
+ */
++ (id)alloc
+{
+    // 他のスレッドで同時に実行されないようにする
+    @synchronized(self) {
+
+        NSAssert(sharedBuffer_ == nil, @"Attempted to allocate a second instance of a singleton.");
+        return [super alloc];
+    }
+
+    return nil;
+}
+
+/*!
+ @brief オブジェクト生成処理
+
+ オブジェクトの生成を行う。イベント配列を確保する。
+ @return 生成したオブジェクト。失敗時はnilを返す。
+ */
+- (id)init
+{
+    // スーパークラスの生成処理
+    self = [super init];
+    if (!self) {
+        return nil;
+    }
+
+    // イベント配列を確保する
+    events_ = malloc(sizeof(struct AKGameEvent) * kAKGameEventInitialCapacity);
+    if (!events_) {
+        [self release];
+        return nil;
+    }
+    capacity_ = kAKGameEventInitialCapacity;
+    count_ = 0;
+
+    return self;
+}
+
+/*!
+ @brief インスタンス解放時処理
+
+ インスタンス解放時にオブジェクトを解放する。
+ */
+- (void)dealloc
+{
+    // イベント配列を解放する
+    free(events_);
+
+    // スーパークラスの解放処理
+    [super dealloc];
+}
+
+/*!
+ @brief イベントの追加
+
+ イベント配列の末尾に要素を追加し、その要素を返す。
+ 配列が不足している場合は倍のサイズに拡張する。
+ @param type イベントの種類
+ @return 追加した要素。拡張に失敗した場合はNULL。
+ */
+- (struct AKGameEvent *)push:(enum AKGameEventType)type
+{
+    // 配列が不足している場合は拡張する
+    if (count_ >= capacity_) {
+
+        struct AKGameEvent *events = realloc(events_, sizeof(struct AKGameEvent) * capacity_ * 2);
+
+        // 拡張に失敗した場合はイベントを破棄する
+        if (!events) {
+            AKLog(1, @"イベント配列の拡張に失敗:capacity=%d", capacity_);
+            return NULL;
+        }
+
+        events_ = events;
+        capacity_ *= 2;
+        AKLog(1, @"イベント配列を拡張:capacity=%d", capacity_);
+    }
+
+    // 末尾の要素を初期化して返す
+    struct AKGameEvent *event = &events_[count_++];
+    memset(event, 0, sizeof(struct AKGameEvent));
+    event->type = type;
+
+    return event;
+}
+
+/*!
+ @brief 効果音再生の追加
+
+ 効果音の再生を追加する。
+ @param fileName 効果音のファイル名(定数文字列)
+ */
+- (void)pushSound:(NSString *)fileName
+{
+    struct AKGameEvent *event = [self push:kAKGameEventSound];
+    if (event) {
+        event->name = fileName;
+    }
+}
+
+/*!
+ @brief 画面効果生成の追加
+
+ 画面効果の生成を追加する。
+ @param fileName 画像ファイル名(定数文字列)
+ @param rect 画像の切り出し範囲
+ @param count アニメーションフレームの個数
+ @param delay フレームの間隔
+ @param posx x座標
+ @param posy y座標
+ */
+- (void)pushEffect:(NSString *)fileName startRect:(CGRect)rect
+        frameCount:(NSInteger)count delay:(float)delay
+              posX:(float)posx posY:(float)posy
+{
+    struct AKGameEvent *event = [self push:kAKGameEventEffect];
+    if (event) {
+        event->name = fileName;
+        event->rect = rect;
+        event->value = count;
+        event->delay = delay;
+        event->x = posx;
+        event->y = posy;
+    }
+}
+
+/*!
+ @brief 敵弾発射の追加
+
+ 敵弾の発射を追加する。
+ @param type 敵弾の種類
+ @param posx 発射位置x座標
+ @param posy 発射位置y座標
+ @param angle 発射方向
+ */
+- (void)pushEnemyShot:(NSInteger)type posX:(float)posx posY:(float)posy angle:(float)angle
+{
+    [self pushEnemyShot:type posX:posx posY:posy angle:angle speed:0.0f pattern:0];
+}
+
+/*!
+ @brief 速度と弾幕パターンを指定した敵弾発射の追加
+
+ 敵弾の発射を追加する。弾幕パターンを指定した場合は生成した敵弾でパターンを開始する。
+ @param type 敵弾の種類
+ @param posx 発射位置x座標
+ @param posy 発射位置y座標
+ @param angle 発射方向
+ @param speed 速度(0の場合は種類ごとの速度)
+ @param pattern 弾幕パターンID(0の場合はパターンなし)
+ */
+- (void)pushEnemyShot:(NSInteger)type posX:(float)posx posY:(float)posy angle:(float)angle
+                speed:(float)speed pattern:(NSInteger)pattern
+{
+    struct AKGameEvent *event = [self push:kAKGameEventEnemyShot];
+    if (event) {
+        event->value = type;
+        event->x = posx;
+        event->y = posy;
+        event->angle = angle;
+        event->speed = speed;
+        event->pattern = pattern;
+    }
+}
+
+/*!
+ @brief スコア加算の追加
+
+ スコアの加算を追加する。
+ @param score 加算するスコア
+ */
+- (void)pushScore:(NSInteger)score
+{
+    struct AKGameEvent *event = [self push:kAKGameEventScore];
+    if (event) {
+        event->value = score;
+    }
+}
+
+/*!
+ @brief 自機弾命中結果の追加
+
+ 自機弾が消滅したときの命中結果を追加する。
+ @param isHit 命中した場合YES
+ */
+- (void)pushShotResult:(BOOL)isHit
+{
+    struct AKGameEvent *event = [self push:kAKGameEventShotResult];
+    if (event) {
+        event->value = isHit;
+    }
+}
+
+/*!
+ @brief 自機破壊の追加
+
+ 自機の破壊を追加する。
+ */
+- (void)pushMiss
+{
+    [self push:kAKGameEventMiss];
+}
+
+/*!
+ @brief イベントの取得
+
+ 指定した位置のイベントを取得する。
+ @param index 位置
+ @return イベント
+ */
+- (const struct AKGameEvent *)eventAtIndex:(NSInteger)index
+{
+    NSAssert(index >= 0 && index < count_, @"イベントの範囲外:index=%d count=%d", index, count_);
+
+    return &events_[index];
+}
+
+/*!
+ @brief イベントのクリア
+
+ 格納しているイベントをすべて破棄する。確保した配列はそのまま再利用する。
+ */
+- (void)clear
+{
+    count_ = 0;
+}
+@end
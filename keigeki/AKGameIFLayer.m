@@ -55,6 +55,9 @@ NSUInteger kAKGameIFTagResult = 0x20;
 /// 待機中のタグ
 NSUInteger kAKGameIFTagWait = 0x80;
 
+/// 加速度センサーの更新間隔
+static const double kAKTiltUpdateInterval = 1.0 / 60.0;
+
 // 加速度センサーの値を比率換算する
 static float AKAccel2Ratio(float accel);
 
@@ -86,6 +89,17 @@ static float AKAccel2Ratio(float accel);
     // 加速度センサーを有効にする
     self.isAccelerometerEnabled = YES;
     
+    // 加速度センサーの更新間隔を設定する。
+    // デバッグ時は起動引数"-AKTiltHz 30"などで更新頻度を変更できる。
+    double tiltInterval = kAKTiltUpdateInterval;
+#ifdef DEBUG
+    NSInteger tiltHz = [[NSUserDefaults standardUserDefaults] integerForKey:@"AKTiltHz"];
+    if (tiltHz > 0) {
+        tiltInterval = 1.0 / tiltHz;
+    }
+#endif
+    [[UIAccelerometer sharedAccelerometer] setUpdateInterval:tiltInterval];
+    
     // ゲームプレイ中のメニュー項目を作成する
     [self createPlayingMenu];
     
@@ -474,8 +488,8 @@ static float AKAccel2Ratio(float accel);
     // 親クラスをゲームシーンクラスにキャストする
     AKGameScene *gameScene = (AKGameScene *)self.parent;
 
-    // 速度の変更
-    [gameScene movePlayerByVX:ax VY:ay];
+    // センサーの計測時刻とともに入力を記録する。速度への反映はシーンの更新時に行う。
+    [gameScene.tiltInput addSampleAtTime:acceleration.timestamp x:ax y:ay];
 }
 @end
 
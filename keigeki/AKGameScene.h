@@ -37,14 +37,20 @@
 #import "cocos2d.h"
 #import "AKBackground.h"
 #import "AKPlayer.h"
+#import "AKPlayerShot.h"
 #import "AKCharacterPool.h"
 #import "AKRadar.h"
 #import "AKLifeMark.h"
+#import "AKEnemy.h"
 #import "AKEnemyShot.h"
 #import "AKResultLayer.h"
 #import "AKLabel.h"
 #import "AKCommon.h"
 #import "AKGameIFLayer.h"
+#import "AKTiltInput.h"
+#import "AKGameSnapshot.h"
+#import "AKRenderRecorder.h"
+#import "AKVersusSession.h"
 
 /// ゲームプレイの状態
 enum AKGameState {
@@ -61,6 +67,14 @@ enum AKGameState {
     kAKGameStateSleep           ///< スリープ処理中
 };
 
+/// ゲームモード
+enum AKGameMode {
+    kAKGameModeNormal = 0,  ///< 通常
+    kAKGameModeStress,      ///< 負荷試験
+    kAKGameModeVersus,      ///< 対戦
+    kAKGameModeCount        ///< ゲームモードの数
+};
+
 /// 敵の種類
 enum AKEnemyType {
     kAKEnemyTypeNormal = 0, ///< 雑魚
@@ -71,9 +85,12 @@ enum AKEnemyType {
     kAKEnemyTypeCanon       ///< 大砲
 };
 
+struct AKVersusSceneRecord;
 
 // ゲームプレイシーン
-@interface AKGameScene : CCScene {
+@interface AKGameScene : CCScene <AKRenderSceneNaming, AKVersusSimulation> {
+    /// ゲームモード
+    enum AKGameMode mode_;
     /// 現在の状態
     enum AKGameState state_;
     /// スリープ終了後の状態
@@ -122,6 +139,38 @@ enum AKEnemyType {
     AKRadar *radar_;
     /// 残機表示
     AKLifeMark *lifeMark_;
+    /// 傾き入力
+    AKTiltInput *tiltInput_;
+    /// スナップショットから復元したかどうか
+    BOOL isRestored_;
+    /// 対戦相手の機体
+    AKPlayer *rival_;
+    /// 対戦相手の自機弾プール
+    AKCharacterPool *rivalShotPool_;
+    /// 対戦モードでレーダーに表示するキャラクター
+    NSArray *radarTargets_;
+    /// 対戦通信
+    AKVersusSession *versusSession_;
+    /// 対戦の計算中のティック
+    uint32_t versusTick_;
+    /// 効果音や画面効果を再生済みのティック数
+    uint32_t versusPresentedTick_;
+    /// 対戦の残機の数(プレイヤー番号順)
+    NSInteger versusLife_[kAKVersusPlayerCount];
+    /// 対戦の自機復活までのティック数(プレイヤー番号順)
+    NSInteger versusRebirthTicks_[kAKVersusPlayerCount];
+    /// 対戦で残機がなくなったプレイヤー(プレイヤー番号のビットの組み合わせ)
+    NSInteger versusLoserMask_;
+    /// 対戦の決着がついたティック
+    uint32_t versusEndTick_;
+    /// 対戦の次のティックまでの経過時間
+    float versusTime_;
+    /// 対戦の自分の入力
+    struct AKVersusInput versusInput_;
+    /// 対戦で次のティックにショットを撃つかどうか
+    BOOL isShotRequested_;
+    /// 対戦のティックごとに保存した状態
+    struct AKVersusSceneRecord *versusRecords_;
 }
 
 /// 現在の状態
@@ -142,13 +191,33 @@ enum AKEnemyType {
 @property (nonatomic, retain)AKRadar *rader;
 /// 残機表示
 @property (nonatomic, retain)AKLifeMark *lifeMark;
+/// 傾き入力
+@property (nonatomic, retain)AKTiltInput *tiltInput;
+/// 対戦相手の機体
+@property (nonatomic, retain)AKPlayer *rival;
+/// 対戦相手の自機弾プール
+@property (nonatomic, retain)AKCharacterPool *rivalShotPool;
+/// 対戦通信
+@property (nonatomic, retain)AKVersusSession *versusSession;
 /// ショット発射数
 @property (nonatomic)NSInteger shotCount;
 /// ショット命中数
 @property (nonatomic)NSInteger hitCount;
+/// ゲームモード
+@property (nonatomic, readonly)enum AKGameMode mode;
 
 // ゲームシーンクラス取得
 + (AKGameScene *)getInstance;
+// ゲームモードを指定したコンビニエンスコンストラクタ
++ (id)sceneWithMode:(enum AKGameMode)mode;
+// 再利用するシーンの事前生成
++ (void)prepareWarmSceneWithMode:(enum AKGameMode)mode;
+// 再利用するシーンの取得
++ (AKGameScene *)warmSceneWithMode:(enum AKGameMode)mode;
+// 再利用するシーンの解放
++ (void)purgeWarmScene;
+// ゲームモードを指定したオブジェクト生成処理
+- (id)initWithMode:(enum AKGameMode)mode;
 // リザルト画面取得
 - (AKResultLayer *)resultLayer;
 // 入力レイヤー取得
@@ -161,22 +230,28 @@ enum AKEnemyType {
 - (void)updateClear:(ccTime)dt;
 // スリープ中の更新処理
 - (void)updateSleep:(ccTime)dt;
+// 対戦中の更新処理
+- (void)updateVersus:(ccTime)dt;
 // 自機の移動
 - (void)movePlayerByVX:(float)vx VY:(float)vy;
+// 傾き入力の反映
+- (void)applyTiltInput;
 // 自機弾の発射
 - (void)firePlayerShot;
 // 敵の生成
-- (void)entryEnemy:(enum AKEnemyType)type
-              PosX:(NSInteger)posx PosY:(NSInteger)posy Angle:(float)angle;
+- (AKEnemy *)entryEnemy:(enum AKEnemyType)type
+                   PosX:(NSInteger)posx PosY:(NSInteger)posy Angle:(float)angle;
 // 敵弾の生成
-- (void)fireEnemyShot:(enum ENEMY_SHOT_TYPE)type
-                 PosX:(NSInteger)posx PosY:(NSInteger)posy Angle:(float)angle;
+- (AKEnemyShot *)fireEnemyShot:(enum ENEMY_SHOT_TYPE)type
+                          PosX:(NSInteger)posx PosY:(NSInteger)posy Angle:(float)angle;
 // 画面効果の生成
 - (void)entryEffect:(NSString *)fileName startRect:(CGRect)rect
          frameCount:(NSInteger)count delay:(float)delay
                posX:(float)posx posY:(float)posy;
 // 自機破壊時の処理
 - (void)miss;
+// キャラクタープールの使用状況出力
+- (void)reportPoolUsage;
 // ゲーム状態リセット
 - (void)resetAll:(NSInteger)stage;
 // スコア加算
@@ -187,8 +262,38 @@ enum AKEnemyType {
 - (void)pause;
 // ゲーム再開
 - (void)resume;
+// スナップショット保存可否
+- (BOOL)isSnapshotAvailable;
+// スナップショット作成
+- (AKGameSnapshot *)snapshot;
+// スナップショットからの復元
+- (BOOL)restoreFromSnapshot:(AKGameSnapshot *)snapshot;
+// 対戦の開始
+- (BOOL)startVersus;
+// 対戦の終了
+- (void)finishVersus:(NSString *)result;
+// 対戦の決着の判定
+- (void)checkVersusResult;
+// 対戦のプレイヤー番号に対応する機体の取得
+- (AKPlayer *)versusShip:(NSInteger)index;
+// 対戦のプレイヤー番号に対応する自機弾プールの取得
+- (AKCharacterPool *)versusShotPool:(NSInteger)index;
+// 対戦の自機弾の配置
+- (AKPlayerShot *)entryVersusShot:(NSInteger)index X:(float)x Y:(float)y Angle:(float)angle;
+// 対戦の機体の移動
+- (void)moveVersusShip:(NSInteger)index ScreenX:(NSInteger)scrx ScreenY:(NSInteger)scry;
+// 対戦の機体の当たり判定
+- (void)hitVersusShip:(NSInteger)index;
+// 対戦の状態の書き出し
+- (void)saveVersusRecord:(struct AKVersusSceneRecord *)record;
+// 対戦の状態の反映
+- (void)loadVersusRecord:(const struct AKVersusSceneRecord *)record;
 // スクリプト読込
 - (void)readScriptOfStage:(NSInteger)stage Wave:(NSInteger)wave;
+// スクリプトからの敵配置
+- (NSInteger)entryEnemyWithScriptOfStage:(NSInteger)stage Wave:(NSInteger)wave;
+// 負荷試験用の敵配置
+- (NSInteger)entryStressWave;
 // ウェーブクリア
 - (void)clearWave;
 // ステージクリア結果スキップ
@@ -197,12 +302,20 @@ enum AKEnemyType {
 - (void)clearStage;
 // ハイスコアファイルの読込
 - (void)readHiScore;
+// ハイスコアの反映
+- (void)applyHiScore:(NSInteger)hiScore;
 // ハイスコアファイルの書込
 - (void)writeHiScore;
+// 連続描画要求
+- (BOOL)needsContinuousFrames;
+// イベント処理
+- (void)processEvents;
 // 命中率更新
 - (void)updateHit;
 // プレイ時間更新
 - (void)updateTime;
+// 処理時間計測結果の表示更新
+- (void)updateProfile;
 // 情報レイヤーへのラベル配置
 - (void)setLabelToInfoLayer:(NSString *)str atPos:(CGPoint)pos tag:(NSInteger)tag frame:(enum AKLabelFrame)frame;
 // タイトル画面に戻る
@@ -230,3 +343,6 @@ enum AKEnemyType {
 // BGM再生
 - (void)startBGM;
 @end
+
+// ステージ構成スクリプトの1行の解析
+BOOL AKParseStageScriptLine(NSString *line, enum AKEnemyType *type, NSInteger *posX, NSInteger *posY);
@@ -33,13 +33,15 @@
  ゲームプレイのメインのシーンを管理するクラスを定義する。
  */
 
+#import <QuartzCore/QuartzCore.h>
+#import <stddef.h>
 #import "AKGameScene.h"
+#import "AKTextureManager.h"
 #import "AKGameIFLayer.h"
 #import "AKPlayerShot.h"
 #import "AKEnemy.h"
 #import "AKEnemyShot.h"
 #import "AKEffect.h"
-#import "AKHiScoreFile.h"
 #import "AKResultLayer.h"
 #import "AKLabel.h"
 #import "AKTitleScene.h"
@@ -47,6 +49,15 @@
 #import "SimpleAudioEngine.h"
 #import "AKGameCenterHelper.h"
 #import "AKTwitterHelper.h"
+#import "AKSaveStore.h"
+#import "AKFrameProfiler.h"
+#import "AKGameEventBuffer.h"
+#import "AKRenderBuffer.h"
+#import "AKBulletPattern.h"
+#import "AKAdController.h"
+#import "AKFramePacer.h"
+#import "AKStartupTrace.h"
+#import "AKTrace.h"
 
 /// 情報レイヤーに配置するノードのタグ
 enum {
@@ -56,7 +67,9 @@ enum {
     kAKInfoTagHiScore,          ///< ハイスコア
     kAKInfoTagWaveNo,           ///< Wave番号
     kAKInfoTagHit,              ///< 命中率
-    kAKInfoTagTime              ///< プレイ時間
+    kAKInfoTagTime,             ///< プレイ時間
+    kAKInfoTagProfile,          ///< 処理時間計測結果
+    kAKInfoTagVersusResult      ///< 対戦結果
 };
 
 /// レイヤーのz座標、タグの値にも使用する
@@ -77,12 +90,68 @@ enum {
     kAKCharaPosZEffect          ///< 画面効果
 };
 
-/// 同時に生成可能な自機弾の最大数
-static const NSInteger kAKMaxPlayerShotCount = 16;
-/// 同時に生成可能な敵弾の最大数
-static const NSInteger kAKEnemyShotCount = 64;
-/// 同時に生成可能な画面効果の最大数
-static const NSInteger kAKMaxEffectCount = 16;
+/// キャラクタープールのサイズ
+typedef struct {
+    NSInteger playerShot;   ///< 同時に生成可能な自機弾の最大数
+    NSInteger enemy;        ///< 同時に生成可能な敵の最大数
+    NSInteger enemyShot;    ///< 同時に生成可能な敵弾の最大数
+    NSInteger effect;       ///< 同時に生成可能な画面効果の最大数
+} AKPoolCapacity;
+
+/// 対戦モードで1人が同時に配置できる自機弾の最大数
+enum {
+    kAKVersusShotCount = 16
+};
+
+/// ゲームモードごとのキャラクタープールのサイズ
+static const AKPoolCapacity kAKPoolCapacity[kAKGameModeCount] = {
+    {16, 16, 64, 16},       // 通常
+    {64, 512, 4096, 128},   // 負荷試験
+    {kAKVersusShotCount, 16, 64, 16}    // 対戦
+};
+
+/// キャラクタープールの空きがないときの動作
+typedef struct {
+    enum AKPoolOverflowPolicy playerShot;   ///< 自機弾
+    enum AKPoolOverflowPolicy enemy;        ///< 敵
+    enum AKPoolOverflowPolicy enemyShot;    ///< 敵弾
+    enum AKPoolOverflowPolicy effect;       ///< 画面効果
+} AKPoolPolicy;
+
+/// キャラクタープールの空きがないときの動作。
+/// 敵は倒さないとウェーブが終わらないため拡張し、敵弾は自機から遠いものから、画面効果は古いものから再利用する。
+static const AKPoolPolicy kAKPoolPolicy = {
+    kAKPoolOverflowDropNewest,
+    kAKPoolOverflowGrow,
+    kAKPoolOverflowRecycleFarthest,
+    kAKPoolOverflowRecycleOldest
+};
+/// 拡張するプールのサイズの上限(通常のサイズに対する倍率)
+static const NSInteger kAKPoolGrowRate = 2;
+
+/// 負荷試験モードで1ウェーブに配置する敵の数
+static const NSInteger kAKStressEnemyCount = 400;
+/// 負荷試験モードで敵を配置する自機からの最小距離
+static const float kAKStressMinDistance = 200.0f;
+/// 負荷試験モードで敵を配置する自機からの最大距離
+static const float kAKStressMaxDistance = 800.0f;
+/// 負荷試験モードで敵を配置する距離の段階数
+static const NSInteger kAKStressRingCount = 8;
+
+/// 対戦モードの1ティックの時間
+static const float kAKVersusTickTime = 1.0f / 60.0f;
+/// 対戦モードで処理が遅れたときに1フレームで計算するティック数の最大値
+static const NSInteger kAKVersusMaxTicksPerFrame = 2;
+/// 対戦モードの自機復活までのティック数
+static const NSInteger kAKVersusRebirthTicks = 60;
+/// 対戦モードの開始時の2機の間隔(画面の幅に対する比率)
+static const float kAKVersusStartDistanceRatio = 1.0f;
+/// 対戦相手の機体と自機弾の色
+static const ccColor3B kAKRivalColor = {255, 128, 128};
+/// 対戦結果の表示位置、下からの比率
+static const float kAKVersusResultPosBottomRatio = 0.8f;
+/// 状態のハッシュ値(FNV-1a)の初期値
+static const uint32_t kAKVersusHashBasis = 2166136261u;
 
 /// 初期残機数
 static const NSInteger kAKStartLifeCount = 2;
@@ -132,6 +201,11 @@ static const float kAKTimePosTopPoint = 40.0f;
 /// メニュー項目の数
 static const NSInteger kAKItemCount = 8;
 
+/// 処理時間計測結果の表示を更新するフレーム間隔
+static const NSInteger kAKProfileUpdateInterval = 30;
+/// 処理時間計測結果の1行の表示文字数
+static const NSInteger kAKProfileLabelLength = 27;
+
 /// スコア表示のフォーマット
 static NSString *kAKScoreFormat = @"SCORE:%06d";
 /// ハイスコア表示のフォーマット
@@ -142,13 +216,19 @@ static NSString *kAKWaveNoFormat = @"%d/%d";
 static NSString *kAKHitFormat = @"HIT:%3d%%";
 /// プレイ時間のフォーマット
 static NSString *kAKTimeFormat = @"TIME:%02d:%02d:%02d";
-/// ハイスコアファイル名
-static NSString *kAKDataFileName = @"hiscore.dat";
-/// ハイスコアファイルのエンコードキー名
-static NSString *kAKDataFileKey = @"hiScoreData";
 
 /// ステージクリア時の表示文字列
 static NSString *kAKStageClearString = @"STAGE CLEAR";
+/// 対戦に勝った時の表示文字列
+static NSString *kAKVersusWinString = @"YOU WIN";
+/// 対戦に負けた時の表示文字列
+static NSString *kAKVersusLoseString = @"YOU LOSE";
+/// 対戦が引き分けの時の表示文字列
+static NSString *kAKVersusDrawString = @"DRAW";
+/// 対戦相手と状態が一致しなくなった時の表示文字列
+static NSString *kAKVersusDesyncString = @"DESYNC";
+/// 対戦通信を開始できなかった時の表示文字列
+static NSString *kAKVersusErrorString = @"CONNECTION ERROR";
 /// ゲームクリア時のツイートのフォーマットのキー
 static NSString *kAKGameClearTweetKey = @"GameClearTweet";
 /// ゲームオーバー時のツイートのフォーマットのキー
@@ -166,10 +246,133 @@ static NSString *kAKPauseSE = @"Pause.caf";
 static NSString *kAKHitSE = @"Hit.caf";
 /// エクステンド時の効果音
 static NSString *kAK1UpSE = @"1Up.caf";
+/// 1フレームに再生する効果音の種類の最大数
+static const NSInteger kAKMaxSoundPerFrame = 8;
+/// トレースをファイルに書き出すプレイ時間の間隔(秒)
+static const float kAKTraceFlushInterval = 5.0f;
+
+/*!
+ @brief キャラクターの状態の保存
+
+ プールのうち配置中のキャラクターの状態を書き出す。
+ 書き込み先にNULLを指定した場合は数のみを数える。
+ @param pool キャラクタープール
+ @param records 書き込み先
+ @return 配置中のキャラクターの数
+ */
+static NSInteger AKSaveCharacterRecords(AKCharacterPool *pool, struct AKCharacterRecord *records)
+{
+    NSInteger count = 0;
+    
+    for (AKCharacter *character in pool.pool) {
+        
+        // 配置中のもののみ保存する
+        if (!character.isStaged) {
+            continue;
+        }
+        
+        if (records != NULL) {
+            [character saveRecord:&records[count]];
+        }
+        count++;
+    }
+    
+    return count;
+}
+
+/// 対戦モードの1ティックの状態(固定長)
+struct AKVersusSceneRecord {
+    int32_t life[kAKVersusPlayerCount];             ///< 残機の数
+    int32_t rebirthTicks[kAKVersusPlayerCount];     ///< 自機復活までのティック数
+    int32_t loserMask;                              ///< 残機がなくなったプレイヤー
+    uint32_t endTick;                               ///< 決着がついたティック
+    int32_t shotCount[kAKVersusPlayerCount];        ///< 配置中の自機弾の数
+    struct AKCharacterRecord ships[kAKVersusPlayerCount];   ///< 機体
+    struct AKCharacterRecord shots[kAKVersusPlayerCount][kAKVersusShotCount];  ///< 配置中の自機弾
+};
+
+/*!
+ @brief 状態のハッシュ値の計算
+
+ FNV-1aでハッシュ値を計算する。計算途中のハッシュ値を渡して続けて計算できる。
+ @param data データ
+ @param length データの長さ
+ @param hash 計算途中のハッシュ値
+ @return ハッシュ値
+ */
+static uint32_t AKVersusHash(const void *data, size_t length, uint32_t hash)
+{
+    const uint8_t *bytes = (const uint8_t *)data;
+    
+    for (size_t i = 0; i < length; i++) {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+    
+    return hash;
+}
+
+/*!
+ @brief 対戦モードの当たり判定
+
+ スクリーン座標は端末ごとに異なるため、絶対座標で判定する。
+ ステージの端でループするため、近いほうの距離で判定する。
+ @param a キャラクター
+ @param b キャラクター
+ @param stageSize ステージサイズ
+ @return 衝突している場合YES
+ */
+static BOOL AKVersusIsHit(AKCharacter *a, AKCharacter *b, CGSize stageSize)
+{
+    float dx = fabsf(a.absx - b.absx);
+    float dy = fabsf(a.absy - b.absy);
+    
+    dx = MIN(dx, stageSize.width - dx);
+    dy = MIN(dy, stageSize.height - dy);
+    
+    return (dx < (a.width + b.width) / 2.0f && dy < (a.height + b.height) / 2.0f);
+}
+
+/*!
+ @brief ステージ構成スクリプトの1行の解析
+
+ カンマ区切りの敵の種類、x座標、y座標を取り出す。
+ 敵の種類は0始まりに変換し、座標はスクリプト上の値をそのまま返す。
+ @param line 1行の文字列
+ @param type 敵の種類
+ @param posX 自機からの相対x座標
+ @param posY 自機からの相対y座標
+ @return 敵の定義の場合YES、コメントの場合NO
+ */
+BOOL AKParseStageScriptLine(NSString *line, enum AKEnemyType *type, NSInteger *posX, NSInteger *posY)
+{
+    // 1文字目が"#"の場合はコメントとする
+    if ([[line substringToIndex:1] isEqualToString:@"#"]) {
+        AKLog(0, @"コメント:%@", line);
+        return NO;
+    }
+    
+    // カンマ区切りでパラメータを分割する
+    NSArray *params = [line componentsSeparatedByString:@","];
+    
+    // 1個目のパラメータは敵の種類として扱う。
+    // 敵の種類は0始まりとするため、-1する。
+    *type = (enum AKEnemyType)([[params objectAtIndex:0] integerValue] - 1);
+    
+    // 2個目のパラメータはx座標として扱う
+    *posX = [[params objectAtIndex:1] integerValue];
+    
+    // 3個目のパラメータはy座標として扱う
+    *posY = [[params objectAtIndex:2] integerValue];
+    
+    return YES;
+}
 
 /// アプリのURL
 static NSString *kAKAplUrl = @"https://itunes.apple.com/us/app/qing-ji/id569653828?l=ja&ls=1&mt=8";
 
+/// 再利用するために保持しているゲームプレイシーン
+static AKGameScene *warmScene_ = nil;
+
 /*!
  @brief ゲームプレイシーン
  
@@ -184,8 +387,13 @@ static NSString *kAKAplUrl = @"https://itunes.apple.com/us/app/qing-ji/id5696538
 @synthesize rader = radar_;
 @synthesize effectPool = effectPool_;
 @synthesize lifeMark = lifeMark_;
+@synthesize tiltInput = tiltInput_;
+@synthesize rival = rival_;
+@synthesize rivalShotPool = rivalShotPool_;
+@synthesize versusSession = versusSession_;
 @synthesize shotCount = shotCount_;
 @synthesize hitCount = hitCount_;
+@synthesize mode = mode_;
 
 /*!
  @brief ゲームシーンクラス取得
@@ -211,15 +419,123 @@ static NSString *kAKAplUrl = @"https://itunes.apple.com/us/app/qing-ji/id5696538
     return nil;
 }
 
+/*!
+ @brief ゲームモードを指定したコンビニエンスコンストラクタ
+ 
+ ゲームモードを指定してシーンを生成する。
+ @param mode ゲームモード
+ @return 生成したオブジェクト
+ */
++ (id)sceneWithMode:(enum AKGameMode)mode
+{
+    return [[[self alloc] initWithMode:mode] autorelease];
+}
+
+/*!
+ @brief 再利用するシーンの事前生成
+ 
+ ゲーム開始時にシーンの生成を待たずに遷移できるように、タイトル画面の表示中にシーンを生成して保持する。
+ 既に同じゲームモードのシーンを保持している場合は何もしない。
+ cocos2dのノードとテクスチャはメインスレッドでしか扱えないため、生成はメインスレッドで行う。
+ 生成中に読み込んだテクスチャがゲームプレイシーンの使用テクスチャとして登録されるように
+ テクスチャ管理のシーンを切り替え、生成後に元のシーンに戻す。
+ @param mode ゲームモード
+ */
++ (void)prepareWarmSceneWithMode:(enum AKGameMode)mode
+{
+    // 同じゲームモードのシーンを保持している場合は何もしない
+    if (warmScene_ != nil && warmScene_.mode == mode) {
+        return;
+    }
+    
+    // 実行中のシーンは差し替えない
+    if (warmScene_.isRunning) {
+        return;
+    }
+    
+    AKLog(1, @"ゲームプレイシーン事前生成:mode=%d", mode);
+    
+    NSString *activeScene = [[[AKTextureManager sharedManager].activeScene retain] autorelease];
+    
+    [warmScene_ release];
+    warmScene_ = [[AKGameScene alloc] initWithMode:mode];
+    
+    // テクスチャ管理のシーンを元に戻す
+    if (activeScene != nil) {
+        [[AKTextureManager sharedManager] beginScene:activeScene];
+    }
+    
+    // 生成にかかった時間を出力する
+    AKTraceReport("warm game scene");
+}
+
+/*!
+ @brief 再利用するシーンの取得
+ 
+ 保持しているシーンをリセットして返す。
+ 保持していない場合やゲームモードが異なる場合は生成して保持する。
+ リセットはゲーム状態のみを初期化し、キャラクタープールや背景、ラベルなどは生成し直さない。
+ @param mode ゲームモード
+ @return ゲームプレイシーン
+ */
++ (AKGameScene *)warmSceneWithMode:(enum AKGameMode)mode
+{
+    // 保持していない場合は生成する
+    if (warmScene_ == nil || warmScene_.mode != mode) {
+        [self prepareWarmSceneWithMode:mode];
+        AKTraceMark("game scene create");
+    }
+    // 保持している場合はリセットして再利用する
+    else {
+        [[AKTextureManager sharedManager] beginScene:NSStringFromClass([self class])];
+        [warmScene_ resetAll:kAKStartStage];
+        AKTraceMark("game scene reset");
+    }
+    
+    return warmScene_;
+}
+
+/*!
+ @brief 再利用するシーンの解放
+ 
+ メモリ不足時に保持しているシーンを解放する。
+ 実行中の場合は解放しない。
+ */
++ (void)purgeWarmScene
+{
+    if (warmScene_ == nil || warmScene_.isRunning) {
+        return;
+    }
+    
+    AKLog(1, @"ゲームプレイシーン解放");
+    
+    [warmScene_ release];
+    warmScene_ = nil;
+}
+
 /*!
  @brief オブジェクト生成処理
  
- オブジェクトの生成を行う。
+ 通常モードでオブジェクトの生成を行う。
  @return 生成したオブジェクト。失敗時はnilを返す。
  */
 - (id)init
+{
+    return [self initWithMode:kAKGameModeNormal];
+}
+
+/*!
+ @brief ゲームモードを指定したオブジェクト生成処理
+ 
+ オブジェクトの生成を行う。
+ キャラクタープールのサイズはゲームモードによって決める。
+ @param mode ゲームモード
+ @return 生成したオブジェクト。失敗時はnilを返す。
+ */
+- (id)initWithMode:(enum AKGameMode)mode
 {
     AKLog(0, @"init 開始");
+    AKTraceMark("game scene init");
     
     // スーパークラスの生成処理
     self = [super init];
@@ -227,11 +543,21 @@ static NSString *kAKAplUrl = @"https://itunes.apple.com/us/app/qing-ji/id5696538
         return nil;
     }
     
+    // このシーンで使用するテクスチャを登録する
+    [[AKTextureManager sharedManager] beginScene:NSStringFromClass([self class])];
+    
+    // ゲームモードを設定する
+    mode_ = mode;
+    
+    // キャラクタープールのサイズを取得する
+    const AKPoolCapacity *capacity = &kAKPoolCapacity[mode_];
+    
     // 効果音の読み込みを行う
     [[SimpleAudioEngine sharedEngine] preloadEffect:kAKShotSE];
     [[SimpleAudioEngine sharedEngine] preloadEffect:kAKPauseSE];
     [[SimpleAudioEngine sharedEngine] preloadEffect:kAKHitSE];
     [[SimpleAudioEngine sharedEngine] preloadEffect:kAK1UpSE];
+    AKTraceMark("sound effects");
 
     // キャラクターを配置するレイヤーを生成する
     CCLayer *baseLayer = [CCLayer node];
@@ -272,19 +598,60 @@ static NSString *kAKAplUrl = @"https://itunes.apple.com/us/app/qing-ji/id5696538
     
     // 自機弾プールの生成
     self.playerShotPool = [[[AKCharacterPool alloc] initWithClass:[AKPlayerShot class]
-                                                             Size:kAKMaxPlayerShotCount] autorelease];
+                                                             Size:capacity->playerShot] autorelease];
     
     // 敵プールの生成
     self.enemyPool = [[[AKCharacterPool alloc] initWithClass:[AKEnemy class]
-                                                        Size:kAKMaxEnemyCount] autorelease];
+                                                        Size:capacity->enemy] autorelease];
     
     // 敵弾プールの生成
     self.enemyShotPool = [[[AKCharacterPool alloc] initWithClass:[AKEnemyShot class]
-                                                            Size:kAKEnemyShotCount] autorelease];
+                                                            Size:capacity->enemyShot] autorelease];
 
     // 画面効果プールの生成
     self.effectPool = [[[AKCharacterPool alloc] initWithClass:[AKEffect class]
-                                                         Size:kAKMaxEffectCount] autorelease];
+                                                         Size:capacity->effect] autorelease];
+    
+    // 空きがないときの動作を設定する
+    self.playerShotPool.policy = kAKPoolPolicy.playerShot;
+    self.enemyPool.policy = kAKPoolPolicy.enemy;
+    self.enemyShotPool.policy = kAKPoolPolicy.enemyShot;
+    self.effectPool.policy = kAKPoolPolicy.effect;
+    self.playerShotPool.limit = capacity->playerShot * kAKPoolGrowRate;
+    self.enemyPool.limit = capacity->enemy * kAKPoolGrowRate;
+    self.enemyShotPool.limit = capacity->enemyShot * kAKPoolGrowRate;
+    self.effectPool.limit = capacity->effect * kAKPoolGrowRate;
+    
+    // 対戦モードの場合は対戦相手の機体と自機弾プールを生成する
+    if (mode_ == kAKGameModeVersus) {
+        
+        // 対戦相手の機体は自機と色を変え、表示座標を画面中央に固定しない
+        self.rival = [[[AKPlayer alloc] init] autorelease];
+        self.rival.isFixedOnScreen = NO;
+        ((CCSprite *)self.rival.image).color = kAKRivalColor;
+        [baseLayer addChild:self.rival.image z:kAKCharaPosZPlayer];
+        
+        self.rivalShotPool = [[[AKCharacterPool alloc] initWithClass:[AKPlayerShot class]
+                                                                Size:capacity->playerShot] autorelease];
+        self.rivalShotPool.policy = kAKPoolPolicy.playerShot;
+        self.rivalShotPool.limit = capacity->playerShot * kAKPoolGrowRate;
+        
+        // レーダーには対戦相手の機体を表示する
+        radarTargets_ = [[NSArray alloc] initWithObjects:self.rival, nil];
+        
+        // 巻き戻しのためにティックごとの状態を保存する領域を確保する
+        versusRecords_ = calloc(kAKVersusHistoryCount, sizeof(struct AKVersusSceneRecord));
+        if (versusRecords_ == NULL) {
+            AKLog(1, @"対戦の状態を保存する領域を確保できない");
+            [self release];
+            return nil;
+        }
+    }
+    AKTraceMark("characters");
+    
+    // 弾幕パターンのスクリプトを読み込む
+    [AKBulletPattern sharedPattern];
+    AKTraceMark("bullet pattern");
     
     // レーダーの生成
     self.rader = [AKRadar node];
@@ -298,6 +665,9 @@ static NSString *kAKAplUrl = @"https://itunes.apple.com/us/app/qing-ji/id5696538
     // 残機マークをレイヤーに配置する
     [infoLayer addChild:self.lifeMark];
     
+    // 傾き入力の生成
+    self.tiltInput = [[[AKTiltInput alloc] init] autorelease];
+    
     // スコアラベルのx座標を計算する。スコアラベルは左詰めにするため、x座標は右に幅の半分移動する。
     float scoreLabelPosX = [AKScreenSize positionFromLeftPoint:kAKScorePosLeftPoint] +
         [AKLabel widthWithLength:[[NSString stringWithFormat:kAKScoreFormat, score_] length] hasFrame:NO] / 2;
@@ -311,6 +681,7 @@ static NSString *kAKAplUrl = @"https://itunes.apple.com/us/app/qing-ji/id5696538
     
     // ハイスコアファイルの読み込みを行う
     [self readHiScore];
+    AKTraceMark("hi score");
     
     // ハイスコアラベルのx座標を計算する。
     // ハイスコアラベルは左詰めにし、スコアラベルの右端を原点とする。
@@ -365,11 +736,26 @@ static NSString *kAKAplUrl = @"https://itunes.apple.com/us/app/qing-ji/id5696538
                           tag:kAKInfoTagTime
                         frame:kAKLabelFrameNone];
 
+#if AK_PROFILE
+    // 処理時間計測が有効な場合は計測結果のラベルを生成する
+    if (AKProfileEnabled) {
+        
+        AKLabel *profileLabel = [AKLabel labelWithString:[AKFrameProfiler summaryString]
+                                               maxLength:kAKProfileLabelLength
+                                                 maxLine:kAKProfilePhaseCount + kAKProfileCounterCount + 1
+                                                   frame:kAKLabelFrameNone];
+        profileLabel.tag = kAKInfoTagProfile;
+        profileLabel.position = [AKScreenSize center];
+        [infoLayer addChild:profileLabel];
+    }
+#endif
+    
+    AKTraceMark("labels");
+    
     // 状態を初期化する
+    // 更新処理はシーンを再利用するため、シーン開始時に開始する。
     [self resetAll:kAKStartStage];
-        
-    // 更新処理開始
-    [self scheduleUpdate];
+    AKTraceMark("reset");
     
     return self;
 }
@@ -386,12 +772,21 @@ static NSString *kAKAplUrl = @"https://itunes.apple.com/us/app/qing-ji/id5696538
     // 更新処理停止
     [self unscheduleUpdate];
     
+    // 実行中の弾幕パターンを破棄する
+    [[AKBulletPattern sharedPattern] clear];
+    
     // リソースの解放
     self.playerShotPool = nil;
     self.enemyPool = nil;
     self.enemyShotPool = nil;
     self.effectPool = nil;
     self.background = nil;
+    self.tiltInput = nil;
+    self.rival = nil;
+    self.rivalShotPool = nil;
+    self.versusSession = nil;
+    [radarTargets_ release];
+    free(versusRecords_);
     
     // スーパークラスの処理を実行する
     [super dealloc];
@@ -415,6 +810,7 @@ static NSString *kAKAplUrl = @"https://itunes.apple.com/us/app/qing-ji/id5696538
  
  ゲームシーンの状態を設定する。
  同時にインターフェースレイヤーの有効タグも変更する。
+ ステージ開始からステージクリアまでの間は広告の読み込みと表示位置の変更を止める。
  @param state ゲーム状態
  */
 - (void)setState:(enum AKGameState)state
@@ -422,9 +818,21 @@ static NSString *kAKAplUrl = @"https://itunes.apple.com/us/app/qing-ji/id5696538
     // メンバ変数に設定する
     state_ = state;
     
+    // 状態が変わった場合は直ちに通常のフレームレートに戻す
+    [[AKFramePacer sharedPacer] wake];
+    
+    // ゲームプレイ中は広告の処理を止め、リザルト画面やポーズ中などに行う
+    [[AKAdController sharedController] setSuspended:(state == kAKGameStateStart ||
+                                                     state == kAKGameStatePlaying ||
+                                                     state == kAKGameStateStageClear ||
+                                                     state == kAKGameStateSleep)];
+    
     // 自動ツイート設定の場合、ゲームオーバー時・ゲームクリア時は結果をツイートする
-    if ([AKTwitterHelper sharedHelper].mode == kAKTwitterModeAuto &&
-        ((self.state == kAKGameStateGameOver) || (self.state == kAKGameStateGameClear))) {
+    // 起動時の復元でTwitter管理クラスが最初のフレームより前に生成されないように、状態を先に判定する
+    // 対戦モードはスコアがないためツイートしない
+    if (((self.state == kAKGameStateGameOver) || (self.state == kAKGameStateGameClear)) &&
+        mode_ != kAKGameModeVersus &&
+        [AKTwitterHelper sharedHelper].mode == kAKTwitterModeAuto) {
         
         NSString *tweet = [NSString stringWithFormat:@"%@ %@", [self makeTweet], kAKAplUrl];
         [[AKTwitterHelper sharedHelper] tweet:tweet];
@@ -469,6 +877,22 @@ static NSString *kAKAplUrl = @"https://itunes.apple.com/us/app/qing-ji/id5696538
     }
 }
 
+/*!
+ @brief 記録時のシーン名
+ 
+ 描画コマンドの記録で使用するシーン名を返す。
+ リザルト画面はゲームプレイと描画内容が大きく異なるため、別のシーンとして集計する。
+ @return シーン名
+ */
+- (NSString *)renderSceneName
+{
+    if (state_ == kAKGameStateResult) {
+        return @"AKResultLayer";
+    }
+    
+    return @"AKGameScene";
+}
+
 /*!
  @brief リザルト画面取得
  
@@ -502,17 +926,72 @@ static NSString *kAKAplUrl = @"https://itunes.apple.com/us/app/qing-ji/id5696538
  */
 - (void)onEnterTransitionDidFinish
 {
-    // ゲーム状態を開始時に変更する。
-    self.state = kAKGameStateStart;
+    AKTraceMark("game scene enter");
+    
+    // スナップショットから復元した場合はスクリプトを読み込まずに一時停止状態で再開する
+    if (isRestored_) {
+        
+        isRestored_ = NO;
+        
+        // シーン生成から表示までの時間を出力する
+        AKTraceReport("game scene");
+        
+        // BGMを再生し、プレイ中の状態から効果音なしで一時停止する
+        [self startBGM];
+        self.state = kAKGameStatePlaying;
+        [self pause:NO];
+    }
+    else {
+        
+        // ゲーム状態を開始時に変更する。
+        self.state = kAKGameStateStart;
+    }
     
     // スーパークラスの処理を実行する
     [super onEnterTransitionDidFinish];
 }
 
+/*!
+ @brief シーン開始時の処理
+ 
+ シーンが配置されたときの処理。
+ シーンは再利用され、取り除かれるたびに更新処理が解除されるため、ここで更新処理を開始する。
+ */
+- (void)onEnter
+{
+    // スーパークラスの処理を実行する
+    [super onEnter];
+    
+    // 更新処理開始
+    [self scheduleUpdate];
+}
+
+/*!
+ @brief シーン終了時の処理
+ 
+ シーンが取り除かれるときの処理。
+ 更新処理を停止し、ゲームプレイ中に止めていた広告の処理を再開する。
+ 対戦モードの場合は相手との通信を終了する。
+ */
+- (void)onExit
+{
+    // 更新処理停止
+    [self unscheduleUpdate];
+    
+    // 対戦通信を終了する
+    self.versusSession = nil;
+    
+    [[AKAdController sharedController] setSuspended:NO];
+    
+    // スーパークラスの処理を実行する
+    [super onExit];
+}
+
 /*!
  @brief 更新処理
 
  ゲームの状態によって、更新処理を行う。
+ 対戦モードではプレイ中以外も相手の入力の受信と自分の入力の再送を続け、相手が待ったままにならないようにする。
  @param dt フレーム更新間隔 
  */
 - (void)update:(ccTime)dt
@@ -524,7 +1003,13 @@ static NSString *kAKAplUrl = @"https://itunes.apple.com/us/app/qing-ji/id5696538
             break;
             
         case kAKGameStatePlaying:   // プレイ中
-            [self updatePlaying:dt];
+            // 対戦モードの場合はティック単位で計算する
+            if (mode_ == kAKGameModeVersus) {
+                [self updateVersus:dt];
+            }
+            else {
+                [self updatePlaying:dt];
+            }
             break;
             
         case kAKGameStateStageClear:     // クリア表示中
@@ -545,12 +1030,20 @@ static NSString *kAKAplUrl = @"https://itunes.apple.com/us/app/qing-ji/id5696538
             // その他の状態のときは変化はないため、無処理とする
             break;
     }
+    
+    // 対戦モードのプレイ中以外の場合は入力の送受信のみ行う
+    if (mode_ == kAKGameModeVersus && self.state != kAKGameStatePlaying) {
+        CFAbsoluteTime now = CFAbsoluteTimeGetCurrent();
+        [self.versusSession synchronize:self atTime:now];
+        [self.versusSession sendInputsAtTime:now];
+    }
 }
 
 /*!
  @brief ゲーム開始時の更新処理
 
  ステージ定義ファイルを読み込み、敵を配置する。
+ 対戦モードの場合は敵を配置せずに相手との通信を開始する。
  @param dt フレーム更新間隔
  */
 - (void)updateStart:(ccTime)dt
@@ -558,8 +1051,30 @@ static NSString *kAKAplUrl = @"https://itunes.apple.com/us/app/qing-ji/id5696538
     // BGMを再生する
     [self startBGM];
 
+    // 対戦モードの場合は相手との通信を開始する
+    if (mode_ == kAKGameModeVersus) {
+        
+        // 開始できない場合は対戦を終了する
+        if (![self startVersus]) {
+            [self finishVersus:kAKVersusErrorString];
+            return;
+        }
+    }
     // ステージ構成スクリプトを読み込む
-    [self readScriptOfStage:stageNo_ Wave:waveNo_];
+    else {
+        [self readScriptOfStage:stageNo_ Wave:waveNo_];
+    }
+    
+    // ゲーム開始の操作から最初のフレームまでの時間を出力する
+    AKTraceMark("first frame");
+    AKTraceReport("game scene");
+    
+#if AK_TRACE
+    // トレースが有効な場合はステージ全体を記録する
+    if (AKTraceEnabled) {
+        AKTraceBeginCapture();
+    }
+#endif
     
     // 状態をプレイ中へと進める
     self.state = kAKGameStatePlaying;
@@ -580,6 +1095,18 @@ static NSString *kAKAplUrl = @"https://itunes.apple.com/us/app/qing-ji/id5696538
     AKCharacter *character = nil;       // キャラクター操作作業用バッファ
     BOOL isClear = NO;      // 敵、敵弾がすべていなくなっているか
     CCNode *baseLayer = nil;   // ベースレイヤー
+    AKRenderBuffer *renderBuffer = [AKRenderBuffer sharedBuffer];  // 描画状態バッファ
+    NSInteger renderCount = 0;  // 反映した描画状態の数
+    
+    // 処理時間の計測を開始する
+    AKProfileStart();
+    AKTraceBegin("updatePlaying");
+    
+    // キャラクターの処理数をクリアする
+    [AKCharacter resetNodeCount];
+    
+    // 傾き入力を反映する
+    [self applyTiltInput];
     
     // 自機が破壊されている場合は復活までの時間をカウントする
     if (!self.player.isStaged) {
@@ -596,21 +1123,20 @@ static NSString *kAKAplUrl = @"https://itunes.apple.com/us/app/qing-ji/id5696538
     
     // 自機の移動
     // 自機にスクリーン座標は無関係なため、0をダミーで格納する。
+    AKTraceBegin("player");
     [self.player move:dt ScreenX:0 ScreenY:0];
+    AKTraceEnd("player");
     AKLog(0, @"m_player.abspos=(%f, %f)", self.player.absx, self.player.absy);
         
     // 移動後のスクリーン座標の取得
     scrx = [self.player getScreenPosX];
     scry = [self.player getScreenPosY];
     AKLog(0, @"x=%f y=%f", scrx, scry);
+    AKProfileLap(kAKProfilePhasePlayer);
     
     // 自機弾の移動
-    enumerator = [self.playerShotPool.pool objectEnumerator];
-    for (character in enumerator) {
-        [character move:dt ScreenX:scrx ScreenY:scry];
-        AKLog(0 && character.isStaged, @"playerShot.abxpos=(%f, %f)",
-               character.absx, character.absy);
-    }
+    [self.playerShotPool moveAll:dt ScreenX:scrx ScreenY:scry];
+    AKProfileLap(kAKProfilePhasePlayerShot);
     
     // ウェーブをクリアしたかどうかを判定するため、
     // 敵または敵弾がひとつでも存在するかどうかを調べる。
@@ -618,25 +1144,26 @@ static NSString *kAKAplUrl = @"https://itunes.apple.com/us/app/qing-ji/id5696538
     isClear = YES;
     
     // 敵の移動
-    enumerator = [self.enemyPool.pool objectEnumerator];
-    for (character in enumerator) {
-        if (character.isStaged) {
-            AKLog(0, @"enemy move start.");
-            [character move:dt ScreenX:scrx ScreenY:scry];
-            isClear = NO;
-        }
+    if ([self.enemyPool moveAll:dt ScreenX:scrx ScreenY:scry]) {
+        isClear = NO;
     }
+    AKProfileLap(kAKProfilePhaseEnemy);
     
     // 敵弾の移動
-    enumerator = [self.enemyShotPool.pool objectEnumerator];
-    for (character in enumerator) {
-        if (character.isStaged) {
-            [character move:dt ScreenX:scrx ScreenY:scry];
-            isClear = NO;
-        }
+    if ([self.enemyShotPool moveAll:dt ScreenX:scrx ScreenY:scry]) {
+        isClear = NO;
     }
+    AKProfileLap(kAKProfilePhaseEnemyShot);
+    
+    // 弾幕パターンを実行する
+    AKTraceBegin("pattern");
+    [[AKBulletPattern sharedPattern] update:dt];
+    AKTraceCount("patterns", [AKBulletPattern sharedPattern].threadCount);
+    AKTraceEnd("pattern");
+    AKProfileLap(kAKProfilePhasePattern);
     
     // 自機弾と敵の当たり判定処理を行う
+    AKTraceBegin("collision");
     enumerator = [self.playerShotPool.pool objectEnumerator];
     for (character in enumerator) {
         [character hit:[self.enemyPool.pool objectEnumerator]];
@@ -651,21 +1178,47 @@ static NSString *kAKAplUrl = @"https://itunes.apple.com/us/app/qing-ji/id5696538
         // 自機と敵弾の当たり判定処理を行う
         [self.player hit:[self.enemyShotPool.pool objectEnumerator]];
     }
+    AKTraceEnd("collision");
+    AKProfileLap(kAKProfilePhaseCollision);
+    
+    // 移動処理と当たり判定処理で発生したイベントを処理する
+    AKTraceBegin("events");
+    [self processEvents];
+    AKTraceEnd("events");
+    AKProfileLap(kAKProfilePhaseEvent);
     
     // 画面効果の移動
+    AKTraceBegin("effect");
     enumerator = [self.effectPool.pool objectEnumerator];
     for (character in enumerator) {
         [character move:dt ScreenX:scrx ScreenY:scry];
         AKLog(0 && character.isStaged, @"effect=(%f, %f) player=(%f, %f)",
-               character.image.position.x, character.image.position.y,
-               self.player.image.position.x, self.player.image.position.y);
+               character.screenPos.x, character.screenPos.y,
+               self.player.screenPos.x, self.player.screenPos.y);
     }
+    [self.effectPool updateUsage];
+    AKTraceEnd("effect");
+    AKProfileLap(kAKProfilePhaseEffect);
+    
+    // 移動処理で追加した描画状態を公開し、ノードに反映する
+    AKTraceBegin("renderSync");
+    [renderBuffer publish];
+    renderCount = [renderBuffer apply];
+    AKTraceCount("rendered", renderCount);
+    AKTraceEnd("renderSync");
+    AKProfileLap(kAKProfilePhaseRenderSync);
     
     // 背景の移動
+    AKTraceBegin("background");
     [self.background moveWithScreenX:scrx ScreenY:scry];
+    AKTraceEnd("background");
+    AKProfileLap(kAKProfilePhaseBackground);
     
     // レーダーの更新
+    AKTraceBegin("radar");
     [self.rader updateMarker:self.enemyPool.pool ScreenAngle:self.player.angle];
+    AKTraceEnd("radar");
+    AKProfileLap(kAKProfilePhaseRadar);
     
     // 自機の向きの取得
     // 自機の向きと反対方向に画面を回転させるため、符号反転
@@ -678,6 +1231,7 @@ static NSString *kAKAplUrl = @"https://itunes.apple.com/us/app/qing-ji/id5696538
     
     // 命中率の表示を更新する
     [self updateHit];
+    AKProfileLap(kAKProfilePhaseHUD);
     
     // プレイ時間のカウントとクリア判定はプレイ中のみ行う
     if (state_ == kAKGameStatePlaying) {
@@ -685,6 +1239,16 @@ static NSString *kAKAplUrl = @"https://itunes.apple.com/us/app/qing-ji/id5696538
         // プレイ時間を更新する
         playTime_ += dt;
         [self updateTime];
+        AKProfileLap(kAKProfilePhaseHUD);
+        
+#if AK_TRACE
+        // リングバッファが一周しないように一定のプレイ時間ごとにトレースを書き出す
+        // (ファイルへの追記はバックグラウンドのキューで行われるため、フレーム処理は待たない)
+        if (AKTraceEnabled &&
+            (int)(playTime_ / kAKTraceFlushInterval) != (int)((playTime_ - dt) / kAKTraceFlushInterval)) {
+            AKTraceFlush();
+        }
+#endif
         
         // 敵と敵弾がひとつも存在しない場合は次のウェーブ開始までの時間をカウントする
         if (isClear) {
@@ -702,6 +1266,50 @@ static NSString *kAKAplUrl = @"https://itunes.apple.com/us/app/qing-ji/id5696538
             }
         }
     }
+    
+    // キャラクターの処理数を記録する
+    AKProfileCount(kAKProfileCounterVisited, [AKCharacter visitedNodeCount]);
+    AKProfileCount(kAKProfileCounterDrawn, [AKCharacter drawnNodeCount]);
+    AKTraceCount("visited", [AKCharacter visitedNodeCount]);
+    AKTraceCount("drawn", [AKCharacter drawnNodeCount]);
+    AKTraceEnd("updatePlaying");
+    
+    // 処理時間の計測を終了する
+    AKProfileFinish();
+    
+#if AK_PROFILE
+    // 処理時間の計測結果の表示を更新する
+    [self updateProfile];
+#endif
+}
+
+/*!
+ @brief 処理時間計測結果の表示更新
+ 
+ 一定フレームごとに処理時間の計測結果のラベルを更新する。
+ */
+- (void)updateProfile
+{
+#if AK_PROFILE
+    static NSInteger frameCount = 0;
+    
+    // 計測が無効な場合は処理しない
+    if (!AKProfileEnabled) {
+        return;
+    }
+    
+    // 一定フレームごとに更新する
+    frameCount++;
+    if (frameCount < kAKProfileUpdateInterval) {
+        return;
+    }
+    frameCount = 0;
+    
+    // ラベルを更新する
+    CCNode *infoLayer = [self getChildByTag:kAKLayerPosZInfo];
+    AKLabel *profileLabel = (AKLabel *)[infoLayer getChildByTag:kAKInfoTagProfile];
+    [profileLabel setString:[AKFrameProfiler summaryString]];
+#endif
 }
 
 /*!
@@ -731,21 +1339,510 @@ static NSString *kAKAplUrl = @"https://itunes.apple.com/us/app/qing-ji/id5696538
 }
 
 /*!
- @brief スリープ中の更新処理
+ @brief スリープ中の更新処理
+ 
+ スリープ中の更新処理を行う。
+ スリープ時間経過したら次の状態に遷移する。
+ @param dt フレーム更新間隔
+ */
+- (void)updateSleep:(ccTime)dt
+{
+    // スリープ時間をカウントする
+    sleepTime_ -= dt;
+    
+    // スリープ時間が経過している場合は次の状態に遷移する
+    if (sleepTime_ < 0.0f) {
+        self.state = nextState_;
+    }
+}
+
+/*!
+ @brief 対戦中の更新処理
+ 
+ 傾き入力とショットボタンを自分の入力として対戦通信に渡し、経過時間分のティックを計算する。
+ 相手の入力が届いていないティックは対戦通信が予測して進め、予測が外れた場合は巻き戻して再計算する。
+ ティックを計算するたびに発生したイベントを処理し、巻き戻し後の再計算で同じ効果音や画面効果が繰り返されないようにする。
+ その後、画面効果や背景、レーダーなどティックの計算に含まれない表示を更新する。
+ @param dt フレーム更新間隔
+ */
+- (void)updateVersus:(ccTime)dt
+{
+    float vx = 0.0f;            // x方向の比率
+    float vy = 0.0f;            // y方向の比率
+    NSInteger tickCount = 0;    // 計算したティックの数
+    CFAbsoluteTime now = CFAbsoluteTimeGetCurrent();
+    
+    AKTraceBegin("updateVersus");
+    
+    // キャラクターの処理数をクリアする
+    [AKCharacter resetNodeCount];
+    
+    // 傾き入力がある場合は自分の入力に反映する。どちらの端末でも同じ値になるように1/1000単位の整数にする。
+    if ([self.tiltInput sampleAtTime:CACurrentMediaTime() x:&vx y:&vy]) {
+        versusInput_.tiltX = (int16_t)lroundf(AKRangeCheckF(vx, -1.0f, 1.0f) * 1000.0f);
+        versusInput_.tiltY = (int16_t)lroundf(AKRangeCheckF(vy, -1.0f, 1.0f) * 1000.0f);
+    }
+    
+    // 経過時間分のティックを計算する
+    versusTime_ += dt;
+    while (versusTime_ >= kAKVersusTickTime && tickCount < kAKVersusMaxTicksPerFrame) {
+        
+        versusInput_.buttons = (isShotRequested_ ? kAKVersusButtonShot : 0);
+        
+        // 相手の入力を待つ必要がある場合は次のフレームで計算する
+        if (![self.versusSession advance:self localInput:versusInput_ atTime:now]) {
+            break;
+        }
+        
+        isShotRequested_ = NO;
+        versusTime_ -= kAKVersusTickTime;
+        tickCount++;
+        
+        // 計算で発生したイベントを処理する
+        [self processEvents];
+        versusPresentedTick_ = self.versusSession.currentTick;
+    }
+    
+    // ティックを計算しなかった場合も相手の入力を受信する
+    if (tickCount == 0) {
+        [self.versusSession synchronize:self atTime:now];
+    }
+    
+    // 相手の入力を待っている間や処理が遅れている間に経過時間がたまらないようにする
+    versusTime_ = MIN(versusTime_, kAKVersusTickTime);
+    AKTraceCount("ticks", tickCount);
+    
+    // スクリーン座標の取得
+    float scrx = [self.player getScreenPosX];
+    float scry = [self.player getScreenPosY];
+    
+    // 画面効果の移動
+    for (AKCharacter *character in [self.effectPool.pool objectEnumerator]) {
+        [character move:dt ScreenX:scrx ScreenY:scry];
+    }
+    [self.effectPool updateUsage];
+    
+    // 移動処理で追加した描画状態を公開し、ノードに反映する
+    [[AKRenderBuffer sharedBuffer] publish];
+    [[AKRenderBuffer sharedBuffer] apply];
+    
+    // 背景の移動
+    [self.background moveWithScreenX:scrx ScreenY:scry];
+    
+    // レーダーの更新
+    [self.rader updateMarker:radarTargets_ ScreenAngle:self.player.angle];
+    
+    // 自機の向きと反対方向に画面を回転させる
+    [self getChildByTag:kAKLayerPosZBase].rotation = -1 * AKCnvAngleRad2Scr(self.player.angle);
+    
+    // 自分の残機の表示を更新する
+    NSInteger life = versusLife_[self.versusSession.playerIndex];
+    if (life_ != life) {
+        life_ = life;
+        [self.lifeMark updateImage:life_];
+    }
+    
+    // 命中率とプレイ時間を更新する
+    [self updateHit];
+    playTime_ += dt;
+    [self updateTime];
+    
+    AKTraceEnd("updateVersus");
+    
+    // 決着を判定する
+    [self checkVersusResult];
+}
+
+/*!
+ @brief 対戦の開始
+ 
+ 設定に従って対戦通信を生成し、2機を初期位置に配置する。
+ 初期位置はどちらの端末でも同じになるように、ステージサイズと画面サイズのみから求める。
+ ステージサイズは画面サイズから決まるため、画面サイズが同じ端末同士でのみ状態が一致する。
+ @return 開始できた場合YES
+ */
+- (BOOL)startVersus
+{
+    // 対戦通信を生成する
+    self.versusSession = [AKVersusSession sessionWithUserDefaults];
+    if (self.versusSession == nil) {
+        AKLog(1, @"対戦通信を開始できない");
+        return NO;
+    }
+    
+    // 2機をステージ中央に画面の幅だけ離して配置する
+    for (NSInteger i = 0; i < kAKVersusPlayerCount; i++) {
+        AKPlayer *ship = [self versusShip:i];
+        
+        [ship reset];
+        ship.absx = [AKScreenSize stageSize].width / 2 +
+            (2 * i - 1) * [AKScreenSize screenSize].width * kAKVersusStartDistanceRatio / 2;
+        ship.absy = [AKScreenSize stageSize].height / 2;
+        [ship setVelocityX:0.0f Y:0.0f];
+        
+        versusLife_[i] = kAKStartLifeCount;
+        versusRebirthTicks_[i] = 0;
+    }
+    
+    // 対戦の状態を初期化する
+    versusLoserMask_ = 0;
+    versusEndTick_ = 0;
+    versusTick_ = 0;
+    versusPresentedTick_ = 0;
+    versusTime_ = 0.0f;
+    memset(&versusInput_, 0, sizeof(versusInput_));
+    isShotRequested_ = NO;
+    
+    AKLog(1, @"対戦開始:player=%d", self.versusSession.playerIndex);
+    
+    return YES;
+}
+
+/*!
+ @brief 対戦の終了
+ 
+ 対戦結果を表示し、ゲームオーバーと同様に一定時間後にタイトルへ戻れる状態にする。
+ @param result 対戦結果の表示文字列
+ */
+- (void)finishVersus:(NSString *)result
+{
+    AKLog(1, @"対戦終了:%@ rollback=%d maxTicks=%d maxTime=%.2fms stall=%d",
+          result,
+          self.versusSession.rollbackCount,
+          self.versusSession.maxRollbackTicks,
+          self.versusSession.maxRollbackTime * 1000.0,
+          self.versusSession.stallCount);
+    
+    // BGMを停止する
+    [[SimpleAudioEngine sharedEngine] stopBackgroundMusic];
+    
+    // 対戦結果を表示する
+    [self setLabelToInfoLayer:result
+                        atPos:ccp([AKScreenSize center].x,
+                                  [AKScreenSize positionFromBottomRatio:kAKVersusResultPosBottomRatio])
+                          tag:kAKInfoTagVersusResult
+                        frame:kAKLabelFrameMessage];
+    
+    // 一定時間後にゲームオーバーの状態に遷移する
+    sleepTime_ = kAKGameOverInterval;
+    nextState_ = kAKGameStateGameOver;
+    self.state = kAKGameStateSleep;
+}
+
+/*!
+ @brief 対戦の決着の判定
+ 
+ 状態が一致しなくなった場合は対戦を中断する。
+ 決着がついたティックまでの相手の入力が確定した場合は、予測で決着した結果が巻き戻されることはないため、結果を表示する。
+ */
+- (void)checkVersusResult
+{
+    NSInteger localMask = 1 << self.versusSession.playerIndex;
+    
+    // 状態が一致しなくなった場合は対戦を中断する
+    if (self.versusSession.isDesynced) {
+        [self finishVersus:kAKVersusDesyncString];
+    }
+    // 決着がついたティックまでの相手の入力が確定した場合は結果を表示する
+    else if (versusLoserMask_ != 0 && self.versusSession.remoteTick > versusEndTick_) {
+        
+        if (versusLoserMask_ == (1 << kAKVersusPlayerCount) - 1) {
+            [self finishVersus:kAKVersusDrawString];
+        }
+        else if (versusLoserMask_ & localMask) {
+            [self finishVersus:kAKVersusLoseString];
+        }
+        else {
+            [self finishVersus:kAKVersusWinString];
+        }
+    }
+}
+
+/*!
+ @brief 対戦のプレイヤー番号に対応する機体の取得
+ 
+ 自分のプレイヤー番号の場合は自機、それ以外の場合は対戦相手の機体を返す。
+ @param index プレイヤー番号
+ @return 機体
+ */
+- (AKPlayer *)versusShip:(NSInteger)index
+{
+    return (index == self.versusSession.playerIndex ? self.player : self.rival);
+}
+
+/*!
+ @brief 対戦のプレイヤー番号に対応する自機弾プールの取得
+ 
+ 自分のプレイヤー番号の場合は自機弾プール、それ以外の場合は対戦相手の自機弾プールを返す。
+ @param index プレイヤー番号
+ @return 自機弾プール
+ */
+- (AKCharacterPool *)versusShotPool:(NSInteger)index
+{
+    return (index == self.versusSession.playerIndex ? self.playerShotPool : self.rivalShotPool);
+}
+
+/*!
+ @brief 対戦の自機弾の配置
+ 
+ プレイヤー番号に対応する自機弾プールから自機弾を取り出して配置する。
+ 対戦相手の自機弾は対戦相手の機体と同じ色にする。
+ @param index プレイヤー番号
+ @param x 絶対座標x
+ @param y 絶対座標y
+ @param angle 向き
+ @return 配置した自機弾。プールに空きがない場合はnil。
+ */
+- (AKPlayerShot *)entryVersusShot:(NSInteger)index X:(float)x Y:(float)y Angle:(float)angle
+{
+    AKCharacterPool *pool = [self versusShotPool:index];
+    
+    // プールから未使用のメモリを取得する
+    AKPlayerShot *shot = [pool getNext];
+    if (shot == nil) {
+        // 空きがない場合は発射しない
+        AKLog(0, @"対戦の自機弾プールに空きなし");
+        return nil;
+    }
+    
+    // 初回の移動更新処理が終わるまでは表示されないように画面外に移動する
+    shot.image.position = ccp([AKScreenSize screenSize].width * 2,
+                              [AKScreenSize screenSize].height * 2);
+    shot.screenPos = shot.image.position;
+    
+    // 対戦相手の自機弾は色を変える
+    if (pool == self.rivalShotPool) {
+        ((CCSprite *)shot.image).color = kAKRivalColor;
+    }
+    
+    // 自機弾を生成する
+    [shot createWithX:x Y:y Z:kAKCharaPosZPlayerShot
+                Angle:angle Parent:[self getChildByTag:kAKLayerPosZBase]];
+    
+    return shot;
+}
+
+/*!
+ @brief 対戦の機体の移動
+ 
+ 機体を移動し、移動中に破壊された場合は残機を減らして復活までのティック数を設定する。
+ 残機がない場合は負けとし、同じティックで両方の機体の残機がなくなった場合は引き分けとする。
+ @param index プレイヤー番号
+ @param scrx スクリーン座標x
+ @param scry スクリーン座標y
+ */
+- (void)moveVersusShip:(NSInteger)index ScreenX:(NSInteger)scrx ScreenY:(NSInteger)scry
+{
+    AKPlayer *ship = [self versusShip:index];
+    BOOL isStaged = ship.isStaged;
+    
+    [ship move:kAKVersusTickTime ScreenX:scrx ScreenY:scry];
+    
+    // 破壊されていない場合は処理を終了する
+    if (!isStaged || ship.isStaged) {
+        return;
+    }
+    
+    // 残機がある場合は残機を減らして復活を待つ
+    if (versusLife_[index] > 0) {
+        versusLife_[index]--;
+        versusRebirthTicks_[index] = kAKVersusRebirthTicks;
+    }
+    // 残機がない場合は負けとする。決着がついたティックと同じティックの場合は引き分けとする。
+    else if (versusLoserMask_ == 0 || versusEndTick_ == versusTick_) {
+        versusEndTick_ = versusTick_;
+        versusLoserMask_ |= 1 << index;
+    }
+}
+
+/*!
+ @brief 対戦の機体の当たり判定
+ 
+ 機体と相手の自機弾の当たり判定を行い、当たった場合は両方のHPを減らす。
+ 破壊処理は次のティックの移動処理で行う。
+ @param index プレイヤー番号
+ */
+- (void)hitVersusShip:(NSInteger)index
+{
+    AKPlayer *ship = [self versusShip:index];
+    CGSize stageSize = [AKScreenSize stageSize];
+    
+    // 破壊されている場合、無敵状態の場合は判定しない
+    if (!ship.isStaged || ship.isInvincible) {
+        return;
+    }
+    
+    for (AKCharacter *shot in [[self versusShotPool:1 - index].pool objectEnumerator]) {
+        
+        if (shot.isStaged && shot.hitPoint > 0 && AKVersusIsHit(ship, shot, stageSize)) {
+            ship.hitPoint--;
+            shot.hitPoint--;
+        }
+    }
+}
+
+/*!
+ @brief 対戦の状態の書き出し
+ 
+ 巻き戻しと状態の比較に使う状態を固定長の構造体に書き出す。
+ @param record 書き込み先
+ */
+- (void)saveVersusRecord:(struct AKVersusSceneRecord *)record
+{
+    // パディングや未使用の自機弾が不定値にならないように0クリアする
+    memset(record, 0, sizeof(*record));
+    
+    record->loserMask = (int32_t)versusLoserMask_;
+    record->endTick = versusEndTick_;
+    
+    for (NSInteger i = 0; i < kAKVersusPlayerCount; i++) {
+        record->life[i] = (int32_t)versusLife_[i];
+        record->rebirthTicks[i] = (int32_t)versusRebirthTicks_[i];
+        [[self versusShip:i] saveRecord:&record->ships[i]];
+        
+        NSAssert(AKSaveCharacterRecords([self versusShotPool:i], NULL) <= kAKVersusShotCount,
+                 @"対戦の自機弾の数が上限を超過");
+        record->shotCount[i] = (int32_t)AKSaveCharacterRecords([self versusShotPool:i], record->shots[i]);
+    }
+}
+
+/*!
+ @brief 対戦の状態の反映
+ 
+ 書き出した状態を反映する。自機弾はプールを初期化してから配置し直す。
+ @param record 読み込み元
+ */
+- (void)loadVersusRecord:(const struct AKVersusSceneRecord *)record
+{
+    versusLoserMask_ = record->loserMask;
+    versusEndTick_ = record->endTick;
+    
+    for (NSInteger i = 0; i < kAKVersusPlayerCount; i++) {
+        versusLife_[i] = record->life[i];
+        versusRebirthTicks_[i] = record->rebirthTicks[i];
+        [[self versusShip:i] loadRecord:&record->ships[i]];
+        
+        [[self versusShotPool:i] reset];
+        for (NSInteger j = 0; j < record->shotCount[i]; j++) {
+            const struct AKCharacterRecord *shotRecord = &record->shots[i][j];
+            
+            AKPlayerShot *shot = [self entryVersusShot:i X:shotRecord->absx Y:shotRecord->absy
+                                                 Angle:shotRecord->angle];
+            [shot loadRecord:shotRecord];
+        }
+    }
+}
+
+/*!
+ @brief 状態の保存
+ 
+ 計算前の状態をティックごとの保存領域に書き出す。
+ @param tick 計算するティック
+ */
+- (void)saveStateForTick:(uint32_t)tick
+{
+    versusTick_ = tick;
+    [self saveVersusRecord:&versusRecords_[tick % kAKVersusHistoryCount]];
+}
+
+/*!
+ @brief 状態の復元
+ 
+ 保存した状態に巻き戻す。
+ 巻き戻した後の状態と食い違うため、まだ反映していない描画状態は破棄する。
+ @param tick 巻き戻すティック
+ */
+- (void)loadStateForTick:(uint32_t)tick
+{
+    versusTick_ = tick;
+    [[AKRenderBuffer sharedBuffer] clear];
+    [self loadVersusRecord:&versusRecords_[tick % kAKVersusHistoryCount]];
+}
+
+/*!
+ @brief 1ティックの計算
+ 
+ 2人の入力を反映し、機体と自機弾を1ティック分移動して当たり判定を行う。
+ どちらの端末でも同じ結果になるように、計算には絶対座標と入力のみを使用する。
+ 再計算中のティックは効果音や画面効果を再生済みのため、発生したイベントは破棄する。
+ @param inputs プレイヤー番号順の入力
+ */
+- (void)stepWithInputs:(const struct AKVersusInput *)inputs
+{
+    NSInteger localIndex = self.versusSession.playerIndex;
+    AKGameEventBuffer *eventBuffer = [AKGameEventBuffer sharedBuffer];
+    
+    // 入力を反映する
+    for (NSInteger i = 0; i < kAKVersusPlayerCount; i++) {
+        AKPlayer *ship = [self versusShip:i];
+        
+        // 破壊されている場合は復活までのティック数をカウントする
+        if (!ship.isStaged && !(versusLoserMask_ & (1 << i))) {
+            versusRebirthTicks_[i]--;
+            if (versusRebirthTicks_[i] <= 0) {
+                [ship rebirth];
+            }
+        }
+        
+        // 傾きを速度に反映する
+        [ship setVelocityX:inputs[i].tiltX / 1000.0f Y:inputs[i].tiltY / 1000.0f];
+        
+        // ショットボタンが押されている場合は自機弾を発射する
+        if (ship.isStaged && (inputs[i].buttons & kAKVersusButtonShot)) {
+            if ([self entryVersusShot:i X:ship.absx Y:ship.absy Angle:ship.angle] != nil) {
+                [eventBuffer pushSound:kAKShotSE];
+            }
+        }
+    }
+    
+    // 自機を移動し、移動後のスクリーン座標で対戦相手の機体を移動する
+    // 自機にスクリーン座標は無関係なため、0をダミーで格納する。
+    [self moveVersusShip:localIndex ScreenX:0 ScreenY:0];
+    NSInteger scrx = [self.player getScreenPosX];
+    NSInteger scry = [self.player getScreenPosY];
+    [self moveVersusShip:1 - localIndex ScreenX:scrx ScreenY:scry];
+    
+    // 自機弾の移動
+    [self.playerShotPool moveAll:kAKVersusTickTime ScreenX:scrx ScreenY:scry];
+    [self.rivalShotPool moveAll:kAKVersusTickTime ScreenX:scrx ScreenY:scry];
+    
+    // 機体と相手の自機弾の当たり判定
+    for (NSInteger i = 0; i < kAKVersusPlayerCount; i++) {
+        [self hitVersusShip:i];
+    }
+    
+    // 再計算中のティックで発生したイベントは破棄する
+    if (versusTick_ < versusPresentedTick_) {
+        [eventBuffer clear];
+    }
+}
+
+/*!
+ @brief 状態のハッシュ値
  
- スリープ中の更新処理を行う。
- スリープ時間経過したら次の状態に遷移する。
- @param dt フレーム更新間隔
+ 相手の端末と状態を比較するためのハッシュ値を計算する。
+ 自機弾はプールの中の並び順が端末ごとに異なるため、1発ごとのハッシュ値の和を使い、並び順に依存しないようにする。
+ @return ハッシュ値
  */
-- (void)updateSleep:(ccTime)dt
+- (uint32_t)stateHash
 {
-    // スリープ時間をカウントする
-    sleepTime_ -= dt;
+    struct AKVersusSceneRecord current;     // 計算後の状態
     
-    // スリープ時間が経過している場合は次の状態に遷移する
-    if (sleepTime_ < 0.0f) {
-        self.state = nextState_;
+    // 計算後の状態を書き出す。保存領域は計算前の状態のため、一時領域を使う。
+    [self saveVersusRecord:&current];
+    
+    uint32_t hash = AKVersusHash(&current, offsetof(struct AKVersusSceneRecord, shots), kAKVersusHashBasis);
+    
+    for (NSInteger i = 0; i < kAKVersusPlayerCount; i++) {
+        uint32_t sum = 0;
+        
+        for (NSInteger j = 0; j < current.shotCount[i]; j++) {
+            sum += AKVersusHash(&current.shots[i][j], sizeof(current.shots[i][j]), kAKVersusHashBasis);
+        }
+        hash = AKVersusHash(&sum, sizeof(sum), hash);
     }
+    
+    return hash;
 }
 
 /*!
@@ -760,6 +1857,31 @@ static NSString *kAKAplUrl = @"https://itunes.apple.com/us/app/qing-ji/id5696538
     [player_ setVelocityX:vx Y:vy];
 }
 
+/*!
+ @brief 傾き入力の反映
+ 
+ 現在のシミュレーション時刻に合わせて傾き入力を取り出し、自機の速度に反映する。
+ 入力から画面表示までの遅延として、使用した入力の経過時間に表示までの1フレーム分を加えた値を
+ 処理時間計測に記録する。
+ */
+- (void)applyTiltInput
+{
+    float vx = 0.0f;    // x方向の比率
+    float vy = 0.0f;    // y方向の比率
+    
+    // 入力がない場合は前回の速度のままとする
+    if (![self.tiltInput sampleAtTime:CACurrentMediaTime() x:&vx y:&vy]) {
+        return;
+    }
+    
+    // 速度の変更
+    [self movePlayerByVX:vx VY:vy];
+    
+    // 入力から表示までの遅延(ミリ秒)を記録する
+    AKProfileCount(kAKProfileCounterTiltLatency,
+                   (self.tiltInput.lastAge + [[CCDirector sharedDirector] animationInterval]) * 1000.0);
+}
+
 /*!
  @brief 自機弾の発射
 
@@ -770,6 +1892,12 @@ static NSString *kAKAplUrl = @"https://itunes.apple.com/us/app/qing-ji/id5696538
     float angle = 0.0f;     // 発射の方向
     AKPlayerShot *shot = nil; // 自機弾
     
+    // 対戦モードの場合は次のティックの入力として相手に送り、ティックの計算で発射する
+    if (mode_ == kAKGameModeVersus) {
+        isShotRequested_ = YES;
+        return;
+    }
+    
     // 自機が破壊されているときは発射しない
     if (!self.player.isStaged) {
         return;
@@ -778,18 +1906,18 @@ static NSString *kAKAplUrl = @"https://itunes.apple.com/us/app/qing-ji/id5696538
     // プールから未使用のメモリを取得する
     shot = [self.playerShotPool getNext];
     if (shot == nil) {
-        // 空きがない場合は処理終了s
-        AKLog(1, @"自機弾プールに空きなし");
-        assert(0);
+        // 空きがない場合は発射しない
+        AKLog(0, @"自機弾プールに空きなし");
         return;
     }
     
     // 発射する方向は自機の角度に回転速度を加算する
     angle = self.player.angle;
     
-    // 初回の移動更新処理が終わるまでは表示されないように画面外に移動する
+    // 初回の移動更新処理が終わるまでは表示と当たり判定が行われないように画面外に移動する
     shot.image.position = ccp([AKScreenSize screenSize].width * 2,
                               [AKScreenSize screenSize].height * 2);
+    shot.screenPos = shot.image.position;
     
     // 自機弾を生成する
     // 位置と向きは自機と同じとする
@@ -808,8 +1936,9 @@ static NSString *kAKAplUrl = @"https://itunes.apple.com/us/app/qing-ji/id5696538
  @param posx 生成位置x座標
  @param posy 生成位置y座標
  @param angle 敵の向き
+ @return 生成した敵。プールに空きがない場合はnil。
  */
-- (void)entryEnemy:(enum AKEnemyType)type PosX:(NSInteger)posx PosY:(NSInteger)posy Angle:(float)angle
+- (AKEnemy *)entryEnemy:(enum AKEnemyType)type PosX:(NSInteger)posx PosY:(NSInteger)posy Angle:(float)angle
 {
     AKEnemy *enemy = nil;     // 敵
     SEL createEnemy = nil;  // 敵生成のメソッド
@@ -819,10 +1948,9 @@ static NSString *kAKAplUrl = @"https://itunes.apple.com/us/app/qing-ji/id5696538
     // プールから未使用のメモリを取得する
     enemy = [self.enemyPool getNext];
     if (enemy == nil) {
-        // 空きがない場合は処理終了
-        assert(0);
-        AKLog(1, @"敵プールに空きなし");
-        return;
+        // 空きがない場合は生成しない
+        AKLog(0, @"敵プールに空きなし");
+        return nil;
     }
     
     // 敵の種類によって生成するメソッドを変える
@@ -865,9 +1993,15 @@ static NSString *kAKAplUrl = @"https://itunes.apple.com/us/app/qing-ji/id5696538
     [enemy createWithX:posx Y:posy Z:kAKCharaPosZEnemy Angle:angle
                 Parent:[self getChildByTag:kAKLayerPosZBase] CreateSel:createEnemy];    
     
-    // 初回の移動更新処理が終わるまでは表示されないように画面外に移動する
+    // スナップショットに保存するため、敵の種類を記録する
+    enemy.type = type;
+    
+    // 初回の移動更新処理が終わるまでは表示と当たり判定が行われないように画面外に移動する
     enemy.image.position = ccp([AKScreenSize screenSize].width * 2,
                                [AKScreenSize screenSize].height * 2);
+    enemy.screenPos = enemy.image.position;
+    
+    return enemy;
 }
 
 /*!
@@ -878,26 +2012,30 @@ static NSString *kAKAplUrl = @"https://itunes.apple.com/us/app/qing-ji/id5696538
  @param posx 生成位置x座標
  @param posy 生成位置y座標
  @param angle 敵弾の向き
+ @return 生成した敵弾。プールに空きがない場合はnil。
  */
-- (void)fireEnemyShot:(enum ENEMY_SHOT_TYPE)type PosX:(NSInteger)posx PosY:(NSInteger)posy Angle:(float)angle
+- (AKEnemyShot *)fireEnemyShot:(enum ENEMY_SHOT_TYPE)type PosX:(NSInteger)posx PosY:(NSInteger)posy Angle:(float)angle
 {
     AKEnemyShot *enemyShot = nil;   // 敵弾
     
     // プールから未使用のメモリを取得する
     enemyShot = [self.enemyShotPool getNext];
     if (enemyShot == nil) {
-        // 空きがない場合は処理を終了する
-        assert(0);
-        return;
+        // 空きがない場合は発射しない
+        AKLog(0, @"敵弾プールに空きなし");
+        return nil;
     }
     
-    // 初回の移動更新処理が行われるまでは表示されないように画面外に移動する
+    // 初回の移動更新処理が行われるまでは表示と当たり判定が行われないように画面外に移動する
     enemyShot.image.position = ccp([AKScreenSize screenSize].width * 2,
                                    [AKScreenSize screenSize].height * 2);
+    enemyShot.screenPos = enemyShot.image.position;
     
     // 敵弾を生成する
     [enemyShot createWithType:type X:posx Y:posy Z:kAKCharaPosZEnemyShot
                         Angle:angle Parent:[self getChildByTag:kAKLayerPosZBase]];
+    
+    return enemyShot;
 }
 
 /*!
@@ -918,8 +2056,8 @@ static NSString *kAKAplUrl = @"https://itunes.apple.com/us/app/qing-ji/id5696538
     // プールから未使用のメモリを取得する
     AKEffect *effect = [self.effectPool getNext];
     if (effect == nil) {
-        // 空きがない場合は処理終了
-        NSAssert(0, @"画面効果プールに空きがない");
+        // 空きがない場合は表示しない
+        AKLog(0, @"画面効果プールに空きなし");
         return;
     }
     
@@ -935,11 +2073,20 @@ static NSString *kAKAplUrl = @"https://itunes.apple.com/us/app/qing-ji/id5696538
  
  自機が破壊されたときの処理を行う。残機の数を一つ減らして自機を復活させる。
  残機が0の場合はゲームオーバーとする。
+ 対戦モードの場合は両方の機体の残機をティックの計算で管理するため、ここでは何もしない。
  */
 - (void)miss
 {
+    // 対戦モードの場合は無処理
+    if (mode_ == kAKGameModeVersus) {
+        return;
+    }
+    // 負荷試験モードの場合は残機を減らさずに復活する
+    else if (mode_ == kAKGameModeStress) {
+        rebirthInterval_ = kAKRebirthInterval;
+    }
     // 残機が残っている場合は残機を減らして復活する
-    if (life_ > 0) {
+    else if (life_ > 0) {
 
         // ライフを一つ減らす
         life_--;
@@ -959,6 +2106,9 @@ static NSString *kAKAplUrl = @"https://itunes.apple.com/us/app/qing-ji/id5696538
         // BGMを停止する
         [[SimpleAudioEngine sharedEngine] stopBackgroundMusic];
         
+        // キャラクタープールの使用状況を出力する
+        [self reportPoolUsage];
+        
         // ゲームの状態を少し間を空けて、ゲームオーバーに変更する
         sleepTime_ = kAKGameOverInterval;
         nextState_ = kAKGameStateGameOver;
@@ -966,6 +2116,20 @@ static NSString *kAKAplUrl = @"https://itunes.apple.com/us/app/qing-ji/id5696538
     }
 }
 
+/*!
+ @brief キャラクタープールの使用状況出力
+
+ ステージ中に同時に配置されたキャラクター数の最大値と、プールに空きがなかった回数を出力する。
+ 使用状況はステージ開始時のプールのリセット(敵弾は使用状況のクリア)でクリアされる。
+ */
+- (void)reportPoolUsage
+{
+    [self.playerShotPool reportUsage];
+    [self.enemyPool reportUsage];
+    [self.enemyShotPool reportUsage];
+    [self.effectPool reportUsage];
+}
+
 /*!
  @brief ゲーム状態リセット
  
@@ -989,6 +2153,7 @@ static NSString *kAKAplUrl = @"https://itunes.apple.com/us/app/qing-ji/id5696538
     missCount_ = 0;
     playTime_ = 0.0f;
     enemyCount_ = 0;
+    isRestored_ = NO;
     
     // 残機マークの初期個数を反映させる
     [self.lifeMark updateImage:life_];
@@ -1000,18 +2165,33 @@ static NSString *kAKAplUrl = @"https://itunes.apple.com/us/app/qing-ji/id5696538
     NSString *scoreString = [NSString stringWithFormat:kAKScoreFormat, score_];
     AKLabel *scoreLabel = (AKLabel *)[infoLayer getChildByTag:kAKInfoTagScore];
     [scoreLabel setString:scoreString];
+    [self updateHit];
+    [self updateTime];
 
     // 自機の状態を初期化する
     [self.player reset];
+    [self.rival reset];
 
     // 画面上の全キャラクターを削除する
     [self.playerShotPool reset];
+    [self.rivalShotPool reset];
     [self.enemyPool reset];
     [self.enemyShotPool reset];
     [self.effectPool reset];
     
-    // ゲームクリアの表示を削除する
+    // 対戦通信はゲーム開始時に作り直すため終了する
+    self.versusSession = nil;
+    
+    // 処理していないイベントと描画状態、実行中の弾幕パターンを破棄する
+    [[AKGameEventBuffer sharedBuffer] clear];
+    [[AKRenderBuffer sharedBuffer] clear];
+    [[AKBulletPattern sharedPattern] clear];
+    
+    // ゲームクリアとステージクリアの表示、リザルト画面を削除する
     [infoLayer removeChildByTag:kAKInfoTagGameClear cleanup:YES];
+    [infoLayer removeChildByTag:kAKInfoTagStageClear cleanup:YES];
+    [infoLayer removeChildByTag:kAKInfoTagVersusResult cleanup:YES];
+    [self removeChildByTag:kAKLayerPosZResult cleanup:YES];
 }
 
 /*!
@@ -1088,14 +2268,38 @@ static NSString *kAKAplUrl = @"https://itunes.apple.com/us/app/qing-ji/id5696538
     // ゲーム状態を一時停止に変更する
     self.state = kAKGameStatePause;
     
+#if AK_PROFILE
+    // 処理時間計測が有効な場合は一時停止時に計測結果を出力する
+    if (AKProfileEnabled) {
+        [AKFrameProfiler exportCSV];
+    }
+    
+    // 描画コマンドの記録が有効な場合は一時停止時にシーンごとの集計を出力する
+    if (AKRenderRecorderEnabled) {
+        [AKRenderRecorder exportCSV];
+    }
+#endif
+    
+#if AK_TRACE
+    // トレースが有効な場合は一時停止時にそれまでの記録を出力する
+    if (AKTraceEnabled) {
+        AKTraceFlush();
+        AKTraceExportChrome();
+    }
+#endif
+    
     // すべてのキャラクターのアニメーションを停止する
     // 自機
     [self.player.image pauseSchedulerAndActions];
+    [self.rival.image pauseSchedulerAndActions];
 
     // 自機弾
     for (AKCharacter *character in [self.playerShotPool.pool objectEnumerator]) {
         [character.image pauseSchedulerAndActions];
     }
+    for (AKCharacter *character in [self.rivalShotPool.pool objectEnumerator]) {
+        [character.image pauseSchedulerAndActions];
+    }
     
     // 敵
     for (AKCharacter *character in [self.enemyPool.pool objectEnumerator]) {
@@ -1144,11 +2348,15 @@ static NSString *kAKAplUrl = @"https://itunes.apple.com/us/app/qing-ji/id5696538
     // すべてのキャラクターのアニメーションを再開する
     // 自機
     [self.player.image resumeSchedulerAndActions];
+    [self.rival.image resumeSchedulerAndActions];
 
     // 自機弾
     for (AKCharacter *character in self.playerShotPool.pool.objectEnumerator) {
         [character.image resumeSchedulerAndActions];
     }
+    for (AKCharacter *character in self.rivalShotPool.pool.objectEnumerator) {
+        [character.image resumeSchedulerAndActions];
+    }
 
     // 敵
     for (AKCharacter *character in self.enemyPool.pool.objectEnumerator) {
@@ -1166,14 +2374,239 @@ static NSString *kAKAplUrl = @"https://itunes.apple.com/us/app/qing-ji/id5696538
     }
 }
 
+/*!
+ @brief スナップショット保存可否
+ 
+ 通常モードのステージ途中の場合のみスナップショットを保存できる。
+ ステージクリア後やゲームオーバー時は再開する意味がないため保存しない。
+ @return 保存できる場合YES
+ */
+- (BOOL)isSnapshotAvailable
+{
+    // 負荷試験モードと対戦モードの場合は保存しない
+    if (mode_ != kAKGameModeNormal) {
+        return NO;
+    }
+    
+    switch (state_) {
+        case kAKGameStatePlaying:
+        case kAKGameStatePause:
+        case kAKGameStateQuitMenu:
+        case kAKGameStateWait:
+            return YES;
+            
+        default:
+            return NO;
+    }
+}
+
+/*!
+ @brief スナップショット作成
+ 
+ ゲームシーンと配置中のキャラクターの状態を固定長のバイナリデータに書き出す。
+ 画面効果は見た目のみのため保存しない。
+ @return スナップショット
+ */
+- (AKGameSnapshot *)snapshot
+{
+    CFTimeInterval start = CACurrentMediaTime();
+    
+    // 配置中のキャラクターの数を数えて領域を確保する
+    NSInteger playerShots = AKSaveCharacterRecords(self.playerShotPool, NULL);
+    NSInteger enemies = AKSaveCharacterRecords(self.enemyPool, NULL);
+    NSInteger enemyShots = AKSaveCharacterRecords(self.enemyShotPool, NULL);
+    AKGameSnapshot *snapshot = [[[AKGameSnapshot alloc] initWithPlayerShots:playerShots
+                                                                    enemies:enemies
+                                                                 enemyShots:enemyShots] autorelease];
+    
+    // シーンの状態を書き出す
+    struct AKSceneRecord *scene = [snapshot scene];
+    scene->stage = (int32_t)stageNo_;
+    scene->wave = (int32_t)waveNo_;
+    scene->life = (int32_t)life_;
+    scene->score = (int32_t)score_;
+    scene->shotCount = (int32_t)shotCount_;
+    scene->hitCount = (int32_t)hitCount_;
+    scene->missCount = (int32_t)missCount_;
+    scene->enemyCount = (int32_t)enemyCount_;
+    scene->rebirthInterval = rebirthInterval_;
+    scene->waveInterval = waveInterval_;
+    scene->playTime = playTime_;
+    [self.player saveRecord:&scene->player];
+    
+    // キャラクターの状態を自機弾、敵、敵弾の順に書き出す
+    struct AKCharacterRecord *records = [snapshot characters];
+    records += AKSaveCharacterRecords(self.playerShotPool, records);
+    records += AKSaveCharacterRecords(self.enemyPool, records);
+    AKSaveCharacterRecords(self.enemyShotPool, records);
+    
+    AKLog(1, @"スナップショット作成:characters=%d time=%.3fms",
+          playerShots + enemies + enemyShots, (CACurrentMediaTime() - start) * 1000.0);
+    
+    return snapshot;
+}
+
+/*!
+ @brief スナップショットからの復元
+ 
+ スナップショットに保存したゲームシーンとキャラクターの状態を反映する。
+ スクリプトの読み込みは行わず、トランジション終了後に一時停止状態で再開する。
+ @param snapshot スナップショット
+ @return 復元に成功した場合YES
+ */
+- (BOOL)restoreFromSnapshot:(AKGameSnapshot *)snapshot
+{
+    CFTimeInterval start = CACurrentMediaTime();
+    
+    const struct AKSceneRecord *scene = [snapshot scene];
+    
+    // ステージ番号とウェーブ番号が範囲外の場合は復元しない
+    if (scene->stage < kAKStartStage || scene->stage > kAKStageCount ||
+        scene->wave < 1 || scene->wave > kAKWaveCount) {
+        
+        AKLog(1, @"スナップショットのステージ番号不正:stage=%d wave=%d", scene->stage, scene->wave);
+        return NO;
+    }
+    
+    // 状態を初期化してからシーンの状態を反映する
+    [self resetAll:scene->stage];
+    waveNo_ = scene->wave;
+    life_ = scene->life;
+    shotCount_ = scene->shotCount;
+    hitCount_ = scene->hitCount;
+    missCount_ = scene->missCount;
+    enemyCount_ = scene->enemyCount;
+    rebirthInterval_ = scene->rebirthInterval;
+    waveInterval_ = scene->waveInterval;
+    playTime_ = scene->playTime;
+    
+    // スコアはエクステンドの判定を行わずに設定し、ラベルとハイスコアのみ更新する
+    score_ = scene->score;
+    [self addScore:0];
+    
+    // 自機の状態を反映する
+    [self.player loadRecord:&scene->player];
+    
+    const struct AKCharacterRecord *record = [snapshot characters];
+    CCNode *baseLayer = [self getChildByTag:kAKLayerPosZBase];
+    
+    // プールの空き不足などで配置できなかったキャラクターがあるかどうか
+    BOOL isComplete = YES;
+    
+    // 自機弾を配置する
+    for (int i = 0; i < scene->playerShotRecords; i++, record++) {
+        
+        AKPlayerShot *shot = [self.playerShotPool getNext];
+        if (shot == nil) {
+            isComplete = NO;
+            continue;
+        }
+        
+        // 初回の移動更新処理が終わるまでは表示と当たり判定が行われないように画面外に移動する
+        shot.image.position = ccp([AKScreenSize screenSize].width * 2,
+                                  [AKScreenSize screenSize].height * 2);
+        shot.screenPos = shot.image.position;
+        
+        [shot createWithX:record->absx Y:record->absy Z:kAKCharaPosZPlayerShot
+                    Angle:record->angle Parent:baseLayer];
+        [shot loadRecord:record];
+    }
+    
+    // 敵を配置する
+    for (int i = 0; i < scene->enemyRecords; i++, record++) {
+        
+        // 敵の種類が不正な場合は配置しない
+        if (record->type < kAKEnemyTypeNormal || record->type > kAKEnemyTypeCanon) {
+            isComplete = NO;
+            continue;
+        }
+        
+        AKEnemy *enemy = [self entryEnemy:record->type PosX:record->absx PosY:record->absy Angle:record->angle];
+        if (enemy == nil) {
+            isComplete = NO;
+            continue;
+        }
+        [enemy loadRecord:record];
+    }
+    
+    // 敵弾を配置する
+    for (int i = 0; i < scene->enemyShotRecords; i++, record++) {
+        
+        AKEnemyShot *enemyShot = [self fireEnemyShot:ENEMY_SHOT_TYPE_NORMAL
+                                                PosX:record->absx PosY:record->absy Angle:record->angle];
+        if (enemyShot == nil) {
+            isComplete = NO;
+            continue;
+        }
+        [enemyShot loadRecord:record];
+    }
+    
+    // 表示を更新する
+    [self.lifeMark updateImage:life_];
+    NSString *waveNoString = [NSString stringWithFormat:kAKWaveNoFormat, waveNo_, kAKWaveCount];
+    AKLabel *waveNoLabel = (AKLabel *)[[self getChildByTag:kAKLayerPosZInfo] getChildByTag:kAKInfoTagWaveNo];
+    [waveNoLabel setString:waveNoString];
+    [self updateHit];
+    [self updateTime];
+    
+    // トランジション終了後に一時停止状態で再開する
+    isRestored_ = YES;
+    
+    AKLog(1, @"スナップショット復元:characters=%d complete=%d time=%.3fms",
+          scene->playerShotRecords + scene->enemyRecords + scene->enemyShotRecords,
+          isComplete, (CACurrentMediaTime() - start) * 1000.0);
+    
+#ifdef DEBUG
+    // 全キャラクターを配置できた場合のみ、復元した状態から作成したスナップショットが元と一致することを確認する
+    // (配置できなかったキャラクターがある場合は状態が変わるため比較しない)
+    NSAssert(!isComplete || [[self snapshot] checksum] == [snapshot checksum], @"スナップショットの復元結果が一致しない");
+#endif
+    
+    return YES;
+}
+
 /*!
  @brief スクリプト読込
  
- ステージ構成のスクリプトファイルを読み込んで敵を配置する。
+ ウェーブの敵を配置し、ウェーブ番号の表示を更新する。
+ 通常はステージ構成のスクリプトファイルから敵を配置する。
+ 負荷試験モードの場合はスクリプトを使用せずに大量の敵を配置する。
  @param stage ステージ番号
  @param wave ウェーブ番号
  */
 - (void)readScriptOfStage:(NSInteger)stage Wave:(NSInteger)wave
+{
+    NSInteger count = 0;
+    
+    // 敵を配置する
+    if (mode_ == kAKGameModeStress) {
+        count = [self entryStressWave];
+    }
+    else {
+        count = [self entryEnemyWithScriptOfStage:stage Wave:wave];
+    }
+    
+    // 敵の数を保持する
+    enemyCount_ += count;
+    
+    // 情報レイヤーを取得する
+    CCNode *infoLayer = [self getChildByTag:kAKLayerPosZInfo];
+    
+    // ラベルの内容を更新する
+    NSString *waveNoString = [NSString stringWithFormat:kAKWaveNoFormat, waveNo_, kAKWaveCount];
+    AKLabel *waveNoLabel = (AKLabel *)[infoLayer getChildByTag:kAKInfoTagWaveNo];
+    [waveNoLabel setString:waveNoString];
+}
+
+/*!
+ @brief スクリプトからの敵配置
+ 
+ ステージ構成のスクリプトファイルを読み込んで敵を配置する。
+ @param stage ステージ番号
+ @param wave ウェーブ番号
+ @return 配置した敵の数
+ */
+- (NSInteger)entryEnemyWithScriptOfStage:(NSInteger)stage Wave:(NSInteger)wave
 {
     // ファイル名をステージ番号、ウェイブ番号から決定する
     NSString *fileName = [NSString stringWithFormat:@"stage%d_%d", stage, wave];
@@ -1205,29 +2638,11 @@ static NSString *kAKAplUrl = @"https://itunes.apple.com/us/app/qing-ji/id5696538
         NSString *line = [stageScript substringWithRange:lineRange];
         AKLog(0, @"%@", line);
         
-        // 1文字目が"#"の場合は処理を飛ばす
-        if ([[line substringToIndex:1] isEqualToString:@"#"]) {
-            AKLog(0, @"コメント:%@", line);
-        }
         // コメントでない場合はパラメータを読み込む
-        else {
-            // カンマ区切りでパラメータを分割する
-            NSArray *params = [line componentsSeparatedByString:@","];
-            
-            // 1個目のパラメータは敵の種類として扱う。
-            NSString *param = [params objectAtIndex:0];
-            enum AKEnemyType enemyType = [param integerValue];
-            
-            // 敵の種類は0始まりとするため、-1する。
-            enemyType--;
-            
-            // 2個目のパラメータはx座標として扱う
-            param = [params objectAtIndex:1];
-            NSInteger enemyPosX = [param integerValue];
-            
-            // 3個目のパラメータはy座標として扱う
-            param = [params objectAtIndex:2];
-            NSInteger enemyPosY = [param integerValue];
+        enum AKEnemyType enemyType = 0;
+        NSInteger enemyPosX = 0;
+        NSInteger enemyPosY = 0;
+        if (AKParseStageScriptLine(line, &enemyType, &enemyPosX, &enemyPosY)) {
             
             // iPadの場合は座標を倍にする
             if (UI_USER_INTERFACE_IDIOM() == UIUserInterfaceIdiomPad) {
@@ -1259,16 +2674,62 @@ static NSString *kAKAplUrl = @"https://itunes.apple.com/us/app/qing-ji/id5696538
         lineRange.length = 0;
     }
     
-    // 敵の数を保持する
-    enemyCount_ += count;
+    return count;
+}
+
+/*!
+ @brief 負荷試験用の敵配置
+ 
+ 負荷試験モードで、自機の周囲に円状に大量の敵を配置する。
+ 計測結果を比較できるように、配置は乱数を使用せずに決める。
+ 敵の種類は弾を多く撃つものを中心に順番に割り当てる。
+ @return 配置した敵の数
+ */
+- (NSInteger)entryStressWave
+{
+    // 配置する敵の種類
+    const enum AKEnemyType kAKStressEnemyType[] = {
+        kAKEnemyType3Way,
+        kAKEnemyTypeHighShot,
+        kAKEnemyTypeNormal,
+        kAKEnemyType3Way,
+        kAKEnemyTypeHighTurn,
+        kAKEnemyTypeCanon
+    };
+    const NSInteger kAKStressEnemyTypeCount = sizeof(kAKStressEnemyType) / sizeof(kAKStressEnemyType[0]);
+    
+    // 配置する敵の数はプールのサイズまでとする
+    NSInteger count = MIN(kAKStressEnemyCount, self.enemyPool.size);
+    
+    for (NSInteger i = 0; i < count; i++) {
+        
+        // 自機からの距離は内側から外側へ段階的に変える
+        float distance = kAKStressMinDistance +
+            (kAKStressMaxDistance - kAKStressMinDistance) * (i % kAKStressRingCount) / kAKStressRingCount;
+        
+        // iPadの場合は距離を倍にする
+        if (UI_USER_INTERFACE_IDIOM() == UIUserInterfaceIdiomPad) {
+            distance *= 2;
+        }
+        
+        // 自機から見た配置方向は全周に均等に割り当てる
+        float direction = 2.0f * M_PI * i / count;
+        NSInteger posx = distance * cosf(direction);
+        NSInteger posy = distance * sinf(direction);
+        
+        // 敵の向きは自機の方向とする
+        float angle = AKCalcDestAngle(posx, posy, 0, 0);
+        
+        // 敵を生成する
+        [self entryEnemy:kAKStressEnemyType[i % kAKStressEnemyTypeCount]
+                    PosX:posx + player_.absx
+                    PosY:posy + player_.absy
+                   Angle:angle];
+    }
     
-    // 情報レイヤーを取得する
-    CCNode *infoLayer = [self getChildByTag:kAKLayerPosZInfo];
+    AKLog(1, @"負荷試験用の敵配置:%d", count);
     
-    // ラベルの内容を更新する
-    NSString *waveNoString = [NSString stringWithFormat:kAKWaveNoFormat, waveNo_, kAKWaveCount];
-    AKLabel *waveNoLabel = (AKLabel *)[infoLayer getChildByTag:kAKInfoTagWaveNo];
-    [waveNoLabel setString:waveNoString];
+    return count;
 }
 
 /*!
@@ -1288,6 +2749,19 @@ static NSString *kAKAplUrl = @"https://itunes.apple.com/us/app/qing-ji/id5696538
         // 状態をゲームクリアに移行する
         self.state = kAKGameStateStageClear;
         
+        // キャラクタープールの使用状況を出力する
+        [self reportPoolUsage];
+        
+#if AK_PROFILE
+        // 起動引数でメモリ確保回数の上限が指定されている場合は上限を超えたフレームがないことを確認する
+        // 連続実行を最後まで行って結果を集計できるように、上限を超えた場合も停止せずにログに出力する
+        if (AKProfileEnabled) {
+            BOOL isWithinBudget = [AKFrameProfiler checkAllocationBudget];
+            AKLog(!isWithinBudget, @"メモリ確保回数が上限を超えたフレームがある:stage=%d failure=%d",
+                  stageNo_, [AKFrameProfiler allocationBudgetFailureCount]);
+        }
+#endif
+        
         // クリアキャプション表示中の間隔を設定する
         stateInterval_ = kAKStageClearInterval;
         
@@ -1349,6 +2823,17 @@ static NSString *kAKAplUrl = @"https://itunes.apple.com/us/app/qing-ji/id5696538
  */
 - (void)clearStage
 {
+    // リザルト画面で解除された実績をまとめて送信する
+    [[AKGameCenterHelper sharedHelper] flush];
+    
+#if AK_TRACE
+    // トレースが有効な場合はステージ全体の記録を出力する
+    if (AKTraceEnabled) {
+        AKTraceFlush();
+        AKTraceExportChrome();
+    }
+#endif
+    
     // ステージ番号を進める
     stageNo_++;
     
@@ -1361,6 +2846,13 @@ static NSString *kAKAplUrl = @"https://itunes.apple.com/us/app/qing-ji/id5696538
         // プレイ中BGMを開始する
         [self startBGM];
         
+#if AK_TRACE
+        // 次のステージの記録を開始する
+        if (AKTraceEnabled) {
+            AKTraceBeginCapture();
+        }
+#endif
+        
         // ゲームの状態をプレイ中に変更する
         self.state = kAKGameStatePlaying;
         
@@ -1408,6 +2900,14 @@ static NSString *kAKAplUrl = @"https://itunes.apple.com/us/app/qing-ji/id5696538
         [self.enemyPool reset];
         [self.effectPool reset];
         
+        // 敵弾は画面に残すため、使用状況のみクリアする
+        [self.enemyShotPool resetUsage];
+        
+        // 処理していないイベントと描画状態、実行中の弾幕パターンを破棄する
+        [[AKGameEventBuffer sharedBuffer] clear];
+        [[AKRenderBuffer sharedBuffer] clear];
+        [[AKBulletPattern sharedPattern] clear];
+        
         // 次のステージのスクリプトを読み込む
         [self readScriptOfStage:stageNo_ Wave:waveNo_];
     }
@@ -1434,82 +2934,203 @@ static NSString *kAKAplUrl = @"https://itunes.apple.com/us/app/qing-ji/id5696538
 /*!
  @brief ハイスコアファイルの読込
  
- ハイスコアファイルを読み込む。
+ セーブデータからハイスコアを読み込む。
+ ファイルの読み込みは通常アプリ起動時にバックグラウンドで完了しているため、すぐに反映される。
+ 完了していない場合はメインスレッドで待たず、完了後に反映する。
  */
 - (void)readHiScore
 {
     AKLog(1, @"start readHiScore");
     
-    // HOMEディレクトリのパスを取得する
-    NSString *homeDir = NSHomeDirectory();
-    
-    // Documentsディレクトリへのパスを作成する
-    NSString *docDir = [homeDir stringByAppendingPathComponent:@"Documents"];
+    [[AKSaveStore sharedStore] hiScoreWithCompletion:^(NSInteger hiScore) {
+        [self applyHiScore:hiScore];
+    }];
+}
+
+/*!
+ @brief ハイスコアの反映
+ 
+ 読み込んだハイスコアがプレイ中のハイスコアより大きい場合はメンバとラベルに反映する。
+ ラベルが生成されていない場合はメンバのみ反映し、ラベル生成時にその値を使用する。
+ @param hiScore 読み込んだハイスコア
+ */
+- (void)applyHiScore:(NSInteger)hiScore
+{
+    AKLog(1, @"m_hiScore=%d hiScore=%d", hiScore_, hiScore);
     
-    // ファイルパスを作成する
-    NSString *filePath = [docDir stringByAppendingPathComponent:kAKDataFileName];
+    if (hiScore <= hiScore_) {
+        return;
+    }
     
-    // ファイルを読み込む
-    NSData *data = [NSData dataWithContentsOfFile:filePath];
+    hiScore_ = hiScore;
     
-    // ファイルが読み込めた場合はデータを取得する
-    if (data != nil) {
-      
-        // ファイルからデコーダーを生成する
-        NSKeyedUnarchiver *decoder = [[[NSKeyedUnarchiver alloc] initForReadingWithData:data] autorelease];
-        
-        // ハイスコアをデコードする
-        AKHiScoreFile *hiScore = [decoder decodeObjectForKey:kAKDataFileKey];
-        
-        // デコードを完了する
-        [decoder finishDecoding];
-        
-        // メンバに読み込む
-        hiScore_ = hiScore.hiscore;
-        
-        AKLog(1, @"m_hiScore=%d", hiScore_);
-    }
+    // ラベルの内容を更新する
+    NSString *hiScoreString = [NSString stringWithFormat:kAKHiScoreFormat, hiScore_];
+    AKLabel *hiScoreLabel = (AKLabel *)[[self getChildByTag:kAKLayerPosZInfo] getChildByTag:kAKInfoTagHiScore];
+    [hiScoreLabel setString:hiScoreString];
 }
 
 /*!
  @brief ハイスコアファイルの書込
  
- ハイスコアファイルを書き込む。
+ セーブデータのハイスコアを更新する。
+ ファイルへの書き込みはバックグラウンドで行うため、ここでは待たない。
  */
 - (void)writeHiScore
 {
     AKLog(1, @"start writeHiScore:m_hiScore=%d m_score=%d", hiScore_, score_);
     
-    // HOMEディレクトリのパスを取得する
-    NSString *homeDir = NSHomeDirectory();
-    
-    // Documentsディレクトリへのパスを作成する
-    NSString *docDir = [homeDir stringByAppendingPathComponent:@"Documents"];
-    
-    // ファイルパスを作成する
-    NSString *filePath = [docDir stringByAppendingPathComponent:kAKDataFileName];
-    
-    // ハイスコアファイルオブジェクトを生成する
-    AKHiScoreFile *hiScore = [[[AKHiScoreFile alloc] init] autorelease];
-    
-    // ハイスコアを設定する
-    hiScore.hiscore = hiScore_;
+    // 負荷試験モードと対戦モードの記録は保存しない
+    if (mode_ != kAKGameModeNormal) {
+        return;
+    }
     
-    // エンコーダーを生成する
-    NSMutableData *data = [NSMutableData data];
-    NSKeyedArchiver *encoder = [[[NSKeyedArchiver alloc] initForWritingWithMutableData:data] autorelease];
+    // セーブデータを更新する
+    [[AKSaveStore sharedStore] updateHiScore:hiScore_];
     
-    // ファイル内容をエンコードする
-    [encoder encodeObject:hiScore forKey:kAKDataFileKey];
+    // Game Centerにスコアを送信する
+    [[AKGameCenterHelper sharedHelper] reportHiScore:score_];
+}
+
+/*!
+ @brief 連続描画要求
+ 
+ フレームレート制御から呼ばれ、連続した描画が必要かどうかを返す。
+ ポーズ中、終了メニュー表示中、ゲームオーバー表示中は画面が変化しないため不要とする。
+ ボタンの点滅などのアクションはフレームレート制御側で検出する。
+ @return 連続した描画が必要な場合YES
+ */
+- (BOOL)needsContinuousFrames
+{
+    switch (state_) {
+        case kAKGameStatePause:
+        case kAKGameStateQuitMenu:
+        case kAKGameStateGameOver:
+            return NO;
+            
+        default:
+            return YES;
+    }
+}
+
+/*!
+ @brief イベント処理
+ 
+ キャラクターの移動処理中に蓄積されたイベントを種類ごとにまとめて処理する。
+ 命中数とスコアは合計してから反映し、効果音は同じものを1フレームに1回だけ鳴らす。
+ 自機の破壊は他のイベントをすべて処理した後に行う。
+ */
+- (void)processEvents
+{
+    AKGameEventBuffer *eventBuffer = [AKGameEventBuffer sharedBuffer];
+    NSInteger shotCount = 0;    // 消滅した自機弾の数
+    NSInteger hitCount = 0;     // 命中した自機弾の数
+    NSInteger score = 0;        // 加算するスコア
+    BOOL isMiss = NO;           // 自機が破壊されたかどうか
+    NSString *sounds[kAKMaxSoundPerFrame];  // 再生した効果音
+    NSInteger soundCount = 0;   // 再生した効果音の数
+    
+    // イベントがない場合は無処理
+    if (eventBuffer.count <= 0) {
+        return;
+    }
     
-    // エンコードを完了する
-    [encoder finishEncoding];
+    // イベントの種類ごとにまとめて処理する
+    for (int type = 0; type < kAKGameEventTypeCount; type++) {
+        for (NSInteger i = 0; i < eventBuffer.count; i++) {
+            
+            const struct AKGameEvent *event = [eventBuffer eventAtIndex:i];
+            if (event->type != type) {
+                continue;
+            }
+            
+            switch (event->type) {
+                case kAKGameEventShotResult:
+                    // 自機弾の発射数と命中数を合計する
+                    shotCount++;
+                    if (event->value) {
+                        hitCount++;
+                    }
+                    break;
+                    
+                case kAKGameEventEnemyShot:
+                {
+                    // 敵弾を生成する
+                    AKEnemyShot *enemyShot = [self fireEnemyShot:event->value
+                                                            PosX:event->x PosY:event->y Angle:event->angle];
+                    
+                    // 弾幕パターンで速度が指定されている場合は設定する
+                    if (enemyShot != nil && event->speed > 0.0f) {
+                        enemyShot.speed = event->speed;
+                    }
+                    
+                    // 弾幕パターンが指定されている場合は敵弾のパターンを開始する
+                    if (enemyShot != nil && event->pattern > 0) {
+                        [[AKBulletPattern sharedPattern] startPattern:event->pattern owner:enemyShot];
+                    }
+                    break;
+                }
+                    
+                case kAKGameEventEffect:
+                    // 画面効果を生成する
+                    [self entryEffect:event->name startRect:event->rect
+                           frameCount:event->value delay:event->delay
+                                 posX:event->x posY:event->y];
+                    break;
+                    
+                case kAKGameEventSound:
+                {
+                    // 同じ効果音を既に再生している場合は鳴らさない
+                    BOOL isPlayed = NO;
+                    for (NSInteger j = 0; j < soundCount; j++) {
+                        if ([sounds[j] isEqualToString:event->name]) {
+                            isPlayed = YES;
+                            break;
+                        }
+                    }
+                    
+                    if (!isPlayed && soundCount < kAKMaxSoundPerFrame) {
+                        [[SimpleAudioEngine sharedEngine] playEffect:event->name];
+                        sounds[soundCount++] = event->name;
+                    }
+                }
+                    break;
+                    
+                case kAKGameEventScore:
+                    // スコアを合計する
+                    score += event->value;
+                    break;
+                    
+                case kAKGameEventMiss:
+                    // 自機の破壊は最後に処理する
+                    isMiss = YES;
+                    break;
+                    
+                default:
+                    NSAssert(0, @"不正なイベントの種類:%d", event->type);
+                    break;
+            }
+        }
+        
+        // 命中数を反映する
+        if (type == kAKGameEventShotResult) {
+            shotCount_ += shotCount;
+            hitCount_ += hitCount;
+            AKLog(0, @"hitCount=%d shotCount=%d", hitCount_, shotCount_);
+        }
+        // スコアを反映する
+        else if (type == kAKGameEventScore && score > 0) {
+            [self addScore:score];
+        }
+    }
     
-    // ファイルを書き込む
-    [data writeToFile:filePath atomically:YES];
+    // イベントをクリアする
+    [eventBuffer clear];
     
-    // Game Centerにスコアを送信する
-    [[AKGameCenterHelper sharedHelper] reportHiScore:score_];
+    // 自機が破壊された場合は自機破壊時の処理を行う
+    if (isMiss) {
+        [self miss];
+    }
 }
 
 /*!
@@ -1536,10 +3157,13 @@ static NSString *kAKAplUrl = @"https://itunes.apple.com/us/app/qing-ji/id5696538
     AKLabel *hitLabel = (AKLabel *)[infoLayer getChildByTag:kAKInfoTagHit];
     
     // 命中率ラベルを更新する
-    NSString *hitString = [NSString stringWithFormat:kAKHitFormat, hit];
-    [hitLabel setString:hitString];
+    // 毎フレーム呼ばれるため、NSStringを生成せずにchar配列で設定する。
+    // 書式の検査ができるように、フォーマットはkAKHitFormatと同じ内容を文字列リテラルで指定する。
+    char hitString[kAKLabelCStringSize];
+    snprintf(hitString, sizeof(hitString), "HIT:%3ld%%", (long)hit);
+    [hitLabel setCString:hitString];
     
-    AKLog(0, @"str=%@", hitString);
+    AKLog(0, @"str=%s", hitString);
 }
 
 /*!
@@ -1572,9 +3196,12 @@ static NSString *kAKAplUrl = @"https://itunes.apple.com/us/app/qing-ji/id5696538
     // プレイ時間ラベルを取得する
     AKLabel *timeLabel = (AKLabel *)[infoLayer getChildByTag:kAKInfoTagTime];
     
-    // 命中率ラベルを更新する
-    NSString *timeString = [NSString stringWithFormat:kAKTimeFormat, min, sec, millisec];
-    [timeLabel setString:timeString];
+    // プレイ時間ラベルを更新する
+    // 毎フレーム呼ばれるため、NSStringを生成せずにchar配列で設定する。
+    // 書式の検査ができるように、フォーマットはkAKTimeFormatと同じ内容を文字列リテラルで指定する。
+    char timeString[kAKLabelCStringSize];
+    snprintf(timeString, sizeof(timeString), "TIME:%02ld:%02ld:%02ld", (long)min, (long)sec, (long)millisec);
+    [timeLabel setCString:timeString];
 }
 
 /*!
@@ -1614,6 +3241,9 @@ static NSString *kAKAplUrl = @"https://itunes.apple.com/us/app/qing-ji/id5696538
     // ハイスコアをファイルに書き込む
     [self writeHiScore];
     
+    // 送信待ちの実績とスコアをまとめて送信する
+    [[AKGameCenterHelper sharedHelper] flush];
+    
     // BGMを停止する
     [[SimpleAudioEngine sharedEngine] stopBackgroundMusic];
         
@@ -1647,6 +3277,14 @@ static NSString *kAKAplUrl = @"https://itunes.apple.com/us/app/qing-ji/id5696538
         hit = (float)hitCount_ / shotCount_ * 100.0f;
     }
     
+    // ステージの記録を更新する。負荷試験モードの記録は保存しない。
+    if (mode_ != kAKGameModeStress) {
+        [[AKSaveStore sharedStore] updateStage:stageNo_
+                                         score:score_
+                                          time:playTime_
+                                           hit:hit];
+    }
+    
     // 各種パラメータを設定する
     [resultLayer setParameterStage:stageNo_
                              score:score_
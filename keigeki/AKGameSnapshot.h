@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) 2012-2013 Akihiro Kaneda.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   1.Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   2.Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ *   3.Neither the name of the Monochrome Soft nor the names of its contributors
+ *     may be used to endorse or promote products derived from this software
+ *     without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+/*!
+ @file AKGameSnapshot.h
+ @brief ゲーム状態のスナップショット
+
+ 中断時にゲームプレイの状態を保存するバイナリ形式のスナップショットを定義する。
+ */
+
+#import <Foundation/Foundation.h>
+#import "AKCharacter.h"
+
+/// スナップショットのフォーマットのバージョン。構造体を変更した場合は更新する。
+enum {
+    kAKSnapshotVersion = 1
+};
+
+/// ゲームシーンの状態(固定長)
+struct AKSceneRecord {
+    int32_t stage;              ///< ステージ番号
+    int32_t wave;               ///< ウェーブ番号
+    int32_t life;               ///< 残機の数
+    int32_t score;              ///< スコア
+    int32_t shotCount;          ///< ショット発射数
+    int32_t hitCount;           ///< ショット命中数
+    int32_t missCount;          ///< 撃墜された数
+    int32_t enemyCount;         ///< 1ステージの敵の数
+    float rebirthInterval;      ///< 自機復活までの間隔
+    float waveInterval;         ///< 次のウェーブ開始までの間隔
+    float playTime;             ///< ステージのプレイ時間
+    int32_t playerShotRecords;  ///< 保存した自機弾の数
+    int32_t enemyRecords;       ///< 保存した敵の数
+    int32_t enemyShotRecords;   ///< 保存した敵弾の数
+    struct AKCharacterRecord player;    ///< 自機
+};
+
+// ゲーム状態のスナップショット
+@interface AKGameSnapshot : NSObject {
+    /// ヘッダを含むデータ
+    NSMutableData *data_;
+}
+
+// 書き込み用の生成処理
+- (id)initWithPlayerShots:(NSInteger)playerShots enemies:(NSInteger)enemies enemyShots:(NSInteger)enemyShots;
+// 読み込み用の生成処理
+- (id)initWithData:(NSData *)data;
+// シーンの状態取得
+- (struct AKSceneRecord *)scene;
+// キャラクターの状態取得
+- (struct AKCharacterRecord *)characters;
+// チェックサムを設定したデータ取得
+- (NSData *)data;
+// チェックサム取得
+- (uint32_t)checksum;
+// ファイルへの書き込み
+- (BOOL)writeToFile;
+// ファイルからの読み込み
++ (AKGameSnapshot *)snapshotFromFile;
+// ファイルの削除
++ (void)removeFile;
+@end
@@ -0,0 +1,276 @@
+/*
+ * Copyright (c) 2012-2013 Akihiro Kaneda.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   1.Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   2.Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ *   3.Neither the name of the Monochrome Soft nor the names of its contributors
+ *     may be used to endorse or promote products derived from this software
+ *     without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+/*!
+ @file AKGameSnapshot.m
+ @brief ゲーム状態のスナップショット
+
+ 中断時にゲームプレイの状態を保存するバイナリ形式のスナップショットを定義する。
+ */
+
+#import <zlib.h>
+#import "AKGameSnapshot.h"
+#import "AKCommon.h"
+
+/*!
+ @brief スナップショットのヘッダ
+
+ ファイルの先頭に置く。チェックサムはヘッダ以降のデータのCRC32とする。
+ */
+typedef struct {
+    uint32_t magic;     ///< 識別子
+    uint32_t version;   ///< フォーマットのバージョン
+    uint32_t length;    ///< ヘッダ以降のデータの長さ
+    uint32_t checksum;  ///< チェックサム
+} AKSnapshotHeader;
+
+/// スナップショットの識別子
+static const uint32_t kAKSnapshotMagic = 0x414B4753;
+/// スナップショットファイル名
+static NSString *kAKSnapshotFileName = @"gamestate.dat";
+
+/*!
+ @brief ファイルパス取得
+
+ Documentsディレクトリ内のスナップショットファイルのパスを作成する。
+ @return ファイルパス
+ */
+static NSString *AKSnapshotFilePath(void)
+{
+    // Documentsディレクトリへのパスを作成する
+    NSString *docDir = [NSHomeDirectory() stringByAppendingPathComponent:@"Documents"];
+
+    return [docDir stringByAppendingPathComponent:kAKSnapshotFileName];
+}
+
+/*!
+ @brief ゲーム状態のスナップショット
+
+ ゲームシーンの状態と配置中のキャラクターの状態を固定長の構造体の並びとして保持する。
+ キャラクターは自機弾、敵、敵弾の順に並べる。
+ 構造体をそのまま書き出すため、読み込みは同じアーキテクチャのビルドでのみ行う前提とする。
+ */
+@implementation AKGameSnapshot
+
+/*!
+ @brief 書き込み用の生成処理
+
+ 指定された数のキャラクターを保存できる領域を確保する。
+ @param playerShots 自機弾の数
+ @param enemies 敵の数
+ @param enemyShots 敵弾の数
+ @return 生成したオブジェクト。失敗時はnilを返す。
+ */
+- (id)initWithPlayerShots:(NSInteger)playerShots enemies:(NSInteger)enemies enemyShots:(NSInteger)enemyShots
+{
+    // スーパークラスの生成処理
+    self = [super init];
+    if (!self) {
+        return nil;
+    }
+
+    // 領域を確保する。NSMutableDataは0クリアされるため、パディングも不定値にならない。
+    NSInteger count = playerShots + enemies + enemyShots;
+    NSUInteger length = sizeof(struct AKSceneRecord) + sizeof(struct AKCharacterRecord) * count;
+    data_ = [[NSMutableData alloc] initWithLength:sizeof(AKSnapshotHeader) + length];
+
+    // ヘッダを設定する
+    AKSnapshotHeader *header = (AKSnapshotHeader *)[data_ mutableBytes];
+    header->magic = kAKSnapshotMagic;
+    header->version = kAKSnapshotVersion;
+    header->length = (uint32_t)length;
+
+    // キャラクターの数を設定する
+    struct AKSceneRecord *scene = [self scene];
+    scene->playerShotRecords = (int32_t)playerShots;
+    scene->enemyRecords = (int32_t)enemies;
+    scene->enemyShotRecords = (int32_t)enemyShots;
+
+    return self;
+}
+
+/*!
+ @brief 読み込み用の生成処理
+
+ ファイルから読み込んだデータの識別子、バージョン、長さ、チェックサムを確認する。
+ 不正なデータの場合はnilを返す。
+ @param data 読み込んだデータ
+ @return 生成したオブジェクト。失敗時はnilを返す。
+ */
+- (id)initWithData:(NSData *)data
+{
+    // スーパークラスの生成処理
+    self = [super init];
+    if (!self) {
+        return nil;
+    }
+
+    // ヘッダとシーンの状態が入っていない場合はエラー
+    if ([data length] < sizeof(AKSnapshotHeader) + sizeof(struct AKSceneRecord)) {
+        AKLog(1, @"スナップショットの長さ不正:%d", [data length]);
+        [self release];
+        return nil;
+    }
+
+    data_ = [data mutableCopy];
+
+    // ヘッダを確認する
+    const AKSnapshotHeader *header = (const AKSnapshotHeader *)[data_ bytes];
+    if (header->magic != kAKSnapshotMagic ||
+        header->version != kAKSnapshotVersion ||
+        header->length != [data_ length] - sizeof(AKSnapshotHeader) ||
+        header->checksum != [self checksum]) {
+
+        AKLog(1, @"スナップショットのヘッダ不正:version=%u length=%u", header->version, header->length);
+        [self release];
+        return nil;
+    }
+
+    // キャラクターの数とデータの長さが一致しない場合はエラー
+    const struct AKSceneRecord *scene = [self scene];
+    if (scene->playerShotRecords < 0 || scene->enemyRecords < 0 || scene->enemyShotRecords < 0 ||
+        header->length != sizeof(struct AKSceneRecord) +
+        sizeof(struct AKCharacterRecord) * (scene->playerShotRecords + scene->enemyRecords + scene->enemyShotRecords)) {
+
+        AKLog(1, @"スナップショットのキャラクター数不正");
+        [self release];
+        return nil;
+    }
+
+    return self;
+}
+
+/*!
+ @brief インスタンス解放時処理
+
+ インスタンス解放時にオブジェクトを解放する。
+ */
+- (void)dealloc
+{
+    [data_ release];
+
+    // スーパークラスの処理を実行する
+    [super dealloc];
+}
+
+/*!
+ @brief シーンの状態取得
+
+ ヘッダの直後に置いたシーンの状態を取得する。
+ @return シーンの状態
+ */
+- (struct AKSceneRecord *)scene
+{
+    return (struct AKSceneRecord *)((uint8_t *)[data_ mutableBytes] + sizeof(AKSnapshotHeader));
+}
+
+/*!
+ @brief キャラクターの状態取得
+
+ シーンの状態の直後に置いたキャラクターの状態の先頭を取得する。
+ @return キャラクターの状態の配列
+ */
+- (struct AKCharacterRecord *)characters
+{
+    return (struct AKCharacterRecord *)([self scene] + 1);
+}
+
+/*!
+ @brief チェックサムを設定したデータ取得
+
+ ヘッダにチェックサムを設定してデータを返す。
+ @return スナップショットのデータ
+ */
+- (NSData *)data
+{
+    AKSnapshotHeader *header = (AKSnapshotHeader *)[data_ mutableBytes];
+    header->checksum = [self checksum];
+
+    return data_;
+}
+
+/*!
+ @brief チェックサム取得
+
+ ヘッダ以降のデータのCRC32を計算する。
+ 同じ状態からは同じ値になるため、保存と復元の結果の比較にも使用する。
+ @return チェックサム
+ */
+- (uint32_t)checksum
+{
+    return (uint32_t)crc32(0L, (const Bytef *)[self scene], [data_ length] - sizeof(AKSnapshotHeader));
+}
+
+/*!
+ @brief ファイルへの書き込み
+
+ Documentsディレクトリにアトミックに書き込む。
+ @return 成功時YES
+ */
+- (BOOL)writeToFile
+{
+    if (![[self data] writeToFile:AKSnapshotFilePath() atomically:YES]) {
+        AKLog(1, @"スナップショット書き込み失敗");
+        return NO;
+    }
+
+    return YES;
+}
+
+/*!
+ @brief ファイルからの読み込み
+
+ スナップショットファイルを読み込む。
+ ファイルがない場合、または内容が不正な場合はnilを返す。
+ @return スナップショット
+ */
++ (AKGameSnapshot *)snapshotFromFile
+{
+    NSData *data = [NSData dataWithContentsOfFile:AKSnapshotFilePath()];
+    if (data == nil) {
+        return nil;
+    }
+
+    return [[[AKGameSnapshot alloc] initWithData:data] autorelease];
+}
+
+/*!
+ @brief ファイルの削除
+
+ スナップショットファイルを削除する。
+ 一度復元したスナップショットや古いスナップショットを使わないようにするために呼び出す。
+ */
++ (void)removeFile
+{
+    NSString *path = AKSnapshotFilePath();
+
+    if ([[NSFileManager defaultManager] fileExistsAtPath:path]) {
+        [[NSFileManager defaultManager] removeItemAtPath:path error:nil];
+    }
+}
+@end
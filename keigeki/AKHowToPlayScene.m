@@ -34,6 +34,7 @@
  */
 
 #import "AKHowToPlayScene.h"
+#import "AKTextureManager.h"
 #import "AKCommon.h"
 #import "AKTitleScene.h"
 #import "AKScreenSize.h"
@@ -124,6 +125,9 @@ static const float kAKAdMarginPosPoint = 30.0f;
         return nil;
     }
     
+    // このシーンで使用するテクスチャを登録する
+    [[AKTextureManager sharedManager] beginScene:NSStringFromClass([self class])];
+    
     // 背景色レイヤーを作成する
     CCLayerColor *backColor = AKCreateBackColorLayer();
     
@@ -310,7 +314,7 @@ static const float kAKAdMarginPosPoint = 30.0f;
     }
     
     // ファイルからスプライトを作成する
-    self.image = [CCSprite spriteWithFile:fileName];
+    self.image = [CCSprite spriteWithTexture:[[AKTextureManager sharedManager] textureForFile:fileName]];
     
     // 広告分のマージンの初期値は0とする
     float adMargin = 0.0f;
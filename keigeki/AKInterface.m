@@ -34,6 +34,8 @@
  */
 
 #import "AKInterface.h"
+#import "AKFramePacer.h"
+#import "AKTextureManager.h"
 #import "AKCommon.h"
 #import "AKScreenSize.h"
 
@@ -170,6 +172,9 @@
  */
 - (BOOL)ccTouchBegan:(UITouch *)touch withEvent:(UIEvent *)event
 {
+    // 低フレームレートで動作中の場合は通常のフレームレートに戻す
+    [[AKFramePacer sharedPacer] wake];
+    
     // メニュー項目が登録されていない場合は処理を終了する
     if (self.menuItems == nil) {
         return YES;
@@ -223,7 +228,7 @@
     if (filename != nil) {
         
         // ボタンの画像を読み込む
-        item = [CCSprite spriteWithFile:filename];
+        item = [CCSprite spriteWithTexture:[[AKTextureManager sharedManager] textureForFile:filename]];
         assert(item != nil);
         
         // ボタンの位置を設定する
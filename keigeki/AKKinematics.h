@@ -0,0 +1,96 @@
+/*
+ * Copyright (c) 2012-2013 Akihiro Kaneda.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   1.Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   2.Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ *   3.Neither the name of the Monochrome Soft nor the names of its contributors
+ *     may be used to endorse or promote products derived from this software
+ *     without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+/*!
+ @file AKKinematics.h
+ @brief 位置の一括計算
+
+ キャラクタープール内のキャラクターの位置をまとめて計算する関数を定義する。
+ */
+
+#import <Foundation/Foundation.h>
+#import "AKCharacter.h"
+#import "AKFrameProfiler.h"
+
+/// 一度に計算する要素の数
+enum {
+    kAKKinematicsLaneCount = 4
+};
+
+/// 位置の計算に使用する値を種類ごとに並べた配列
+struct AKKinematicsBatch {
+    AKCharacter **characters;   ///< 値を取り出したキャラクター(保持はしない)
+    float *absx;                ///< 絶対座標x
+    float *absy;                ///< 絶対座標y
+    float *angle;               ///< 向き
+    float *speed;               ///< 速度
+    float *rotSpeed;            ///< 回転速度
+    float *posx;                ///< スクリーン座標x
+    float *posy;                ///< スクリーン座標y
+    NSInteger count;            ///< 格納している要素の数
+    NSInteger capacity;         ///< 配列の確保サイズ
+};
+
+/// スタック上の配列で一度に計算する要素の数
+enum {
+    kAKKinematicsStackCount = 16
+};
+
+/*!
+ @brief スタック上に確保する位置計算用の配列
+
+ ヒープに配列を確保できない場合や、少数のキャラクターを計算する場合に使用する。
+ AKKinematicsInitStackBatchで初期化してから、batchをAKKinematicsBatchとして使用する。
+ */
+struct AKKinematicsStackBatch {
+    struct AKKinematicsBatch batch;                                 ///< 配列
+    AKCharacter *characters[kAKKinematicsStackCount];               ///< キャラクターの領域
+    float absx[kAKKinematicsStackCount] __attribute__((aligned(16)));       ///< 絶対座標xの領域
+    float absy[kAKKinematicsStackCount] __attribute__((aligned(16)));       ///< 絶対座標yの領域
+    float angle[kAKKinematicsStackCount] __attribute__((aligned(16)));      ///< 向きの領域
+    float speed[kAKKinematicsStackCount] __attribute__((aligned(16)));      ///< 速度の領域
+    float rotSpeed[kAKKinematicsStackCount] __attribute__((aligned(16)));   ///< 回転速度の領域
+    float posx[kAKKinematicsStackCount] __attribute__((aligned(16)));       ///< スクリーン座標xの領域
+    float posy[kAKKinematicsStackCount] __attribute__((aligned(16)));       ///< スクリーン座標yの領域
+};
+
+// 配列の確保
+BOOL AKKinematicsReserve(struct AKKinematicsBatch *batch, NSInteger capacity);
+// 配列の解放
+void AKKinematicsRelease(struct AKKinematicsBatch *batch);
+// 位置の一括計算
+void AKKinematicsIntegrate(struct AKKinematicsBatch *batch, NSInteger start, NSInteger end,
+                           const struct AKMoveParam *param);
+// スタック上の配列の初期化
+void AKKinematicsInitStackBatch(struct AKKinematicsStackBatch *stack);
+// 格納している要素の計算と書き戻し
+void AKKinematicsFlush(struct AKKinematicsBatch *batch, const struct AKMoveParam *param);
+#if AK_PROFILE
+// キャラクターごとの計算との比較
+void AKKinematicsBenchmark(void);
+#endif
@@ -0,0 +1,495 @@
+/*
+ * Copyright (c) 2012-2013 Akihiro Kaneda.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   1.Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   2.Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ *   3.Neither the name of the Monochrome Soft nor the names of its contributors
+ *     may be used to endorse or promote products derived from this software
+ *     without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+/*!
+ @file AKKinematics.m
+ @brief 位置の一括計算
+
+ キャラクタープール内のキャラクターの位置をまとめて計算する関数を定義する。
+ */
+
+#import <mach/mach_time.h>
+#import "AKKinematics.h"
+#import "AKCommon.h"
+#import "AKScreenSize.h"
+
+/// 4要素の浮動小数点ベクトル
+typedef float AKFloat4 __attribute__((vector_size(16)));
+/// 4要素の符号付き整数ベクトル
+typedef int32_t AKInt4 __attribute__((vector_size(16)));
+/// 4要素の符号なし整数ベクトル(ビット演算用)
+typedef uint32_t AKUInt4 __attribute__((vector_size(16)));
+
+/// 配列の先頭アドレスの境界
+static const size_t kAKKinematicsAlignment = 16;
+
+/// sin/cosの範囲縮小の係数(4/π)
+static const float kAKFourOverPi = 1.27323954473516f;
+/// π/4を3つに分割した値(範囲縮小の誤差を小さくするため)
+static const float kAKPiOver4Part1 = 0.78515625f;
+static const float kAKPiOver4Part2 = 2.4187564849853515625e-4f;
+static const float kAKPiOver4Part3 = 3.77489497744594108e-8f;
+
+/*!
+ @brief 全要素が同じ値のベクトル作成
+
+ 全要素に指定した値を設定したベクトルを作成する。
+ @param value 値
+ @return ベクトル
+ */
+static inline AKFloat4 AKFloat4Splat(float value)
+{
+    return (AKFloat4){value, value, value, value};
+}
+
+/*!
+ @brief 要素ごとの選択
+
+ マスクのビットが立っている要素はaを、それ以外はbを選択する。
+ @param mask 比較結果のマスク
+ @param a マスクが立っている場合の値
+ @param b マスクが立っていない場合の値
+ @return 選択結果
+ */
+static inline AKFloat4 AKFloat4Select(AKUInt4 mask, AKFloat4 a, AKFloat4 b)
+{
+    return (AKFloat4)((mask & (AKUInt4)a) | (~mask & (AKUInt4)b));
+}
+
+/*!
+ @brief 小数点以下の切り捨て
+
+ 各要素の小数点以下を0方向に切り捨てる。
+ @param v 値
+ @return 切り捨て結果
+ */
+static inline AKFloat4 AKFloat4Trunc(AKFloat4 v)
+{
+    return __builtin_convertvector(__builtin_convertvector(v, AKInt4), AKFloat4);
+}
+
+/*!
+ @brief sinとcosの計算
+
+ 各要素のsinとcosを同時に計算する。
+ π/4単位で範囲を縮小し、[-π/4, π/4]の範囲で多項式近似を行う(Cephesのsinf/cosfと同じ方法)。
+ 誤差は|x|が数千ラジアンまでの範囲で1e-7程度。
+ @param x 角度(ラジアン)
+ @param s sinの計算結果
+ @param c cosの計算結果
+ */
+static inline void AKFloat4SinCos(AKFloat4 x, AKFloat4 *s, AKFloat4 *c)
+{
+    const AKUInt4 signBit = (AKUInt4)AKFloat4Splat(-0.0f);
+    
+    // 符号を分離して絶対値で計算する
+    AKUInt4 signSin = (AKUInt4)x & signBit;
+    AKFloat4 ax = (AKFloat4)((AKUInt4)x & ~signBit);
+    
+    // π/4単位の象限を求める(偶数に切り上げる)
+    AKUInt4 j = __builtin_convertvector(ax * AKFloat4Splat(kAKFourOverPi), AKUInt4);
+    j = (j + 1) & ~1u;
+    AKFloat4 y = __builtin_convertvector(j, AKFloat4);
+    
+    // 象限の分だけ角度を戻す
+    ax = ((ax - y * AKFloat4Splat(kAKPiOver4Part1))
+              - y * AKFloat4Splat(kAKPiOver4Part2))
+              - y * AKFloat4Splat(kAKPiOver4Part3);
+    
+    // 象限から結果の符号と使用する多項式を決める
+    signSin ^= (j & 4) << 29;
+    AKUInt4 signCos = (~(j - 2) & 4) << 29;
+    AKUInt4 polyMask = (AKUInt4)((j & 2) == 0);
+    
+    // cosとsinの多項式近似
+    AKFloat4 z = ax * ax;
+    AKFloat4 yc = ((AKFloat4Splat(2.443315711809948e-5f) * z
+                    - AKFloat4Splat(1.388731625493765e-3f)) * z
+                    + AKFloat4Splat(4.166664568298827e-2f)) * z * z
+                  - AKFloat4Splat(0.5f) * z + AKFloat4Splat(1.0f);
+    AKFloat4 ys = ((AKFloat4Splat(-1.9515295891e-4f) * z
+                    + AKFloat4Splat(8.3321608736e-3f)) * z
+                    - AKFloat4Splat(1.6666654611e-1f)) * z * ax + ax;
+    
+    *s = (AKFloat4)((AKUInt4)AKFloat4Select(polyMask, ys, yc) ^ signSin);
+    *c = (AKFloat4)((AKUInt4)AKFloat4Select(polyMask, yc, ys) ^ signCos);
+}
+
+/*!
+ @brief 範囲チェック(ループ、 実数)
+
+ AKRangeCheckLFを4要素同時に行う。分岐せずに全要素を計算し、範囲内の要素はそのまま返す。
+ fmodfの代わりに切り捨てた商を引いて剰余を求めるが、
+ 1フレームのはみ出し量は範囲の幅より十分小さいため、結果はAKRangeCheckLFと一致する。
+ @param v 値
+ @param min 最小値
+ @param max 最大値
+ @return 補正結果
+ */
+static inline AKFloat4 AKFloat4RangeCheck(AKFloat4 v, float min, float max)
+{
+    AKFloat4 vmin = AKFloat4Splat(min);
+    AKFloat4 vmax = AKFloat4Splat(max);
+    AKFloat4 range = AKFloat4Splat(max - min);
+    AKFloat4 zero = AKFloat4Splat(0.0f);
+    
+    AKUInt4 below = (AKUInt4)(v < vmin);
+    AKUInt4 above = (AKUInt4)(v > vmax);
+    
+    // 範囲からはみ出した量を範囲の幅で割った余りを求める
+    AKFloat4 d = AKFloat4Select(below, vmin - v, v - vmax);
+    AKFloat4 over = d - AKFloat4Trunc(d / range) * range;
+    over = AKFloat4Select((AKUInt4)(over < zero), over + range, over);
+    over = AKFloat4Select((AKUInt4)(over >= range), over - range, over);
+    
+    // 最小値未満の場合は最大値側から、最大値超過の場合は最小値側から戻す
+    AKUInt4 positive = (AKUInt4)(over > zero);
+    AKFloat4 lower = AKFloat4Select(positive, vmax - over, vmin);
+    AKFloat4 upper = AKFloat4Select(positive, vmin + over, vmax);
+    
+    return AKFloat4Select(below | above, AKFloat4Select(below, lower, upper), v);
+}
+
+/*!
+ @brief 配列の確保
+
+ 指定した数の要素を格納できるように配列を確保し直す。格納していた要素は破棄する。
+ 一度に計算する要素の数の倍数に切り上げ、末尾の余りの要素は0で初期化する。
+ @param batch 確保する配列
+ @param capacity 格納する要素の数
+ @return 確保に成功した場合YES
+ */
+BOOL AKKinematicsReserve(struct AKKinematicsBatch *batch, NSInteger capacity)
+{
+    float **arrays[] = {
+        &batch->absx, &batch->absy, &batch->angle, &batch->speed,
+        &batch->rotSpeed, &batch->posx, &batch->posy
+    };
+    
+    // 確保済みの配列を解放する
+    AKKinematicsRelease(batch);
+    
+    // 一度に計算する要素の数の倍数に切り上げる
+    capacity = (capacity + kAKKinematicsLaneCount - 1) / kAKKinematicsLaneCount * kAKKinematicsLaneCount;
+    if (capacity <= 0) {
+        return YES;
+    }
+    
+    batch->characters = calloc(capacity, sizeof(AKCharacter *));
+    if (!batch->characters) {
+        AKLog(1, @"位置計算の配列の確保に失敗:capacity=%d", capacity);
+        return NO;
+    }
+    
+    for (int i = 0; i < sizeof(arrays) / sizeof(arrays[0]); i++) {
+        
+        void *array = NULL;
+        if (posix_memalign(&array, kAKKinematicsAlignment, sizeof(float) * capacity) != 0) {
+            AKLog(1, @"位置計算の配列の確保に失敗:capacity=%d", capacity);
+            AKKinematicsRelease(batch);
+            return NO;
+        }
+        memset(array, 0, sizeof(float) * capacity);
+        *arrays[i] = array;
+    }
+    
+    batch->capacity = capacity;
+    
+    return YES;
+}
+
+/*!
+ @brief 配列の解放
+
+ 確保した配列を解放し、要素数を0にする。
+ @param batch 解放する配列
+ */
+void AKKinematicsRelease(struct AKKinematicsBatch *batch)
+{
+    free(batch->characters);
+    free(batch->absx);
+    free(batch->absy);
+    free(batch->angle);
+    free(batch->speed);
+    free(batch->rotSpeed);
+    free(batch->posx);
+    free(batch->posy);
+    memset(batch, 0, sizeof(struct AKKinematicsBatch));
+}
+
+/*!
+ @brief 位置の一括計算
+
+ 指定した範囲の要素について、速度による位置の計算を4要素ずつ行う。
+ キャラクターの位置の計算はintegrate:を含めてすべてこの関数で行い、計算結果を一致させる。
+ 速度によって向きと絶対座標を更新し、同じループでスクリーン座標を計算する。
+ 範囲が重ならなければ複数のスレッドから同時に呼び出せる。
+ @param batch 計算する配列
+ @param start 開始位置(一度に計算する要素の数の倍数)
+ @param end 終了位置(この位置は含まない)
+ @param param 移動計算パラメータ
+ */
+void AKKinematicsIntegrate(struct AKKinematicsBatch *batch, NSInteger start, NSInteger end,
+                           const struct AKMoveParam *param)
+{
+    assert(start % kAKKinematicsLaneCount == 0);
+    
+    const AKFloat4 dt = AKFloat4Splat(param->dt);
+    const AKFloat4 speedRatio = AKFloat4Splat(param->speedRatio);
+    const AKFloat4 scrx = AKFloat4Splat((float)param->scrx);
+    const AKFloat4 scry = AKFloat4Splat((float)param->scry);
+    const AKFloat4 halfScreenWidth = AKFloat4Splat(param->screenSize.width / 2);
+    const AKFloat4 halfScreenHeight = AKFloat4Splat(param->screenSize.height / 2);
+    const float stageWidth = param->stageSize.width;
+    const float stageHeight = param->stageSize.height;
+    
+    // 末尾の余りの要素も含めて4要素ずつ計算する。余りの要素の結果は使用しない。
+    for (NSInteger i = start; i < end; i += kAKKinematicsLaneCount) {
+        
+        AKFloat4 *absx = (AKFloat4 *)&batch->absx[i];
+        AKFloat4 *absy = (AKFloat4 *)&batch->absy[i];
+        AKFloat4 *angle = (AKFloat4 *)&batch->angle[i];
+        AKFloat4 speed = *(AKFloat4 *)&batch->speed[i];
+        AKFloat4 rotSpeed = *(AKFloat4 *)&batch->rotSpeed[i];
+        AKFloat4 sinAngle;
+        AKFloat4 cosAngle;
+        
+        // 向きを更新する
+        *angle += rotSpeed * dt;
+        
+        // 速度をx方向、y方向に分解し、iPadの場合は倍にする
+        AKFloat4SinCos(*angle, &sinAngle, &cosAngle);
+        AKFloat4 velx = speed * cosAngle * speedRatio;
+        AKFloat4 vely = speed * sinAngle * speedRatio;
+        
+        // 座標の移動
+        // ステージの範囲内に収まるように値を設定する
+        *absx = AKFloat4RangeCheck(*absx + velx * dt, 0.0f, stageWidth);
+        *absy = AKFloat4RangeCheck(*absy + vely * dt, 0.0f, stageHeight);
+        
+        // 表示位置の計算
+        // スクリーン位置中心からの距離 + スクリーンサイズの半分
+        *(AKFloat4 *)&batch->posx[i] = AKFloat4RangeCheck(*absx - scrx + halfScreenWidth,
+                                                          -(stageWidth / 2), stageWidth / 2);
+        *(AKFloat4 *)&batch->posy[i] = AKFloat4RangeCheck(*absy - scry + halfScreenHeight,
+                                                          -(stageHeight / 2), stageHeight / 2);
+    }
+}
+
+/*!
+ @brief スタック上の配列の初期化
+
+ スタック上に確保した領域を位置計算用の配列として使えるようにする。
+ @param stack スタック上の配列
+ */
+void AKKinematicsInitStackBatch(struct AKKinematicsStackBatch *stack)
+{
+    stack->batch.characters = stack->characters;
+    stack->batch.absx = stack->absx;
+    stack->batch.absy = stack->absy;
+    stack->batch.angle = stack->angle;
+    stack->batch.speed = stack->speed;
+    stack->batch.rotSpeed = stack->rotSpeed;
+    stack->batch.posx = stack->posx;
+    stack->batch.posy = stack->posy;
+    stack->batch.count = 0;
+    stack->batch.capacity = kAKKinematicsStackCount;
+}
+
+/*!
+ @brief 格納している要素の計算と書き戻し
+
+ 格納している全要素の位置をAKKinematicsIntegrateで計算し、各キャラクターに書き戻して配列を空にする。
+ 末尾の余りの要素は前回の値が残らないように0にしてから計算する。
+ @param batch 計算する配列
+ @param param 移動計算パラメータ
+ */
+void AKKinematicsFlush(struct AKKinematicsBatch *batch, const struct AKMoveParam *param)
+{
+    NSInteger count = batch->count;
+    if (count <= 0) {
+        return;
+    }
+    
+    // 末尾の余りの要素を0にする
+    NSInteger end = (count + kAKKinematicsLaneCount - 1) / kAKKinematicsLaneCount * kAKKinematicsLaneCount;
+    assert(end <= batch->capacity);
+    for (NSInteger i = count; i < end; i++) {
+        batch->absx[i] = 0.0f;
+        batch->absy[i] = 0.0f;
+        batch->angle[i] = 0.0f;
+        batch->speed[i] = 0.0f;
+        batch->rotSpeed[i] = 0.0f;
+    }
+    
+    // 計算して書き戻す
+    AKKinematicsIntegrate(batch, 0, count, param);
+    for (NSInteger i = 0; i < count; i++) {
+        [batch->characters[i] unpackKinematics:batch index:i];
+    }
+    
+    batch->count = 0;
+}
+
+#if AK_PROFILE
+/// 比較を行うキャラクターの数(通常モードの敵弾、負荷試験モードの敵、負荷試験モードの敵弾)
+static const NSInteger kAKBenchmarkSizes[] = {64, 512, 4096};
+/// 比較を行うフレーム数
+static const NSInteger kAKBenchmarkFrameCount = 600;
+
+/*!
+ @brief 比較用のキャラクター作成
+
+ 乱数で状態を設定したキャラクターを作成する。同じ乱数の種からは同じ状態を作成する。
+ @param count キャラクターの数
+ @param seed 乱数の種
+ @return キャラクターの配列
+ */
+static NSArray *AKKinematicsBenchmarkCharacters(NSInteger count, unsigned int seed)
+{
+    NSMutableArray *characters = [NSMutableArray arrayWithCapacity:count];
+    CGSize stageSize = [AKScreenSize stageSize];
+    
+    srand(seed);
+    for (int i = 0; i < count; i++) {
+        
+        AKCharacter *character = [[[AKCharacter alloc] init] autorelease];
+        character.absx = rand() % (int)stageSize.width;
+        character.absy = rand() % (int)stageSize.height;
+        character.angle = (rand() % 6283) / 1000.0f;
+        character.speed = 60 + rand() % 240;
+        character.rotSpeed = ((rand() % 2000) - 1000) / 1000.0f;
+        character.hitPoint = 1;
+        character.isStaged = YES;
+        [characters addObject:character];
+    }
+    
+    return characters;
+}
+
+/*!
+ @brief 2つのキャラクター群の差の最大値
+
+ 同じ順番のキャラクター同士の絶対座標、スクリーン座標、向きの差の最大値を求める。
+ @param a キャラクター群
+ @param b キャラクター群
+ @param position 座標の差の最大値
+ @param angle 向きの差の最大値
+ */
+static void AKKinematicsBenchmarkError(NSArray *a, NSArray *b, float *position, float *angle)
+{
+    *position = 0.0f;
+    *angle = 0.0f;
+    
+    for (int i = 0; i < [a count]; i++) {
+        
+        AKCharacter *ca = [a objectAtIndex:i];
+        AKCharacter *cb = [b objectAtIndex:i];
+        
+        *position = MAX(*position, fabsf(ca.absx - cb.absx));
+        *position = MAX(*position, fabsf(ca.absy - cb.absy));
+        *position = MAX(*position, fabsf(ca.screenPos.x - cb.screenPos.x));
+        *position = MAX(*position, fabsf(ca.screenPos.y - cb.screenPos.y));
+        *angle = MAX(*angle, fabsf(ca.angle - cb.angle));
+    }
+}
+
+/*!
+ @brief キャラクターごとの計算との比較
+
+ 同じ状態のキャラクター群について、キャラクターごとにintegrate:を呼ぶ場合(1要素ずつの計算)と
+ 配列に取り出して一括計算する場合の処理時間と計算結果の差を出力する。
+ どちらも同じ関数で計算するため、計算結果の差は0となる。
+ 一括計算の処理時間には配列への取り出しと書き戻しを含む。
+ 結果の差は1フレーム後と比較フレーム数経過後の値を出力する。
+ */
+void AKKinematicsBenchmark(void)
+{
+    mach_timebase_info_data_t info;
+    mach_timebase_info(&info);
+    
+    // 画面中央付近をスクリーン座標として1/60秒ずつ進める
+    CGSize stageSize = [AKScreenSize stageSize];
+    struct AKMoveParam param = AKMakeMoveParam(1.0f / 60.0f, stageSize.width / 2, stageSize.height / 2);
+    
+    for (int n = 0; n < sizeof(kAKBenchmarkSizes) / sizeof(kAKBenchmarkSizes[0]); n++) {
+        
+        NSInteger count = kAKBenchmarkSizes[n];
+        NSArray *objects = AKKinematicsBenchmarkCharacters(count, (unsigned int)count);
+        NSArray *batched = AKKinematicsBenchmarkCharacters(count, (unsigned int)count);
+        struct AKKinematicsBatch batch;
+        memset(&batch, 0, sizeof(batch));
+        AKKinematicsReserve(&batch, count);
+        
+        uint64_t objectTime = 0;
+        uint64_t batchTime = 0;
+        float firstPositionError = 0.0f;
+        float firstAngleError = 0.0f;
+        
+        for (int frame = 0; frame < kAKBenchmarkFrameCount; frame++) {
+            
+            // キャラクターごとの計算
+            uint64_t start = mach_absolute_time();
+            for (AKCharacter *character in objects) {
+                [character integrate:&param];
+            }
+            objectTime += mach_absolute_time() - start;
+            
+            // 一括計算
+            start = mach_absolute_time();
+            batch.count = 0;
+            for (AKCharacter *character in batched) {
+                [character packKinematics:&batch];
+            }
+            AKKinematicsIntegrate(&batch, 0, batch.count, &param);
+            for (NSInteger i = 0; i < batch.count; i++) {
+                [batch.characters[i] unpackKinematics:&batch index:i];
+            }
+            batchTime += mach_absolute_time() - start;
+            
+            // 1フレーム後の差を記録する
+            if (frame == 0) {
+                AKKinematicsBenchmarkError(objects, batched, &firstPositionError, &firstAngleError);
+            }
+        }
+        
+        float positionError = 0.0f;
+        float angleError = 0.0f;
+        AKKinematicsBenchmarkError(objects, batched, &positionError, &angleError);
+        
+        AKLog(1, @"kinematics n=%d object=%.2fus batch=%.2fus error(1)=%g/%g error(%d)=%g/%g",
+              count,
+              (double)objectTime * info.numer / info.denom / 1000.0 / kAKBenchmarkFrameCount,
+              (double)batchTime * info.numer / info.denom / 1000.0 / kAKBenchmarkFrameCount,
+              firstPositionError, firstAngleError,
+              kAKBenchmarkFrameCount, positionError, angleError);
+        
+        AKKinematicsRelease(&batch);
+    }
+}
+#endif
@@ -43,6 +43,11 @@ enum AKLabelFrame {
     kAKLabelFrameButton     ///< ボタン
 };
 
+/// char配列で設定する表示文字列の最大長
+enum {
+    kAKLabelCStringSize = 64
+};
+
 // ラベル表示クラス
 @interface AKLabel : CCNode <CCLabelProtocol> {
     /// 表示文字列
@@ -55,6 +60,8 @@ enum AKLabelFrame {
     enum AKLabelFrame frame_;
     /// 色反転するかどうか
     BOOL isReverse_;
+    /// char配列で設定した表示文字列
+    char cString_[kAKLabelCStringSize];
 }
 
 /// 表示文字列
@@ -84,5 +91,9 @@ enum AKLabelFrame {
 - (CGRect)rect;
 // 枠の生成
 - (void)createFrame;
+// char配列による表示文字列の設定
+- (void)setCString:(const char *)label;
+// 文字のスプライトの更新
+- (void)updateCharacters:(const unichar *)chars length:(NSInteger)length;
 
 @end
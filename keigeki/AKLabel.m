@@ -282,7 +282,7 @@ enum {
         [self createFrame];
         
         // 表示文字列を更新する
-        [self setString:self.labelString];
+        [self setString:self.string];
     }
 }
 
@@ -326,10 +326,15 @@ enum {
  @brief 表示文字列の取得
  
  表示文字列を取得する。
+ char配列で設定されている場合はNSStringに変換して返す。
  @return 表示文字列
  */
 - (NSString *)string
 {
+    if (labelString_ == nil) {
+        return [NSString stringWithUTF8String:cString_];
+    }
+    
     return labelString_;
 }
 
@@ -347,10 +352,61 @@ enum {
     assert(label.length <= length_ * line_);
     
     // パラメータをメンバに設定する
-    if (![self.labelString isEqualToString:label]) {
+    if (![labelString_ isEqualToString:label]) {
         self.labelString = [[label copy] autorelease];
     }
     
+    // 文字列を取り出して各文字のスプライトを変更する
+    NSInteger length = label.length;
+    unichar chars[MAX(length, 1)];
+    [label getCharacters:chars range:NSMakeRange(0, length)];
+    [self updateCharacters:chars length:length];
+}
+
+/*!
+ @brief char配列による表示文字列の設定
+ 
+ 表示文字列をchar配列で指定して設定する。
+ 毎フレーム更新する表示で使用するため、NSStringを生成せず、前回と同じ文字列の場合は何もしない。
+ ASCII文字のみを扱う。
+ @param label 表示文字列
+ */
+- (void)setCString:(const char *)label
+{
+    // 文字列が保持できる長さを超えている場合はエラー
+    assert(strlen(label) < kAKLabelCStringSize);
+    
+    // 前回char配列で設定した文字列と同じ場合は何もしない
+    if (labelString_ == nil && strcmp(cString_, label) == 0) {
+        return;
+    }
+    
+    // パラメータをメンバに設定する
+    self.labelString = nil;
+    strlcpy(cString_, label, sizeof(cString_));
+    
+    // 文字を変換して各文字のスプライトを変更する
+    unichar chars[kAKLabelCStringSize];
+    NSInteger length = 0;
+    for (length = 0; cString_[length] != '\0'; length++) {
+        chars[length] = (unsigned char)cString_[length];
+    }
+    
+    // 文字列が表示可能文字数を超えている場合はエラー
+    assert(length <= length_ * line_);
+    
+    [self updateCharacters:chars length:length];
+}
+
+/*!
+ @brief 文字のスプライトの更新
+ 
+ 各文字のスプライトを表示文字列の文字に差し替える。
+ @param chars 表示文字列
+ @param length 表示文字列の長さ
+ */
+- (void)updateCharacters:(const unichar *)chars length:(NSInteger)length
+{
     // 各文字のスプライトを変更する
     int charpos = 0;
     BOOL isNewLine = NO;
@@ -367,8 +423,8 @@ enum {
             unichar c = ' ';
             
             // 改行されておらず、文字列がまだ残っている場合、1文字切り出す
-            if (!isNewLine && charpos < self.labelString.length) {
-                c = [self.labelString characterAtIndex:charpos];
+            if (!isNewLine && charpos < length) {
+                c = chars[charpos];
                 charpos++;
                 
                 // 改行文字の場合はブランクに置き換え、改行フラグを立てる
@@ -384,7 +440,7 @@ enum {
             
             AKLog(0, @"x=%d y=%d c=%C", x, y, c);
             
-            // フォントクラスからスプライトフレームを生成する
+            // フォントクラスからスプライトフレームを取得する
             CCSpriteFrame *charSpriteFrame = [[AKFont sharedInstance] spriteFrameOfChar:c isReverse:self.isReverse];
             
             // スプライトを差し替える
@@ -392,23 +448,12 @@ enum {
         }
         
         // 行末の改行文字は飛ばす
-        if (charpos < self.labelString.length && [self.labelString characterAtIndex:charpos] == '\n') {
+        if (charpos < length && chars[charpos] == '\n') {
             charpos++;
         }
     }
 }
 
-/*!
- @brief char配列による表示文字列の設定
- 
- 表示文字列をchar配列で指定して設定する。
- @param 表示文字列
- */
-- (void)setCString:(char *)label
-{
-    [self setString:[NSString stringWithUTF8String:label]];
-}
-
 /*!
  @brief ラベルの幅の取得
  
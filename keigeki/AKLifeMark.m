@@ -34,6 +34,7 @@
  */
 
 #import "AKLifeMark.h"
+#import "AKTextureManager.h"
 #import "AKScreenSize.h"
 
 /// 残機マーク表示位置、左からの位置
@@ -111,7 +112,7 @@ static const NSInteger kAKLifeMarkInterval = 20;
         for (i = 0; i < life - imageCount; i++) {
             
             // 画像を読み込む
-            image = [CCSprite spriteWithFile:@"Life.png"];
+            image = [CCSprite spriteWithTexture:[[AKTextureManager sharedManager] textureForFile:@"Life.png"]];
             assert(image != nil);
             
             // 画像のx座標は原点から右側に現在の個数分ずらした位置とする
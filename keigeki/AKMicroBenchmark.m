@@ -0,0 +1,734 @@
+/*
+ * Copyright (c) 2012-2013 Akihiro Kaneda.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   1.Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   2.Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ *   3.Neither the name of the Monochrome Soft nor the names of its contributors
+ *     may be used to endorse or promote products derived from this software
+ *     without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+/*!
+ @file AKMicroBenchmark.m
+ @brief 基本処理の性能計測
+
+ 計算処理やプールなど、毎フレーム呼ばれる基本処理の1回あたりの処理時間を計測する処理を定義する。
+ */
+
+#import "AKMicroBenchmark.h"
+
+#if AK_PROFILE
+#import <mach/mach_time.h>
+#import "AKCommon.h"
+#import "AKCharacter.h"
+#import "AKCharacterPool.h"
+#import "AKLabel.h"
+#import "AKGameScene.h"
+
+/// 入力値の配列のサイズ(2の累乗)
+enum {
+    kAKBenchInputCount = 64
+};
+
+/// 1つの計測項目で取るサンプル数
+enum {
+    kAKBenchSampleCount = 20
+};
+
+/// 1サンプルの計測時間の下限(ナノ秒)
+static const double kAKBenchMinSampleTime = 2.0e6;
+/// 1サンプルの繰り返し回数の上限
+static const NSInteger kAKBenchMaxIterations = 1 << 22;
+/// サンプル数20での95%信頼区間のt値(自由度19)
+static const double kAKBenchT95 = 2.093;
+/// 判定を行う性能低下の割合の初期値(パーセント)
+static const double kAKBenchDefaultThreshold = 10.0;
+/// 計測用のステージの幅
+static const float kAKBenchStageSize = 1024.0f;
+/// プールと当たり判定の計測に使うキャラクターの数
+static const NSInteger kAKBenchCharacterCount = 64;
+/// n-way弾の計測に使う弾の数の最大値
+enum {
+    kAKBenchMaxNWayCount = 32
+};
+/// 計測結果のファイル名
+static NSString *kAKBenchResultFileName = @"microbench.json";
+/// 基準値のファイル名
+static NSString *kAKBenchBaselineFileName = @"microbench-baseline.json";
+/// 計測結果を基準値として保存することを指定する設定のキー
+static NSString *kAKBenchRecordKey = @"AKMicroBenchmarkRecord";
+/// 判定を行う性能低下の割合を指定する設定のキー(パーセント)
+static NSString *kAKBenchThresholdKey = @"AKMicroBenchmarkThreshold";
+/// 計測結果の1回あたりの処理時間のキー
+static NSString *kAKBenchNsKey = @"ns";
+/// 計測結果の95%信頼区間の幅の半分のキー
+static NSString *kAKBenchCiKey = @"ci";
+/// 計測結果の1サンプルの繰り返し回数のキー
+static NSString *kAKBenchIterationsKey = @"iterations";
+
+/// 計測処理
+typedef void (*AKBenchFunc)(NSInteger iterations);
+
+/// 最適化で計算が省略されないように結果を書き込む先
+static volatile float AKBenchSink = 0.0f;
+/// 範囲内の座標
+static float AKBenchInside[kAKBenchInputCount];
+/// 範囲の境界をわずかに超えた座標
+static float AKBenchSeam[kAKBenchInputCount];
+/// 範囲から大きく外れた座標
+static float AKBenchFar[kAKBenchInputCount];
+/// 角度
+static float AKBenchAngle[kAKBenchInputCount];
+/// 空きのあるプール
+static AKCharacterPool *AKBenchFreePool = nil;
+/// 空きのないプール
+static AKCharacterPool *AKBenchFullPool = nil;
+/// 当たり判定を行うキャラクター
+static AKCharacter *AKBenchHitter = nil;
+/// 重なっていない判定対象
+static NSArray *AKBenchMissTargets = nil;
+/// すべて重なっている判定対象
+static NSArray *AKBenchHitTargets = nil;
+/// 文字列を設定するラベル
+static AKLabel *AKBenchLabel = nil;
+/// ラベルに設定する文字列
+static NSString *AKBenchLabelStrings[2] = {nil, nil};
+/// ステージ構成スクリプトの行
+static NSArray *AKBenchScriptLines = nil;
+
+/*!
+ @brief 変更前の範囲チェック(ループ、 実数)
+
+ 比較用に残した変更前の実装。範囲外の場合は1周ずつ再帰でずらす。
+ @param val 値
+ @param min 最小値
+ @param max 最大値
+ @return 補正結果
+ */
+__attribute__((noinline)) static float AKBenchLegacyRangeCheckLF(float val, float min, float max)
+{
+    if (val < min) {
+        return AKBenchLegacyRangeCheckLF(val + (max - min), min, max);
+    }
+    else if (val > max) {
+        return AKBenchLegacyRangeCheckLF(val - (max - min), min, max);
+    }
+    else {
+        return val;
+    }
+}
+
+/*!
+ @brief 変更前の回転方向の計算
+
+ 比較用に残した変更前の実装。三角関数を倍精度で計算する。
+ @param angle 現在の角度
+ @param srcx 現在x座標
+ @param srcy 現在y座標
+ @param dstx 目標x座標
+ @param dsty 目標y座標
+ @return 回転方向
+ */
+__attribute__((noinline)) static int AKBenchLegacyCalcRotDirect(float angle, float srcx, float srcy, float dstx, float dsty)
+{
+    float destangle = AKCalcDestAngle(srcx, srcy, dstx, dsty);
+    float destsin = sin(destangle - angle);
+
+    if (destsin > 0.0f) {
+        return 1;
+    }
+    else if (destsin < 0.0f) {
+        return -1;
+    }
+    else {
+        return (cos(destangle - angle) < 0.0f) ? 1 : 0;
+    }
+}
+
+/*!
+ @brief 変更前のn-way弾発射時の方向計算
+
+ 比較用に残した変更前の実装。角度をNSNumberの配列で返す。
+ @param count 弾の数
+ @param centerAngle n-way弾の中心の角度
+ @param space 2点間の間隔
+ @return 角度の配列
+ */
+__attribute__((noinline)) static NSArray *AKBenchLegacyCalcNWayAngle(int count, float centerAngle, float space)
+{
+    NSMutableArray *angleArray = [NSMutableArray arrayWithCapacity:count];
+    float minAngle = centerAngle - (space * (count - 1)) / 2.0f;
+
+    for (int i = 0; i < count; i++) {
+        [angleArray addObject:[NSNumber numberWithFloat:minAngle + i * space]];
+    }
+
+    return angleArray;
+}
+
+/// 範囲チェック(範囲内)
+static void AKBenchRangeCheckInside(NSInteger iterations)
+{
+    float sum = 0.0f;
+    for (NSInteger i = 0; i < iterations; i++) {
+        sum += AKRangeCheckLF(AKBenchInside[i & (kAKBenchInputCount - 1)], 0.0f, kAKBenchStageSize);
+    }
+    AKBenchSink = sum;
+}
+
+/// 範囲チェック(境界をわずかに超えた値)
+static void AKBenchRangeCheckSeam(NSInteger iterations)
+{
+    float sum = 0.0f;
+    for (NSInteger i = 0; i < iterations; i++) {
+        sum += AKRangeCheckLF(AKBenchSeam[i & (kAKBenchInputCount - 1)], 0.0f, kAKBenchStageSize);
+    }
+    AKBenchSink = sum;
+}
+
+/// 範囲チェック(大きく外れた値)
+static void AKBenchRangeCheckFar(NSInteger iterations)
+{
+    float sum = 0.0f;
+    for (NSInteger i = 0; i < iterations; i++) {
+        sum += AKRangeCheckLF(AKBenchFar[i & (kAKBenchInputCount - 1)], 0.0f, kAKBenchStageSize);
+    }
+    AKBenchSink = sum;
+}
+
+/// 変更前の範囲チェック(範囲内)
+static void AKBenchLegacyRangeCheckInside(NSInteger iterations)
+{
+    float sum = 0.0f;
+    for (NSInteger i = 0; i < iterations; i++) {
+        sum += AKBenchLegacyRangeCheckLF(AKBenchInside[i & (kAKBenchInputCount - 1)], 0.0f, kAKBenchStageSize);
+    }
+    AKBenchSink = sum;
+}
+
+/// 変更前の範囲チェック(境界をわずかに超えた値)
+static void AKBenchLegacyRangeCheckSeam(NSInteger iterations)
+{
+    float sum = 0.0f;
+    for (NSInteger i = 0; i < iterations; i++) {
+        sum += AKBenchLegacyRangeCheckLF(AKBenchSeam[i & (kAKBenchInputCount - 1)], 0.0f, kAKBenchStageSize);
+    }
+    AKBenchSink = sum;
+}
+
+/// 変更前の範囲チェック(大きく外れた値)
+static void AKBenchLegacyRangeCheckFar(NSInteger iterations)
+{
+    float sum = 0.0f;
+    for (NSInteger i = 0; i < iterations; i++) {
+        sum += AKBenchLegacyRangeCheckLF(AKBenchFar[i & (kAKBenchInputCount - 1)], 0.0f, kAKBenchStageSize);
+    }
+    AKBenchSink = sum;
+}
+
+/// 2点間の角度計算(通常)
+static void AKBenchCalcDestAngle(NSInteger iterations)
+{
+    float sum = 0.0f;
+    for (NSInteger i = 0; i < iterations; i++) {
+        float x = AKBenchInside[i & (kAKBenchInputCount - 1)];
+        sum += AKCalcDestAngle(0.0f, 0.0f, x - 512.0f, 300.0f - x);
+    }
+    AKBenchSink = sum;
+}
+
+/// 2点間の角度計算(x座標が等しい場合)
+static void AKBenchCalcDestAngleVertical(NSInteger iterations)
+{
+    float sum = 0.0f;
+    for (NSInteger i = 0; i < iterations; i++) {
+        sum += AKCalcDestAngle(0.0f, 0.0f, 0.0f, AKBenchInside[i & (kAKBenchInputCount - 1)] - 512.0f);
+    }
+    AKBenchSink = sum;
+}
+
+/// 回転方向の計算
+static void AKBenchCalcRotDirect(NSInteger iterations)
+{
+    float sum = 0.0f;
+    for (NSInteger i = 0; i < iterations; i++) {
+        sum += AKCalcRotDirect(AKBenchAngle[i & (kAKBenchInputCount - 1)], 0.0f, 0.0f, 100.0f, 50.0f);
+    }
+    AKBenchSink = sum;
+}
+
+/// 変更前の回転方向の計算
+static void AKBenchLegacyCalcRotDirect(NSInteger iterations)
+{
+    float sum = 0.0f;
+    for (NSInteger i = 0; i < iterations; i++) {
+        sum += AKBenchLegacyCalcRotDirect(AKBenchAngle[i & (kAKBenchInputCount - 1)], 0.0f, 0.0f, 100.0f, 50.0f);
+    }
+    AKBenchSink = sum;
+}
+
+/// 角度の変換
+static void AKBenchCnvAngleRad2Scr(NSInteger iterations)
+{
+    float sum = 0.0f;
+    for (NSInteger i = 0; i < iterations; i++) {
+        sum += AKCnvAngleRad2Scr(AKBenchAngle[i & (kAKBenchInputCount - 1)]);
+    }
+    AKBenchSink = sum;
+}
+
+/*!
+ @brief n-way弾発射時の方向計算の計測
+
+ 指定した弾の数で方向を計算する。
+ @param iterations 繰り返し回数
+ @param count 弾の数
+ */
+static void AKBenchCalcNWayAnglesOfCount(NSInteger iterations, int count)
+{
+    float angles[kAKBenchMaxNWayCount];
+    float sum = 0.0f;
+    for (NSInteger i = 0; i < iterations; i++) {
+        AKCalcNWayAngles(count, AKBenchAngle[i & (kAKBenchInputCount - 1)], 0.1f, angles);
+        sum += angles[count - 1];
+    }
+    AKBenchSink = sum;
+}
+
+/*!
+ @brief 変更前のn-way弾発射時の方向計算の計測
+
+ 指定した弾の数で方向を計算する。生成したオブジェクトは一定回数ごとに解放する。
+ @param iterations 繰り返し回数
+ @param count 弾の数
+ */
+static void AKBenchLegacyCalcNWayAngleOfCount(NSInteger iterations, int count)
+{
+    float sum = 0.0f;
+    NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+    for (NSInteger i = 0; i < iterations; i++) {
+        NSArray *angles = AKBenchLegacyCalcNWayAngle(count, AKBenchAngle[i & (kAKBenchInputCount - 1)], 0.1f);
+        sum += [[angles lastObject] floatValue];
+
+        if ((i & 255) == 255) {
+            [pool drain];
+            pool = [[NSAutoreleasePool alloc] init];
+        }
+    }
+    [pool drain];
+    AKBenchSink = sum;
+}
+
+/// n-way弾発射時の方向計算(3-way)
+static void AKBenchCalcNWayAngles3(NSInteger iterations)
+{
+    AKBenchCalcNWayAnglesOfCount(iterations, 3);
+}
+
+/// n-way弾発射時の方向計算(最大数)
+static void AKBenchCalcNWayAnglesMax(NSInteger iterations)
+{
+    AKBenchCalcNWayAnglesOfCount(iterations, kAKBenchMaxNWayCount);
+}
+
+/// 変更前のn-way弾発射時の方向計算(3-way)
+static void AKBenchLegacyCalcNWayAngle3(NSInteger iterations)
+{
+    AKBenchLegacyCalcNWayAngleOfCount(iterations, 3);
+}
+
+/// 変更前のn-way弾発射時の方向計算(最大数)
+static void AKBenchLegacyCalcNWayAngleMax(NSInteger iterations)
+{
+    AKBenchLegacyCalcNWayAngleOfCount(iterations, kAKBenchMaxNWayCount);
+}
+
+/// 未使用キャラクター取得(空きがある場合)
+static void AKBenchGetNextFree(NSInteger iterations)
+{
+    NSInteger count = 0;
+    for (NSInteger i = 0; i < iterations; i++) {
+        count += ([AKBenchFreePool getNext] != nil);
+    }
+    AKBenchSink = count;
+}
+
+/// 未使用キャラクター取得(空きがない場合)
+static void AKBenchGetNextFull(NSInteger iterations)
+{
+    NSInteger count = 0;
+    for (NSInteger i = 0; i < iterations; i++) {
+        count += ([AKBenchFullPool getNext] != nil);
+    }
+    AKBenchSink = count;
+}
+
+/// 当たり判定(重なっていない場合)
+static void AKBenchHitMiss(NSInteger iterations)
+{
+    for (NSInteger i = 0; i < iterations; i++) {
+        [AKBenchHitter hit:[AKBenchMissTargets objectEnumerator]];
+    }
+}
+
+/// 当たり判定(すべて重なっている場合)
+static void AKBenchHitAll(NSInteger iterations)
+{
+    for (NSInteger i = 0; i < iterations; i++) {
+        [AKBenchHitter hit:[AKBenchHitTargets objectEnumerator]];
+    }
+}
+
+/// ラベルの文字列設定(同じ文字列)
+static void AKBenchLabelSame(NSInteger iterations)
+{
+    for (NSInteger i = 0; i < iterations; i++) {
+        [AKBenchLabel setString:AKBenchLabelStrings[0]];
+    }
+}
+
+/// ラベルの文字列設定(異なる文字列)
+static void AKBenchLabelChanged(NSInteger iterations)
+{
+    for (NSInteger i = 0; i < iterations; i++) {
+        [AKBenchLabel setString:AKBenchLabelStrings[i & 1]];
+    }
+}
+
+/// ステージ構成スクリプトの1行の解析
+static void AKBenchParseStageScript(NSInteger iterations)
+{
+    NSInteger lineCount = [AKBenchScriptLines count];
+    NSInteger sum = 0;
+    NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+    for (NSInteger i = 0; i < iterations; i++) {
+
+        enum AKEnemyType type = 0;
+        NSInteger x = 0;
+        NSInteger y = 0;
+        if (AKParseStageScriptLine([AKBenchScriptLines objectAtIndex:i % lineCount], &type, &x, &y)) {
+            sum += type + x + y;
+        }
+
+        if ((i & 255) == 255) {
+            [pool drain];
+            pool = [[NSAutoreleasePool alloc] init];
+        }
+    }
+    [pool drain];
+    AKBenchSink = sum;
+}
+
+/*!
+ @brief 計測対象の準備
+
+ 入力値の配列、プール、判定対象、ラベル、ステージ構成スクリプトの行を作成する。
+ 同じ内容で毎回計測できるように乱数は使用しない。
+ */
+static void AKBenchSetUp(void)
+{
+    // 座標と角度
+    for (int i = 0; i < kAKBenchInputCount; i++) {
+        AKBenchInside[i] = (i * 37) % (int)kAKBenchStageSize;
+        AKBenchSeam[i] = (i & 1) ? -0.5f - i * 0.1f : kAKBenchStageSize + 0.5f + i * 0.1f;
+        AKBenchFar[i] = (i & 1) ? -50.0f * kAKBenchStageSize - i : 51.0f * kAKBenchStageSize + i;
+        AKBenchAngle[i] = ((i * 97) % 628) / 100.0f;
+    }
+
+    // 空きのあるプールは全キャラクターを生成して未配置のままにする
+    AKBenchFreePool = [[AKCharacterPool alloc] initWithClass:[AKCharacter class] Size:kAKBenchCharacterCount];
+    for (int i = 0; i < kAKBenchCharacterCount; i++) {
+        [AKBenchFreePool addCharacter];
+    }
+
+    // 空きのないプールは全キャラクターを配置済みにし、空きがなければ生成しない設定にする
+    AKBenchFullPool = [[AKCharacterPool alloc] initWithClass:[AKCharacter class] Size:kAKBenchCharacterCount];
+    AKBenchFullPool.policy = kAKPoolOverflowDropNewest;
+    for (int i = 0; i < kAKBenchCharacterCount; i++) {
+        [AKBenchFullPool addCharacter].isStaged = YES;
+    }
+
+    // 当たり判定
+    AKBenchHitter = [[AKCharacter alloc] init];
+    AKBenchHitter.width = 16;
+    AKBenchHitter.height = 16;
+    AKBenchHitter.isStaged = YES;
+    NSMutableArray *missTargets = [NSMutableArray arrayWithCapacity:kAKBenchCharacterCount];
+    NSMutableArray *hitTargets = [NSMutableArray arrayWithCapacity:kAKBenchCharacterCount];
+    for (int i = 0; i < kAKBenchCharacterCount; i++) {
+
+        AKCharacter *miss = [[[AKCharacter alloc] init] autorelease];
+        miss.width = 16;
+        miss.height = 16;
+        miss.screenPos = ccp(100.0f + i * 20.0f, 100.0f);
+        miss.isStaged = YES;
+        [missTargets addObject:miss];
+
+        AKCharacter *hit = [[[AKCharacter alloc] init] autorelease];
+        hit.width = 16;
+        hit.height = 16;
+        hit.screenPos = ccp((i % 8) - 4.0f, (i / 8) - 4.0f);
+        hit.isStaged = YES;
+        [hitTargets addObject:hit];
+    }
+    AKBenchMissTargets = [missTargets retain];
+    AKBenchHitTargets = [hitTargets retain];
+
+    // ラベル
+    AKBenchLabelStrings[0] = @"HI:012345";
+    AKBenchLabelStrings[1] = @"HI:067890";
+    AKBenchLabel = [[AKLabel alloc] initWithString:AKBenchLabelStrings[0]
+                                         maxLength:[AKBenchLabelStrings[0] length]
+                                           maxLine:1
+                                             frame:kAKLabelFrameNone];
+
+    // バンドル内のステージ構成スクリプトをすべて行に分割する
+    NSMutableArray *lines = [NSMutableArray array];
+    for (int stage = 1; ; stage++) {
+
+        NSString *filePath = [[NSBundle mainBundle] pathForResource:[NSString stringWithFormat:@"stage%d_1", stage]
+                                                             ofType:@"txt"];
+        if (filePath == nil) {
+            break;
+        }
+
+        for (int wave = 1; ; wave++) {
+
+            filePath = [[NSBundle mainBundle] pathForResource:[NSString stringWithFormat:@"stage%d_%d", stage, wave]
+                                                       ofType:@"txt"];
+            NSString *script = [NSString stringWithContentsOfFile:filePath encoding:NSUTF8StringEncoding error:NULL];
+            if (script == nil) {
+                break;
+            }
+
+            NSRange lineRange = {0};
+            while (lineRange.location < script.length) {
+                lineRange = [script lineRangeForRange:lineRange];
+                [lines addObject:[script substringWithRange:lineRange]];
+                lineRange.location = lineRange.location + lineRange.length;
+                lineRange.length = 0;
+            }
+        }
+    }
+    AKBenchScriptLines = [lines retain];
+}
+
+/*!
+ @brief 計測対象の解放
+
+ 計測対象の準備で作成したオブジェクトを解放する。
+ */
+static void AKBenchTearDown(void)
+{
+    [AKBenchFreePool release];
+    AKBenchFreePool = nil;
+    [AKBenchFullPool release];
+    AKBenchFullPool = nil;
+    [AKBenchHitter release];
+    AKBenchHitter = nil;
+    [AKBenchMissTargets release];
+    AKBenchMissTargets = nil;
+    [AKBenchHitTargets release];
+    AKBenchHitTargets = nil;
+    [AKBenchLabel release];
+    AKBenchLabel = nil;
+    [AKBenchScriptLines release];
+    AKBenchScriptLines = nil;
+}
+
+/*!
+ @brief 処理時間の計測
+
+ 1サンプルの計測時間が下限を超えるまで繰り返し回数を倍にしてから、
+ 決めた回数でサンプル数分計測し、1回あたりの処理時間の平均と95%信頼区間を求める。
+ @param name 計測項目名
+ @param func 計測処理
+ @param results 計測結果の格納先
+ */
+static void AKBenchRun(NSString *name, AKBenchFunc func, NSMutableDictionary *results)
+{
+    mach_timebase_info_data_t info;
+    mach_timebase_info(&info);
+
+    // 繰り返し回数を決める(1回目は暖機を兼ねる)
+    NSInteger iterations = 1;
+    for (;;) {
+        uint64_t start = mach_absolute_time();
+        func(iterations);
+        double elapsed = (double)(mach_absolute_time() - start) * info.numer / info.denom;
+        if (elapsed >= kAKBenchMinSampleTime || iterations >= kAKBenchMaxIterations) {
+            break;
+        }
+        iterations *= 2;
+    }
+
+    // サンプルを取る
+    double samples[kAKBenchSampleCount];
+    double mean = 0.0;
+    for (int i = 0; i < kAKBenchSampleCount; i++) {
+        uint64_t start = mach_absolute_time();
+        func(iterations);
+        samples[i] = (double)(mach_absolute_time() - start) * info.numer / info.denom / iterations;
+        mean += samples[i];
+    }
+    mean /= kAKBenchSampleCount;
+
+    // 標本標準偏差から95%信頼区間を求める
+    double variance = 0.0;
+    for (int i = 0; i < kAKBenchSampleCount; i++) {
+        variance += (samples[i] - mean) * (samples[i] - mean);
+    }
+    variance /= kAKBenchSampleCount - 1;
+    double ci = kAKBenchT95 * sqrt(variance / kAKBenchSampleCount);
+
+    AKLog(1, @"bench %@ %.2f ns/op +/- %.2f (%d x %d)", name, mean, ci, kAKBenchSampleCount, iterations);
+
+    [results setObject:[NSDictionary dictionaryWithObjectsAndKeys:
+                        [NSNumber numberWithDouble:mean], kAKBenchNsKey,
+                        [NSNumber numberWithDouble:ci], kAKBenchCiKey,
+                        [NSNumber numberWithInteger:iterations], kAKBenchIterationsKey,
+                        nil]
+                forKey:name];
+}
+
+/*!
+ @brief 基準値との比較
+
+ 基準値より指定割合以上遅くなっており、その差が両方の信頼区間を合わせた幅より大きい項目を性能低下とする。
+ 基準値にない項目は判定しない。
+ @param results 計測結果
+ @param baseline 基準値
+ @param threshold 性能低下とする割合(パーセント)
+ @return 性能低下がない場合YES
+ */
+static BOOL AKBenchCompare(NSDictionary *results, NSDictionary *baseline, double threshold)
+{
+    BOOL isPassed = YES;
+
+    for (NSString *name in [[baseline allKeys] sortedArrayUsingSelector:@selector(compare:)]) {
+
+        NSDictionary *current = [results objectForKey:name];
+        if (current == nil) {
+            continue;
+        }
+
+        NSDictionary *base = [baseline objectForKey:name];
+        double currentNs = [[current objectForKey:kAKBenchNsKey] doubleValue];
+        double currentCi = [[current objectForKey:kAKBenchCiKey] doubleValue];
+        double baseNs = [[base objectForKey:kAKBenchNsKey] doubleValue];
+        double baseCi = [[base objectForKey:kAKBenchCiKey] doubleValue];
+
+        if (currentNs > baseNs * (1.0 + threshold / 100.0) &&
+            currentNs - currentCi > baseNs + baseCi) {
+
+            AKLog(1, @"bench regression %@: %.2f ns/op -> %.2f ns/op (+%.1f%%)",
+                  name, baseNs, currentNs, (currentNs / baseNs - 1.0) * 100.0);
+            isPassed = NO;
+        }
+    }
+
+    return isPassed;
+}
+
+/*!
+ @brief 基本処理の性能計測
+
+ 範囲チェック、角度計算、n-way弾の方向計算、プールからの取得、当たり判定、ラベルの文字列設定、
+ ステージ構成スクリプトの解析について、通常の入力と最悪の入力で1回あたりの処理時間を計測する。
+ 範囲チェック、回転方向、n-way弾の方向計算は変更前の実装も計測し、変更の効果を比較できるようにする。
+ 計測結果はDocumentsディレクトリにJSONで書き出す。
+ 起動引数"-AKMicroBenchmarkRecord YES"が指定されている場合は計測結果を基準値として保存する。
+ 指定されていない場合は基準値があれば比較し、"-AKMicroBenchmarkThreshold"で指定した割合(パーセント)以上の
+ 性能低下があれば失敗とする。
+ @return 性能低下がない場合YES
+ */
+BOOL AKMicroBenchmark(void)
+{
+    NSUserDefaults *userDefaults = [NSUserDefaults standardUserDefaults];
+    NSString *docDir = [NSHomeDirectory() stringByAppendingPathComponent:@"Documents"];
+    NSString *resultPath = [docDir stringByAppendingPathComponent:kAKBenchResultFileName];
+    NSString *baselinePath = [docDir stringByAppendingPathComponent:kAKBenchBaselineFileName];
+
+    AKBenchSetUp();
+
+    // 計測する
+    NSMutableDictionary *results = [NSMutableDictionary dictionary];
+    AKBenchRun(@"AKRangeCheckLF.inside", AKBenchRangeCheckInside, results);
+    AKBenchRun(@"AKRangeCheckLF.seam", AKBenchRangeCheckSeam, results);
+    AKBenchRun(@"AKRangeCheckLF.far", AKBenchRangeCheckFar, results);
+    AKBenchRun(@"legacy.AKRangeCheckLF.inside", AKBenchLegacyRangeCheckInside, results);
+    AKBenchRun(@"legacy.AKRangeCheckLF.seam", AKBenchLegacyRangeCheckSeam, results);
+    AKBenchRun(@"legacy.AKRangeCheckLF.far", AKBenchLegacyRangeCheckFar, results);
+    AKBenchRun(@"AKCalcDestAngle.typical", AKBenchCalcDestAngle, results);
+    AKBenchRun(@"AKCalcDestAngle.vertical", AKBenchCalcDestAngleVertical, results);
+    AKBenchRun(@"AKCalcRotDirect.typical", AKBenchCalcRotDirect, results);
+    AKBenchRun(@"legacy.AKCalcRotDirect.typical", AKBenchLegacyCalcRotDirect, results);
+    AKBenchRun(@"AKCnvAngleRad2Scr.typical", AKBenchCnvAngleRad2Scr, results);
+    AKBenchRun(@"AKCalcNWayAngles.3", AKBenchCalcNWayAngles3, results);
+    AKBenchRun(@"AKCalcNWayAngles.32", AKBenchCalcNWayAnglesMax, results);
+    AKBenchRun(@"legacy.AKCalcNWayAngle.3", AKBenchLegacyCalcNWayAngle3, results);
+    AKBenchRun(@"legacy.AKCalcNWayAngle.32", AKBenchLegacyCalcNWayAngleMax, results);
+    AKBenchRun(@"AKCharacterPool.getNext.free", AKBenchGetNextFree, results);
+    AKBenchRun(@"AKCharacterPool.getNext.full", AKBenchGetNextFull, results);
+    AKBenchRun(@"AKCharacter.hit.miss64", AKBenchHitMiss, results);
+    AKBenchRun(@"AKCharacter.hit.all64", AKBenchHitAll, results);
+    AKBenchRun(@"AKLabel.setString.same", AKBenchLabelSame, results);
+    AKBenchRun(@"AKLabel.setString.changed", AKBenchLabelChanged, results);
+    AKBenchRun(@"AKParseStageScriptLine.line", AKBenchParseStageScript, results);
+
+    AKBenchTearDown();
+
+    // 計測結果を書き出す
+    NSData *json = [NSJSONSerialization dataWithJSONObject:results options:NSJSONWritingPrettyPrinted error:NULL];
+    [json writeToFile:resultPath atomically:YES];
+    AKLog(1, @"bench result: %@", resultPath);
+
+    // 基準値として保存する場合は比較しない
+    if ([userDefaults boolForKey:kAKBenchRecordKey]) {
+        [json writeToFile:baselinePath atomically:YES];
+        AKLog(1, @"bench baseline recorded: %@", baselinePath);
+        return YES;
+    }
+
+    // 基準値がない場合は比較しない
+    NSData *baselineData = [NSData dataWithContentsOfFile:baselinePath];
+    if (baselineData == nil) {
+        AKLog(1, @"bench baseline not found: %@", baselinePath);
+        return YES;
+    }
+    NSDictionary *baseline = [NSJSONSerialization JSONObjectWithData:baselineData options:0 error:NULL];
+    if (![baseline isKindOfClass:[NSDictionary class]]) {
+        AKLog(1, @"bench baseline is invalid: %@", baselinePath);
+        return NO;
+    }
+
+    // 基準値と比較する
+    double threshold = kAKBenchDefaultThreshold;
+    if ([userDefaults objectForKey:kAKBenchThresholdKey] != nil) {
+        threshold = [userDefaults doubleForKey:kAKBenchThresholdKey];
+    }
+    BOOL isPassed = AKBenchCompare(results, baseline, threshold);
+
+    AKLog(1, @"bench %@ (threshold=%.1f%%)", isPassed ? @"passed" : @"FAILED", threshold);
+
+    return isPassed;
+}
+#endif
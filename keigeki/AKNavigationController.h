@@ -35,20 +35,17 @@
 
 #import <UIKit/UIKit.h>
 #import <GameKit/GameKit.h>
-#import "GADBannerView.h"
-#import "GADBannerViewDelegate.h"
 
 // UINavigationControllerのカスタマイズ
 @interface AKNavigationController : UINavigationController<GKLeaderboardViewControllerDelegate,
-    GKAchievementViewControllerDelegate, GADBannerViewDelegate> {
+    GKAchievementViewControllerDelegate> {
     
-    /// 広告バナー
-    GADBannerView *bannerView_;
+    /// 広告バナーの表示を開始したかどうか
+    BOOL isAdStarted_;
 }
 
-/// 広告バナー
-@property (nonatomic, retain)GADBannerView *bannerView;
-
+// 広告バナーの表示開始
+- (void)startAdBanner;
 // 広告バナーを作成
 - (void)createAdBanner;
 // 広告バナーを削除
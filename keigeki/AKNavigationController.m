@@ -37,14 +37,11 @@
 #import "AKNavigationController.h"
 #import "AKCommon.h"
 #import "AKScreenSize.h"
-#import "AKGameScene.h"
-#import "SimpleAudioEngine.h"
+#import "AKAdController.h"
 #import "AKInAppPurchaseHelper.h"
 
 /// アプリのURL
 static NSString *kAKAplUrl = @"https://itunes.apple.com/us/app/qing-ji/id569653828?l=ja&ls=1&mt=8";
-/// AdMobパブリッシャーID
-static NSString *kAKAdMobID = @"ca-app-pub-8055460627535570/7187368047";
 
 /*!
  @brief UINavigationControllerのカスタマイズ
@@ -54,8 +51,6 @@ static NSString *kAKAdMobID = @"ca-app-pub-8055460627535570/7187368047";
  */
 @implementation AKNavigationController
 
-@synthesize bannerView = bannerView_;
-
 /*!
  @brief 初期化処理
  
@@ -93,7 +88,7 @@ static NSString *kAKAdMobID = @"ca-app-pub-8055460627535570/7187368047";
  @brief 読み込み時処理
  
  ビューが読み込まれたときの処理。
- AdMobの広告バナーを生成する。
+ 広告バナーの表示を開始済みの場合はAdMobの広告バナーを生成する。
  */
 - (void)viewDidLoad
 {
@@ -103,13 +98,35 @@ static NSString *kAKAdMobID = @"ca-app-pub-8055460627535570/7187368047";
     [super viewDidLoad];
 
     // 広告解除が無効の場合は広告を作成する
-    if (![[AKInAppPurchaseHelper sharedHelper] isRemoveAd]) {
+    // 起動直後は最初のフレームの表示を優先するため、表示開始後のみ作成する
+    if (isAdStarted_ && ![[AKInAppPurchaseHelper sharedHelper] isRemoveAd]) {
         [self createAdBanner];
     }
     
     AKLog(1, @"end");
 }
 
+/*!
+ @brief 広告バナーの表示開始
+ 
+ 起動後の最初のフレームの表示が終わってから呼び出す。
+ 広告解除が無効の場合は広告バナーを生成する。
+ */
+- (void)startAdBanner
+{
+    isAdStarted_ = YES;
+    
+    // ビューが読み込まれていない場合はviewDidLoadで生成する
+    if (![self isViewLoaded]) {
+        return;
+    }
+    
+    // 広告解除が無効で、まだ生成していない場合は広告を作成する
+    if (![[AKInAppPurchaseHelper sharedHelper] isRemoveAd] && ![[AKAdController sharedController] isAttached]) {
+        [self createAdBanner];
+    }
+}
+
 /*!
  @brief メモリ不足時の処理
  
@@ -187,34 +204,13 @@ static NSString *kAKAdMobID = @"ca-app-pub-8055460627535570/7187368047";
  @brief 広告バナーを作成
  
  広告バナーを作成する。
+ 読み込みと表示位置の変更を行うタイミングは広告管理クラスで管理する。
  */
 - (void)createAdBanner
 {
     AKLog(1, @"start");
     
-    // 画面下部に標準サイズのビューを作成する
-    self.bannerView = [[[GADBannerView alloc] initWithFrame:CGRectMake(0.0,
-                                                                       self.view.bounds.size.height - GAD_SIZE_320x50.height,
-                                                                       GAD_SIZE_320x50.width,
-                                                                       GAD_SIZE_320x50.height)]
-                       autorelease];
-    
-    // 広告の「ユニット ID」を指定する。これは AdMob パブリッシャー ID です。
-    self.bannerView.adUnitID = kAKAdMobID;
-    
-    // デリゲートを設定する
-    self.bannerView.delegate = self;
-    
-    // ユーザーに広告を表示した場所に後で復元する UIViewController をランタイムに知らせて
-    // ビュー階層に追加する。
-    self.bannerView.rootViewController = self;
-    [self.view addSubview:self.bannerView];
-    
-    // 広告リクエストを作成する
-    GADRequest *request = [GADRequest request];
-    
-    // リクエストを行って広告を読み込む
-    [self.bannerView loadRequest:request];
+    [[AKAdController sharedController] attachToViewController:self];
     
     AKLog(1, @"end");
 }
@@ -228,14 +224,7 @@ static NSString *kAKAdMobID = @"ca-app-pub-8055460627535570/7187368047";
 {
     AKLog(1, @"start");
     
-    // バナーを取り除く
-    [self.bannerView removeFromSuperview];
-    
-    // デリゲートを削除する
-    self.bannerView.delegate = nil;
-    
-    // バナーを削除する
-    self.bannerView = nil;
+    [[AKAdController sharedController] detach];
     
     AKLog(1, @"end");
 }
@@ -273,101 +262,4 @@ static NSString *kAKAdMobID = @"ca-app-pub-8055460627535570/7187368047";
     // Twitter Viewを表示する
     [self presentModalViewController:viewController animated:YES];
 }
-
-/*!
- @brief リクエスト成功時処理
- 
- 広告リクエストに成功した時の処理。
- 画面内に広告バナーを表示する。
- @param bannerView 広告バナー
- */
-- (void)adViewDidReceiveAd:(GADBannerView *)bannerView
-{
-    AKLog(1, @"start");
-    
-    // 画面内に広告を表示する
-    bannerView.frame = CGRectMake(0.0,
-                                  self.view.bounds.size.height - GAD_SIZE_320x50.height,
-                                  bannerView.frame.size.width,
-                                  bannerView.frame.size.height);
-    
-    AKLog(1, @"end");
-}
-
-/*!
- @brief リクエスト失敗時処理
- 
- 広告リクエストに失敗した時の処理。
- 画面外に広告バナーを移動する。
- @param bannerView 広告バナー
- @param error エラー内容
- */
-- (void)adView:(GADBannerView *)bannerView didFailToReceiveAdWithError:(GADRequestError *)error
-{
-    AKLog(1, @"start");
-    
-    // ビューの位置を画面外に設定する
-    bannerView.frame = CGRectMake(0.0,
-                                  -bannerView.frame.size.height,
-                                  bannerView.frame.size.width,
-                                  bannerView.frame.size.height);
-    
-    AKLog(1, @"end");
-}
-
-/*!
- @brief 広告フルスクリーン表示時処理
- 
- 広告がフルスクリーン表示される前に行う処理。
- ゲームプレイ中の場合は一時停止状態にする。
- @param bannerView 広告バナー
- */
-- (void)adViewWillPresentScreen:(GADBannerView *)bannerView
-{
-    AKLog(1, @"start");
-    
-    // 実行中のシーンを取得する
-    CCScene *scene = [[CCDirector sharedDirector] runningScene];
-    
-    // ゲームプレイシーンでゲームプレイ中の場合は一時停止状態にする
-    if ([scene isKindOfClass:[AKGameScene class]]) {
-        
-        // ゲームプレイシーンにキャストする
-        AKGameScene *gameScene = (AKGameScene *)scene;
-        
-        // ゲームプレイ中の場合は一時停止状態にする
-        if (gameScene.state == kAKGameStatePlaying) {
-            
-            // 一時停止する
-            [gameScene pause:NO];
-            
-            // BGMは停止させる
-            [[SimpleAudioEngine sharedEngine] stopBackgroundMusic];
-        }
-    }
-    
-    AKLog(1, @"end");
-}
-
-/*!
- @brief 広告フルスクリーン終了時処理
- 
- フルスクリーン広告が閉じられる時に行う処理。
- @param bannerView 広告バナー
- */
-- (void)adViewDidDismissScreen:(GADBannerView *)bannerView
-{
-    AKLog(1, @"start");
-}
-
-/*!
- @brief 広告表示によるバックグラウンド移行時処理
- 
- 広告表示によってアプリケーションがバックグラウンドに移行するときの処理。
- @param bannerView 広告バナー
- */
-- (void)adViewWillLeaveApplication:(GADBannerView *)bannerView
-{
-    AKLog(1, @"start");
-}
 @end
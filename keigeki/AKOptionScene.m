@@ -34,6 +34,7 @@
  */
 
 #import "AKOptionScene.h"
+#import "AKTextureManager.h"
 #import "SimpleAudioEngine.h"
 #import "AKScreenSize.h"
 #import "AKLabel.h"
@@ -183,6 +184,9 @@ static const float kAKAdMarginPosPoint = 20.0f;
         return nil;
     }
     
+    // このシーンで使用するテクスチャを登録する
+    [[AKTextureManager sharedManager] beginScene:NSStringFromClass([self class])];
+    
     // 背景色レイヤーを作成する
     CCLayerColor *backColor = AKCreateBackColorLayer();
     
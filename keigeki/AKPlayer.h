@@ -46,10 +46,16 @@
     float invincivleTime_;
     /// アニメーション間隔
     float animationTime_;
+    /// 表示しているアニメーションフレーム
+    NSInteger frame_;
+    /// 表示座標を画面中央下部に固定するかどうか
+    BOOL isFixedOnScreen_;
 }
 
 /// 無敵状態かどうか
 @property (nonatomic)BOOL isInvincible;
+/// 表示座標を画面中央下部に固定するかどうか
+@property (nonatomic)BOOL isFixedOnScreen;
 
 // スクリーン座標(x座標)の取得
 - (float)getScreenPosX;
@@ -35,9 +35,9 @@
 
 #import <math.h>
 #import "AKPlayer.h"
-#import "AKGameScene.h"
+#import "AKTextureManager.h"
+#import "AKGameEventBuffer.h"
 #import "AKScreenSize.h"
-#import "SimpleAudioEngine.h"
 
 /// 速度の最大値
 static const NSInteger kAKPlayerSpeed = 240;
@@ -74,6 +74,11 @@ static const NSInteger kAKPlayerImagePosRight = 4;
 /// 破壊時の効果音
 static NSString *kAKHitSE = @"Hit.caf";
 
+/// スナップショットの動作状態:ステージに配置されている
+static const int32_t kAKPlayerRecordStaged = 0x01;
+/// スナップショットの動作状態:無敵状態
+static const int32_t kAKPlayerRecordInvincible = 0x02;
+
 /*!
  @brief 自機クラス
 
@@ -82,6 +87,7 @@ static NSString *kAKHitSE = @"Hit.caf";
 @implementation AKPlayer
 
 @synthesize isInvincible = isInvincible_;
+@synthesize isFixedOnScreen = isFixedOnScreen_;
 
 /*!
  @brief オブジェクト生成処理
@@ -113,8 +119,12 @@ static NSString *kAKHitSE = @"Hit.caf";
     // 状態を初期化する
     [self reset];
     
+    // 表示座標は画面中央下部に固定する
+    isFixedOnScreen_ = YES;
+    
     // アニメーションの間隔を初期化する
     animationTime_ = 0.0f;
+    frame_ = 0;
     
     // 画像サイズを決める
     NSInteger imageSize = kAKPlayerImageSize;
@@ -125,16 +135,45 @@ static NSString *kAKHitSE = @"Hit.caf";
     }
     
     // 画像の読込
-    self.image = [CCSprite spriteWithFile:@"Player.png" rect:CGRectMake(0, 0, imageSize, imageSize)];
+    self.image = [CCSprite spriteWithTexture:[[AKTextureManager sharedManager] textureForFile:@"Player.png"] rect:CGRectMake(0, 0, imageSize, imageSize)];
     assert(image_ != nil);
     
     return self;
 }
 
+/*!
+ @brief 表示状態の更新
+
+ 自機は常に画面内に表示されるため、表示範囲の判定は行わない。
+ 表示/非表示は無敵状態の点滅と破壊処理で制御する。
+ @return 常にYES
+ */
+- (BOOL)updateVisibility
+{
+    return YES;
+}
+
+/*!
+ @brief 位置の計算
+
+ 速度によって向きと絶対座標を更新する。自機の表示座標は画面中央下部に固定する。
+ 対戦相手の機体のように固定しない場合は、他のキャラクターと同じくスクリーン座標から表示座標を決める。
+ @param param 移動計算パラメータ
+ */
+- (void)integrate:(const struct AKMoveParam *)param
+{
+    [super integrate:param];
+    
+    // 自機の表示座標は画面中央下部に固定
+    if (isFixedOnScreen_) {
+        screenPos_ = ccp(AKPlayerPosX(), AKPlayerPosY());
+    }
+}
+
 /*!
  @brief キャラクター固有の動作
 
- 速度によって位置を移動する。自機の表示位置は固定とする。
+ 無敵時間をカウントし、回転速度から表示するアニメーションフレームを決める。
  @param dt フレーム更新間隔
  */
 - (void)action:(ccTime)dt
@@ -149,9 +188,6 @@ static NSString *kAKHitSE = @"Hit.caf";
         }
     }
     
-    // 自機の表示座標は画面中央下部に固定
-    self.image.position = ccp(AKPlayerPosX(), AKPlayerPosY());
-    
     // 回転速度から表示画像を切り替える
     NSInteger playerDirection = 0;
     if (rotSpeed_ < -kAKFrameChangeRotSpeed) {
@@ -164,37 +200,55 @@ static NSString *kAKHitSE = @"Hit.caf";
         playerDirection = kAKPlayerImagePosStraight;
     }
     
-    // 画像サイズを決める
-    NSInteger imageSize = kAKPlayerImageSize;
-    
-    // iPadの場合はサイズを倍にする
-    if (UI_USER_INTERFACE_IDIOM() == UIUserInterfaceIdiomPad) {
-        imageSize *= 2;
-    }
-
     // アニメーションの間隔をカウントする
     animationTime_ += dt;
     // アニメーション間隔の経過時間によって表示するフレームを切り替える
+    NSInteger frame = frame_;
     if (animationTime_ < kAKAnimationFrameDelay) {
-        [(CCSprite *)self.image setTextureRect:CGRectMake(playerDirection * imageSize,
-                                                          0,
-                                                          imageSize,
-                                                          imageSize)];
+        frame = playerDirection;
     }
     else if (animationTime_ < kAKAnimationFrameDelay * 2) {
-        [(CCSprite *)self.image setTextureRect:CGRectMake((playerDirection + 1) * imageSize,
-                                                          0,
-                                                          imageSize,
-                                                          imageSize)];
+        frame = playerDirection + 1;
     }
     else {
         animationTime_ = 0.0f;
     }
     
-    AKLog(0, @"player pos=(%f, %f)", self.image.position.x, self.image.position.y);
+    // フレームが変わった場合は描画状態を追加する
+    if (frame != frame_) {
+        struct AKRenderState *state = [self pushRenderState:kAKRenderFlagFrame];
+        if (state) {
+            state->frame = (int32_t)frame;
+            frame_ = frame;
+        }
+    }
+    
+    AKLog(0, @"player pos=(%f, %f)", screenPos_.x, screenPos_.y);
     AKLog(0, @"player angle=%f speed=%f", angle_, speed_);
 }
 
+/*!
+ @brief アニメーションフレームの反映
+
+ アニメーションフレームに対応する範囲を画像から切り出して表示する。
+ @param frame アニメーションフレーム
+ */
+- (void)applyFrame:(NSInteger)frame
+{
+    // 画像サイズを決める
+    NSInteger imageSize = kAKPlayerImageSize;
+    
+    // iPadの場合はサイズを倍にする
+    if (UI_USER_INTERFACE_IDIOM() == UIUserInterfaceIdiomPad) {
+        imageSize *= 2;
+    }
+    
+    [(CCSprite *)self.image setTextureRect:CGRectMake(frame * imageSize,
+                                                      0,
+                                                      imageSize,
+                                                      imageSize)];
+}
+
 /*!
  @brief 破壊処理
  
@@ -202,24 +256,26 @@ static NSString *kAKHitSE = @"Hit.caf";
  */
 - (void)destroy
 {
+    AKGameEventBuffer *eventBuffer = [AKGameEventBuffer sharedBuffer];
+    
     // 破壊時の効果音を鳴らす
-    [[SimpleAudioEngine sharedEngine] playEffect:kAKHitSE];
+    [eventBuffer pushSound:kAKHitSE];
 
     // 画面効果を生成する
-    [[AKGameScene getInstance] entryEffect:kAKExplosion
-                                 startRect:kAKExplosionRect
-                                frameCount:kAKExplosionFrameCount
-                                     delay:kAKExplosionFrameDelay
-                                      posX:self.absx posY:self.absy];
+    [eventBuffer pushEffect:kAKExplosion
+                  startRect:kAKExplosionRect
+                 frameCount:kAKExplosionFrameCount
+                      delay:kAKExplosionFrameDelay
+                       posX:self.absx posY:self.absy];
     
     // 配置フラグを落とす
     self.isStaged = NO;
     
     // 非表示とする
-    self.image.visible = NO;
+    [self pushRenderState:kAKRenderFlagHide];
     
     // 自機破壊時の処理を行う
-    [[AKGameScene getInstance] miss];
+    [eventBuffer pushMiss];
 }
 
 /*!
@@ -318,4 +374,46 @@ static NSString *kAKHitSE = @"Hit.caf";
     // アクションはすべて停止する
     [self.image stopAllActions];
 }
+
+/*!
+ @brief 状態の保存
+
+ 共通の状態に加えて、配置状態と無敵状態を書き出す。
+ @param record 書き込み先
+ */
+- (void)saveRecord:(struct AKCharacterRecord *)record
+{
+    [super saveRecord:record];
+    
+    record->state = (isStaged_ ? kAKPlayerRecordStaged : 0) |
+                    (isInvincible_ ? kAKPlayerRecordInvincible : 0);
+    record->time = invincivleTime_;
+}
+
+/*!
+ @brief 状態の復元
+
+ 共通の状態に加えて、配置状態と無敵状態を反映する。
+ 無敵状態の場合は残り時間の間ブリンクさせる。
+ @param record 保存した状態
+ */
+- (void)loadRecord:(const struct AKCharacterRecord *)record
+{
+    // 初期状態に戻してから保存した状態を反映する
+    [self reset];
+    [super loadRecord:record];
+    
+    isStaged_ = ((record->state & kAKPlayerRecordStaged) != 0);
+    isInvincible_ = ((record->state & kAKPlayerRecordInvincible) != 0);
+    invincivleTime_ = record->time;
+    
+    // 破壊されている場合は非表示にする
+    self.image.visible = isStaged_;
+    
+    // 無敵中はブリンクする
+    if (isStaged_ && isInvincible_ && invincivleTime_ > 0.0f) {
+        CCBlink *blink = [CCBlink actionWithDuration:invincivleTime_ blinks:ceilf(invincivleTime_ * 8)];
+        [self.image runAction:blink];
+    }
+}
 @end
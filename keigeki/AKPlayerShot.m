@@ -34,7 +34,8 @@
  */
 
 #import "AKPlayerShot.h"
-#import "AKGameScene.h"
+#import "AKTextureManager.h"
+#import "AKGameEventBuffer.h"
 #import "AKCommon.h"
 
 /// 自機弾のスピード
@@ -64,7 +65,7 @@ static const CGSize kAKPlayerShotSize = {2, 8};
     }
     
     // 画像の読込
-    self.image = [CCSprite spriteWithFile:@"PlayerShot.png"];
+    self.image = [CCSprite spriteWithTexture:[[AKTextureManager sharedManager] textureForFile:@"PlayerShot.png"]];
     assert(image_ != nil);
     
     // 各種パラメータを設定する
@@ -89,17 +90,9 @@ static const CGSize kAKPlayerShotSize = {2, 8};
  */
 - (void)destroy
 {
-    // ゲームプレイシーンクラスを取得する
-    AKGameScene *gameScene = [AKGameScene getInstance];
-    
-    // ショット発射数をカウントする
-    gameScene.shotCount++;
-    
-    // 射程距離が残っていれば命中数をカウントする
-    if (distance_ > 0.0f) {
-        gameScene.hitCount++;
-    }
-    AKLog(0, @"hitCount=%d shotCount=%d", gameScene.hitCount, gameScene.shotCount);
+    // ショット発射数と、射程距離が残っていれば命中数をカウントする
+    [[AKGameEventBuffer sharedBuffer] pushShotResult:(distance_ > 0.0f)];
+    AKLog(0, @"distance=%f", distance_);
     
     // スーパークラスの処理を行う
     [super destroy];
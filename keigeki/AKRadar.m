@@ -34,9 +34,9 @@
  */
 
 #import "AKRadar.h"
+#import "AKTextureManager.h"
 #import "AKCharacter.h"
 #import "AKScreenSize.h"
-#import "AKGameScene.h"
 
 /// レーダーのサイズ
 static const NSInteger kAKRadarSize = 128;
@@ -46,6 +46,8 @@ static const CGPoint kAKRadarPos = {400, 190};
 static const float kAKRadarPosRightPoint = 80.0f;
 /// レーダーの配置位置、上からの位置
 static const float kAKRadarPosTopPoint = 130.0f;
+/// レーダーのマーカーの数(表示できる敵の最大数)
+static const NSInteger kAKRadarMarkerCount = 16;
 
 /*!
  @brief レーダークラス
@@ -75,7 +77,7 @@ static const float kAKRadarPosTopPoint = 130.0f;
     }
     
     // レーダーの画像を読み込む
-    self.radarImage = [CCSprite spriteWithFile:@"Radar.png"];
+    self.radarImage = [CCSprite spriteWithTexture:[[AKTextureManager sharedManager] textureForFile:@"Radar.png"]];
     assert(self.radarImage != nil);
     
     // レーダーの画像をノードに配置する
@@ -86,7 +88,7 @@ static const float kAKRadarPosTopPoint = 130.0f;
                                    [AKScreenSize positionFromTopPoint:kAKRadarPosTopPoint]);
     
     // 自機用のマーカーの画像を読み込む
-    marker = [CCSprite spriteWithFile:@"Marker.png"];
+    marker = [CCSprite spriteWithTexture:[[AKTextureManager sharedManager] textureForFile:@"Marker.png"]];
     
     // レーダーのサイズを決める
     NSInteger radarSize = kAKRadarSize;
@@ -103,13 +105,13 @@ static const float kAKRadarPosTopPoint = 130.0f;
     [self.radarImage addChild:marker];
 
     // マーカーを保存する配列を生成する
-    self.markerImage = [NSMutableArray arrayWithCapacity:kAKMaxEnemyCount];
+    self.markerImage = [NSMutableArray arrayWithCapacity:kAKRadarMarkerCount];
     
     // マーカーを生成する
-    for (i = 0; i < kAKMaxEnemyCount; i++) {
+    for (i = 0; i < kAKRadarMarkerCount; i++) {
         
         // マーカーの画像を読み込む
-        marker = [CCSprite spriteWithFile:@"Marker.png"];
+        marker = [CCSprite spriteWithTexture:[[AKTextureManager sharedManager] textureForFile:@"Marker.png"]];
         
         // 初期状態は非表示とする
         marker.visible = NO;
@@ -146,6 +148,7 @@ static const float kAKRadarPosTopPoint = 130.0f;
  @brief マーカーの配置位置更新処理
 
  マーカーの配置位置を敵の座標情報から更新する。
+ 敵プールのサイズはゲームモードによって変わるため、マーカーの数とは一致しない。
  @param enemys 敵情報配列
  @param screenAngle 画面の傾き
  */
@@ -159,29 +162,31 @@ static const float kAKRadarPosTopPoint = 130.0f;
         radarSize *= 2;
     }
 
-    // 各敵の位置をマーカーに反映させる
-    for (int i = 0; i < kAKMaxEnemyCount; i++) {
+    // 配置されている敵に先頭から順にマーカーを割り当てる。
+    // 敵の数がマーカーの数を超えている場合は、超えた分は表示しない。
+    NSInteger markerCount = 0;
+    for (AKCharacter *enemy in enemys) {
         
-        // 配列サイズのチェックを行う
-        assert(i < enemys.count);
-        assert(i < self.markerImage.count);
-        
-        // 配列から要素を取得する
-        AKCharacter *enemy = [enemys objectAtIndex:i];
-        CCNode *marker = [self.markerImage objectAtIndex:i];
+        // マーカーをすべて使用した場合は処理を終了する
+        if (markerCount >= self.markerImage.count) {
+            break;
+        }
         
-        // 敵が画面に配置されていない場合はマーカーの表示を消す
+        // 敵が画面に配置されていない場合は処理しない
         if (!enemy.isStaged) {
-            AKLog(0 && marker.visible, @"visible=NO i=%d", i);
-            marker.visible = NO;
             continue;
         }
         
+        // マーカーを取得する
+        CCNode *marker = [self.markerImage objectAtIndex:markerCount];
+        markerCount++;
+        
         // 自機から見て敵の方向を調べる。
         // 絶対座標ではステージループの問題が発生するため
         // スクリーン座標を使用する。
+        // 遠くの敵は画像の表示を更新しないため、画像の位置ではなく保存しているスクリーン座標を使う。
         float angle = AKCalcDestAngle(AKPlayerPosX(), AKPlayerPosY(),
-                                      enemy.image.position.x, enemy.image.position.y);
+                                      enemy.screenPos.x, enemy.screenPos.y);
         
         // 自機の向いている方向を上向きとする。
         // 上向き(π/2)を0とするので、自機の角度 - π / 2をマイナスする。
@@ -191,14 +196,14 @@ static const float kAKRadarPosTopPoint = 130.0f;
         
         // マーカーの向きを計算する
         // 敵の向いている向きから自機の向いている向きをマイナスして画面の向きに補正する
-        float makerAngle =  enemy.angle - [AKGameScene getInstance].player.angle + M_PI / 2.0f;
+        float makerAngle = enemy.angle - screenAngle + M_PI / 2.0f;
                 
         // 座標を計算する
         // レーダーの中心を原点とするため、xyそれぞれレーダーの幅の半分を加算する。
         float posx = ((radarSize / 2) * cos(angle)) + (radarSize / 2);
         float posy = ((radarSize / 2) * sin(angle)) + (radarSize / 2);
         AKLog(0, @"enemy=(%f,%f) angle=%f marker=(%f,%f)",
-               enemy.image.position.x, enemy.image.position.y,
+               enemy.screenPos.x, enemy.screenPos.y,
                AKCnvAngleRad2Deg(angle), posx, posy);
         
         // マーカーの配置位置と角度を設定し、表示状態にする。
@@ -206,5 +211,11 @@ static const float kAKRadarPosTopPoint = 130.0f;
         marker.rotation = AKCnvAngleRad2Scr(makerAngle);
         marker.visible = YES;
     }
+    
+    // 割り当てなかったマーカーの表示を消す
+    for (NSInteger i = markerCount; i < self.markerImage.count; i++) {
+        CCNode *marker = [self.markerImage objectAtIndex:i];
+        marker.visible = NO;
+    }
 }
 @end
@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) 2012-2013 Akihiro Kaneda.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   1.Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   2.Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ *   3.Neither the name of the Monochrome Soft nor the names of its contributors
+ *     may be used to endorse or promote products derived from this software
+ *     without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+/*!
+ @file AKRenderBuffer.h
+ @brief 描画状態バッファ
+
+ 移動処理で計算したキャラクターの表示状態をノードに反映するまで保持するクラスを定義する。
+ */
+
+#import <Foundation/Foundation.h>
+#import <UIKit/UIKit.h>
+
+@class AKCharacter;
+
+/// 描画状態のうち反映する項目
+enum AKRenderFlag {
+    kAKRenderFlagTransform = 0x01,  ///< 位置と回転
+    kAKRenderFlagShow = 0x02,       ///< 表示する
+    kAKRenderFlagHide = 0x04,       ///< 非表示にする
+    kAKRenderFlagFrame = 0x08       ///< アニメーションフレーム
+};
+
+/// キャラクター1体分の描画状態
+struct AKRenderState {
+    /// 対象のキャラクター。キャラクタープールが保持するため、ここでは保持しない。
+    AKCharacter *character;
+    /// 追加したときの画像の世代。反映時に画像が差し替えられていた場合は反映しない。
+    uint32_t generation;
+    /// 反映する項目(AKRenderFlagの組み合わせ)
+    uint32_t flags;
+    /// アニメーションフレーム
+    int32_t frame;
+    /// 表示位置
+    CGPoint position;
+    /// 回転(cocos2dの角度)
+    float rotation;
+};
+
+// 描画状態バッファクラス
+@interface AKRenderBuffer : NSObject {
+    /// 描画状態の配列(書き込み側と反映側)
+    struct AKRenderState *states_[2];
+    /// 格納している描画状態の数
+    NSInteger count_[2];
+    /// 配列の確保サイズ
+    NSInteger capacity_[2];
+    /// 書き込み側の配列のインデックス
+    NSInteger backIndex_;
+}
+
+// シングルトンオブジェクト取得
++ (AKRenderBuffer *)sharedBuffer;
+// 描画状態の追加
+- (struct AKRenderState *)push:(AKCharacter *)character;
+// 書き込んだ描画状態の公開
+- (void)publish;
+// 公開された描画状態のノードへの反映
+- (NSInteger)apply;
+// 描画状態のクリア
+- (void)clear;
+@end
@@ -0,0 +1,307 @@
+/*
+ * Copyright (c) 2012-2013 Akihiro Kaneda.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   1.Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   2.Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ *   3.Neither the name of the Monochrome Soft nor the names of its contributors
+ *     may be used to endorse or promote products derived from this software
+ *     without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+/*!
+ @file AKRenderBuffer.m
+ @brief 描画状態バッファ
+
+ 移動処理で計算したキャラクターの表示状態をノードに反映するまで保持するクラスを定義する。
+ */
+
+#import <libkern/OSAtomic.h>
+#import "AKRenderBuffer.h"
+#import "AKCharacter.h"
+#import "AKCommon.h"
+
+/// 描画状態配列の初期確保サイズ
+static const NSInteger kAKRenderStateInitialCapacity = 256;
+
+/// シングルトンオブジェクト
+static AKRenderBuffer *sharedBuffer_ = nil;
+
+/// 書き込み側と反映側の切り替えの排他用
+static OSSpinLock swapLock_ = OS_SPINLOCK_INIT;
+
+/*!
+ @brief 描画状態バッファクラス
+
+ 移動処理はキャラクターのメンバのみを更新し、ノードに反映する位置や表示状態などを
+ 書き込み側の配列に追加する。1回の移動処理が終わったら公開し、反映処理で公開された配列の内容を
+ まとめてノードに反映する。
+ 書き込み側と反映側で配列を分けているため、移動処理と反映処理は別のスレッドで並行して実行できる。
+ 反映処理が行われる前に次の公開が行われた場合は、表示状態の切り替えを失わないように
+ 反映待ちの配列の末尾に追加する。
+ 配列は不足したときのみ拡張し、毎フレームのメモリ確保は行わない。
+ */
+@implementation AKRenderBuffer
+
+/*!
+ @brief シングルトンオブジェクト取得
+
+ シングルトンオブジェクトを取得する。
+ まだ生成されていない場合は生成を行う。
+ @return シングルトンオブジェクト
+ */
++ (AKRenderBuffer *)sharedBuffer
+{
+    // 他のスレッドで同時に実行されないようにする
+    @synchronized(self) {
+
+        // シングルトンオブジェクトが生成されていない場合は生成する
+        if (!sharedBuffer_) {
+            sharedBuffer_ = [[AKRenderBuffer alloc] init];
+        }
+
+        return sharedBuffer_;
+    }
+
+    return nil;
+}
+
+/*!
+ @brief インスタンス生成処理
+
+ インスタンス生成処理。
+ シングルトンのため、二重に生成された場合はアサーションを出力する。
+ */
++ (id)alloc
+{
+    // 他のスレッドで同時に実行されないようにする
+    @synchronized(self) {
+
+        NSAssert(sharedBuffer_ == nil, @"Attempted to allocate a second instance of a singleton.");
+        return [super alloc];
+    }
+
+    return nil;
+}
+
+/*!
+ @brief オブジェクト生成処理
+
+ オブジェクトの生成を行う。書き込み側と反映側の配列を確保する。
+ @return 生成したオブジェクト。失敗時はnilを返す。
+ */
+- (id)init
+{
+    // スーパークラスの生成処理
+    self = [super init];
+    if (!self) {
+        return nil;
+    }
+
+    // 描画状態の配列を確保する
+    for (int i = 0; i < 2; i++) {
+
+        states_[i] = malloc(sizeof(struct AKRenderState) * kAKRenderStateInitialCapacity);
+        if (!states_[i]) {
+            [self release];
+            return nil;
+        }
+        capacity_[i] = kAKRenderStateInitialCapacity;
+        count_[i] = 0;
+    }
+    backIndex_ = 0;
+
+    return self;
+}
+
+/*!
+ @brief インスタンス解放時処理
+
+ インスタンス解放時にオブジェクトを解放する。
+ */
+- (void)dealloc
+{
+    // 描画状態の配列を解放する
+    free(states_[0]);
+    free(states_[1]);
+
+    // スーパークラスの解放処理
+    [super dealloc];
+}
+
+/*!
+ @brief 配列の拡張
+
+ 指定した配列が指定した数の要素を格納できるように、必要であれば倍のサイズずつ拡張する。
+ @param index 配列のインデックス
+ @param count 格納する要素の数
+ @return 拡張に成功した場合、拡張の必要がない場合YES
+ */
+- (BOOL)reserve:(NSInteger)index count:(NSInteger)count
+{
+    // 配列が足りている場合は何もしない
+    if (count <= capacity_[index]) {
+        return YES;
+    }
+
+    NSInteger capacity = capacity_[index];
+    while (capacity < count) {
+        capacity *= 2;
+    }
+
+    struct AKRenderState *states = realloc(states_[index], sizeof(struct AKRenderState) * capacity);
+    if (!states) {
+        AKLog(1, @"描画状態配列の拡張に失敗:capacity=%d", capacity);
+        return NO;
+    }
+
+    states_[index] = states;
+    capacity_[index] = capacity;
+    AKLog(1, @"描画状態配列を拡張:capacity=%d", capacity);
+
+    return YES;
+}
+
+/*!
+ @brief 描画状態の追加
+
+ 書き込み側の配列の末尾に要素を追加し、その要素を返す。
+ 移動処理を行うスレッドから呼び出す。
+ @param character 対象のキャラクター
+ @return 追加した要素。拡張に失敗した場合はNULL。
+ */
+- (struct AKRenderState *)push:(AKCharacter *)character
+{
+    NSInteger index = backIndex_;
+
+    // 配列が不足している場合は拡張する
+    if (![self reserve:index count:count_[index] + 1]) {
+        return NULL;
+    }
+
+    // 末尾の要素を初期化して返す
+    struct AKRenderState *state = &states_[index][count_[index]++];
+    memset(state, 0, sizeof(struct AKRenderState));
+    state->character = character;
+    state->generation = character.imageGeneration;
+
+    return state;
+}
+
+/*!
+ @brief 書き込んだ描画状態の公開
+
+ 書き込み側の配列を反映側に切り替える。
+ 反映側の配列がまだ反映されていない場合は、その末尾に書き込み側の内容を追加する。
+ 移動処理を行うスレッドから1回の移動処理ごとに呼び出す。
+ */
+- (void)publish
+{
+    OSSpinLockLock(&swapLock_);
+
+    NSInteger back = backIndex_;
+    NSInteger front = 1 - back;
+
+    // 反映側が空の場合は切り替える
+    if (count_[front] == 0) {
+        backIndex_ = front;
+    }
+    // 反映待ちの場合は末尾に追加する
+    else if ([self reserve:front count:count_[front] + count_[back]]) {
+        memcpy(&states_[front][count_[front]], states_[back], sizeof(struct AKRenderState) * count_[back]);
+        count_[front] += count_[back];
+        count_[back] = 0;
+    }
+    // 拡張に失敗した場合は反映待ちの内容を破棄して切り替える
+    else {
+        count_[front] = 0;
+        backIndex_ = front;
+    }
+
+    OSSpinLockUnlock(&swapLock_);
+}
+
+/*!
+ @brief 公開された描画状態のノードへの反映
+
+ 反映側の配列の内容を順番にキャラクターの画像に反映し、配列を空にする。
+ cocos2dのノードを操作するため、メインスレッドから呼び出す。
+ @return 反映した描画状態の数
+ */
+- (NSInteger)apply
+{
+    OSSpinLockLock(&swapLock_);
+
+    NSInteger front = 1 - backIndex_;
+    NSInteger count = count_[front];
+
+    for (NSInteger i = 0; i < count; i++) {
+
+        const struct AKRenderState *state = &states_[front][i];
+        CCNode *image = state->character.image;
+
+        // 画像が解放されている場合、差し替えられている場合は無処理
+        if (!image || state->generation != state->character.imageGeneration) {
+            continue;
+        }
+
+        // 表示座標と回転を設定する
+        if (state->flags & kAKRenderFlagTransform) {
+            image.position = state->position;
+            image.rotation = state->rotation;
+        }
+
+        // 表示状態を設定する
+        if (state->flags & kAKRenderFlagShow) {
+            image.visible = YES;
+        }
+        else if (state->flags & kAKRenderFlagHide) {
+            image.visible = NO;
+        }
+
+        // アニメーションフレームを切り替える
+        if (state->flags & kAKRenderFlagFrame) {
+            [state->character applyFrame:state->frame];
+        }
+    }
+
+    count_[front] = 0;
+
+    OSSpinLockUnlock(&swapLock_);
+
+    return count;
+}
+
+/*!
+ @brief 描画状態のクリア
+
+ 書き込み側と反映側の配列を空にする。
+ キャラクターの状態を初期化するときに呼び出す。
+ */
+- (void)clear
+{
+    OSSpinLockLock(&swapLock_);
+
+    count_[0] = 0;
+    count_[1] = 0;
+
+    OSSpinLockUnlock(&swapLock_);
+}
+@end
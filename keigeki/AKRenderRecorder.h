@@ -0,0 +1,93 @@
+/*
+ * Copyright (c) 2012-2013 Akihiro Kaneda.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   1.Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   2.Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ *   3.Neither the name of the Monochrome Soft nor the names of its contributors
+ *     may be used to endorse or promote products derived from this software
+ *     without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+/*!
+ @file AKRenderRecorder.h
+ @brief 描画コマンド記録
+
+ シーングラフから描画コマンドを見積もり、描画負荷を記録するクラスを定義する。
+ */
+
+#import <Foundation/Foundation.h>
+#import "cocos2d.h"
+#import "AKFrameProfiler.h"
+
+/// 重ね描きを数える画面の分割数
+enum {
+    kAKRenderGridColumns = 24,  ///< 横方向の分割数
+    kAKRenderGridRows = 16      ///< 縦方向の分割数
+};
+
+/// 記録するシーンの数
+enum {
+    kAKRenderSceneCount = 8
+};
+
+/// 1フレームの描画コマンドの記録
+struct AKRenderFrameStats {
+    NSInteger drawCalls;        ///< 描画コマンドの数
+    NSInteger textureBinds;     ///< テクスチャの切り替え回数
+    NSInteger vertices;         ///< 頂点数
+    NSInteger blendChanges;     ///< ブレンドモードの切り替え回数
+    float overdraw;             ///< 描画したセルの平均の重ね描き回数
+    NSInteger maxOverdraw;      ///< セルの重ね描き回数の最大値
+};
+
+/*!
+ @brief 記録時のシーン名の指定
+
+ 同じシーンでも画面によって別に集計したい場合に実装する。
+ */
+@protocol AKRenderSceneNaming <NSObject>
+
+// 記録時のシーン名
+- (NSString *)renderSceneName;
+
+@end
+
+#if AK_PROFILE
+/// 記録が有効かどうか
+extern BOOL AKRenderRecorderEnabled;
+
+// 描画コマンド記録クラス
+@interface AKRenderRecorder : NSObject
+
+// 記録の有効/無効設定
++ (void)setEnabled:(BOOL)enabled;
+// 記録のクリア
++ (void)reset;
+// フレームの記録
++ (void)recordFrame:(ccTime)dt;
+// シーンの描画コマンドの見積もり
++ (void)measureScene:(CCNode *)scene stats:(struct AKRenderFrameStats *)stats;
+// 記録結果の表示用文字列取得
++ (NSString *)summaryString;
+// 記録結果のCSV出力
++ (BOOL)exportCSV;
+@end
+#endif
@@ -0,0 +1,436 @@
+/*
+ * Copyright (c) 2012-2013 Akihiro Kaneda.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   1.Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   2.Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ *   3.Neither the name of the Monochrome Soft nor the names of its contributors
+ *     may be used to endorse or promote products derived from this software
+ *     without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+/*!
+ @file AKRenderRecorder.m
+ @brief 描画コマンド記録
+
+ シーングラフから描画コマンドを見積もり、描画負荷を記録するクラスを定義する。
+ */
+
+#import "AKRenderRecorder.h"
+#import "AKCommon.h"
+
+#if AK_PROFILE
+
+/// CSVファイル名
+static NSString *kAKRenderCSVFileName = @"render.csv";
+/// 表示用文字列の1行のフォーマット
+static NSString *kAKRenderLineFormat = @"%-16s%6d%5d%5d%6d%4d%6.2f%4d";
+/// 表示用文字列の見出し
+static NSString *kAKRenderHeader = @"SCENE           FRAMES DRAW BIND  VERT BLD  OVER MAX";
+
+/// 記録が有効かどうか
+BOOL AKRenderRecorderEnabled = NO;
+
+/// シーンごとの集計
+struct AKRenderSceneStats {
+    const char *name;               ///< シーン名
+    NSInteger frames;               ///< 記録したフレーム数
+    struct AKRenderFrameStats sum;  ///< 合計
+    struct AKRenderFrameStats max;  ///< 最大値
+};
+
+/// シーンごとの集計
+static struct AKRenderSceneStats scenes_[kAKRenderSceneCount];
+/// 集計しているシーンの数
+static NSInteger sceneCount_ = 0;
+
+/// 見積もり中のセルごとの重ね描き回数
+static NSInteger grid_[kAKRenderGridRows][kAKRenderGridColumns];
+/// 見積もり中の前回の描画コマンドのテクスチャ
+static GLuint lastTexture_ = 0;
+/// 見積もり中の前回の描画コマンドのブレンドモード
+static ccBlendFunc lastBlend_ = {0, 0};
+/// 見積もり中の描画コマンドがまだないかどうか
+static BOOL isFirstDraw_ = YES;
+
+/*!
+ @brief 重ね描き回数の加算
+
+ ノードの画面上の範囲に含まれるセルの重ね描き回数を加算する。
+ セルの中心が範囲に含まれる場合にそのセルを描画したものとする。
+ @param node ノード
+ */
+static void AKRenderAddCoverage(CCNode *node)
+{
+    CGSize winSize = [CCDirector sharedDirector].winSize;
+    CGRect rect = CGRectApplyAffineTransform(CGRectMake(0.0f, 0.0f, node.contentSize.width, node.contentSize.height),
+                                             [node nodeToWorldTransform]);
+    float cellWidth = winSize.width / kAKRenderGridColumns;
+    float cellHeight = winSize.height / kAKRenderGridRows;
+
+    // セルの中心が範囲に含まれるセルの範囲を求める
+    int left = MAX((int)ceilf(CGRectGetMinX(rect) / cellWidth - 0.5f), 0);
+    int right = MIN((int)floorf(CGRectGetMaxX(rect) / cellWidth - 0.5f), kAKRenderGridColumns - 1);
+    int bottom = MAX((int)ceilf(CGRectGetMinY(rect) / cellHeight - 0.5f), 0);
+    int top = MIN((int)floorf(CGRectGetMaxY(rect) / cellHeight - 0.5f), kAKRenderGridRows - 1);
+
+    for (int y = bottom; y <= top; y++) {
+        for (int x = left; x <= right; x++) {
+            grid_[y][x]++;
+        }
+    }
+}
+
+/*!
+ @brief 描画コマンドの追加
+
+ 描画コマンドの数と頂点数を加算する。
+ 前回の描画コマンドとテクスチャやブレンドモードが異なる場合は切り替え回数を加算する。
+ cocos2dはテクスチャとブレンドモードが前回と同じ場合はGLの呼び出しを省略するため、それに合わせている。
+ @param stats 記録先
+ @param texture テクスチャ。テクスチャを使用しない場合は0。
+ @param blend ブレンドモード
+ @param vertices 頂点数
+ */
+static void AKRenderAddDraw(struct AKRenderFrameStats *stats, GLuint texture, ccBlendFunc blend, NSInteger vertices)
+{
+    stats->drawCalls++;
+    stats->vertices += vertices;
+
+    if (texture != 0 && (isFirstDraw_ || texture != lastTexture_)) {
+        stats->textureBinds++;
+        lastTexture_ = texture;
+    }
+
+    if (isFirstDraw_ || blend.src != lastBlend_.src || blend.dst != lastBlend_.dst) {
+        stats->blendChanges++;
+        lastBlend_ = blend;
+    }
+
+    isFirstDraw_ = NO;
+}
+
+/*!
+ @brief ノードの描画コマンドの見積もり
+
+ cocos2dの描画順に合わせて、z座標が負の子ノード、自ノード、残りの子ノードの順にたどる。
+ バッチノードは配下のスプライトをまとめて1回の描画コマンドとし、配下はたどらない。
+ 非表示のノードは配下も含めて描画しない。
+ @param node ノード
+ @param stats 記録先
+ */
+static void AKRenderVisit(CCNode *node, struct AKRenderFrameStats *stats)
+{
+    if (!node.visible) {
+        return;
+    }
+
+    // バッチノードは1回の描画コマンドとする
+    if ([node isKindOfClass:[CCSpriteBatchNode class]]) {
+
+        CCSpriteBatchNode *batch = (CCSpriteBatchNode *)node;
+        if (batch.textureAtlas.totalQuads > 0) {
+            AKRenderAddDraw(stats, batch.texture.name, batch.blendFunc, batch.textureAtlas.totalQuads * 4);
+        }
+
+        // 表示中のスプライトのみ重ね描きの対象とする
+        CCSprite *sprite = nil;
+        CCARRAY_FOREACH(batch.descendants, sprite) {
+
+            BOOL isVisible = YES;
+            for (CCNode *parent = sprite; parent != batch; parent = parent.parent) {
+                if (!parent.visible) {
+                    isVisible = NO;
+                    break;
+                }
+            }
+
+            if (isVisible) {
+                AKRenderAddCoverage(sprite);
+            }
+        }
+
+        return;
+    }
+
+    // z座標が負の子ノードを先にたどる
+    CCNode *child = nil;
+    CCARRAY_FOREACH(node.children, child) {
+        if (child.zOrder < 0) {
+            AKRenderVisit(child, stats);
+        }
+    }
+
+    // 自ノードの描画コマンドを追加する
+    if ([node isKindOfClass:[CCSprite class]]) {
+
+        CCSprite *sprite = (CCSprite *)node;
+        AKRenderAddDraw(stats, sprite.texture.name, sprite.blendFunc, 4);
+        AKRenderAddCoverage(sprite);
+    }
+    else if ([node isKindOfClass:[CCLayerColor class]]) {
+
+        CCLayerColor *layer = (CCLayerColor *)node;
+        AKRenderAddDraw(stats, 0, layer.blendFunc, 4);
+        AKRenderAddCoverage(layer);
+    }
+
+    // 残りの子ノードをたどる
+    CCARRAY_FOREACH(node.children, child) {
+        if (child.zOrder >= 0) {
+            AKRenderVisit(child, stats);
+        }
+    }
+}
+
+/*!
+ @brief シーンの集計の取得
+
+ シーン名に対応する集計を取得する。まだない場合は追加する。
+ @param name シーン名
+ @return シーンの集計。追加できない場合はNULL。
+ */
+static struct AKRenderSceneStats *AKRenderSceneStatsForName(NSString *name)
+{
+    const char *cname = [name UTF8String];
+
+    for (int i = 0; i < sceneCount_; i++) {
+        if (strcmp(scenes_[i].name, cname) == 0) {
+            return &scenes_[i];
+        }
+    }
+
+    // 記録領域がいっぱいの場合は記録しない
+    if (sceneCount_ >= kAKRenderSceneCount) {
+        return NULL;
+    }
+
+    struct AKRenderSceneStats *stats = &scenes_[sceneCount_];
+    memset(stats, 0, sizeof(*stats));
+    stats->name = strdup(cname);
+    sceneCount_++;
+
+    return stats;
+}
+
+/*!
+ @brief 描画コマンド記録クラス
+
+ GPUや計測ツールを使わずに描画負荷を比較するため、実行中のシーンのシーングラフから
+ cocos2dが発行する描画コマンドを見積もり、シーンごとに集計する。
+ 描画コマンド、テクスチャの切り替え、頂点数、ブレンドモードの切り替えを数え、
+ 画面を粗いセルに分割してスプライトの範囲から重ね描き回数を求める。
+ スプライトの範囲は矩形として扱うため、透明部分も描画したものとして数える。
+ */
+@implementation AKRenderRecorder
+
+/*!
+ @brief 記録の有効/無効設定
+
+ 記録の有効/無効を設定する。
+ 有効にする場合は過去の記録をクリアし、毎フレームの記録を開始する。
+ @param enabled 有効にする場合YES
+ */
++ (void)setEnabled:(BOOL)enabled
+{
+    CCScheduler *scheduler = [CCDirector sharedDirector].scheduler;
+
+    if (enabled && !AKRenderRecorderEnabled) {
+        [self reset];
+        [scheduler scheduleSelector:@selector(recordFrame:) forTarget:self interval:0.0f paused:NO];
+    }
+    else if (!enabled && AKRenderRecorderEnabled) {
+        [scheduler unscheduleSelector:@selector(recordFrame:) forTarget:self];
+    }
+
+    AKRenderRecorderEnabled = enabled;
+}
+
+/*!
+ @brief 記録のクリア
+
+ シーンごとの集計をクリアする。
+ */
++ (void)reset
+{
+    for (int i = 0; i < sceneCount_; i++) {
+        free((void *)scenes_[i].name);
+    }
+    memset(scenes_, 0, sizeof(scenes_));
+    sceneCount_ = 0;
+}
+
+/*!
+ @brief フレームの記録
+
+ 実行中のシーンの描画コマンドを見積もり、シーンごとの集計に加える。
+ 更新処理の後、描画の前に呼び出されるため、このフレームで描画される状態を記録する。
+ シーンが記録時のシーン名を指定している場合はそのシーン名で、それ以外はクラス名で集計する。
+ トランジション中は2つのシーンが混ざるため記録しない。
+ @param dt フレーム更新間隔
+ */
++ (void)recordFrame:(ccTime)dt
+{
+    CCScene *scene = [CCDirector sharedDirector].runningScene;
+    if (scene == nil || [scene isKindOfClass:[CCTransitionScene class]]) {
+        return;
+    }
+
+    // シーン名を決める
+    NSString *name = nil;
+    if ([scene conformsToProtocol:@protocol(AKRenderSceneNaming)]) {
+        name = [(id<AKRenderSceneNaming>)scene renderSceneName];
+    }
+    else {
+        name = NSStringFromClass([scene class]);
+    }
+
+    struct AKRenderSceneStats *sceneStats = AKRenderSceneStatsForName(name);
+    if (sceneStats == NULL) {
+        return;
+    }
+
+    // 描画コマンドを見積もる
+    struct AKRenderFrameStats stats;
+    [self measureScene:scene stats:&stats];
+
+    // 集計に加える
+    sceneStats->frames++;
+    sceneStats->sum.drawCalls += stats.drawCalls;
+    sceneStats->sum.textureBinds += stats.textureBinds;
+    sceneStats->sum.vertices += stats.vertices;
+    sceneStats->sum.blendChanges += stats.blendChanges;
+    sceneStats->sum.overdraw += stats.overdraw;
+    sceneStats->sum.maxOverdraw += stats.maxOverdraw;
+    sceneStats->max.drawCalls = MAX(sceneStats->max.drawCalls, stats.drawCalls);
+    sceneStats->max.textureBinds = MAX(sceneStats->max.textureBinds, stats.textureBinds);
+    sceneStats->max.vertices = MAX(sceneStats->max.vertices, stats.vertices);
+    sceneStats->max.blendChanges = MAX(sceneStats->max.blendChanges, stats.blendChanges);
+    sceneStats->max.overdraw = MAX(sceneStats->max.overdraw, stats.overdraw);
+    sceneStats->max.maxOverdraw = MAX(sceneStats->max.maxOverdraw, stats.maxOverdraw);
+}
+
+/*!
+ @brief シーンの描画コマンドの見積もり
+
+ シーングラフをたどり、1フレーム分の描画コマンドを見積もる。
+ @param scene シーン
+ @param stats 記録先
+ */
++ (void)measureScene:(CCNode *)scene stats:(struct AKRenderFrameStats *)stats
+{
+    memset(stats, 0, sizeof(*stats));
+    memset(grid_, 0, sizeof(grid_));
+    isFirstDraw_ = YES;
+
+    // 描画コマンドを数える
+    AKRenderVisit(scene, stats);
+
+    // 描画したセルの平均と最大の重ね描き回数を求める
+    NSInteger covered = 0;
+    NSInteger total = 0;
+    for (int y = 0; y < kAKRenderGridRows; y++) {
+        for (int x = 0; x < kAKRenderGridColumns; x++) {
+            if (grid_[y][x] > 0) {
+                covered++;
+                total += grid_[y][x];
+                stats->maxOverdraw = MAX(stats->maxOverdraw, grid_[y][x]);
+            }
+        }
+    }
+    stats->overdraw = (covered > 0) ? (float)total / covered : 0.0f;
+}
+
+/*!
+ @brief 記録結果の表示用文字列取得
+
+ シーンごとに記録したフレーム数と、1フレームあたりの平均値を1行ずつ並べた文字列を作成する。
+ @return 表示用文字列
+ */
++ (NSString *)summaryString
+{
+    NSMutableString *summary = [NSMutableString stringWithString:kAKRenderHeader];
+
+    for (int i = 0; i < sceneCount_; i++) {
+
+        struct AKRenderSceneStats *stats = &scenes_[i];
+        NSInteger frames = MAX(stats->frames, 1);
+
+        [summary appendString:@"\n"];
+        [summary appendFormat:kAKRenderLineFormat,
+         stats->name,
+         stats->frames,
+         stats->sum.drawCalls / frames,
+         stats->sum.textureBinds / frames,
+         stats->sum.vertices / frames,
+         stats->sum.blendChanges / frames,
+         stats->sum.overdraw / frames,
+         stats->max.maxOverdraw];
+    }
+
+    return summary;
+}
+
+/*!
+ @brief 記録結果のCSV出力
+
+ シーンごとの平均値と最大値をDocumentsディレクトリにCSV形式で出力する。
+ @return 出力に成功した場合YES
+ */
++ (BOOL)exportCSV
+{
+    NSMutableString *csv = [NSMutableString string];
+
+    [csv appendString:@"scene,frames,"
+                      @"draw_avg,draw_max,bind_avg,bind_max,vertex_avg,vertex_max,"
+                      @"blend_avg,blend_max,overdraw_avg,overdraw_max,depth_avg,depth_max\n"];
+
+    for (int i = 0; i < sceneCount_; i++) {
+
+        struct AKRenderSceneStats *stats = &scenes_[i];
+        float frames = MAX(stats->frames, 1);
+
+        [csv appendFormat:@"%s,%d,%f,%d,%f,%d,%f,%d,%f,%d,%f,%f,%f,%d\n",
+         stats->name,
+         stats->frames,
+         stats->sum.drawCalls / frames, stats->max.drawCalls,
+         stats->sum.textureBinds / frames, stats->max.textureBinds,
+         stats->sum.vertices / frames, stats->max.vertices,
+         stats->sum.blendChanges / frames, stats->max.blendChanges,
+         stats->sum.overdraw / frames, stats->max.overdraw,
+         stats->sum.maxOverdraw / frames, stats->max.maxOverdraw];
+    }
+
+    // Documentsディレクトリへのパスを作成する
+    NSString *docDir = [NSHomeDirectory() stringByAppendingPathComponent:@"Documents"];
+    NSString *filePath = [docDir stringByAppendingPathComponent:kAKRenderCSVFileName];
+
+    // ファイルを書き込む
+    NSError *error = nil;
+    BOOL isSuccess = [csv writeToFile:filePath atomically:YES encoding:NSUTF8StringEncoding error:&error];
+
+    AKLog(!isSuccess, @"CSV出力に失敗:%@", [error localizedDescription]);
+    AKLog(isSuccess, @"CSV出力:%@\n%@", filePath, [self summaryString]);
+
+    return isSuccess;
+}
+@end
+
+#endif
@@ -0,0 +1,91 @@
+/*
+ * Copyright (c) 2012-2013 Akihiro Kaneda.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   1.Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   2.Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ *   3.Neither the name of the Monochrome Soft nor the names of its contributors
+ *     may be used to endorse or promote products derived from this software
+ *     without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+/*!
+ @file AKSaveStore.h
+ @brief セーブデータ管理
+
+ ハイスコアやステージごとの記録をジャーナル形式で保存するクラスを定義する。
+ */
+
+#import <Foundation/Foundation.h>
+#import "AKFrameProfiler.h"
+
+/// 記録を保持するステージの最大数
+enum {
+    kAKSaveStageCount = 8
+};
+
+// セーブデータ管理クラス
+@interface AKSaveStore : NSObject {
+    /// ファイル入出力用のキュー
+    dispatch_queue_t queue_;
+    /// ジャーナルファイルのファイルディスクリプタ
+    int journalFd_;
+    /// ジャーナルに追記したレコード数
+    NSInteger journalCount_;
+    /// 読み込みが完了しているかどうか
+    BOOL isLoaded_;
+    /// ハイスコア
+    NSInteger hiScore_;
+    /// ステージごとの最高スコア
+    NSInteger stageScore_[kAKSaveStageCount];
+    /// ステージごとの最短クリア時間
+    float stageTime_[kAKSaveStageCount];
+    /// ステージごとの最高命中率
+    NSInteger stageHit_[kAKSaveStageCount];
+}
+
+// シングルトンオブジェクト取得
++ (AKSaveStore *)sharedStore;
+// ハイスコア取得
+- (NSInteger)hiScore;
+// ハイスコアの非同期取得
+- (void)hiScoreWithCompletion:(void (^)(NSInteger hiScore))completion;
+// ハイスコア更新
+- (void)updateHiScore:(NSInteger)score;
+// ステージの記録更新
+- (void)updateStage:(NSInteger)stage score:(NSInteger)score time:(float)time hit:(NSInteger)hit;
+// ステージの最高スコア取得
+- (NSInteger)bestScoreOfStage:(NSInteger)stage;
+// ステージの最短クリア時間取得
+- (float)clearTimeOfStage:(NSInteger)stage;
+// ステージの最高命中率取得
+- (NSInteger)hitRateOfStage:(NSInteger)stage;
+// ジャーナルの圧縮
+- (void)compact;
+// 完了処理を指定したジャーナルの圧縮
+- (void)compactWithCompletion:(void (^)(void))completion;
+// 書き込み完了待ち
+- (void)waitUntilWritten;
+@end
+
+#if AK_PROFILE
+// ジャーナルの障害時の整合性確認
+BOOL AKSaveStoreJournalCheck(void);
+#endif
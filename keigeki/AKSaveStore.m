@@ -0,0 +1,892 @@
+/*
+ * Copyright (c) 2012-2013 Akihiro Kaneda.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   1.Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   2.Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ *   3.Neither the name of the Monochrome Soft nor the names of its contributors
+ *     may be used to endorse or promote products derived from this software
+ *     without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+/*!
+ @file AKSaveStore.m
+ @brief セーブデータ管理
+
+ ハイスコアやステージごとの記録をジャーナル形式で保存するクラスを定義する。
+ */
+
+#import <fcntl.h>
+#import <unistd.h>
+#import <zlib.h>
+#import "AKSaveStore.h"
+#import "AKHiScoreFile.h"
+#import "AKCommon.h"
+
+/// レコード種別
+enum AKSaveRecordType {
+    kAKSaveRecordHiScore = 1,   ///< ハイスコア
+    kAKSaveRecordStage          ///< ステージの記録
+};
+
+/*!
+ @brief 保存レコード
+
+ ジャーナルとスナップショットに書き込む固定長のレコード。
+ 末尾のチェックサムは先頭からチェックサム直前までのCRC32とする。
+ */
+typedef struct {
+    uint32_t magic;     ///< 識別子
+    uint16_t type;      ///< レコード種別
+    uint16_t stage;     ///< ステージ番号
+    int32_t score;      ///< スコア
+    float time;         ///< クリア時間
+    int32_t hit;        ///< 命中率
+    uint32_t checksum;  ///< チェックサム
+} AKSaveRecord;
+
+/// レコードの識別子
+static const uint32_t kAKSaveRecordMagic = 0x414B5356;
+/// ジャーナルを圧縮するレコード数
+static const NSInteger kAKSaveCompactCount = 64;
+/// スナップショットファイル名
+static NSString *kAKSnapshotFileName = @"savedata.dat";
+/// ジャーナルファイル名
+static NSString *kAKJournalFileName = @"savedata.journal";
+/// 旧形式のハイスコアファイル名
+static NSString *kAKLegacyFileName = @"hiscore.dat";
+/// 旧形式のハイスコアファイルのエンコードキー名
+static NSString *kAKLegacyFileKey = @"hiScoreData";
+
+/*!
+ @brief レコードのチェックサム計算
+
+ チェックサムのフィールドを除いたレコードの内容からCRC32を計算する。
+ @param record レコード
+ @return チェックサム
+ */
+static uint32_t AKSaveRecordChecksum(const AKSaveRecord *record)
+{
+    return (uint32_t)crc32(0L, (const Bytef *)record, offsetof(AKSaveRecord, checksum));
+}
+
+/*!
+ @brief レコード作成
+
+ パラメータからレコードを作成し、チェックサムを設定する。
+ @param type レコード種別
+ @param stage ステージ番号
+ @param score スコア
+ @param time クリア時間
+ @param hit 命中率
+ @return レコード
+ */
+static AKSaveRecord AKMakeSaveRecord(enum AKSaveRecordType type, NSInteger stage,
+                                     NSInteger score, float time, NSInteger hit)
+{
+    AKSaveRecord record;
+
+    // パディングが不定値にならないように0クリアする
+    memset(&record, 0, sizeof(record));
+
+    record.magic = kAKSaveRecordMagic;
+    record.type = type;
+    record.stage = (uint16_t)MIN(MAX(stage, 0), UINT16_MAX);
+    record.score = (int32_t)score;
+    record.time = time;
+    record.hit = (int32_t)hit;
+    record.checksum = AKSaveRecordChecksum(&record);
+
+    return record;
+}
+
+/*!
+ @brief レコードの正当性チェック
+
+ 識別子とチェックサムを確認する。
+ @param record レコード
+ @return 正しいレコードの場合YES
+ */
+static BOOL AKIsValidSaveRecord(const AKSaveRecord *record)
+{
+    return (record->magic == kAKSaveRecordMagic &&
+            record->checksum == AKSaveRecordChecksum(record));
+}
+
+/*!
+ @brief ファイルパス取得
+
+ Documentsディレクトリ内のファイルパスを作成する。
+ @param fileName ファイル名
+ @return ファイルパス
+ */
+static NSString *AKSaveFilePath(NSString *fileName)
+{
+    // Documentsディレクトリへのパスを作成する
+    NSString *docDir = [NSHomeDirectory() stringByAppendingPathComponent:@"Documents"];
+
+    return [docDir stringByAppendingPathComponent:fileName];
+}
+
+/*!
+ @brief レコード列の反映
+
+ データに含まれるレコードを先頭から順に反映処理に渡す。
+ 不正なレコードが見つかった時点で処理を終了する。
+ @param data レコード列
+ @param apply レコードの反映処理
+ @return 正しく読み込めたデータの長さ
+ */
+static NSUInteger AKReplaySaveRecords(NSData *data, void (^apply)(const AKSaveRecord *record))
+{
+    const char *bytes = data.bytes;
+    NSUInteger pos = 0;
+
+    // 1レコード分のデータが残っている間は処理を続ける
+    while (pos + sizeof(AKSaveRecord) <= data.length) {
+
+        // アラインメントを揃えるためコピーする
+        AKSaveRecord record;
+        memcpy(&record, bytes + pos, sizeof(record));
+
+        // 不正なレコードの場合は処理を終了する
+        if (!AKIsValidSaveRecord(&record)) {
+            AKLog(1, @"不正なレコード:pos=%d", pos);
+            break;
+        }
+
+        // 反映する
+        apply(&record);
+
+        pos += sizeof(AKSaveRecord);
+    }
+
+    return pos;
+}
+
+/*!
+ @brief ジャーナルを開く
+
+ ジャーナルの正しいレコードを先頭から反映処理に渡し、追記モードで開く。
+ 末尾に書き込み途中のレコードや不正なデータがある場合は、正しく読み込めた長さに切り捨てる。
+ @param path ジャーナルファイルのパス
+ @param recordCount 正しく読み込めたレコード数
+ @param apply レコードの反映処理
+ @return ファイルディスクリプタ。開けない場合は-1。
+ */
+static int AKOpenSaveJournal(NSString *path, NSInteger *recordCount, void (^apply)(const AKSaveRecord *record))
+{
+    // ジャーナルを読み込む
+    NSData *journal = [NSData dataWithContentsOfFile:path];
+    NSUInteger validLength = AKReplaySaveRecords(journal, apply);
+    *recordCount = validLength / sizeof(AKSaveRecord);
+
+    // ジャーナルファイルを追記モードで開く
+    int fd = open([path fileSystemRepresentation], O_WRONLY | O_CREAT | O_APPEND, 0644);
+    AKLog(fd < 0, @"ジャーナルファイルを開けない:errno=%d", errno);
+
+    // 書き込み途中のレコードが残っている場合は切り捨てる
+    if (fd >= 0 && validLength < journal.length) {
+        AKLog(1, @"ジャーナル末尾を切り捨て:%d -> %d", journal.length, validLength);
+        ftruncate(fd, validLength);
+    }
+
+    return fd;
+}
+
+/*!
+ @brief ジャーナルへのレコード追記
+
+ レコードをジャーナルの末尾に追記してストレージに反映する。
+ 書き込みが途中で失敗した場合は、書き込み途中のレコードの後ろに追記したレコードが
+ 読み込み時に捨てられないように、追記前の長さに戻す。
+ @param fd ジャーナルファイルのファイルディスクリプタ
+ @param record レコード
+ @return 追記できた場合YES
+ */
+static BOOL AKAppendSaveJournal(int fd, const AKSaveRecord *record)
+{
+    // 失敗時に戻せるように追記前の長さを取得する
+    off_t offset = lseek(fd, 0, SEEK_END);
+    if (offset < 0) {
+        AKLog(1, @"ジャーナルの長さを取得できない:errno=%d", errno);
+        return NO;
+    }
+
+    // レコードを追記する
+    ssize_t size = write(fd, record, sizeof(*record));
+    if (size != sizeof(*record)) {
+        AKLog(1, @"ジャーナル書き込み失敗:size=%d errno=%d", size, errno);
+        ftruncate(fd, offset);
+        return NO;
+    }
+
+    // ストレージに反映する
+    fsync(fd);
+
+    return YES;
+}
+
+/*!
+ @brief セーブデータ管理クラス
+
+ ハイスコアやステージごとの記録を管理する。
+ 記録はメモリ上にキャッシュし、更新内容はバックグラウンドのキューから
+ チェックサム付きのレコードとしてジャーナルファイルに追記する。
+ ジャーナルが一定数たまった時点でスナップショットに書き出してジャーナルを空にする。
+ */
+@implementation AKSaveStore
+
+// シングルトンオブジェクト
+static AKSaveStore *sharedStore_ = nil;
+
+/*!
+ @brief シングルトンオブジェクト取得
+
+ シングルトンオブジェクトを取得する。
+ まだ生成されていない場合は生成を行う。
+ @return シングルトンオブジェクト
+ */
++ (AKSaveStore *)sharedStore
+{
+    // 他のスレッドで同時に実行されないようにする
+    @synchronized(self) {
+
+        // シングルトンオブジェクトが生成されていない場合は生成する
+        if (!sharedStore_) {
+            sharedStore_ = [[AKSaveStore alloc] init];
+        }
+
+        return sharedStore_;
+    }
+
+    return nil;
+}
+
+/*!
+ @brief インスタンス生成処理
+
+ インスタンス生成処理。
+ シングルトンのため、二重に生成された場合はアサーションを出力する。
+ */
++ (id)alloc
+{
+    // 他のスレッドで同時に実行されないようにする
+    @synchronized(self) {
+
+        NSAssert(sharedStore_ == nil, @"Attempted to allocate a second instance of a singleton.");
+        return [super alloc];
+    }
+
+    return nil;
+}
+
+/*!
+ @brief インスタンス初期化処理
+
+ インスタンス初期化。
+ ファイル入出力用のキューを作成し、ファイルの読み込みをバックグラウンドで開始する。
+ */
+- (id)init
+{
+    // スーパークラスの初期化処理を実行する
+    self = [super init];
+    if (!self) {
+        return nil;
+    }
+
+    // メンバを初期化する
+    journalFd_ = -1;
+    journalCount_ = 0;
+    isLoaded_ = NO;
+    hiScore_ = 0;
+    for (int i = 0; i < kAKSaveStageCount; i++) {
+        stageScore_[i] = 0;
+        stageTime_[i] = 0.0f;
+        stageHit_[i] = 0;
+    }
+
+    // ファイル入出力用のキューを作成する
+    queue_ = dispatch_queue_create("com.monochromesoft.keigeki.savestore", DISPATCH_QUEUE_SERIAL);
+
+    // ファイルの読み込みを開始する
+    dispatch_async(queue_, ^{
+        [self load];
+    });
+
+    return self;
+}
+
+/*!
+ @brief インスタンス解放処理
+
+ インスタンス解放処理。
+ 書き込み完了を待ってからファイルを閉じる。
+ */
+- (void)dealloc
+{
+    // 書き込みの完了を待つ
+    [self waitUntilWritten];
+
+    // ジャーナルファイルを閉じる
+    if (journalFd_ >= 0) {
+        close(journalFd_);
+    }
+
+    // キューを解放する
+    dispatch_release(queue_);
+
+    // スーパークラスの解放処理を実行する
+    [super dealloc];
+}
+
+/*!
+ @brief ファイル読み込み
+
+ スナップショットとジャーナルを読み込み、キャッシュに反映する。
+ スナップショットがない場合は旧形式のハイスコアファイルを取り込む。
+ ジャーナルの末尾に書き込み途中のレコードがある場合は切り捨てる。
+ ファイル入出力用のキューから呼び出すこと。
+ */
+- (void)load
+{
+    AKLog(1, @"start load");
+
+    // スナップショットを読み込む
+    NSData *snapshot = [NSData dataWithContentsOfFile:AKSaveFilePath(kAKSnapshotFileName)];
+    if (snapshot != nil) {
+        AKReplaySaveRecords(snapshot, ^(const AKSaveRecord *record) {
+            [self applyRecord:record];
+        });
+    }
+    // スナップショットがない場合は旧形式のファイルを読み込む
+    else {
+        NSData *legacy = [NSData dataWithContentsOfFile:AKSaveFilePath(kAKLegacyFileName)];
+        if (legacy != nil) {
+
+            // ファイルからデコーダーを生成する
+            NSKeyedUnarchiver *decoder = [[[NSKeyedUnarchiver alloc] initForReadingWithData:legacy] autorelease];
+
+            // ハイスコアをデコードする
+            AKHiScoreFile *hiScore = [decoder decodeObjectForKey:kAKLegacyFileKey];
+
+            // デコードを完了する
+            [decoder finishDecoding];
+
+            // キャッシュに反映する
+            AKSaveRecord record = AKMakeSaveRecord(kAKSaveRecordHiScore, 0, hiScore.hiscore, 0.0f, 0);
+            [self applyRecord:&record];
+
+            AKLog(1, @"旧形式のハイスコアを取り込み:%d", hiScore.hiscore);
+        }
+    }
+
+    // ジャーナルを読み込み、追記モードで開く
+    journalFd_ = AKOpenSaveJournal(AKSaveFilePath(kAKJournalFileName), &journalCount_, ^(const AKSaveRecord *record) {
+        [self applyRecord:record];
+    });
+
+    // 読み込み完了とする
+    @synchronized(self) {
+        isLoaded_ = YES;
+    }
+
+    // ジャーナルが長い場合は圧縮する
+    if (journalCount_ >= kAKSaveCompactCount) {
+        [self compactInQueue];
+    }
+
+    AKLog(1, @"end load:hiScore=%d", hiScore_);
+}
+
+/*!
+ @brief レコードの反映
+
+ レコードの内容をキャッシュに反映する。
+ 記録は常に良い方の値を残すため、同じレコードを何度反映しても結果は変わらない。
+ @param record レコード
+ @return キャッシュが更新された場合YES
+ */
+- (BOOL)applyRecord:(const AKSaveRecord *)record
+{
+    BOOL isUpdated = NO;
+
+    @synchronized(self) {
+
+        switch (record->type) {
+            case kAKSaveRecordHiScore:
+                if (record->score > hiScore_) {
+                    hiScore_ = record->score;
+                    isUpdated = YES;
+                }
+                break;
+
+            case kAKSaveRecordStage:
+            {
+                // 範囲外のステージは無視する
+                NSInteger index = record->stage - 1;
+                if (index < 0 || index >= kAKSaveStageCount) {
+                    break;
+                }
+
+                // 最高スコア
+                if (record->score > stageScore_[index]) {
+                    stageScore_[index] = record->score;
+                    isUpdated = YES;
+                }
+
+                // 最短クリア時間
+                if (record->time > 0.0f &&
+                    (stageTime_[index] <= 0.0f || record->time < stageTime_[index])) {
+                    stageTime_[index] = record->time;
+                    isUpdated = YES;
+                }
+
+                // 最高命中率
+                if (record->hit > stageHit_[index]) {
+                    stageHit_[index] = record->hit;
+                    isUpdated = YES;
+                }
+            }
+                break;
+
+            default:
+                AKLog(1, @"不明なレコード種別:%d", record->type);
+                break;
+        }
+    }
+
+    return isUpdated;
+}
+
+/*!
+ @brief レコードの追記
+
+ ファイル入出力用のキューでレコードをジャーナルに追記する。
+ 呼び出し元はファイルの書き込みを待たない。
+ @param record レコード
+ */
+- (void)appendRecord:(AKSaveRecord)record
+{
+    dispatch_async(queue_, ^{
+
+        // ジャーナルファイルが開けていない場合は処理しない
+        if (journalFd_ < 0) {
+            return;
+        }
+
+        // レコードを追記する。失敗した場合は記録数に含めない。
+        if (!AKAppendSaveJournal(journalFd_, &record)) {
+            return;
+        }
+
+        // ジャーナルが一定数たまった場合は圧縮する
+        journalCount_++;
+        if (journalCount_ >= kAKSaveCompactCount) {
+            [self compactInQueue];
+        }
+    });
+}
+
+/*!
+ @brief 読み込み完了待ち
+
+ バックグラウンドでの読み込みが完了していない場合は完了を待つ。
+ 通常はアプリ起動直後に読み込みが完了しているため、待ちは発生しない。
+ */
+- (void)waitUntilLoaded
+{
+    BOOL isLoaded = NO;
+
+    @synchronized(self) {
+        isLoaded = isLoaded_;
+    }
+
+    // 読み込み処理はキューの先頭に積まれているため、空の処理の完了を待てばよい
+    if (!isLoaded) {
+        AKLog(1, @"読み込み完了待ち");
+        dispatch_sync(queue_, ^{});
+    }
+}
+
+/*!
+ @brief ハイスコア取得
+
+ キャッシュしているハイスコアを取得する。
+ @return ハイスコア
+ */
+- (NSInteger)hiScore
+{
+    [self waitUntilLoaded];
+
+    @synchronized(self) {
+        return hiScore_;
+    }
+}
+
+/*!
+ @brief ハイスコアの非同期取得
+
+ 読み込みが完了している場合はキャッシュしているハイスコアをすぐに渡す。
+ 完了していない場合は読み込みの完了を待たずに戻り、完了後にメインスレッドで渡す。
+ @param completion ハイスコアを受け取る処理
+ */
+- (void)hiScoreWithCompletion:(void (^)(NSInteger hiScore))completion
+{
+    BOOL isLoaded = NO;
+
+    @synchronized(self) {
+        isLoaded = isLoaded_;
+    }
+
+    // 読み込みが完了している場合はすぐに渡す
+    if (isLoaded) {
+        completion([self hiScore]);
+        return;
+    }
+
+    // 読み込み処理はキューの先頭に積まれているため、その後でメインスレッドに渡す
+    dispatch_async(queue_, ^{
+
+        NSInteger hiScore = 0;
+        @synchronized(self) {
+            hiScore = hiScore_;
+        }
+
+        dispatch_async(dispatch_get_main_queue(), ^{
+            completion(hiScore);
+        });
+    });
+}
+
+/*!
+ @brief ハイスコア更新
+
+ ハイスコアを更新する。キャッシュを更新し、ジャーナルへの追記をキューに積む。
+ @param score スコア
+ */
+- (void)updateHiScore:(NSInteger)score
+{
+    AKSaveRecord record = AKMakeSaveRecord(kAKSaveRecordHiScore, 0, score, 0.0f, 0);
+
+    // キャッシュが更新された場合のみジャーナルに追記する
+    if ([self applyRecord:&record]) {
+        [self appendRecord:record];
+    }
+}
+
+/*!
+ @brief ステージの記録更新
+
+ ステージクリア時の記録を更新する。キャッシュを更新し、ジャーナルへの追記をキューに積む。
+ @param stage ステージ番号
+ @param score スコア
+ @param time クリア時間
+ @param hit 命中率
+ */
+- (void)updateStage:(NSInteger)stage score:(NSInteger)score time:(float)time hit:(NSInteger)hit
+{
+    AKSaveRecord record = AKMakeSaveRecord(kAKSaveRecordStage, stage, score, time, hit);
+
+    // キャッシュが更新された場合のみジャーナルに追記する
+    if ([self applyRecord:&record]) {
+        [self appendRecord:record];
+    }
+}
+
+/*!
+ @brief ステージの最高スコア取得
+
+ ステージの最高スコアを取得する。
+ @param stage ステージ番号
+ @return 最高スコア。記録がない場合は0。
+ */
+- (NSInteger)bestScoreOfStage:(NSInteger)stage
+{
+    [self waitUntilLoaded];
+
+    // 範囲外のステージは記録なしとする
+    if (stage < 1 || stage > kAKSaveStageCount) {
+        return 0;
+    }
+
+    @synchronized(self) {
+        return stageScore_[stage - 1];
+    }
+}
+
+/*!
+ @brief ステージの最短クリア時間取得
+
+ ステージの最短クリア時間を取得する。
+ @param stage ステージ番号
+ @return 最短クリア時間。記録がない場合は0。
+ */
+- (float)clearTimeOfStage:(NSInteger)stage
+{
+    [self waitUntilLoaded];
+
+    // 範囲外のステージは記録なしとする
+    if (stage < 1 || stage > kAKSaveStageCount) {
+        return 0.0f;
+    }
+
+    @synchronized(self) {
+        return stageTime_[stage - 1];
+    }
+}
+
+/*!
+ @brief ステージの最高命中率取得
+
+ ステージの最高命中率を取得する。
+ @param stage ステージ番号
+ @return 最高命中率。記録がない場合は0。
+ */
+- (NSInteger)hitRateOfStage:(NSInteger)stage
+{
+    [self waitUntilLoaded];
+
+    // 範囲外のステージは記録なしとする
+    if (stage < 1 || stage > kAKSaveStageCount) {
+        return 0;
+    }
+
+    @synchronized(self) {
+        return stageHit_[stage - 1];
+    }
+}
+
+/*!
+ @brief ジャーナルの圧縮
+
+ ジャーナルの圧縮をキューに積む。呼び出し元は書き込みを待たない。
+ */
+- (void)compact
+{
+    [self compactWithCompletion:nil];
+}
+
+/*!
+ @brief 完了処理を指定したジャーナルの圧縮
+
+ ジャーナルの圧縮をキューに積み、書き込み完了後にメインスレッドで完了処理を呼び出す。
+ 呼び出し元は書き込みを待たない。
+ @param completion 完了処理。不要な場合はnil。
+ */
+- (void)compactWithCompletion:(void (^)(void))completion
+{
+    dispatch_async(queue_, ^{
+
+        [self compactInQueue];
+
+        if (completion != nil) {
+            dispatch_async(dispatch_get_main_queue(), completion);
+        }
+    });
+}
+
+/*!
+ @brief ジャーナルの圧縮(キュー内処理)
+
+ キャッシュの内容をスナップショットに書き出し、ジャーナルを空にする。
+ スナップショットはアトミックに置き換えるため、途中で終了しても
+ 古いスナップショットとジャーナルの組み合わせから同じ内容を復元できる。
+ ファイル入出力用のキューから呼び出すこと。
+ */
+- (void)compactInQueue
+{
+    AKLog(1, @"start compact:journalCount=%d", journalCount_);
+
+    NSMutableData *data = [NSMutableData dataWithCapacity:sizeof(AKSaveRecord) * (kAKSaveStageCount + 1)];
+
+    // キャッシュの内容をレコードに変換する
+    @synchronized(self) {
+
+        // ハイスコア
+        AKSaveRecord record = AKMakeSaveRecord(kAKSaveRecordHiScore, 0, hiScore_, 0.0f, 0);
+        [data appendBytes:&record length:sizeof(record)];
+
+        // ステージごとの記録
+        for (int i = 0; i < kAKSaveStageCount; i++) {
+            record = AKMakeSaveRecord(kAKSaveRecordStage, i + 1, stageScore_[i], stageTime_[i], stageHit_[i]);
+            [data appendBytes:&record length:sizeof(record)];
+        }
+    }
+
+    // スナップショットを書き込む。失敗した場合はジャーナルを残す。
+    if (![data writeToFile:AKSaveFilePath(kAKSnapshotFileName) atomically:YES]) {
+        AKLog(1, @"スナップショット書き込み失敗");
+        return;
+    }
+
+    // ジャーナルを空にする
+    if (journalFd_ >= 0) {
+        ftruncate(journalFd_, 0);
+        fsync(journalFd_);
+    }
+    journalCount_ = 0;
+}
+
+/*!
+ @brief 書き込み完了待ち
+
+ キューに積まれたファイル書き込みがすべて完了するまで待つ。
+ アプリ終了時など、書き込みを確実に完了させたい場合に使用する。
+ */
+- (void)waitUntilWritten
+{
+    dispatch_sync(queue_, ^{});
+}
+@end
+
+#if AK_PROFILE
+/// 確認に使うジャーナルファイル名
+static NSString *kAKJournalCheckFileName = @"savedata-check.journal";
+/// 確認で書き込む正しいレコードの数
+enum {
+    kAKJournalCheckRecordCount = 5
+};
+
+/*!
+ @brief 確認用のジャーナルの読み込み
+
+ ジャーナルを開き直し、読み込めたレコード数とファイルの長さを確認する。
+ @param path ジャーナルファイルのパス
+ @param expectedCount 読み込めるはずのレコード数
+ @param lastScore 最後に読み込めるはずのレコードのスコア
+ @param name 確認項目の名前
+ @return 期待通りの場合YES
+ */
+static BOOL AKCheckSaveJournal(NSString *path, NSInteger expectedCount, NSInteger lastScore, NSString *name)
+{
+    __block NSInteger replayCount = 0;
+    __block NSInteger replayScore = -1;
+    NSInteger recordCount = 0;
+
+    int fd = AKOpenSaveJournal(path, &recordCount, ^(const AKSaveRecord *record) {
+        replayCount++;
+        replayScore = record->score;
+    });
+    if (fd < 0) {
+        AKLog(1, @"ジャーナル確認:%@ NG(open)", name);
+        return NO;
+    }
+    close(fd);
+
+    // 正しいレコードがすべて反映され、ファイルがその長さに切り捨てられていることを確認する
+    unsigned long long length = [[[NSFileManager defaultManager] attributesOfItemAtPath:path error:NULL] fileSize];
+    BOOL isSuccess = (replayCount == expectedCount &&
+                      recordCount == expectedCount &&
+                      replayScore == lastScore &&
+                      length == expectedCount * sizeof(AKSaveRecord));
+
+    AKLog(1, @"ジャーナル確認:%@ %@ replay=%d/%d length=%llu",
+          name, isSuccess ? @"OK" : @"NG", replayCount, expectedCount, length);
+
+    return isSuccess;
+}
+
+/*!
+ @brief 確認用のジャーナルへの書き込み
+
+ ジャーナルファイルの末尾にデータを直接追加し、書き込み途中での終了やデータ破損を模擬する。
+ @param path ジャーナルファイルのパス
+ @param bytes 追加するデータ
+ @param length 追加するデータの長さ
+ */
+static void AKAppendRawSaveJournal(NSString *path, const void *bytes, size_t length)
+{
+    int fd = open([path fileSystemRepresentation], O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (fd < 0) {
+        return;
+    }
+    write(fd, bytes, length);
+    close(fd);
+}
+
+/*!
+ @brief ジャーナルの障害時の整合性確認
+
+ 一時ディレクトリのジャーナルに対して、書き込み途中のレコード、チェックサムが不正なレコード、
+ 書き込みに失敗した追記をそれぞれ発生させ、読み込み直したときに正しいレコードのみが反映され、
+ ジャーナルが正しく読み込めた長さに切り捨てられることを確認する。
+ セーブデータ本体のファイルには触れない。
+ @return すべての確認に成功した場合YES
+ */
+BOOL AKSaveStoreJournalCheck(void)
+{
+    NSString *path = [NSTemporaryDirectory() stringByAppendingPathComponent:kAKJournalCheckFileName];
+    [[NSFileManager defaultManager] removeItemAtPath:path error:NULL];
+
+    BOOL isSuccess = YES;
+    NSInteger count = 0;
+
+    // 正しいレコードを書き込む
+    int fd = AKOpenSaveJournal(path, &count, ^(const AKSaveRecord *record) {});
+    if (fd < 0) {
+        return NO;
+    }
+    for (int i = 0; i < kAKJournalCheckRecordCount; i++) {
+        AKSaveRecord record = AKMakeSaveRecord(kAKSaveRecordHiScore, 0, i + 1, 0.0f, 0);
+        AKAppendSaveJournal(fd, &record);
+    }
+    close(fd);
+    isSuccess &= AKCheckSaveJournal(path, kAKJournalCheckRecordCount, kAKJournalCheckRecordCount, @"valid");
+
+    // 書き込み途中で終了したレコードを末尾に追加する
+    AKSaveRecord torn = AKMakeSaveRecord(kAKSaveRecordHiScore, 0, 100, 0.0f, 0);
+    AKAppendRawSaveJournal(path, &torn, sizeof(torn) / 2);
+    isSuccess &= AKCheckSaveJournal(path, kAKJournalCheckRecordCount, kAKJournalCheckRecordCount, @"torn");
+
+    // チェックサムが不正なレコードと、その後ろの正しいレコードを追加する
+    // 不正なレコード以降は反映されずに切り捨てられる
+    AKSaveRecord garbage = AKMakeSaveRecord(kAKSaveRecordHiScore, 0, 200, 0.0f, 0);
+    garbage.score ^= 0x5A5A;
+    AKSaveRecord after = AKMakeSaveRecord(kAKSaveRecordHiScore, 0, 300, 0.0f, 0);
+    AKAppendRawSaveJournal(path, &garbage, sizeof(garbage));
+    AKAppendRawSaveJournal(path, &after, sizeof(after));
+    isSuccess &= AKCheckSaveJournal(path, kAKJournalCheckRecordCount, kAKJournalCheckRecordCount, @"garbage");
+
+    // 書き込みに失敗する追記を行う(読み込み専用で開いたファイルへの書き込み)
+    fd = open([path fileSystemRepresentation], O_RDONLY);
+    if (fd >= 0) {
+        AKSaveRecord failed = AKMakeSaveRecord(kAKSaveRecordHiScore, 0, 400, 0.0f, 0);
+        isSuccess &= !AKAppendSaveJournal(fd, &failed);
+        close(fd);
+    }
+    isSuccess &= AKCheckSaveJournal(path, kAKJournalCheckRecordCount, kAKJournalCheckRecordCount, @"failed write");
+
+    // 切り捨て後に追記したレコードが読み込めることを確認する
+    fd = AKOpenSaveJournal(path, &count, ^(const AKSaveRecord *record) {});
+    if (fd >= 0) {
+        AKSaveRecord record = AKMakeSaveRecord(kAKSaveRecordHiScore, 0, 500, 0.0f, 0);
+        isSuccess &= AKAppendSaveJournal(fd, &record);
+        close(fd);
+    }
+    isSuccess &= AKCheckSaveJournal(path, kAKJournalCheckRecordCount + 1, 500, @"append after recovery");
+
+    [[NSFileManager defaultManager] removeItemAtPath:path error:NULL];
+
+    AKLog(1, @"ジャーナル確認結果:%@", isSuccess ? @"OK" : @"NG");
+
+    return isSuccess;
+}
+#endif
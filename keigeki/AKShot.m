@@ -93,4 +93,30 @@ static const NSInteger kAKShotRange = 600;
     // レイヤーに配置する
     [parent addChild:self.image z:z];
 }
+
+/*!
+ @brief 状態の保存
+
+ 共通の状態に加えて、移動距離を書き出す。
+ @param record 書き込み先
+ */
+- (void)saveRecord:(struct AKCharacterRecord *)record
+{
+    [super saveRecord:record];
+    
+    record->distance = distance_;
+}
+
+/*!
+ @brief 状態の復元
+
+ 共通の状態に加えて、移動距離を反映する。
+ @param record 保存した状態
+ */
+- (void)loadRecord:(const struct AKCharacterRecord *)record
+{
+    [super loadRecord:record];
+    
+    distance_ = record->distance;
+}
 @end
@@ -0,0 +1,57 @@
+/*
+ * Copyright (c) 2012-2013 Akihiro Kaneda.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   1.Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   2.Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ *   3.Neither the name of the Monochrome Soft nor the names of its contributors
+ *     may be used to endorse or promote products derived from this software
+ *     without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+/*!
+ @file AKStartupTrace.h
+ @brief 起動時間計測
+
+ アプリ起動時やシーン生成時の各処理の時間を記録する関数を定義する。
+ */
+
+#import <Foundation/Foundation.h>
+#import "AKTrace.h"
+
+/// 1回の計測で記録できる区切りの数
+enum {
+    kAKStartupTraceMarkCount = 32
+};
+
+#if AK_TRACE
+// 区切りの記録
+void AKStartupTraceMark(const char *label);
+// 計測結果の出力
+void AKStartupTraceReport(const char *title);
+
+/// 前回の区切りから現在までの時間を記録する
+#define AKTraceMark(label) AKStartupTraceMark(label)
+/// 記録した時間を出力して計測を開始し直す
+#define AKTraceReport(title) AKStartupTraceReport(title)
+#else
+#define AKTraceMark(label) do { } while (0)
+#define AKTraceReport(title) do { } while (0)
+#endif
@@ -0,0 +1,137 @@
+/*
+ * Copyright (c) 2012-2013 Akihiro Kaneda.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   1.Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   2.Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ *   3.Neither the name of the Monochrome Soft nor the names of its contributors
+ *     may be used to endorse or promote products derived from this software
+ *     without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+/*!
+ @file AKStartupTrace.m
+ @brief 起動時間計測
+
+ アプリ起動時やシーン生成時の各処理の時間を記録する関数を定義する。
+ */
+
+#import <QuartzCore/QuartzCore.h>
+#import <sys/sysctl.h>
+#import <sys/time.h>
+#import <unistd.h>
+#import "AKStartupTrace.h"
+#import "AKCommon.h"
+
+#if AK_TRACE
+
+/// 区切りの名前
+static const char *markLabels_[kAKStartupTraceMarkCount];
+/// 区切りの時刻
+static CFTimeInterval markTimes_[kAKStartupTraceMarkCount];
+/// 記録した区切りの数
+static NSInteger markCount_ = 0;
+/// 計測開始時刻
+static CFTimeInterval traceStart_ = 0.0;
+/// プロセス起動からmain関数実行までの時間を出力したかどうか
+static BOOL isPreMainReported_ = NO;
+
+/*!
+ @brief プロセス起動からの経過時間取得
+
+ カーネルからプロセスの起動時刻を取得し、現在までの経過時間を計算する。
+ main関数より前の処理(ライブラリの読み込みなど)の時間を含む。
+ @return 経過時間(秒)。取得できない場合は0。
+ */
+static double AKProcessUptime(void)
+{
+    struct kinfo_proc info;
+    size_t size = sizeof(info);
+    int mib[4] = {CTL_KERN, KERN_PROC, KERN_PROC_PID, getpid()};
+
+    if (sysctl(mib, 4, &info, &size, NULL, 0) != 0) {
+        return 0.0;
+    }
+
+    struct timeval now;
+    gettimeofday(&now, NULL);
+
+    struct timeval start = info.kp_proc.p_starttime;
+    return (now.tv_sec - start.tv_sec) + (now.tv_usec - start.tv_usec) / 1000000.0;
+}
+
+/*!
+ @brief 区切りの記録
+
+ 前回の区切りから現在までの時間を指定した名前で記録する。
+ 計測開始後の最初の呼び出しでは開始時刻のみを記録する。
+ アプリ起動時の最初の呼び出しではプロセス起動からの経過時間も出力する。
+ メインスレッドから呼び出すこと。
+ @param label 区切りの名前(文字列リテラル)
+ */
+void AKStartupTraceMark(const char *label)
+{
+    CFTimeInterval now = CACurrentMediaTime();
+
+    // プロセス起動からの経過時間を出力する
+    if (!isPreMainReported_) {
+        isPreMainReported_ = YES;
+        AKLog(1, @"startup pre-main:%.1fms", AKProcessUptime() * 1000.0);
+    }
+
+    // 計測開始時は開始時刻を記録する
+    if (traceStart_ == 0.0) {
+        traceStart_ = now;
+    }
+
+    // 記録領域がいっぱいの場合は記録しない
+    if (markCount_ >= kAKStartupTraceMarkCount) {
+        return;
+    }
+
+    markLabels_[markCount_] = label;
+    markTimes_[markCount_] = now;
+    markCount_++;
+}
+
+/*!
+ @brief 計測結果の出力
+
+ 記録した区切りごとに前の区切りからの時間と計測開始からの時間を出力し、記録をクリアする。
+ @param title 計測の名前
+ */
+void AKStartupTraceReport(const char *title)
+{
+    CFTimeInterval prev = traceStart_;
+
+    AKLog(1, @"startup trace [%s]", title);
+
+    for (int i = 0; i < markCount_; i++) {
+        AKLog(1, @"  %-24s %8.2fms %8.2fms", markLabels_[i],
+              (markTimes_[i] - prev) * 1000.0, (markTimes_[i] - traceStart_) * 1000.0);
+        prev = markTimes_[i];
+    }
+
+    // 記録をクリアする
+    markCount_ = 0;
+    traceStart_ = 0.0;
+}
+
+#endif
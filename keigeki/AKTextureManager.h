@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) 2012-2013 Akihiro Kaneda.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   1.Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   2.Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ *   3.Neither the name of the Monochrome Soft nor the names of its contributors
+ *     may be used to endorse or promote products derived from this software
+ *     without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+/*!
+ @file AKTextureManager.h
+ @brief テクスチャ管理
+
+ テクスチャの使用状況を記録し、メモリの使用量を管理するクラスを定義する。
+ */
+
+#import <Foundation/Foundation.h>
+#import "cocos2d.h"
+
+// テクスチャ管理クラス
+@interface AKTextureManager : NSObject {
+    /// テクスチャごとのメモリ使用量(ファイル名をキーとする)
+    NSMutableDictionary *textureBytes_;
+    /// テクスチャごとの最終使用番号(ファイル名をキーとする)
+    NSMutableDictionary *lastUsed_;
+    /// シーンごとの使用テクスチャ(シーン名をキーとする)
+    NSMutableDictionary *sceneTextures_;
+    /// 常駐させるテクスチャ
+    NSMutableSet *commonTextures_;
+    /// 現在のシーン名
+    NSString *activeScene_;
+    /// 使用番号のカウンタ
+    NSUInteger useCounter_;
+    /// メモリ使用量の上限(バイト)
+    NSUInteger budget_;
+}
+
+/// 現在のシーン名
+@property (nonatomic, copy)NSString *activeScene;
+/// メモリ使用量の上限(バイト)
+@property (nonatomic)NSUInteger budget;
+
+// シングルトンオブジェクト取得
++ (AKTextureManager *)sharedManager;
+// シーンの開始
+- (void)beginScene:(NSString *)sceneName;
+// テクスチャの取得
+- (CCTexture2D *)textureForFile:(NSString *)fileName;
+// 常駐テクスチャの取得
+- (CCTexture2D *)commonTextureForFile:(NSString *)fileName;
+// テクスチャのメモリ使用量の合計
+- (NSUInteger)residentBytes;
+// 解放可能なテクスチャの取得
+- (NSArray *)evictableTextures;
+// テクスチャの解放
+- (void)evictTexture:(NSString *)fileName;
+// 上限を超えた分のテクスチャ解放
+- (void)trimToBudget;
+// メモリ不足時の処理
+- (void)didReceiveMemoryWarning;
+// メモリ使用量のレポート
+- (NSString *)residencyReport;
+@end
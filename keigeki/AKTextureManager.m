@@ -0,0 +1,373 @@
+/*
+ * Copyright (c) 2012-2013 Akihiro Kaneda.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   1.Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   2.Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ *   3.Neither the name of the Monochrome Soft nor the names of its contributors
+ *     may be used to endorse or promote products derived from this software
+ *     without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+/*!
+ @file AKTextureManager.m
+ @brief テクスチャ管理
+
+ テクスチャの使用状況を記録し、メモリの使用量を管理するクラスを定義する。
+ */
+
+#import "AKTextureManager.h"
+#import "AKCommon.h"
+
+/// テクスチャのメモリ使用量の上限(バイト)。iPadは画像サイズが縦横倍になるため4倍とする。
+static const NSUInteger kAKTextureBudget = 2 * 1024 * 1024;
+
+/// シングルトンオブジェクト
+static AKTextureManager *sharedManager_ = nil;
+
+/*!
+ @brief テクスチャ管理クラス
+
+ テクスチャの読み込みをCCTextureCache経由で行い、ファイルごとのメモリ使用量と最終使用順を記録する。
+ 読み込んだテクスチャは読み込み時のシーンの使用テクスチャとして登録する。
+ メモリ使用量が上限を超えた場合やメモリ不足の通知を受けた場合は、
+ 現在のシーンで使用しないテクスチャを最後に使用したのが古い順にキャッシュから取り除く。
+ 取り除いたテクスチャは次に要求されたときにファイルから読み込み直す。
+ スプライトなどから参照されているテクスチャは解放してもメモリが減らないため取り除かない。
+ */
+@implementation AKTextureManager
+
+@synthesize activeScene = activeScene_;
+@synthesize budget = budget_;
+
+/*!
+ @brief シングルトンオブジェクト取得
+
+ シングルトンオブジェクトを取得する。
+ まだ生成されていない場合は生成を行う。
+ @return シングルトンオブジェクト
+ */
++ (AKTextureManager *)sharedManager
+{
+    // 他のスレッドで同時に実行されないようにする
+    @synchronized(self) {
+
+        // シングルトンオブジェクトが生成されていない場合は生成する
+        if (!sharedManager_) {
+            sharedManager_ = [[AKTextureManager alloc] init];
+        }
+
+        return sharedManager_;
+    }
+
+    return nil;
+}
+
+/*!
+ @brief インスタンス生成処理
+
+ インスタンス生成処理。
+ シングルトンのため、二重に生成された場合はアサーションを出力する。
+ */
++ (id)alloc
+{
+    // 他のスレッドで同時に実行されないようにする
+    @synchronized(self) {
+
+        NSAssert(sharedManager_ == nil, @"Attempted to allocate a second instance of a singleton.");
+        return [super alloc];
+    }
+
+    return nil;
+}
+
+/*!
+ @brief オブジェクト生成処理
+
+ オブジェクトの生成を行う。
+ @return 生成したオブジェクト。失敗時はnilを返す。
+ */
+- (id)init
+{
+    // スーパークラスの生成処理
+    self = [super init];
+    if (!self) {
+        return nil;
+    }
+
+    // メンバを初期化する
+    textureBytes_ = [[NSMutableDictionary alloc] init];
+    lastUsed_ = [[NSMutableDictionary alloc] init];
+    sceneTextures_ = [[NSMutableDictionary alloc] init];
+    commonTextures_ = [[NSMutableSet alloc] init];
+    self.activeScene = nil;
+    useCounter_ = 0;
+
+    // メモリ使用量の上限を設定する
+    self.budget = kAKTextureBudget;
+    if (UI_USER_INTERFACE_IDIOM() == UIUserInterfaceIdiomPad) {
+        self.budget *= 4;
+    }
+
+    return self;
+}
+
+/*!
+ @brief インスタンス解放時処理
+
+ インスタンス解放時にオブジェクトを解放する。
+ */
+- (void)dealloc
+{
+    // メンバを解放する
+    [textureBytes_ release];
+    [lastUsed_ release];
+    [sceneTextures_ release];
+    [commonTextures_ release];
+    self.activeScene = nil;
+
+    // スーパークラスの解放処理
+    [super dealloc];
+}
+
+/*!
+ @brief シーンの開始
+
+ 現在のシーンを設定する。以降に読み込んだテクスチャはこのシーンの使用テクスチャとして登録する。
+ 前のシーンのテクスチャは上限を超えた場合に解放の対象となる。
+ @param sceneName シーン名
+ */
+- (void)beginScene:(NSString *)sceneName
+{
+    AKLog(1, @"シーン開始:%@", sceneName);
+
+    self.activeScene = sceneName;
+
+    // シーンの使用テクスチャの集合を作成する
+    if (![sceneTextures_ objectForKey:sceneName]) {
+        [sceneTextures_ setObject:[NSMutableSet set] forKey:sceneName];
+    }
+}
+
+/*!
+ @brief テクスチャの取得
+
+ テクスチャを取得する。キャッシュにない場合はファイルから読み込む。
+ テクスチャの最終使用順を更新し、現在のシーンの使用テクスチャとして登録する。
+ @param fileName 画像ファイル名
+ @return テクスチャ
+ */
+- (CCTexture2D *)textureForFile:(NSString *)fileName
+{
+    // キャッシュから取得する。キャッシュにない場合は読み込まれる。
+    CCTexture2D *texture = [[CCTextureCache sharedTextureCache] addImage:fileName];
+    NSAssert(texture != nil, @"テクスチャの読み込みに失敗:%@", fileName);
+
+    // 最終使用順を更新する
+    useCounter_++;
+    [lastUsed_ setObject:[NSNumber numberWithUnsignedInteger:useCounter_] forKey:fileName];
+
+    // 新しく読み込んだ場合はメモリ使用量を記録する
+    if (![textureBytes_ objectForKey:fileName]) {
+
+        NSUInteger bytes = texture.pixelsWide * texture.pixelsHigh * [texture bitsPerPixelForFormat] / 8;
+        [textureBytes_ setObject:[NSNumber numberWithUnsignedInteger:bytes] forKey:fileName];
+
+        AKLog(1, @"テクスチャ読み込み:%@ %dbytes", fileName, bytes);
+
+        // シーンの使用テクスチャとして登録する
+        if (self.activeScene) {
+            [[sceneTextures_ objectForKey:self.activeScene] addObject:fileName];
+        }
+        else {
+            [commonTextures_ addObject:fileName];
+        }
+
+        // 上限を超えている場合は古いテクスチャを解放する
+        [self trimToBudget];
+    }
+    else if (self.activeScene) {
+        [[sceneTextures_ objectForKey:self.activeScene] addObject:fileName];
+    }
+
+    return texture;
+}
+
+/*!
+ @brief 常駐テクスチャの取得
+
+ テクスチャを取得し、常駐させるテクスチャとして登録する。
+ フォントなど、全シーンで使用するテクスチャに使用する。
+ @param fileName 画像ファイル名
+ @return テクスチャ
+ */
+- (CCTexture2D *)commonTextureForFile:(NSString *)fileName
+{
+    [commonTextures_ addObject:fileName];
+
+    return [self textureForFile:fileName];
+}
+
+/*!
+ @brief テクスチャのメモリ使用量の合計
+
+ キャッシュに読み込まれているテクスチャのメモリ使用量の合計を取得する。
+ @return メモリ使用量(バイト)
+ */
+- (NSUInteger)residentBytes
+{
+    NSUInteger total = 0;
+
+    for (NSNumber *bytes in [textureBytes_ objectEnumerator]) {
+        total += [bytes unsignedIntegerValue];
+    }
+
+    return total;
+}
+
+/*!
+ @brief 解放可能なテクスチャの取得
+
+ 現在のシーンと常駐テクスチャに含まれず、スプライトなどから参照されていないテクスチャを
+ 最後に使用したのが古い順に並べて返す。
+ @return 解放可能なテクスチャのファイル名の配列
+ */
+- (NSArray *)evictableTextures
+{
+    NSSet *activeTextures = [sceneTextures_ objectForKey:self.activeScene];
+    NSMutableArray *evictable = [NSMutableArray array];
+
+    for (NSString *fileName in [textureBytes_ keyEnumerator]) {
+
+        // 現在のシーンのテクスチャと常駐テクスチャは対象外とする
+        if ([activeTextures containsObject:fileName] || [commonTextures_ containsObject:fileName]) {
+            continue;
+        }
+
+        // キャッシュ以外から参照されているものは解放してもメモリが減らないため対象外とする
+        CCTexture2D *texture = [[CCTextureCache sharedTextureCache] textureForKey:fileName];
+        if (texture != nil && [texture retainCount] > 1) {
+            continue;
+        }
+
+        [evictable addObject:fileName];
+    }
+
+    // 最終使用順の古い順に並べる
+    [evictable sortUsingComparator:^NSComparisonResult(id a, id b) {
+        return [[lastUsed_ objectForKey:a] compare:[lastUsed_ objectForKey:b]];
+    }];
+
+    return evictable;
+}
+
+/*!
+ @brief テクスチャの解放
+
+ テクスチャをキャッシュから取り除き、記録を削除する。
+ シーンの使用テクスチャの登録は残し、次に読み込まれたときも同じシーンのテクスチャとして扱う。
+ @param fileName 画像ファイル名
+ */
+- (void)evictTexture:(NSString *)fileName
+{
+    AKLog(1, @"テクスチャ解放:%@ %@bytes", fileName, [textureBytes_ objectForKey:fileName]);
+
+    [[CCTextureCache sharedTextureCache] removeTextureForKey:fileName];
+    [textureBytes_ removeObjectForKey:fileName];
+    [lastUsed_ removeObjectForKey:fileName];
+}
+
+/*!
+ @brief 上限を超えた分のテクスチャ解放
+
+ メモリ使用量が上限を超えている場合、解放可能なテクスチャを古い順に上限以下になるまで解放する。
+ */
+- (void)trimToBudget
+{
+    NSUInteger total = [self residentBytes];
+
+    // 上限以下の場合は無処理
+    if (total <= self.budget) {
+        return;
+    }
+
+    for (NSString *fileName in [self evictableTextures]) {
+
+        total -= [[textureBytes_ objectForKey:fileName] unsignedIntegerValue];
+        [self evictTexture:fileName];
+
+        if (total <= self.budget) {
+            break;
+        }
+    }
+}
+
+/*!
+ @brief メモリ不足時の処理
+
+ 解放可能なテクスチャをすべて解放する。
+ 現在のシーンのテクスチャは画面遷移までの読み込み直しを避けるため残す。
+ */
+- (void)didReceiveMemoryWarning
+{
+    AKLog(1, @"メモリ不足通知:\n%@", [self residencyReport]);
+
+    for (NSString *fileName in [self evictableTextures]) {
+        [self evictTexture:fileName];
+    }
+
+    AKLog(1, @"解放後:%dbytes", [self residentBytes]);
+}
+
+/*!
+ @brief メモリ使用量のレポート
+
+ テクスチャごとのメモリ使用量を最終使用順の新しい順に並べた文字列を作成する。
+ 現在のシーンのテクスチャには"*"、常駐テクスチャには"+"を付ける。
+ @return レポート文字列
+ */
+- (NSString *)residencyReport
+{
+    NSSet *activeTextures = [sceneTextures_ objectForKey:self.activeScene];
+    NSMutableString *report = [NSMutableString string];
+
+    // 最終使用順の新しい順に並べる
+    NSArray *fileNames = [[textureBytes_ allKeys] sortedArrayUsingComparator:^NSComparisonResult(id a, id b) {
+        return [[lastUsed_ objectForKey:b] compare:[lastUsed_ objectForKey:a]];
+    }];
+
+    for (NSString *fileName in fileNames) {
+
+        NSString *mark = @" ";
+        if ([commonTextures_ containsObject:fileName]) {
+            mark = @"+";
+        }
+        else if ([activeTextures containsObject:fileName]) {
+            mark = @"*";
+        }
+
+        [report appendFormat:@"%@%8u %@\n", mark, [[textureBytes_ objectForKey:fileName] unsignedIntegerValue], fileName];
+    }
+
+    [report appendFormat:@"total %u / budget %u", [self residentBytes], self.budget];
+
+    return report;
+}
+@end
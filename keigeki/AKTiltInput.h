@@ -0,0 +1,76 @@
+/*
+ * Copyright (c) 2012-2013 Akihiro Kaneda.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   1.Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   2.Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ *   3.Neither the name of the Monochrome Soft nor the names of its contributors
+ *     may be used to endorse or promote products derived from this software
+ *     without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+/*!
+ @file AKTiltInput.h
+ @brief 傾き入力管理
+
+ 加速度センサーの入力をタイムスタンプ付きで保持し、シミュレーション時刻に合わせて取り出すクラスを定義する。
+ */
+
+#import <Foundation/Foundation.h>
+
+/// 保持する入力の数
+enum {
+    kAKTiltSampleCount = 32
+};
+
+/// 傾き入力
+struct AKTiltSample {
+    /// 入力時刻(端末起動からの秒数)
+    double timestamp;
+    /// x方向の比率
+    float ax;
+    /// y方向の比率
+    float ay;
+};
+
+// 傾き入力管理クラス
+@interface AKTiltInput : NSObject {
+    /// 入力のリングバッファ
+    struct AKTiltSample samples_[kAKTiltSampleCount];
+    /// 次に書き込む位置
+    NSInteger next_;
+    /// 保持している入力の数
+    NSInteger count_;
+    /// 前回取り出した時刻
+    double lastTick_;
+    /// 前回取り出した入力の経過時間(秒)
+    double lastAge_;
+}
+
+/// 前回取り出した入力の経過時間(秒)
+@property (nonatomic, readonly)double lastAge;
+
+// 入力の追加
+- (void)addSampleAtTime:(double)timestamp x:(float)ax y:(float)ay;
+// シミュレーション時刻の入力取得
+- (BOOL)sampleAtTime:(double)tick x:(float *)ax y:(float *)ay;
+// 入力のクリア
+- (void)clear;
+@end
@@ -0,0 +1,189 @@
+/*
+ * Copyright (c) 2012-2013 Akihiro Kaneda.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   1.Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   2.Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ *   3.Neither the name of the Monochrome Soft nor the names of its contributors
+ *     may be used to endorse or promote products derived from this software
+ *     without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+/*!
+ @file AKTiltInput.m
+ @brief 傾き入力管理
+
+ 加速度センサーの入力をタイムスタンプ付きで保持し、シミュレーション時刻に合わせて取り出すクラスを定義する。
+ */
+
+#import "AKTiltInput.h"
+#import "AKCommon.h"
+
+/*!
+ @brief 傾き入力管理クラス
+
+ 加速度センサーの入力を受信時刻ではなくセンサーのタイムスタンプとともにリングバッファに保持する。
+ シミュレーションの更新時には前回の更新から今回の更新までの区間の入力を、
+ 各入力が次の入力まで保持されるものとして時間で重み付けした平均を求める。
+ センサーの更新間隔がフレームの更新間隔と異なる場合でも、フレームごとの入力の偏りを抑える。
+ */
+@implementation AKTiltInput
+
+@synthesize lastAge = lastAge_;
+
+/*!
+ @brief オブジェクト生成処理
+
+ オブジェクトの生成を行う。
+ @return 生成したオブジェクト。失敗時はnilを返す。
+ */
+- (id)init
+{
+    // スーパークラスの生成処理
+    self = [super init];
+    if (!self) {
+        return nil;
+    }
+
+    // 入力をクリアする
+    [self clear];
+
+    return self;
+}
+
+/*!
+ @brief 入力の追加
+
+ 入力をリングバッファに追加する。いっぱいの場合は最も古い入力を上書きする。
+ @param timestamp 入力時刻(端末起動からの秒数)
+ @param ax x方向の比率
+ @param ay y方向の比率
+ */
+- (void)addSampleAtTime:(double)timestamp x:(float)ax y:(float)ay
+{
+    samples_[next_].timestamp = timestamp;
+    samples_[next_].ax = ax;
+    samples_[next_].ay = ay;
+
+    next_ = (next_ + 1) % kAKTiltSampleCount;
+    if (count_ < kAKTiltSampleCount) {
+        count_++;
+    }
+}
+
+/*!
+ @brief シミュレーション時刻の入力取得
+
+ 前回の取得時刻から今回の取得時刻までの区間の入力を時間で重み付けした平均を求める。
+ 区間の開始時点の値はその直前の入力とする。
+ 初回や区間が長すぎる場合は、区間をフレーム1回分程度に制限する。
+ @param tick シミュレーション時刻(端末起動からの秒数)
+ @param ax x方向の比率
+ @param ay y方向の比率
+ @return 入力がある場合YES
+ */
+- (BOOL)sampleAtTime:(double)tick x:(float *)ax y:(float *)ay
+{
+    // 平均を求める区間の最大長
+    const double kAKMaxWindow = 1.0 / 30.0;
+
+    // 入力がない場合は無処理
+    if (count_ <= 0) {
+        return NO;
+    }
+
+    // 区間の開始時刻を決める
+    double windowStart = lastTick_;
+    if (windowStart <= 0.0 || tick - windowStart > kAKMaxWindow) {
+        windowStart = tick - kAKMaxWindow;
+    }
+    lastTick_ = tick;
+
+    // 新しい入力から順に区間内の値を積算する
+    double sumx = 0.0;
+    double sumy = 0.0;
+    double sumTime = 0.0;
+    double segmentEnd = tick;
+    const struct AKTiltSample *newest = NULL;
+
+    for (NSInteger i = 0; i < count_; i++) {
+
+        const struct AKTiltSample *sample = &samples_[(next_ - 1 - i + kAKTiltSampleCount) % kAKTiltSampleCount];
+
+        // シミュレーション時刻より後の入力は次回に使用する
+        if (sample->timestamp > tick) {
+            continue;
+        }
+
+        if (newest == NULL) {
+            newest = sample;
+        }
+
+        // この入力が保持されていた期間のうち区間内の部分を積算する
+        double segmentStart = MAX(sample->timestamp, windowStart);
+        if (segmentEnd > segmentStart) {
+            sumx += sample->ax * (segmentEnd - segmentStart);
+            sumy += sample->ay * (segmentEnd - segmentStart);
+            sumTime += segmentEnd - segmentStart;
+        }
+
+        // 区間の開始より前の入力まで積算したら終了する
+        if (sample->timestamp <= windowStart) {
+            break;
+        }
+        segmentEnd = sample->timestamp;
+    }
+
+    // 有効な入力がない場合は無処理
+    if (newest == NULL) {
+        return NO;
+    }
+
+    // 区間内に長さがない場合は最新の入力を使用する
+    if (sumTime <= 0.0) {
+        *ax = newest->ax;
+        *ay = newest->ay;
+    }
+    else {
+        *ax = sumx / sumTime;
+        *ay = sumy / sumTime;
+    }
+
+    // 使用した最新の入力の経過時間を記録する
+    lastAge_ = tick - newest->timestamp;
+
+    AKLog(0, @"ax=%f ay=%f age=%f", *ax, *ay, lastAge_);
+
+    return YES;
+}
+
+/*!
+ @brief 入力のクリア
+
+ 保持している入力をすべて破棄する。
+ */
+- (void)clear
+{
+    next_ = 0;
+    count_ = 0;
+    lastTick_ = 0.0;
+    lastAge_ = 0.0;
+}
+@end
@@ -35,6 +35,7 @@
 
 #import <Foundation/Foundation.h>
 #import "AKInterface.h"
+#import "AKGameScene.h"
 #import "cocos2d.h"
 
 // タイトルシーンクラス
@@ -44,8 +45,14 @@
 
 // インターフェースレイヤーの取得
 - (AKInterface *)interface;
+// ゲームプレイシーンの事前生成
+- (void)prepareGameScene:(ccTime)dt;
+// ゲームモードの取得
+- (enum AKGameMode)gameMode;
 // ゲームの開始
 - (void)startGame;
+// 対戦の開始
+- (void)startVersus;
 // 遊び方画面の開始
 - (void)startHowTo;
 // オプション画面の開始
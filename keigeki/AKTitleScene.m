@@ -34,9 +34,9 @@
  */
 
 #import "AKTitleScene.h"
+#import "AKTextureManager.h"
 #import "AKInterface.h"
 #import "AKLabel.h"
-#import "AKGameScene.h"
 #import "AKHowToPlayScene.h"
 #import "AKScreenSize.h"
 #import "AKCommon.h"
@@ -45,6 +45,7 @@
 #import "AKOptionScene.h"
 #import "AKInAppPurchaseHelper.h"
 #import "AKCreditScene.h"
+#import "AKStartupTrace.h"
 
 /// メニュー項目のタグ
 enum {
@@ -52,6 +53,7 @@ enum {
     kAKTitleMenuHowTo,      ///< 遊び方ボタン
     kAKTitleMenuOption,     ///< オプションボタン
     kAKTitleMenuCredit,     ///< クレジットボタン
+    kAKTitleMenuVersus,     ///< 対戦ボタン
     kAKTitleMenuCount       ///< メニュー項目数
 };
 
@@ -72,13 +74,15 @@ static NSString *kAKHowToPlayCaption = @"HOW TO PLAY";
 static NSString *kAKOptionCaption = @"OPTION     ";
 /// クレジット画面メニューのキャプション
 static NSString *kAKCreditCaption = @"CREDIT     ";
+/// 対戦メニューのキャプション
+static NSString *kAKVersusCaption = @"VERSUS     ";
 
 /// タイトルの位置、横方向の中心からの位置
 static const float kAKTitlePosFromHorizontalCenterPoint = -100.0f;
 /// タイトルの位置、上からの比率
 static const float kAKTitlePosFromTopRatio = 0.45f;
 /// メニュー項目の数
-static const NSInteger kAKMenuItemCount = 3;
+static const NSInteger kAKMenuItemCount = 4;
 /// メニュー項目の位置、右からの位置
 static const float kAKMenuPosRightPoint = 120.0f;
 /// ゲーム開始メニューのキャプションの表示位置、上からの比率
@@ -91,6 +95,8 @@ static const float kAKOptionMenuPosTopRatio = 0.55f;
 static const float kAKCreditMenuPosTopRatio = 0.75f;
 /// メニュー位置広告のマージン
 static const float kAKAdMarginPosRatio = 0.05f;
+/// タイトル画面表示からゲームプレイシーンを事前生成するまでの時間
+static const ccTime kAKPrepareGameSceneDelay = 0.5f;
 
 /// 各ノードのz座標
 enum {
@@ -122,6 +128,9 @@ enum {
         return nil;
     }
     
+    // このシーンで使用するテクスチャを登録する
+    [[AKTextureManager sharedManager] beginScene:NSStringFromClass([self class])];
+    
     // 背景レイヤーを配置する
     [self addChild:AKCreateBackColorLayer() z:kAKTitleBackground tag:kAKTitleBackground];
     
@@ -140,7 +149,7 @@ enum {
     }
     
     // タイトル画像を読み込む
-    CCSprite *image = [CCSprite spriteWithFile:kAKTitleImage];
+    CCSprite *image = [CCSprite spriteWithTexture:[[AKTextureManager sharedManager] textureForFile:kAKTitleImage]];
     NSAssert(image != nil, @"can not open title image : %@", kAKTitleImage);
     
     // 配置位置を設定する
@@ -186,6 +195,17 @@ enum {
                              tag:kAKTitleMenuCredit
                        withFrame:YES];
     
+    // 対戦相手が設定されている場合は対戦のメニューをタイトルの下に作成する
+    if ([AKVersusSession isConfigured]) {
+        [interface addMenuWithString:kAKVersusCaption
+                               atPos:ccp([AKScreenSize positionFromHorizontalCenterPoint:kAKTitlePosFromHorizontalCenterPoint],
+                                         [AKScreenSize positionFromTopRatio:kAKCreditMenuPosTopRatio + adMargin])
+                              action:@selector(startVersus)
+                                   z:0
+                                 tag:kAKTitleMenuVersus
+                           withFrame:YES];
+    }
+    
     // すべてのメニュー項目を有効とする
     interface.enableTag = 0xFFFFFFFFUL;
     
@@ -204,20 +224,89 @@ enum {
     return (AKInterface *)[self getChildByTag:kAKTitleInterface];
 }
 
+/*!
+ @brief トランジション終了時の処理
+ 
+ トランジション終了時の処理。
+ タイトル画面の表示が落ち着いてからゲームプレイシーンを事前生成する。
+ */
+- (void)onEnterTransitionDidFinish
+{
+    // スーパークラスの処理を実行する
+    [super onEnterTransitionDidFinish];
+    
+    // ゲームプレイシーンを事前生成する
+    [self scheduleOnce:@selector(prepareGameScene:) delay:kAKPrepareGameSceneDelay];
+}
+
+/*!
+ @brief ゲームプレイシーンの事前生成
+ 
+ ゲーム開始時にシーンの生成を待たずに遷移できるように、ゲームプレイシーンを生成しておく。
+ @param dt フレーム更新間隔
+ */
+- (void)prepareGameScene:(ccTime)dt
+{
+    [AKGameScene prepareWarmSceneWithMode:[self gameMode]];
+}
+
+/*!
+ @brief ゲームモードの取得
+ 
+ 開始するゲームモードを取得する。
+ デバッグ時は起動引数"-AKStressMode YES"で負荷試験モードとする。
+ @return ゲームモード
+ */
+- (enum AKGameMode)gameMode
+{
+#ifdef DEBUG
+    if ([[NSUserDefaults standardUserDefaults] boolForKey:@"AKStressMode"]) {
+        return kAKGameModeStress;
+    }
+#endif
+    
+    return kAKGameModeNormal;
+}
+
 /*!
  @brief ゲームの開始
  
- ゲームを開始する。ゲームシーンへと遷移する。
+ ゲームを開始する。事前生成したゲームシーンをリセットして遷移する。
  */
 - (void)startGame
 {
     AKLog(0, @"startGame");
     
+    // ゲーム開始の操作から最初のフレームまでの時間の計測を開始する
+    AKTraceMark("game start");
+    
     // ボタン選択エフェクトを発生させる
     [self selectButton:kAKTitleMenuGame];
     
     // ゲームシーンへの遷移を作成する
-    CCTransitionFade *transition = [CCTransitionFade transitionWithDuration:0.5f scene:[AKGameScene node]];
+    CCTransitionFade *transition = [CCTransitionFade transitionWithDuration:0.5f
+                                                                      scene:[AKGameScene warmSceneWithMode:[self gameMode]]];
+    
+    // ゲームシーンへ遷移する
+    [[CCDirector sharedDirector] replaceScene:transition];
+}
+
+/*!
+ @brief 対戦の開始
+ 
+ 対戦を開始する。対戦モードのゲームシーンへと遷移する。
+ 対戦相手は起動引数"-AKVersusHost"と"-AKVersusPlayer"で指定する。
+ */
+- (void)startVersus
+{
+    AKLog(1, @"startVersus");
+    
+    // ボタン選択エフェクトを発生させる
+    [self selectButton:kAKTitleMenuVersus];
+    
+    // ゲームシーンへの遷移を作成する
+    CCTransitionFade *transition = [CCTransitionFade transitionWithDuration:0.5f
+                                                                      scene:[AKGameScene warmSceneWithMode:kAKGameModeVersus]];
     
     // ゲームシーンへ遷移する
     [[CCDirector sharedDirector] replaceScene:transition];
@@ -0,0 +1,94 @@
+/*
+ * Copyright (c) 2012-2013 Akihiro Kaneda.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   1.Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   2.Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ *   3.Neither the name of the Monochrome Soft nor the names of its contributors
+ *     may be used to endorse or promote products derived from this software
+ *     without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+/*!
+ @file AKTrace.h
+ @brief イベントトレース
+
+ 処理の開始・終了などのイベントをスレッドごとのリングバッファにバイナリ形式で記録する関数を定義する。
+ */
+
+#import <Foundation/Foundation.h>
+#import "AKFrameProfiler.h"
+
+/// トレースを組み込むかどうか。デフォルトは処理時間計測と同じとする。
+#ifndef AK_TRACE
+#define AK_TRACE AK_PROFILE
+#endif
+
+/// イベントの種類
+enum AKTraceType {
+    kAKTraceTypeBegin = 0,  ///< 処理開始
+    kAKTraceTypeEnd,        ///< 処理終了
+    kAKTraceTypeInstant,    ///< 瞬間イベント
+    kAKTraceTypeCounter     ///< 数値
+};
+
+#if AK_TRACE
+/// トレースが有効かどうか
+extern BOOL AKTraceEnabled;
+
+// トレースの有効/無効設定
+void AKTraceSetEnabled(BOOL enabled);
+// イベント名の登録
+uint16_t AKTraceRegisterName(uint16_t *cache, const char *name);
+// イベントの記録
+void AKTraceWrite(enum AKTraceType type, uint16_t name, int32_t value);
+// 記録の開始
+void AKTraceBeginCapture(void);
+// ファイルへの書き出し
+BOOL AKTraceFlush(void);
+// Chromeのトレース形式への変換
+BOOL AKTraceExportChrome(void);
+
+/*!
+ @brief イベントの記録(内部用)
+
+ イベント名は文字列リテラルとし、呼び出し箇所ごとに最初の一回のみ登録してIDをキャッシュする。
+ */
+#define AKTraceEvent(type, name, value) \
+    do { \
+        if (AKTraceEnabled) { \
+            static uint16_t traceNameID_ = 0; \
+            AKTraceWrite(type, traceNameID_ ? traceNameID_ : AKTraceRegisterName(&traceNameID_, name), value); \
+        } \
+    } while (0)
+/// 処理の開始を記録する
+#define AKTraceBegin(name) AKTraceEvent(kAKTraceTypeBegin, name, 0)
+/// 処理の終了を記録する
+#define AKTraceEnd(name) AKTraceEvent(kAKTraceTypeEnd, name, 0)
+/// 瞬間イベントを記録する
+#define AKTraceInstant(name) AKTraceEvent(kAKTraceTypeInstant, name, 0)
+/// 数値を記録する
+#define AKTraceCount(name, value) AKTraceEvent(kAKTraceTypeCounter, name, (int32_t)(value))
+#else
+#define AKTraceBegin(name) do { } while (0)
+#define AKTraceEnd(name) do { } while (0)
+#define AKTraceInstant(name) do { } while (0)
+#define AKTraceCount(name, value) do { } while (0)
+#endif
@@ -0,0 +1,539 @@
+/*
+ * Copyright (c) 2012-2013 Akihiro Kaneda.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   1.Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   2.Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ *   3.Neither the name of the Monochrome Soft nor the names of its contributors
+ *     may be used to endorse or promote products derived from this software
+ *     without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+/*!
+ @file AKTrace.m
+ @brief イベントトレース
+
+ 処理の開始・終了などのイベントをスレッドごとのリングバッファにバイナリ形式で記録する関数を定義する。
+ */
+
+#import <mach/mach_time.h>
+#import <libkern/OSAtomic.h>
+#import <pthread.h>
+#import "AKTrace.h"
+#import "AKCommon.h"
+
+#if AK_TRACE
+
+/*!
+ @brief イベントのレコード
+
+ ファイルにもこの形式のまま書き出す。
+ */
+typedef struct {
+    uint64_t time;      ///< 時刻(mach_absolute_time)
+    int32_t value;      ///< 数値
+    uint16_t name;      ///< イベント名のID
+    uint8_t type;       ///< イベントの種類
+    uint8_t thread;     ///< スレッド番号
+} AKTraceRecord;
+
+/// リングバッファのレコード数
+enum {
+    kAKTraceRecordCount = 1 << 15
+};
+/// 記録するスレッドの最大数
+enum {
+    kAKTraceMaxThread = 16
+};
+/// 登録できるイベント名の最大数
+enum {
+    kAKTraceMaxName = 1024
+};
+
+/*!
+ @brief スレッドごとのリングバッファ
+
+ 書き込みは所有するスレッドのみが行い、読み込みはファイル書き出し時のみ行う。
+ 書き込み数と読み込み数は単調増加させ、バッファの位置は容量の剰余とする。
+ */
+typedef struct {
+    AKTraceRecord records[kAKTraceRecordCount]; ///< レコード
+    volatile uint32_t writeCount;       ///< 書き込んだレコード数
+    uint32_t readCount;                 ///< ファイルに書き出したレコード数
+    uint8_t thread;                     ///< スレッド番号
+} AKTraceBuffer;
+
+/*!
+ @brief ファイルのブロックの種類
+
+ ファイルはヘッダの後にブロックを並べる。イベント名の表は書き出しのたびに全体を書き出し、
+ 変換時は最後に現れたものを使用する。
+ */
+enum AKTraceBlockType {
+    kAKTraceBlockNames = 1,     ///< イベント名の表
+    kAKTraceBlockRecords        ///< レコード
+};
+
+/// ファイルのヘッダ
+typedef struct {
+    uint32_t magic;         ///< 識別子
+    uint32_t version;       ///< フォーマットのバージョン
+    uint32_t timebaseNumer; ///< 時刻をナノ秒に変換する係数(分子)
+    uint32_t timebaseDenom; ///< 時刻をナノ秒に変換する係数(分母)
+} AKTraceFileHeader;
+
+/// ブロックのヘッダ
+typedef struct {
+    uint32_t type;      ///< ブロックの種類
+    uint32_t length;    ///< ブロックヘッダ以降の長さ
+} AKTraceBlockHeader;
+
+/// ファイルの識別子
+static const uint32_t kAKTraceMagic = 0x414B5452;
+/// ファイルのフォーマットのバージョン
+static const uint32_t kAKTraceVersion = 1;
+/// バイナリファイル名
+static NSString *kAKTraceFileName = @"trace.bin";
+/// Chromeのトレース形式のファイル名
+static NSString *kAKTraceJSONFileName = @"trace.json";
+/// Chromeのトレース形式のイベントの種類
+static const char kAKTracePhase[] = {'B', 'E', 'i', 'C'};
+
+/// トレースが有効かどうか
+BOOL AKTraceEnabled = NO;
+
+/// スレッドごとのリングバッファ
+static AKTraceBuffer *buffers_[kAKTraceMaxThread];
+/// 確保したリングバッファの数
+static volatile int32_t bufferCount_ = 0;
+/// リングバッファを取得するスレッドローカル変数のキー
+static pthread_key_t bufferKey_;
+/// スレッドローカル変数のキーの初期化制御
+static pthread_once_t bufferKeyOnce_ = PTHREAD_ONCE_INIT;
+/// イベント名
+static const char *names_[kAKTraceMaxName];
+/// 登録したイベント名の数
+static volatile int32_t nameCount_ = 0;
+/// イベント名登録の排他制御
+static OSSpinLock nameLock_ = OS_SPINLOCK_INIT;
+/// ファイル書き込み用のキュー
+static dispatch_queue_t fileQueue_ = NULL;
+/// ファイル書き込み用のキューの初期化制御
+static dispatch_once_t fileQueueOnce_;
+
+/*!
+ @brief ファイル書き込み用のキュー取得
+
+ ファイルの作成・追記・変換を順番に行うためのシリアルキューを取得する。初回は作成する。
+ ゲームプレイ中のフレーム処理でファイルへの書き込みを待たないように、書き込みはこのキューで行う。
+ @return ファイル書き込み用のキュー
+ */
+static dispatch_queue_t AKTraceFileQueue(void)
+{
+    dispatch_once(&fileQueueOnce_, ^{
+        fileQueue_ = dispatch_queue_create("com.monochromesoft.keigeki.trace", DISPATCH_QUEUE_SERIAL);
+    });
+    return fileQueue_;
+}
+
+/*!
+ @brief ファイルパス取得
+
+ Documentsディレクトリ内のファイルパスを作成する。
+ @param fileName ファイル名
+ @return ファイルパス
+ */
+static NSString *AKTraceFilePath(NSString *fileName)
+{
+    // Documentsディレクトリへのパスを作成する
+    NSString *docDir = [NSHomeDirectory() stringByAppendingPathComponent:@"Documents"];
+
+    return [docDir stringByAppendingPathComponent:fileName];
+}
+
+/*!
+ @brief スレッドローカル変数のキーの作成
+
+ pthread_onceから一度だけ呼び出される。
+ */
+static void AKTraceCreateBufferKey(void)
+{
+    pthread_key_create(&bufferKey_, NULL);
+}
+
+/*!
+ @brief リングバッファ取得
+
+ 呼び出したスレッドのリングバッファを取得する。初回は確保する。
+ スレッドのプールで使い回されるため、確保したバッファは解放しない。
+ @return リングバッファ。スレッド数が上限を超えた場合はNULL。
+ */
+static AKTraceBuffer *AKTraceCurrentBuffer(void)
+{
+    pthread_once(&bufferKeyOnce_, AKTraceCreateBufferKey);
+
+    AKTraceBuffer *buffer = pthread_getspecific(bufferKey_);
+    if (buffer != NULL) {
+        return buffer;
+    }
+
+    // スレッド番号を割り当てる
+    int32_t index = OSAtomicIncrement32Barrier(&bufferCount_) - 1;
+    if (index >= kAKTraceMaxThread) {
+        return NULL;
+    }
+
+    buffer = calloc(1, sizeof(AKTraceBuffer));
+    if (buffer == NULL) {
+        return NULL;
+    }
+    buffer->thread = index;
+
+    // 書き出し側から参照できるようにしてからスレッドローカル変数に設定する
+    OSMemoryBarrier();
+    buffers_[index] = buffer;
+    pthread_setspecific(bufferKey_, buffer);
+
+    return buffer;
+}
+
+/*!
+ @brief トレースの有効/無効設定
+
+ トレースの有効/無効を設定する。
+ @param enabled 有効にする場合YES
+ */
+void AKTraceSetEnabled(BOOL enabled)
+{
+    AKTraceEnabled = enabled;
+}
+
+/*!
+ @brief イベント名の登録
+
+ イベント名を登録してIDを割り当てる。
+ 呼び出し箇所ごとのキャッシュに書き込むため、同じ箇所からは二回目以降は呼ばれない。
+ 複数スレッドから同時に呼ばれた場合は登録済みのIDを返す。
+ @param cache IDのキャッシュ
+ @param name イベント名(文字列リテラル)
+ @return イベント名のID。登録できない場合は0。
+ */
+uint16_t AKTraceRegisterName(uint16_t *cache, const char *name)
+{
+    uint16_t id = 0;
+
+    OSSpinLockLock(&nameLock_);
+
+    // 他のスレッドが登録済みの場合はそのIDを使用する
+    if (*cache != 0) {
+        id = *cache;
+    }
+    else if (nameCount_ < kAKTraceMaxName) {
+        names_[nameCount_] = name;
+        nameCount_++;
+
+        // IDは0を未登録とするため1から始める
+        id = nameCount_;
+        *cache = id;
+    }
+
+    OSSpinLockUnlock(&nameLock_);
+
+    return id;
+}
+
+/*!
+ @brief イベントの記録
+
+ 呼び出したスレッドのリングバッファにイベントを記録する。
+ 書き出し前にリングバッファが一周した場合は古いレコードから上書きする。
+ @param type イベントの種類
+ @param name イベント名のID
+ @param value 数値
+ */
+void AKTraceWrite(enum AKTraceType type, uint16_t name, int32_t value)
+{
+    AKTraceBuffer *buffer = AKTraceCurrentBuffer();
+    if (buffer == NULL || name == 0) {
+        return;
+    }
+
+    uint32_t count = buffer->writeCount;
+    AKTraceRecord *record = &buffer->records[count % kAKTraceRecordCount];
+
+    record->time = mach_absolute_time();
+    record->value = value;
+    record->name = name;
+    record->type = type;
+    record->thread = buffer->thread;
+
+    // レコードを書き込んでから書き込み数を進める
+    OSMemoryBarrier();
+    buffer->writeCount = count + 1;
+}
+
+/*!
+ @brief イベント名の表のブロック作成
+
+ 登録済みのイベント名をNULL終端文字列の並びとしてデータに追加する。
+ 後続のレコードの64ビットの時刻が8バイト境界に揃うように、末尾を0で埋める。
+ @param data 追加先
+ */
+static void AKTraceAppendNames(NSMutableData *data)
+{
+    NSMutableData *names = [NSMutableData data];
+
+    OSSpinLockLock(&nameLock_);
+    for (int i = 0; i < nameCount_; i++) {
+        [names appendBytes:names_[i] length:strlen(names_[i]) + 1];
+    }
+    OSSpinLockUnlock(&nameLock_);
+
+    [names increaseLengthBy:(8 - [names length] % 8) % 8];
+
+    AKTraceBlockHeader block = {kAKTraceBlockNames, (uint32_t)[names length]};
+    [data appendBytes:&block length:sizeof(block)];
+    [data appendData:names];
+}
+
+/*!
+ @brief ファイルの作成
+
+ ファイルをヘッダのみの状態で作成する。既存のファイルは置き換える。
+ */
+static void AKTraceCreateFile(void)
+{
+    mach_timebase_info_data_t info;
+    mach_timebase_info(&info);
+    AKTraceFileHeader header = {kAKTraceMagic, kAKTraceVersion, info.numer, info.denom};
+
+    NSData *data = [NSData dataWithBytes:&header length:sizeof(header)];
+    if (![data writeToFile:AKTraceFilePath(kAKTraceFileName) atomically:YES]) {
+        AKLog(1, @"トレースファイル書き込み失敗");
+    }
+}
+
+/*!
+ @brief 記録の開始
+
+ 書き出していないレコードを破棄し、ファイルをヘッダのみにする。
+ ステージ開始時など、まとまった区間の記録を始めるときに呼び出す。
+ */
+void AKTraceBeginCapture(void)
+{
+    // 書き出していないレコードを破棄する
+    int32_t count = MIN(bufferCount_, kAKTraceMaxThread);
+    for (int i = 0; i < count; i++) {
+        if (buffers_[i] != NULL) {
+            buffers_[i]->readCount = buffers_[i]->writeCount;
+        }
+    }
+
+    dispatch_async(AKTraceFileQueue(), ^{
+        AKTraceCreateFile();
+    });
+}
+
+/*!
+ @brief ファイルへの書き出し
+
+ 前回の書き出し以降に記録されたレコードとイベント名の表をファイルに追記する。
+ レコードの収集は呼び出したスレッドで行い、ファイルへの追記はファイル書き込み用のキューで行う。
+ 記録中のスレッドがリングバッファを一周するほどの間隔は空けずに呼び出すこと。
+ @return 書き出しを開始した場合YES
+ */
+BOOL AKTraceFlush(void)
+{
+    NSMutableData *data = [NSMutableData data];
+    NSMutableData *records = [NSMutableData data];
+    NSInteger lostCount = 0;
+
+    // スレッドごとに書き出していないレコードを集める
+    int32_t count = MIN(bufferCount_, kAKTraceMaxThread);
+    for (int i = 0; i < count; i++) {
+
+        AKTraceBuffer *buffer = buffers_[i];
+        if (buffer == NULL) {
+            continue;
+        }
+
+        uint32_t write = buffer->writeCount;
+        OSMemoryBarrier();
+        uint32_t read = buffer->readCount;
+
+        // 一周して上書きされたレコードは読み飛ばす
+        if (write - read > kAKTraceRecordCount) {
+            lostCount += write - read - kAKTraceRecordCount;
+            read = write - kAKTraceRecordCount;
+        }
+
+        for (; read != write; read++) {
+            [records appendBytes:&buffer->records[read % kAKTraceRecordCount] length:sizeof(AKTraceRecord)];
+        }
+        buffer->readCount = write;
+    }
+
+    AKLog(lostCount > 0, @"トレースのレコード欠落:%d", lostCount);
+
+    // イベント名の表とレコードのブロックを作成する
+    AKTraceAppendNames(data);
+    AKTraceBlockHeader block = {kAKTraceBlockRecords, (uint32_t)[records length]};
+    [data appendBytes:&block length:sizeof(block)];
+    [data appendData:records];
+
+    // ファイルへの追記はフレーム処理を止めないようにキューで行う
+    dispatch_async(AKTraceFileQueue(), ^{
+
+        NSString *path = AKTraceFilePath(kAKTraceFileName);
+
+        // ファイルがない場合は作成する
+        if (![[NSFileManager defaultManager] fileExistsAtPath:path]) {
+            AKTraceCreateFile();
+        }
+
+        // ファイルに追記する
+        NSFileHandle *file = [NSFileHandle fileHandleForWritingAtPath:path];
+        if (file == nil) {
+            AKLog(1, @"トレースファイルオープン失敗");
+            return;
+        }
+        [file seekToEndOfFile];
+        [file writeData:data];
+        [file closeFile];
+    });
+
+    return YES;
+}
+
+/*!
+ @brief Chromeのトレース形式への変換
+
+ バイナリファイルを読み込み、Chromeのabout:tracingで読み込めるJSON形式のファイルを作成する。
+ 時刻は最も古いレコードからの経過時間(マイクロ秒)とする。
+ @return 成功時YES
+ */
+BOOL AKTraceExportChrome(void)
+{
+    // キューに積まれているファイルへの追記が終わるのを待ってから読み込む
+    __block NSData *data = nil;
+    dispatch_sync(AKTraceFileQueue(), ^{
+        data = [[NSData alloc] initWithContentsOfFile:AKTraceFilePath(kAKTraceFileName)];
+    });
+    [data autorelease];
+
+    if ([data length] < sizeof(AKTraceFileHeader)) {
+        return NO;
+    }
+
+    const uint8_t *bytes = [data bytes];
+    const uint8_t *end = bytes + [data length];
+
+    // ヘッダを確認する
+    const AKTraceFileHeader *header = (const AKTraceFileHeader *)bytes;
+    if (header->magic != kAKTraceMagic || header->version != kAKTraceVersion || header->timebaseDenom == 0) {
+        AKLog(1, @"トレースファイルのヘッダ不正");
+        return NO;
+    }
+    double ticksToUsec = (double)header->timebaseNumer / header->timebaseDenom / 1000.0;
+    bytes += sizeof(AKTraceFileHeader);
+
+    // 最後のイベント名の表と最も古いレコードの時刻を取得する
+    NSMutableArray *names = [NSMutableArray array];
+    uint64_t startTime = UINT64_MAX;
+    for (const uint8_t *p = bytes; p + sizeof(AKTraceBlockHeader) <= end; ) {
+
+        const AKTraceBlockHeader *block = (const AKTraceBlockHeader *)p;
+        p += sizeof(AKTraceBlockHeader);
+        if (p + block->length > end) {
+            break;
+        }
+
+        if (block->type == kAKTraceBlockNames) {
+            [names removeAllObjects];
+            const char *name = (const char *)p;
+            while (name < (const char *)(p + block->length) && *name != '\0') {
+                [names addObject:[NSString stringWithUTF8String:name]];
+                name += strlen(name) + 1;
+            }
+        }
+        else if (block->type == kAKTraceBlockRecords) {
+            const AKTraceRecord *records = (const AKTraceRecord *)p;
+            for (NSInteger i = 0; i < block->length / sizeof(AKTraceRecord); i++) {
+                startTime = MIN(startTime, records[i].time);
+            }
+        }
+        p += block->length;
+    }
+
+    // レコードをJSONに変換する
+    NSMutableString *json = [NSMutableString stringWithString:@"{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n"];
+    BOOL isFirst = YES;
+    for (const uint8_t *p = bytes; p + sizeof(AKTraceBlockHeader) <= end; ) {
+
+        const AKTraceBlockHeader *block = (const AKTraceBlockHeader *)p;
+        p += sizeof(AKTraceBlockHeader);
+        if (p + block->length > end) {
+            break;
+        }
+
+        if (block->type == kAKTraceBlockRecords) {
+
+            const AKTraceRecord *records = (const AKTraceRecord *)p;
+            NSInteger count = block->length / sizeof(AKTraceRecord);
+            for (NSInteger i = 0; i < count; i++) {
+
+                const AKTraceRecord *record = &records[i];
+                if (record->name == 0 || record->name > [names count] || record->type > kAKTraceTypeCounter) {
+                    continue;
+                }
+
+                [json appendFormat:@"%@{\"name\":\"%@\",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":1,\"tid\":%d",
+                 isFirst ? @"" : @",\n",
+                 [names objectAtIndex:record->name - 1],
+                 kAKTracePhase[record->type],
+                 (record->time - startTime) * ticksToUsec,
+                 record->thread];
+
+                if (record->type == kAKTraceTypeCounter) {
+                    [json appendFormat:@",\"args\":{\"value\":%d}", record->value];
+                }
+                else if (record->type == kAKTraceTypeInstant) {
+                    [json appendString:@",\"s\":\"t\""];
+                }
+                [json appendString:@"}"];
+
+                isFirst = NO;
+            }
+        }
+        p += block->length;
+    }
+    [json appendString:@"\n]}\n"];
+
+    // ファイルに書き込む
+    NSError *error = nil;
+    if (![json writeToFile:AKTraceFilePath(kAKTraceJSONFileName) atomically:YES encoding:NSUTF8StringEncoding error:&error]) {
+        AKLog(1, @"トレースのJSON書き込み失敗:%@", error);
+        return NO;
+    }
+
+    return YES;
+}
+
+#endif
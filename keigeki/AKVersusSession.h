@@ -0,0 +1,220 @@
+/*
+ * Copyright (c) 2012-2013 Akihiro Kaneda.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   1.Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   2.Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ *   3.Neither the name of the Monochrome Soft nor the names of its contributors
+ *     may be used to endorse or promote products derived from this software
+ *     without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+/*!
+ @file AKVersusSession.h
+ @brief 対戦通信
+
+ 対戦プレイで入力を交換し、ロックステップと巻き戻しで同期するクラスを定義する。
+ */
+
+#import <Foundation/Foundation.h>
+#import <netinet/in.h>
+#import "AKFrameProfiler.h"
+
+/// 入力のボタン
+enum AKVersusButton {
+    kAKVersusButtonShot = 1 << 0   ///< ショット
+};
+
+/// 対戦するプレイヤーの数
+enum {
+    kAKVersusPlayerCount = 2
+};
+
+/// 入力と状態を保持するティック数
+enum {
+    kAKVersusHistoryCount = 64
+};
+
+/// 相手の入力を予測して進められる最大のティック数(巻き戻しの最大ティック数)
+enum {
+    kAKVersusMaxPrediction = 8
+};
+
+/// 1つのパケットで送る入力の最大数
+enum {
+    kAKVersusRedundancy = 16
+};
+
+/// 遅延させて送信するパケットの最大数
+enum {
+    kAKVersusPendingCount = 128
+};
+
+/// パケットの最大サイズ
+enum {
+    kAKVersusPacketSize = 128
+};
+
+/// 1ティックの入力
+struct AKVersusInput {
+    int16_t tiltX;      ///< 傾きx(1/1000単位)
+    int16_t tiltY;      ///< 傾きy(1/1000単位)
+    uint8_t buttons;    ///< 押しているボタン(AKVersusButtonの組み合わせ)
+};
+
+/*!
+ @brief 対戦プレイのシミュレーション
+
+ 巻き戻しと再計算を行うため、ティックごとに状態を保存・復元できるようにする。
+ 同じ状態に同じ入力を与えた場合は、どちらの端末でも同じ状態になること。
+ */
+@protocol AKVersusSimulation <NSObject>
+
+// 状態の保存
+- (void)saveStateForTick:(uint32_t)tick;
+// 状態の復元
+- (void)loadStateForTick:(uint32_t)tick;
+// 1ティックの計算
+- (void)stepWithInputs:(const struct AKVersusInput *)inputs;
+// 状態のハッシュ値
+- (uint32_t)stateHash;
+
+@end
+
+// 対戦通信クラス
+@interface AKVersusSession : NSObject {
+    /// ソケット
+    int socket_;
+    /// 相手のアドレス
+    struct sockaddr_in remoteAddress_;
+    /// 自分の対戦の識別値
+    uint32_t epoch_;
+    /// 相手の対戦の識別値(0は未確定)
+    uint32_t remoteEpoch_;
+    /// プレイヤー番号(0または1)
+    NSInteger playerIndex_;
+    /// 次に計算するティック
+    uint32_t currentTick_;
+    /// 受信済みの相手の入力のティック数(これより前のティックの相手の入力は確定している)
+    uint32_t remoteTick_;
+    /// 相手が受信済みの自分の入力のティック数
+    uint32_t peerAck_;
+    /// 巻き戻しが必要な最初のティック
+    uint32_t rollbackTick_;
+    /// 自分の入力
+    struct AKVersusInput localInputs_[kAKVersusHistoryCount];
+    /// 相手の入力
+    struct AKVersusInput remoteInputs_[kAKVersusHistoryCount];
+    /// 計算に使用した相手の入力の予測値
+    struct AKVersusInput predictedInputs_[kAKVersusHistoryCount];
+    /// 計算後の状態のハッシュ値
+    uint32_t localHashes_[kAKVersusHistoryCount];
+    /// 比較を待っている相手の状態のハッシュ値のティック
+    uint32_t remoteHashTick_;
+    /// 比較を待っている相手の状態のハッシュ値
+    uint32_t remoteHash_;
+    /// 遅延させて送信するパケット
+    uint8_t pendingPackets_[kAKVersusPendingCount][kAKVersusPacketSize];
+    /// 遅延させて送信するパケットの長さ
+    size_t pendingLengths_[kAKVersusPendingCount];
+    /// 遅延させて送信するパケットの送信時刻
+    CFAbsoluteTime pendingTimes_[kAKVersusPendingCount];
+    /// 遅延させて送信するパケットの先頭位置
+    NSInteger pendingHead_;
+    /// 遅延させて送信するパケットの数
+    NSInteger pendingCount_;
+    /// パケットを失う確率の判定に使う乱数の状態
+    unsigned int lossSeed_;
+    /// 模擬する片道の通信遅延(秒)
+    NSTimeInterval latency_;
+    /// 模擬するパケットを失う確率(0.0〜1.0)
+    float lossRate_;
+    /// 状態が一致しなくなったかどうか
+    BOOL isDesynced_;
+    /// 巻き戻しを行った回数
+    NSInteger rollbackCount_;
+    /// 1回の巻き戻しで再計算したティック数の最大値
+    NSInteger maxRollbackTicks_;
+    /// 1回の巻き戻しにかかった時間の最大値(秒)
+    NSTimeInterval maxRollbackTime_;
+    /// 相手の入力を待って進められなかった回数
+    NSInteger stallCount_;
+    /// 送信したパケットの数
+    NSInteger sentCount_;
+    /// 失ったことにしたパケットの数
+    NSInteger lostCount_;
+}
+
+/// プレイヤー番号(0または1)
+@property (nonatomic, readonly)NSInteger playerIndex;
+/// 次に計算するティック
+@property (nonatomic, readonly)uint32_t currentTick;
+/// 受信済みの相手の入力のティック数
+@property (nonatomic, readonly)uint32_t remoteTick;
+/// 模擬する片道の通信遅延(秒)
+@property (nonatomic)NSTimeInterval latency;
+/// 模擬するパケットを失う確率(0.0〜1.0)
+@property (nonatomic)float lossRate;
+/// 状態が一致しなくなったかどうか
+@property (nonatomic, readonly)BOOL isDesynced;
+/// 巻き戻しを行った回数
+@property (nonatomic, readonly)NSInteger rollbackCount;
+/// 1回の巻き戻しで再計算したティック数の最大値
+@property (nonatomic, readonly)NSInteger maxRollbackTicks;
+/// 1回の巻き戻しにかかった時間の最大値(秒)
+@property (nonatomic, readonly)NSTimeInterval maxRollbackTime;
+/// 相手の入力を待って進められなかった回数
+@property (nonatomic, readonly)NSInteger stallCount;
+
+// 設定に従った対戦通信の生成
++ (id)sessionWithUserDefaults;
+// 対戦相手が設定されているかどうか
++ (BOOL)isConfigured;
+// ポートと相手のアドレスを指定した初期化処理
+- (id)initWithPlayerIndex:(NSInteger)playerIndex localPort:(uint16_t)localPort
+               remoteHost:(NSString *)remoteHost remotePort:(uint16_t)remotePort;
+// 受信した入力による同期
+- (void)synchronize:(id<AKVersusSimulation>)simulation atTime:(CFAbsoluteTime)now;
+// 1ティックの計算
+- (BOOL)advance:(id<AKVersusSimulation>)simulation localInput:(struct AKVersusInput)input atTime:(CFAbsoluteTime)now;
+// パケットの送受信
+- (void)pollAtTime:(CFAbsoluteTime)now;
+// 相手の入力を待つ必要があるかどうか
+- (BOOL)isStalled;
+// 巻き戻しと再計算
+- (void)rollback:(id<AKVersusSimulation>)simulation;
+// ティックの計算
+- (void)simulateTick:(uint32_t)tick simulation:(id<AKVersusSimulation>)simulation;
+// 相手の入力の取得
+- (struct AKVersusInput)remoteInputForTick:(uint32_t)tick;
+// 入力の送信
+- (void)sendInputsAtTime:(CFAbsoluteTime)now;
+// パケットの送信
+- (void)sendPacket:(const uint8_t *)packet length:(size_t)length atTime:(CFAbsoluteTime)now;
+// パケットの受信
+- (void)receivePacket:(const uint8_t *)packet length:(size_t)length;
+// 状態のハッシュ値の比較
+- (void)checkHash;
+@end
+
+#if AK_PROFILE
+// ループバックでの対戦通信の確認
+void AKVersusLoopbackTest(void);
+#endif
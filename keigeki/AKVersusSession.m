@@ -0,0 +1,857 @@
+/*
+ * Copyright (c) 2012-2013 Akihiro Kaneda.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   1.Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   2.Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ *   3.Neither the name of the Monochrome Soft nor the names of its contributors
+ *     may be used to endorse or promote products derived from this software
+ *     without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+/*!
+ @file AKVersusSession.m
+ @brief 対戦通信
+
+ 対戦プレイで入力を交換し、ロックステップと巻き戻しで同期するクラスを定義する。
+ */
+
+#import <sys/socket.h>
+#import <arpa/inet.h>
+#import <fcntl.h>
+#import <unistd.h>
+#import <errno.h>
+#import <mach/mach_time.h>
+#import "AKVersusSession.h"
+#import "AKCommon.h"
+
+/// パケットの識別子("AKVS")
+static const uint32_t kAKVersusMagic = 0x414b5653;
+/// パケットのヘッダのサイズ(識別子、対戦の識別値、先頭ティック、入力数、受信済みティック数、ハッシュ値のティック、ハッシュ値)
+static const size_t kAKVersusHeaderSize = 4 + 4 + 4 + 1 + 4 + 4 + 4;
+/// パケットの1ティックの入力のサイズ
+static const size_t kAKVersusInputSize = 2 + 2 + 1;
+/// ティックがないことを示す値
+static const uint32_t kAKVersusNoTick = UINT32_MAX;
+/// 1回の巻き戻しにかける時間の上限(秒)
+static const NSTimeInterval kAKVersusRollbackBudget = 0.004;
+/// 対戦で使用する最初のポート(プレイヤー番号を加えたポートで受信する)
+static const uint16_t kAKVersusPort = 47000;
+/// 対戦相手のIPv4アドレスを指定する設定のキー
+static NSString *kAKVersusHostKey = @"AKVersusHost";
+/// 自分のプレイヤー番号を指定する設定のキー
+static NSString *kAKVersusPlayerKey = @"AKVersusPlayer";
+/// 模擬する通信遅延を指定する設定のキー(ミリ秒)
+static NSString *kAKVersusLatencyKey = @"AKVersusLatency";
+/// 模擬するパケットの損失率を指定する設定のキー(パーセント)
+static NSString *kAKVersusLossKey = @"AKVersusLoss";
+
+/*!
+ @brief 32ビット値の書き込み
+
+ ネットワークバイトオーダーで書き込み、書き込み位置を進める。
+ @param p 書き込み位置
+ @param value 書き込む値
+ */
+static inline void AKVersusWrite32(uint8_t **p, uint32_t value)
+{
+    value = htonl(value);
+    memcpy(*p, &value, sizeof(value));
+    *p += sizeof(value);
+}
+
+/*!
+ @brief 16ビット値の書き込み
+
+ ネットワークバイトオーダーで書き込み、書き込み位置を進める。
+ @param p 書き込み位置
+ @param value 書き込む値
+ */
+static inline void AKVersusWrite16(uint8_t **p, uint16_t value)
+{
+    value = htons(value);
+    memcpy(*p, &value, sizeof(value));
+    *p += sizeof(value);
+}
+
+/*!
+ @brief 32ビット値の読み込み
+
+ ネットワークバイトオーダーで読み込み、読み込み位置を進める。
+ @param p 読み込み位置
+ @return 読み込んだ値
+ */
+static inline uint32_t AKVersusRead32(const uint8_t **p)
+{
+    uint32_t value;
+    memcpy(&value, *p, sizeof(value));
+    *p += sizeof(value);
+    return ntohl(value);
+}
+
+/*!
+ @brief 16ビット値の読み込み
+
+ ネットワークバイトオーダーで読み込み、読み込み位置を進める。
+ @param p 読み込み位置
+ @return 読み込んだ値
+ */
+static inline uint16_t AKVersusRead16(const uint8_t **p)
+{
+    uint16_t value;
+    memcpy(&value, *p, sizeof(value));
+    *p += sizeof(value);
+    return ntohs(value);
+}
+
+/*!
+ @brief 入力の比較
+
+ 2つの入力が同じかどうかを判定する。
+ @param a 入力
+ @param b 入力
+ @return 同じ場合YES
+ */
+static inline BOOL AKVersusInputEqual(struct AKVersusInput a, struct AKVersusInput b)
+{
+    return (a.tiltX == b.tiltX && a.tiltY == b.tiltY && a.buttons == b.buttons);
+}
+
+/*!
+ @brief 経過時間の取得
+
+ mach_absolute_timeの差を秒に変換する。
+ @param start 開始時刻
+ @return 経過時間(秒)
+ */
+static NSTimeInterval AKVersusElapsed(uint64_t start)
+{
+    static mach_timebase_info_data_t info;
+    if (info.denom == 0) {
+        mach_timebase_info(&info);
+    }
+    return (double)(mach_absolute_time() - start) * info.numer / info.denom / 1.0e9;
+}
+
+/*!
+ @brief 対戦通信クラス
+
+ 2台の端末で入力をUDPで交換し、同じ入力で同じティックを計算することで状態を一致させる。
+ 相手の入力が届いていないティックは最後に届いた入力が続くものとして予測して計算し、
+ 予測と異なる入力が届いた場合は予測を始めたティックの状態に巻き戻して再計算する。
+ 予測で進められるティック数には上限があり、上限に達した場合は相手の入力が届くまで待つ。
+ パケットは失われることがあるため、相手が受信済みと通知してきたティック以降の入力をまとめて毎回送信する。
+ 両方の入力が確定したティックの状態のハッシュ値を交換し、一致しない場合は非同期になったものとする。
+ 前の対戦のパケットを取り込まないように、対戦ごとに識別値を決めてパケットに含める。
+ 通信遅延とパケットの損失は送信側で模擬できる。
+ */
+@implementation AKVersusSession
+
+@synthesize playerIndex = playerIndex_;
+@synthesize currentTick = currentTick_;
+@synthesize remoteTick = remoteTick_;
+@synthesize latency = latency_;
+@synthesize lossRate = lossRate_;
+@synthesize isDesynced = isDesynced_;
+@synthesize rollbackCount = rollbackCount_;
+@synthesize maxRollbackTicks = maxRollbackTicks_;
+@synthesize maxRollbackTime = maxRollbackTime_;
+@synthesize stallCount = stallCount_;
+
+/*!
+ @brief 設定に従った対戦通信の生成
+
+ 起動引数などで設定した相手のアドレスとプレイヤー番号から対戦通信を生成する。
+ ポートはプレイヤー番号から決めるため、同じ端末で2つ起動してループバックアドレスで対戦することもできる。
+ 模擬する通信遅延とパケットの損失率が設定されている場合は反映する。
+ @return 生成したオブジェクト。相手が設定されていない場合、生成に失敗した場合はnilを返す。
+ */
++ (id)sessionWithUserDefaults
+{
+    NSUserDefaults *userDefaults = [NSUserDefaults standardUserDefaults];
+
+    if (![self isConfigured]) {
+        return nil;
+    }
+
+    NSInteger playerIndex = ([userDefaults integerForKey:kAKVersusPlayerKey] != 0 ? 1 : 0);
+    AKVersusSession *session = [[[self alloc] initWithPlayerIndex:playerIndex
+                                                        localPort:kAKVersusPort + playerIndex
+                                                       remoteHost:[userDefaults stringForKey:kAKVersusHostKey]
+                                                       remotePort:kAKVersusPort + 1 - playerIndex] autorelease];
+
+    session.latency = [userDefaults doubleForKey:kAKVersusLatencyKey] / 1000.0;
+    session.lossRate = [userDefaults floatForKey:kAKVersusLossKey] / 100.0f;
+
+    return session;
+}
+
+/*!
+ @brief 対戦相手が設定されているかどうか
+
+ 相手のアドレスが設定されているかどうかを返す。
+ @return 設定されている場合YES
+ */
++ (BOOL)isConfigured
+{
+    return ([[NSUserDefaults standardUserDefaults] stringForKey:kAKVersusHostKey].length > 0);
+}
+
+/*!
+ @brief ポートと相手のアドレスを指定した初期化処理
+
+ UDPソケットを作成してポートにバインドし、ノンブロッキングにする。
+ @param playerIndex プレイヤー番号(0または1)
+ @param localPort 受信するポート
+ @param remoteHost 相手のIPv4アドレス
+ @param remotePort 相手のポート
+ @return 生成したオブジェクト。失敗時はnilを返す。
+ */
+- (id)initWithPlayerIndex:(NSInteger)playerIndex localPort:(uint16_t)localPort
+               remoteHost:(NSString *)remoteHost remotePort:(uint16_t)remotePort
+{
+    NSAssert(playerIndex == 0 || playerIndex == 1, @"playerIndex is invalid.");
+
+    // スーパークラスの初期化処理を実行する
+    self = [super init];
+    if (!self) {
+        return nil;
+    }
+
+    playerIndex_ = playerIndex;
+    epoch_ = arc4random() | 1;
+    remoteEpoch_ = 0;
+    rollbackTick_ = kAKVersusNoTick;
+    remoteHashTick_ = kAKVersusNoTick;
+    lossSeed_ = (unsigned int)(localPort + playerIndex);
+
+    // 相手のアドレスを作成する
+    memset(&remoteAddress_, 0, sizeof(remoteAddress_));
+    remoteAddress_.sin_len = sizeof(remoteAddress_);
+    remoteAddress_.sin_family = AF_INET;
+    remoteAddress_.sin_port = htons(remotePort);
+    if (inet_pton(AF_INET, [remoteHost UTF8String], &remoteAddress_.sin_addr) != 1) {
+        AKLog(1, @"相手のアドレスが不正:%@", remoteHost);
+        socket_ = -1;
+        [self release];
+        return nil;
+    }
+
+    // ソケットを作成する
+    socket_ = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (socket_ < 0) {
+        AKLog(1, @"ソケットの作成に失敗:errno=%d", errno);
+        [self release];
+        return nil;
+    }
+
+    // 受信するポートにバインドする
+    struct sockaddr_in localAddress;
+    memset(&localAddress, 0, sizeof(localAddress));
+    localAddress.sin_len = sizeof(localAddress);
+    localAddress.sin_family = AF_INET;
+    localAddress.sin_port = htons(localPort);
+    localAddress.sin_addr.s_addr = htonl(INADDR_ANY);
+    if (bind(socket_, (struct sockaddr *)&localAddress, sizeof(localAddress)) != 0) {
+        AKLog(1, @"バインドに失敗:port=%d errno=%d", localPort, errno);
+        [self release];
+        return nil;
+    }
+
+    // 受信を待たないようにする
+    fcntl(socket_, F_SETFL, fcntl(socket_, F_GETFL, 0) | O_NONBLOCK);
+
+    return self;
+}
+
+/*!
+ @brief インスタンス解放処理
+
+ ソケットを閉じる。
+ */
+- (void)dealloc
+{
+    if (socket_ >= 0) {
+        close(socket_);
+    }
+
+    // スーパークラスの解放処理を実行する
+    [super dealloc];
+}
+
+/*!
+ @brief 受信した入力による同期
+
+ パケットを送受信し、予測と異なる入力を受信した場合は巻き戻して再計算する。
+ 両方の入力が確定したティックについて、相手の状態のハッシュ値と比較する。
+ @param simulation シミュレーション
+ @param now 現在時刻
+ */
+- (void)synchronize:(id<AKVersusSimulation>)simulation atTime:(CFAbsoluteTime)now
+{
+    // パケットを送受信する
+    [self pollAtTime:now];
+
+    // 予測と異なる入力を受信した場合は巻き戻す
+    if (rollbackTick_ != kAKVersusNoTick) {
+        [self rollback:simulation];
+    }
+
+    // 状態のハッシュ値を比較する
+    [self checkHash];
+}
+
+/*!
+ @brief 1ティックの計算
+
+ 受信した入力で同期した後、自分の入力を記録して次のティックを計算し、入力を送信する。
+ 相手の入力の予測で進められるティック数の上限に達している場合は計算を行わない。
+ @param simulation シミュレーション
+ @param input 自分の入力
+ @param now 現在時刻
+ @return ティックを計算した場合YES、相手の入力を待つ場合NO
+ */
+- (BOOL)advance:(id<AKVersusSimulation>)simulation localInput:(struct AKVersusInput)input atTime:(CFAbsoluteTime)now
+{
+    [self synchronize:simulation atTime:now];
+
+    // 相手の入力を待つ必要がある場合は入力の再送のみ行う
+    if ([self isStalled]) {
+        stallCount_++;
+        [self sendInputsAtTime:now];
+        return NO;
+    }
+
+    // 自分の入力を記録してティックを計算する
+    localInputs_[currentTick_ % kAKVersusHistoryCount] = input;
+    [self simulateTick:currentTick_ simulation:simulation];
+    currentTick_++;
+
+    // 入力を送信する
+    [self sendInputsAtTime:now];
+
+    return YES;
+}
+
+/*!
+ @brief パケットの送受信
+
+ 送信時刻になった遅延させているパケットを送信し、受信したパケットをすべて処理する。
+ @param now 現在時刻
+ */
+- (void)pollAtTime:(CFAbsoluteTime)now
+{
+    // 送信時刻になったパケットを送信する
+    while (pendingCount_ > 0 && pendingTimes_[pendingHead_] <= now) {
+        sendto(socket_, pendingPackets_[pendingHead_], pendingLengths_[pendingHead_], 0,
+               (struct sockaddr *)&remoteAddress_, sizeof(remoteAddress_));
+        pendingHead_ = (pendingHead_ + 1) % kAKVersusPendingCount;
+        pendingCount_--;
+    }
+
+    // 受信したパケットを処理する
+    uint8_t packet[kAKVersusPacketSize];
+    for (;;) {
+        ssize_t length = recv(socket_, packet, sizeof(packet), 0);
+        if (length < 0) {
+            AKLog(errno != EAGAIN && errno != EWOULDBLOCK, @"受信に失敗:errno=%d", errno);
+            break;
+        }
+        [self receivePacket:packet length:length];
+    }
+}
+
+/*!
+ @brief 相手の入力を待つ必要があるかどうか
+
+ 相手の入力を予測しているティック数が上限に達している場合、
+ または相手が受信していない自分の入力が1つのパケットに入りきらない場合は待つ必要がある。
+ @return 待つ必要がある場合YES
+ */
+- (BOOL)isStalled
+{
+    // 相手のほうが進んでいる場合があるため、差を取る前に大小を比較する
+    return ((currentTick_ > remoteTick_ && currentTick_ - remoteTick_ >= kAKVersusMaxPrediction) ||
+            currentTick_ - peerAck_ >= kAKVersusRedundancy);
+}
+
+/*!
+ @brief 巻き戻しと再計算
+
+ 予測と異なる入力を受信した最初のティックの状態を復元し、現在のティックまで再計算する。
+ @param simulation シミュレーション
+ */
+- (void)rollback:(id<AKVersusSimulation>)simulation
+{
+    uint32_t from = rollbackTick_;
+    rollbackTick_ = kAKVersusNoTick;
+
+    uint64_t start = mach_absolute_time();
+
+    // 状態を復元して再計算する
+    [simulation loadStateForTick:from];
+    for (uint32_t tick = from; tick < currentTick_; tick++) {
+        [self simulateTick:tick simulation:simulation];
+    }
+
+    NSTimeInterval elapsed = AKVersusElapsed(start);
+
+    rollbackCount_++;
+    maxRollbackTicks_ = MAX(maxRollbackTicks_, (NSInteger)(currentTick_ - from));
+    maxRollbackTime_ = MAX(maxRollbackTime_, elapsed);
+
+    AKLog(elapsed > kAKVersusRollbackBudget, @"巻き戻しが時間の上限を超過:ticks=%u time=%.2fms",
+          currentTick_ - from, elapsed * 1000.0);
+}
+
+/*!
+ @brief ティックの計算
+
+ 計算前の状態を保存し、自分と相手の入力でティックを計算して計算後の状態のハッシュ値を記録する。
+ 入力はプレイヤー番号の順に並べ、どちらの端末でも同じ順番にする。
+ @param tick 計算するティック
+ @param simulation シミュレーション
+ */
+- (void)simulateTick:(uint32_t)tick simulation:(id<AKVersusSimulation>)simulation
+{
+    [simulation saveStateForTick:tick];
+
+    struct AKVersusInput inputs[kAKVersusPlayerCount];
+    inputs[playerIndex_] = localInputs_[tick % kAKVersusHistoryCount];
+    inputs[1 - playerIndex_] = [self remoteInputForTick:tick];
+    [simulation stepWithInputs:inputs];
+
+    localHashes_[tick % kAKVersusHistoryCount] = [simulation stateHash];
+}
+
+/*!
+ @brief 相手の入力の取得
+
+ 受信済みのティックの場合は受信した入力を返す。
+ 受信していないティックの場合は最後に受信した入力を予測値として記録して返す。
+ @param tick ティック
+ @return 相手の入力
+ */
+- (struct AKVersusInput)remoteInputForTick:(uint32_t)tick
+{
+    if (tick < remoteTick_) {
+        return remoteInputs_[tick % kAKVersusHistoryCount];
+    }
+
+    struct AKVersusInput predicted = {0, 0, 0};
+    if (remoteTick_ > 0) {
+        predicted = remoteInputs_[(remoteTick_ - 1) % kAKVersusHistoryCount];
+    }
+    predictedInputs_[tick % kAKVersusHistoryCount] = predicted;
+
+    return predicted;
+}
+
+/*!
+ @brief 入力の送信
+
+ 相手が受信していない自分の入力と、入力が確定している最新のティックの状態のハッシュ値を送信する。
+ 新しい入力がない場合も受信済みティック数を伝えるために送信する。
+ @param now 現在時刻
+ */
+- (void)sendInputsAtTime:(CFAbsoluteTime)now
+{
+    // 送信する入力の範囲を決める
+    uint32_t first = MAX(peerAck_, currentTick_ > kAKVersusRedundancy ? currentTick_ - kAKVersusRedundancy : 0);
+    uint32_t count = currentTick_ - first;
+
+    // 入力が確定している最新のティックを決める
+    uint32_t confirmed = MIN(remoteTick_, currentTick_);
+    uint32_t hashTick = (confirmed > 0 ? confirmed - 1 : kAKVersusNoTick);
+    uint32_t hash = (confirmed > 0 ? localHashes_[hashTick % kAKVersusHistoryCount] : 0);
+
+    // パケットを作成する
+    uint8_t packet[kAKVersusPacketSize];
+    uint8_t *p = packet;
+    AKVersusWrite32(&p, kAKVersusMagic);
+    AKVersusWrite32(&p, epoch_);
+    AKVersusWrite32(&p, first);
+    *p++ = (uint8_t)count;
+    AKVersusWrite32(&p, remoteTick_);
+    AKVersusWrite32(&p, hashTick);
+    AKVersusWrite32(&p, hash);
+    for (uint32_t tick = first; tick < currentTick_; tick++) {
+        struct AKVersusInput input = localInputs_[tick % kAKVersusHistoryCount];
+        AKVersusWrite16(&p, (uint16_t)input.tiltX);
+        AKVersusWrite16(&p, (uint16_t)input.tiltY);
+        *p++ = input.buttons;
+    }
+
+    [self sendPacket:packet length:p - packet atTime:now];
+}
+
+/*!
+ @brief パケットの送信
+
+ 模擬するパケットの損失の確率に応じてパケットを捨てる。
+ 模擬する通信遅延がある場合は送信時刻を記録して遅延させ、ない場合はすぐに送信する。
+ @param packet パケット
+ @param length パケットの長さ
+ @param now 現在時刻
+ */
+- (void)sendPacket:(const uint8_t *)packet length:(size_t)length atTime:(CFAbsoluteTime)now
+{
+    sentCount_++;
+
+    // パケットの損失を模擬する
+    if (lossRate_ > 0.0f && rand_r(&lossSeed_) % 10000 < (int)(lossRate_ * 10000)) {
+        lostCount_++;
+        return;
+    }
+
+    // 遅延がない場合はすぐに送信する
+    if (latency_ <= 0.0) {
+        sendto(socket_, packet, length, 0, (struct sockaddr *)&remoteAddress_, sizeof(remoteAddress_));
+        return;
+    }
+
+    // 遅延させるパケットがいっぱいの場合は失ったものとする
+    if (pendingCount_ >= kAKVersusPendingCount) {
+        lostCount_++;
+        return;
+    }
+
+    NSInteger index = (pendingHead_ + pendingCount_) % kAKVersusPendingCount;
+    memcpy(pendingPackets_[index], packet, length);
+    pendingLengths_[index] = length;
+    pendingTimes_[index] = now + latency_;
+    pendingCount_++;
+}
+
+/*!
+ @brief パケットの受信
+
+ 相手の受信済みティック数と入力、状態のハッシュ値を取り出す。
+ 相手の対戦の識別値は、相手が対戦を始めたときの先頭ティックが0のパケットで決め、異なる識別値のパケットは無視する。
+ 入力は受信済みのティックの次から連続している分だけ記録し、
+ 予測で計算済みのティックの入力が予測と異なる場合は巻き戻すティックを記録する。
+ @param packet パケット
+ @param length パケットの長さ
+ */
+- (void)receivePacket:(const uint8_t *)packet length:(size_t)length
+{
+    // ヘッダを読み込む
+    if (length < kAKVersusHeaderSize) {
+        return;
+    }
+    const uint8_t *p = packet;
+    if (AKVersusRead32(&p) != kAKVersusMagic) {
+        return;
+    }
+    uint32_t epoch = AKVersusRead32(&p);
+    uint32_t first = AKVersusRead32(&p);
+    uint32_t count = *p++;
+    uint32_t ack = AKVersusRead32(&p);
+    uint32_t hashTick = AKVersusRead32(&p);
+    uint32_t hash = AKVersusRead32(&p);
+    if (length < kAKVersusHeaderSize + count * kAKVersusInputSize) {
+        return;
+    }
+
+    // 相手の前の対戦のパケットが残っている場合があるため、対戦の識別値が異なるパケットは無視する
+    if (remoteEpoch_ == 0) {
+        if (first != 0) {
+            return;
+        }
+        remoteEpoch_ = epoch;
+    }
+    else if (epoch != remoteEpoch_) {
+        return;
+    }
+
+    // 相手の受信済みティック数を更新する(計算していないティックを受信済みとはしない)
+    peerAck_ = MAX(peerAck_, MIN(ack, currentTick_));
+
+    // 入力を記録する
+    for (uint32_t tick = first; tick < first + count; tick++) {
+
+        struct AKVersusInput input;
+        input.tiltX = (int16_t)AKVersusRead16(&p);
+        input.tiltY = (int16_t)AKVersusRead16(&p);
+        input.buttons = *p++;
+
+        // 受信済みのティックは無視し、途中が抜けている場合はそれ以降を無視する
+        if (tick < remoteTick_) {
+            continue;
+        }
+        if (tick > remoteTick_) {
+            break;
+        }
+
+        // 予測で計算済みのティックの入力が予測と異なる場合は巻き戻す
+        if (tick < currentTick_ && !AKVersusInputEqual(input, predictedInputs_[tick % kAKVersusHistoryCount])) {
+            rollbackTick_ = MIN(rollbackTick_, tick);
+        }
+
+        remoteInputs_[tick % kAKVersusHistoryCount] = input;
+        remoteTick_++;
+    }
+
+    // 状態のハッシュ値は新しいものを比較対象にする
+    if (hashTick != kAKVersusNoTick &&
+        (remoteHashTick_ == kAKVersusNoTick || hashTick > remoteHashTick_)) {
+        remoteHashTick_ = hashTick;
+        remoteHash_ = hash;
+    }
+}
+
+/*!
+ @brief 状態のハッシュ値の比較
+
+ 相手から受信したハッシュ値のティックの入力が確定している場合は、自分のハッシュ値と比較する。
+ 一致しない場合は非同期になったものとする。
+ */
+- (void)checkHash
+{
+    uint32_t confirmed = MIN(remoteTick_, currentTick_);
+    if (remoteHashTick_ == kAKVersusNoTick || remoteHashTick_ >= confirmed) {
+        return;
+    }
+
+    // 記録が残っている場合のみ比較する
+    if (currentTick_ - remoteHashTick_ <= kAKVersusHistoryCount &&
+        localHashes_[remoteHashTick_ % kAKVersusHistoryCount] != remoteHash_) {
+
+        if (!isDesynced_) {
+            AKLog(1, @"非同期を検出:player=%d tick=%u local=%08x remote=%08x",
+                  playerIndex_, remoteHashTick_,
+                  localHashes_[remoteHashTick_ % kAKVersusHistoryCount], remoteHash_);
+        }
+        isDesynced_ = YES;
+    }
+
+    remoteHashTick_ = kAKVersusNoTick;
+}
+
+@end
+
+#if AK_PROFILE
+
+/// 確認に使う最初のポート
+static const uint16_t kAKVersusTestPort = 47100;
+/// 確認で計算するティック数
+enum {
+    kAKVersusTestTickCount = 1200
+};
+/// 確認で計算する最大フレーム数
+static const NSInteger kAKVersusTestFrameCount = 4800;
+/// 確認の1フレームの時間(秒)
+static const CFAbsoluteTime kAKVersusTestFrameTime = 1.0 / 60.0;
+/// 確認のステージのサイズ(固定小数点)
+static const int32_t kAKVersusTestStageSize = 1024 << 8;
+/// 確認の自機の最大速度(固定小数点)
+static const int32_t kAKVersusTestMaxSpeed = 4 << 8;
+/// 確認の自機のショットの間隔(ティック)
+static const int32_t kAKVersusTestShotInterval = 8;
+
+/// 確認用のシミュレーションの状態
+struct AKVersusTestState {
+    int32_t x[2];           ///< x座標(固定小数点)
+    int32_t y[2];           ///< y座標(固定小数点)
+    int32_t vx[2];          ///< x方向の速度(固定小数点)
+    int32_t vy[2];          ///< y方向の速度(固定小数点)
+    int32_t shotWait[2];    ///< 次のショットまでのティック数
+    int32_t shotCount[2];   ///< ショットの数
+};
+
+/*!
+ @brief 確認用のシミュレーション
+
+ 2機の自機が傾きで加速し、ステージの端でループする。
+ 端末によって結果が変わらないように整数だけで計算する。
+ */
+@interface AKVersusTestSimulation : NSObject <AKVersusSimulation> {
+    /// 現在の状態
+    struct AKVersusTestState state_;
+    /// 保存した状態
+    struct AKVersusTestState saved_[kAKVersusHistoryCount];
+}
+@end
+
+@implementation AKVersusTestSimulation
+
+/*!
+ @brief 状態の保存
+
+ ティックの計算前の状態を保存する。
+ @param tick ティック
+ */
+- (void)saveStateForTick:(uint32_t)tick
+{
+    saved_[tick % kAKVersusHistoryCount] = state_;
+}
+
+/*!
+ @brief 状態の復元
+
+ ティックの計算前の状態を復元する。
+ @param tick ティック
+ */
+- (void)loadStateForTick:(uint32_t)tick
+{
+    state_ = saved_[tick % kAKVersusHistoryCount];
+}
+
+/*!
+ @brief 1ティックの計算
+
+ 傾きで速度を変え、位置を移動する。ボタンが押されている場合はショットを撃つ。
+ @param inputs プレイヤー番号順の入力
+ */
+- (void)stepWithInputs:(const struct AKVersusInput *)inputs
+{
+    for (int i = 0; i < 2; i++) {
+
+        // 傾きで加速する
+        state_.vx[i] = MIN(MAX(state_.vx[i] + inputs[i].tiltX / 4, -kAKVersusTestMaxSpeed), kAKVersusTestMaxSpeed);
+        state_.vy[i] = MIN(MAX(state_.vy[i] + inputs[i].tiltY / 4, -kAKVersusTestMaxSpeed), kAKVersusTestMaxSpeed);
+
+        // 移動してステージの端でループする
+        state_.x[i] = (state_.x[i] + state_.vx[i] + kAKVersusTestStageSize) % kAKVersusTestStageSize;
+        state_.y[i] = (state_.y[i] + state_.vy[i] + kAKVersusTestStageSize) % kAKVersusTestStageSize;
+
+        // ショットを撃つ
+        if (state_.shotWait[i] > 0) {
+            state_.shotWait[i]--;
+        }
+        else if (inputs[i].buttons & kAKVersusButtonShot) {
+            state_.shotCount[i]++;
+            state_.shotWait[i] = kAKVersusTestShotInterval;
+        }
+    }
+}
+
+/*!
+ @brief 状態のハッシュ値
+
+ 状態をFNV-1aでハッシュする。
+ @return ハッシュ値
+ */
+- (uint32_t)stateHash
+{
+    const uint8_t *bytes = (const uint8_t *)&state_;
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < sizeof(state_); i++) {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+    return hash;
+}
+
+@end
+
+/*!
+ @brief ループバックでの対戦通信の確認
+
+ 2つの対戦通信をループバックアドレスで接続し、同じプロセス内で1/60秒ずつ進める。
+ 時刻は実時間ではなくフレーム数から計算し、通信遅延とパケットの損失は起動引数で指定する。
+ 入力は時々変化させて予測を外し、巻き戻しを発生させる。
+ 全ティックの入力が確定した後の状態が一致するかどうかと、巻き戻しの回数と時間を出力する。
+ */
+void AKVersusLoopbackTest(void)
+{
+    NSUserDefaults *userDefaults = [NSUserDefaults standardUserDefaults];
+    NSTimeInterval latency = [userDefaults doubleForKey:kAKVersusLatencyKey] / 1000.0;
+    float lossRate = [userDefaults floatForKey:kAKVersusLossKey] / 100.0f;
+
+    // 対戦通信とシミュレーションを作成する
+    AKVersusSession *sessions[2];
+    AKVersusTestSimulation *simulations[2];
+    for (int i = 0; i < 2; i++) {
+        sessions[i] = [[[AKVersusSession alloc] initWithPlayerIndex:i
+                                                          localPort:kAKVersusTestPort + i
+                                                         remoteHost:@"127.0.0.1"
+                                                         remotePort:kAKVersusTestPort + 1 - i] autorelease];
+        if (sessions[i] == nil) {
+            return;
+        }
+        sessions[i].latency = latency;
+        sessions[i].lossRate = lossRate;
+        simulations[i] = [[[AKVersusTestSimulation alloc] init] autorelease];
+    }
+
+    // 入力を作成する
+    static struct AKVersusInput inputs[2][kAKVersusTestTickCount];
+    for (int i = 0; i < 2; i++) {
+        unsigned int seed = i + 1;
+        struct AKVersusInput input = {0, 0, 0};
+        for (uint32_t tick = 0; tick < kAKVersusTestTickCount; tick++) {
+            if (rand_r(&seed) % 8 == 0) {
+                input.tiltX = rand_r(&seed) % 2001 - 1000;
+                input.tiltY = rand_r(&seed) % 2001 - 1000;
+                input.buttons = (rand_r(&seed) % 2 ? kAKVersusButtonShot : 0);
+            }
+            inputs[i][tick] = input;
+        }
+    }
+
+    // 全ティックの入力が確定するまで進める
+    CFAbsoluteTime now = 0.0;
+    NSInteger frame = 0;
+    for (frame = 0; frame < kAKVersusTestFrameCount; frame++) {
+
+        now += kAKVersusTestFrameTime;
+
+        BOOL isFinished = YES;
+        for (int i = 0; i < 2; i++) {
+
+            AKVersusSession *session = sessions[i];
+            if (session.currentTick < kAKVersusTestTickCount) {
+                [session advance:simulations[i] localInput:inputs[i][session.currentTick] atTime:now];
+            }
+            else {
+                [session synchronize:simulations[i] atTime:now];
+                [session sendInputsAtTime:now];
+            }
+
+            if (session.currentTick < kAKVersusTestTickCount || session.remoteTick < kAKVersusTestTickCount) {
+                isFinished = NO;
+            }
+        }
+
+        if (isFinished) {
+            break;
+        }
+    }
+
+    // 最後の巻き戻しを反映する
+    for (int i = 0; i < 2; i++) {
+        [sessions[i] synchronize:simulations[i] atTime:now];
+    }
+
+    BOOL isMatched = ([simulations[0] stateHash] == [simulations[1] stateHash]);
+
+    for (int i = 0; i < 2; i++) {
+        AKVersusSession *session = sessions[i];
+        AKLog(1, @"versus player=%d latency=%.0fms loss=%.0f%% ticks=%u/%u frames=%d rollback=%d max=%d/%.3fms stall=%d desync=%d",
+              i, latency * 1000.0, lossRate * 100.0f,
+              session.currentTick, session.remoteTick, frame,
+              session.rollbackCount, session.maxRollbackTicks, session.maxRollbackTime * 1000.0,
+              session.stallCount, session.isDesynced);
+    }
+    AKLog(1, @"versus %@: hash=%08x/%08x",
+          (isMatched ? @"matched" : @"MISMATCH"), [simulations[0] stateHash], [simulations[1] stateHash]);
+}
+
+#endif
@@ -56,4 +56,9 @@
 /// Director
 @property (readonly) CCDirectorIOS *director;
 
+// 最初のフレームの処理
+- (void)didStartFirstFrame:(ccTime)dt;
+// 起動後に初期化するサービスの開始
+- (void)startDeferredServices;
+
 @end
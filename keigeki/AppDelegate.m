@@ -42,6 +42,18 @@
 #import "AKGameCenterHelper.h"
 #import "AKTwitterHelper.h"
 #import "AKInAppPurchaseHelper.h"
+#import "AKSaveStore.h"
+#import "AKFrameProfiler.h"
+#import "AKRenderRecorder.h"
+#import "AKCharacterPool.h"
+#import "AKKinematics.h"
+#import "AKMicroBenchmark.h"
+#import "AKVersusSession.h"
+#import "AKTextureManager.h"
+#import "AKFramePacer.h"
+#import "AKGameSnapshot.h"
+#import "AKStartupTrace.h"
+#import "AKTrace.h"
 
 /*!
  @brief Application controller
@@ -54,6 +66,9 @@
 
 - (BOOL)application:(UIApplication *)application didFinishLaunchingWithOptions:(NSDictionary *)launchOptions
 {
+    // 起動時間の計測を開始する
+    AKTraceMark("launch");
+    
 	// Create the main window
 	window_ = [[UIWindow alloc] initWithFrame:[[UIScreen mainScreen] bounds]];
 
@@ -66,6 +81,7 @@
 									sharegroup:nil
 								 multiSampling:NO
 							   numberOfSamples:0];
+    AKTraceMark("gl view");
 
 	director_ = (CCDirectorIOS*) [CCDirector sharedDirector];
 
@@ -108,6 +124,7 @@
 
 	// Assume that PVR images have premultiplied alpha
 	[CCTexture2D PVRImagesHavePremultipliedAlpha:YES];
+    AKTraceMark("director");
     
     // サウンド再生環境の初期化を行う
     // 他のアプリによるバックグラウンド再生を禁止する
@@ -116,13 +133,92 @@
     // BGMとSEの音量を下げる
     [SimpleAudioEngine sharedEngine].backgroundMusicVolume = 0.5f;
     [SimpleAudioEngine sharedEngine].effectsVolume = 0.2f;
+    AKTraceMark("audio");
     
-    // Twitterアカウントの認証ダイアログをアプリ起動時に表示するため、
-    // ここでTwitter管理クラスのインスタンスを生成する。
-    [AKTwitterHelper sharedHelper];
+    // セーブデータの読み込みをバックグラウンドで開始するため、
+    // ここでセーブデータ管理クラスのインスタンスを生成する。
+    [AKSaveStore sharedStore];
+    AKTraceMark("save store");
+    
+#if AK_PROFILE
+    // 起動引数"-AKFrameProfiler YES"が指定されている場合は処理時間計測を有効にする
+    [AKFrameProfiler setEnabled:[[NSUserDefaults standardUserDefaults] boolForKey:@"AKFrameProfiler"]];
+    
+    // 起動引数"-AKAllocBudget N"が指定されている場合は1フレームのメモリ確保回数の上限をNとして判定する
+    if ([[NSUserDefaults standardUserDefaults] objectForKey:@"AKAllocBudget"] != nil) {
+        [AKFrameProfiler setAllocationBudget:[[NSUserDefaults standardUserDefaults] integerForKey:@"AKAllocBudget"]];
+    }
+    
+    // 起動引数"-AKRenderRecorder YES"が指定されている場合は描画コマンドの見積もりを記録する
+    [AKRenderRecorder setEnabled:[[NSUserDefaults standardUserDefaults] boolForKey:@"AKRenderRecorder"]];
+#endif
+    
+#if AK_TRACE
+    // 起動引数"-AKTrace YES"が指定されている場合はイベントトレースを有効にする
+    AKTraceSetEnabled([[NSUserDefaults standardUserDefaults] boolForKey:@"AKTrace"]);
+#endif
+    
+#ifdef DEBUG
+    // 起動引数"-AKParallelUpdate NO"が指定されている場合はキャラクターの位置の計算を直列に行う
+    if ([[NSUserDefaults standardUserDefaults] objectForKey:@"AKParallelUpdate"]) {
+        [AKCharacterPool setParallelEnabled:[[NSUserDefaults standardUserDefaults] boolForKey:@"AKParallelUpdate"]];
+    }
+#endif
+    
+#if AK_PROFILE
+    // 起動引数"-AKKinematicsBenchmark YES"が指定されている場合は位置の一括計算とキャラクターごとの計算を比較する
+    if ([[NSUserDefaults standardUserDefaults] boolForKey:@"AKKinematicsBenchmark"]) {
+        AKKinematicsBenchmark();
+    }
+    
+    // 起動引数"-AKMicroBenchmark YES"が指定されている場合は基本処理の性能を計測する
+    // 基準値から性能が低下している場合は自動実行で検出できるように異常終了する
+    if ([[NSUserDefaults standardUserDefaults] boolForKey:@"AKMicroBenchmark"]) {
+        if (!AKMicroBenchmark()) {
+            exit(EXIT_FAILURE);
+        }
+    }
+    
+    // 起動引数"-AKSaveStoreCheck YES"が指定されている場合はセーブデータのジャーナルの障害時の整合性を確認する
+    // 確認に失敗した場合は自動実行で検出できるように異常終了する
+    if ([[NSUserDefaults standardUserDefaults] boolForKey:@"AKSaveStoreCheck"]) {
+        if (!AKSaveStoreJournalCheck()) {
+            exit(EXIT_FAILURE);
+        }
+    }
+    
+    // 起動引数"-AKVersusLoopback YES"が指定されている場合はループバックで対戦通信の同期を確認する
+    // 通信遅延と損失率は"-AKVersusLatency ミリ秒"、"-AKVersusLoss パーセント"で指定する
+    if ([[NSUserDefaults standardUserDefaults] boolForKey:@"AKVersusLoopback"]) {
+        AKVersusLoopbackTest();
+    }
+#endif
+
+    // 中断時のスナップショットがある場合はゲームプレイを復元する
+    CCScene *firstScene = nil;
+    AKGameSnapshot *snapshot = [AKGameSnapshot snapshotFromFile];
+    if (snapshot != nil) {
+        
+        AKGameScene *gameScene = [AKGameScene warmSceneWithMode:kAKGameModeNormal];
+        if ([gameScene restoreFromSnapshot:snapshot]) {
+            firstScene = gameScene;
+        }
+    }
+    
+    // 同じスナップショットから再度復元しないように削除する
+    [AKGameSnapshot removeFile];
+    
+    // 復元しない場合はタイトル画面から開始する
+    if (firstScene == nil) {
+        firstScene = [AKTitleScene node];
+    }
 
 	// and add the scene to the stack. The director will run it when it automatically when the view is displayed.
-	[director_ runWithScene:[AKTitleScene node]];
+	[director_ runWithScene:firstScene];
+    AKTraceMark("first scene");
+    
+    // 画面に変化がない間は描画間隔を長くする
+    [[AKFramePacer sharedPacer] start];
 	
 	// Create a Navigation Controller with the Director
 	navController_ = [[AKNavigationController alloc] initWithRootViewController:director_];
@@ -134,11 +230,61 @@
 	
 	// make main window visible
 	[window_ makeKeyAndVisible];
+    AKTraceMark("window");
+    
+    // Twitter、Game Center、課金、広告は最初のフレームの表示後に初期化する
+    [[director_ scheduler] scheduleSelector:@selector(didStartFirstFrame:)
+                                  forTarget:self
+                                   interval:0.0f
+                                     paused:NO];
+    
+	return YES;
+}
+
+/*!
+ @brief 最初のフレームの処理
+ 
+ 最初のフレームの更新処理で呼び出される。
+ 描画が終わった後に起動後のサービスの初期化を行うため、次のランループに処理を回す。
+ @param dt フレーム更新間隔
+ */
+- (void)didStartFirstFrame:(ccTime)dt
+{
+    // 一度だけ実行する
+    [[director_ scheduler] unscheduleSelector:@selector(didStartFirstFrame:) forTarget:self];
+    
+    [self performSelector:@selector(startDeferredServices) withObject:nil afterDelay:0.0];
+}
+
+/*!
+ @brief 起動後に初期化するサービスの開始
+ 
+ 最初のフレームの表示に必要ないサービスの初期化を行う。
+ Twitterアカウントの認証ダイアログ、Game Centerの認証、課金情報の読み込み、広告の読み込みは
+ 起動直後の描画を遅らせないようにここで行う。
+ */
+- (void)startDeferredServices
+{
+    AKTraceMark("first frame");
+    AKTraceReport("launch");
+    
+    // Twitterアカウントの認証を行うため、Twitter管理クラスのインスタンスを生成する
+    [AKTwitterHelper sharedHelper];
+    AKTraceMark("twitter");
     
     // Game Centerの認証を行う
     [[AKGameCenterHelper sharedHelper] authenticateLocalPlayer];
-        
-	return YES;
+    AKTraceMark("game center");
+    
+    // 課金情報の読み込みとペイメントキューへの登録を行う
+    [AKInAppPurchaseHelper sharedHelper];
+    AKTraceMark("in-app purchase");
+    
+    // 広告バナーの表示を開始する
+    [navController_ startAdBanner];
+    AKTraceMark("ad banner");
+    
+    AKTraceReport("deferred services");
 }
 
 // Supported orientations: Landscape. Customize it for your own needs
@@ -202,6 +348,40 @@
 		[director_ stopAnimation];
         
     }
+    
+    // 終了される可能性があるため、ジャーナルをスナップショットに書き出す
+    // 書き込み完了前にサスペンドされないようにバックグラウンドタスクとして実行する
+    __block UIBackgroundTaskIdentifier task = [application beginBackgroundTaskWithExpirationHandler:^{
+        AKLog(1, @"セーブデータの書き出しが時間内に終わらなかった");
+        [application endBackgroundTask:task];
+        task = UIBackgroundTaskInvalid;
+    }];
+    [[AKSaveStore sharedStore] compactWithCompletion:^{
+        if (task != UIBackgroundTaskInvalid) {
+            [application endBackgroundTask:task];
+            task = UIBackgroundTaskInvalid;
+        }
+    }];
+    
+    // ゲームプレイ中の場合は次回起動時に再開できるように状態を保存する
+    CCScene *scene = [[CCDirector sharedDirector] runningScene];
+    if ([scene isKindOfClass:[AKGameScene class]]) {
+        
+        AKGameScene *gameScene = (AKGameScene *)scene;
+        if ([gameScene isSnapshotAvailable]) {
+            [[gameScene snapshot] writeToFile];
+        }
+    }
+    
+    // 送信待ちの実績とスコアをまとめて送信する
+    [[AKGameCenterHelper sharedHelper] flush];
+    
+#if AK_PROFILE
+    // 描画コマンドの記録が有効な場合はシーンごとの集計を出力する
+    if (AKRenderRecorderEnabled) {
+        [AKRenderRecorder exportCSV];
+    }
+#endif
 }
 
 
@@ -209,18 +389,32 @@
 {
 	if( [navController_ visibleViewController] == director_ )
 		[director_ startAnimation];
+    
+    // 終了されずに復帰した場合は保存した状態は不要なため削除する
+    [AKGameSnapshot removeFile];
 }
 
 // application will be killed
 - (void)applicationWillTerminate:(UIApplication *)application
 {
+    // セーブデータの書き込み完了を待つ
+    [[AKSaveStore sharedStore] waitUntilWritten];
+    
 	CC_DIRECTOR_END();
 }
 
 // purge memory
 - (void)applicationDidReceiveMemoryWarning:(UIApplication *)application
 {
-	[[CCDirector sharedDirector] purgeCachedData];
+    // 現在のシーンで使用しないテクスチャを解放する。
+    // CCDirectorのpurgeCachedDataは現在のシーンのテクスチャも解放してしまうため使用しない。
+    [[AKTextureManager sharedManager] didReceiveMemoryWarning];
+    
+    // 実行中でなければ再利用するために保持しているゲームプレイシーンを解放する
+    [AKGameScene purgeWarmScene];
+    
+    // ファイルパスのキャッシュを解放する
+    [[CCFileUtils sharedFileUtils] purgeCachedEntries];
 }
 
 // next delta time will be zero